@@ -0,0 +1,345 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "batch.h"
+
+#include "chariohandler.h"
+#include "machine/machine.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+
+using namespace machine;
+
+using ae = machine::AccessEffects; // For enum values, type is obvious from
+                                   // context.
+
+// Limit of the job is checked after each batch of this size
+constexpr unsigned BATCH_RUN_CYCLES = 1u << 20;
+
+// ELF loader keeps global library state, machines are created one by one
+static QMutex machine_create_lock;
+
+class BatchRunner::Task : public QRunnable {
+public:
+    Task(BatchRunner *runner, const Job &job) : runner(runner), job(job) {}
+
+    void run() override { runner->write_result(runner->run_job(job)); }
+
+private:
+    BatchRunner *runner;
+    const Job &job;
+};
+
+static bool parse_address(const QJsonValue &value, uint64_t &out) {
+    bool ok = true;
+    if (value.isString()) {
+        out = value.toString().toULongLong(&ok, 0);
+    } else if (value.isDouble()) {
+        out = (uint64_t)value.toDouble();
+    } else {
+        ok = false;
+    }
+    return ok;
+}
+
+bool BatchRunner::load_manifest(const QString &path, QVector<Job> &jobs, QString &error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = "Cannot open batch manifest " + path;
+        return false;
+    }
+    QDir dir = QFileInfo(path).absoluteDir();
+    int line_num = 0;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        line_num++;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        QString where = QString("Manifest line %1: ").arg(line_num);
+        QJsonParseError parse_error {};
+        QJsonDocument doc = QJsonDocument::fromJson(line, &parse_error);
+        if (!doc.isObject()) {
+            error = where + parse_error.errorString();
+            return false;
+        }
+        QJsonObject obj = doc.object();
+        Job job {};
+        job.index = jobs.size();
+        job.elf = obj.value("elf").toString();
+        if (job.elf.isEmpty()) {
+            error = where + "missing elf";
+            return false;
+        }
+        job.elf = dir.filePath(job.elf);
+        job.name = obj.value("name").toString(QFileInfo(job.elf).fileName());
+        for (const QJsonValue &arg : obj.value("args").toArray()) {
+            job.args.append(arg.toString());
+        }
+        if (obj.contains("serial_in")) {
+            job.serial_in = dir.filePath(obj.value("serial_in").toString());
+        }
+        if (obj.contains("serial_out")) {
+            job.serial_out = dir.filePath(obj.value("serial_out").toString());
+        }
+        job.max_cycles = (unsigned)obj.value("max_cycles").toDouble(0);
+        for (const QJsonValue &val : obj.value("expect").toArray()) {
+            QJsonObject exp = val.toObject();
+            uint64_t start, len;
+            if (!parse_address(exp.value("start"), start)
+                || !parse_address(exp.value("length"), len)
+                || !exp.value("file").isString()) {
+                error = where + "expected dump needs start, length and file";
+                return false;
+            }
+            job.expect.append(
+                { Address(start), (size_t)len, dir.filePath(exp.value("file").toString()) });
+        }
+        jobs.append(job);
+    }
+    return true;
+}
+
+BatchRunner::BatchRunner(QVector<Job> jobs, int threads, QIODevice *report)
+    : jobs(std::move(jobs))
+    , threads(threads)
+    , report(report) {}
+
+int BatchRunner::run() {
+    QThreadPool pool;
+    if (threads > 0) {
+        pool.setMaxThreadCount(threads);
+    }
+    for (const Job &job : jobs) {
+        pool.start(new Task(this, job));
+    }
+    pool.waitForDone();
+    return failed;
+}
+
+void BatchRunner::write_result(const QJsonObject &result) {
+    QMutexLocker locker(&report_lock);
+    if (!result.value("passed").toBool()) {
+        failed++;
+    }
+    report->write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+    report->write("\n");
+}
+
+static QJsonObject cache_result(const Cache *cache) {
+    QJsonObject obj;
+    obj["hits"] = (qint64)cache->get_hit_count();
+    obj["misses"] = (qint64)cache->get_miss_count();
+    obj["memory_reads"] = (qint64)cache->get_read_count();
+    obj["memory_writes"] = (qint64)cache->get_write_count();
+    obj["stalled_cycles"] = (qint64)cache->get_stall_count();
+    obj["hit_rate"] = cache->get_hit_rate();
+    if (cache->get_config().prefetcher() != CacheConfig::PF_NONE) {
+        const CacheStatistics &st = cache->get_statistics();
+        obj["prefetches"] = (qint64)st.prefetches;
+        obj["prefetch_useful"] = (qint64)st.prefetch_useful;
+        obj["prefetch_late"] = (qint64)st.prefetch_late;
+        obj["prefetch_useless"] = (qint64)st.prefetch_useless;
+    }
+    return obj;
+}
+
+// Compares memory with dump written by --dump-range, returns description of
+// the first difference
+static QString compare_dump(Machine &machine, const BatchRunner::Dump &dump) {
+    std::ifstream in(dump.path.toLocal8Bit().data(), std::ios::in);
+    if (!in) {
+        return "cannot open " + dump.path;
+    }
+    const MemoryDataBus *mem = machine.memory_data_bus();
+    Address addr = dump.start & ~3;
+    Address end = dump.start + dump.len;
+    for (std::string line; addr < end && std::getline(in, line);) {
+        if (line.find_first_not_of(" \t\r\n") == std::string::npos) {
+            continue;
+        }
+        size_t idx;
+        uint32_t expected;
+        try {
+            expected = std::stoul(line, &idx, 0);
+        } catch (std::exception &) {
+            return "cannot parse " + dump.path;
+        }
+        uint32_t val = mem->read_u32(addr, ae::INTERNAL);
+        if (val != expected) {
+            return QString("0x%1 is 0x%2, expected 0x%3")
+                .arg(addr.get_raw(), 8, 16, QChar('0'))
+                .arg(val, 8, 16, QChar('0'))
+                .arg(expected, 8, 16, QChar('0'));
+        }
+        addr += 4;
+    }
+    if (addr < end) {
+        return dump.path + " is shorter than the range";
+    }
+    return {};
+}
+
+QJsonObject BatchRunner::run_job(const Job &job) const {
+    QJsonObject result;
+    result["index"] = job.index;
+    result["name"] = job.name;
+    QElapsedTimer timer;
+    timer.start();
+
+    QString status;
+    QString message;
+    bool passed = false;
+    try {
+        // Instruction cache statistics are reported, every fetch has to go
+        // through the cache as with --dump-cache-stats
+        MachineConfig config(job.config);
+        config.set_fetch_simulated(true);
+        std::unique_ptr<Machine> machine;
+        {
+            QMutexLocker locker(&machine_create_lock);
+            machine.reset(new Machine(config, true, true));
+        }
+        QObject::connect(
+            machine.get(), &Machine::program_trap,
+            [&message](SimulatorException &e) { message = e.msg(false); });
+
+        SerialPort *ser_port = machine->serial_port();
+        if (!job.serial_in.isEmpty()) {
+            auto *ser_in = new CharIOHandler(new QFile(job.serial_in), ser_port);
+            if (!ser_in->open(QFile::ReadOnly)) {
+                throw SIMULATOR_EXCEPTION(Input, "Cannot open serial input", job.serial_in);
+            }
+            QObject::connect(
+                ser_port, &SerialPort::rx_byte_pool, ser_in, &CharIOHandler::readBytePoll);
+            ser_port->rx_queue_check();
+        }
+        if (!job.serial_out.isEmpty()) {
+            auto *ser_out = new CharIOHandler(new QFile(job.serial_out), ser_port);
+            if (!ser_out->open(QFile::WriteOnly)) {
+                throw SIMULATOR_EXCEPTION(Input, "Cannot open serial output", job.serial_out);
+            }
+            QObject::connect(
+                ser_port, &SerialPort::tx_byte, ser_out,
+                QOverload<unsigned>::of(&CharIOHandler::writeByte));
+        }
+
+        uint64_t cycles = 0;
+        bool stopped = false;
+        while (!machine->exited() && !stopped) {
+            unsigned batch = BATCH_RUN_CYCLES;
+            if (job.max_cycles != 0) {
+                if (cycles >= job.max_cycles) {
+                    break;
+                }
+                batch = std::min<uint64_t>(batch, job.max_cycles - cycles);
+            }
+            unsigned executed = machine->run(batch);
+            cycles += executed;
+            stopped = executed < batch;
+        }
+
+        if (machine->status() == Machine::ST_EXIT) {
+            status = "exit";
+        } else if (machine->status() == Machine::ST_TRAPPED) {
+            status = "trap";
+        } else if (stopped) {
+            status = "stop";
+            result["exception_cause"] = (int)machine->get_exception_cause();
+        } else {
+            status = "timeout";
+        }
+        passed = status == "exit";
+
+        result["cycles"] = (qint64)machine->core()->get_cycle_count();
+        result["stalls"] = (qint64)machine->core()->get_stall_count();
+        QJsonObject caches;
+        caches["i-cache"] = cache_result(machine->cache_program());
+        caches["d-cache"] = cache_result(machine->cache_data());
+        result["caches"] = caches;
+        if (machine->core_count() > 1) {
+            QJsonArray cores;
+            for (unsigned i = 0; i < machine->core_count(); i++) {
+                QJsonObject core;
+                core["cycles"] = (qint64)machine->core(i)->get_cycle_count();
+                core["stalls"] = (qint64)machine->core(i)->get_stall_count();
+                core["d-cache"] = cache_result(machine->cache_data(i));
+                cores.append(core);
+            }
+            result["cores"] = cores;
+        }
+
+        QJsonArray dumps;
+        for (const Dump &dump : job.expect) {
+            QString mismatch = compare_dump(*machine, dump);
+            QJsonObject obj;
+            obj["file"] = dump.path;
+            obj["match"] = mismatch.isEmpty();
+            if (!mismatch.isEmpty()) {
+                obj["mismatch"] = mismatch;
+                passed = false;
+            }
+            dumps.append(obj);
+        }
+        if (!dumps.isEmpty()) {
+            result["expect"] = dumps;
+        }
+    } catch (SimulatorException &e) {
+        status = "error";
+        message = e.msg(false);
+        passed = false;
+    }
+
+    result["status"] = status;
+    if (!message.isEmpty()) {
+        result["message"] = message;
+    }
+    result["passed"] = passed;
+    result["host_ms"] = (qint64)timer.elapsed();
+    return result;
+}
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "machine/machineconfig.h"
+#include "machine/memory/address.h"
+
+#include <QIODevice>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Runs many independent simulations on a thread pool, each job with its own
+ * Machine. Jobs are read from a manifest with one JSON object per line:
+ *
+ *   {"name": "s01", "elf": "prog.elf", "args": ["--pipelined"],
+ *    "serial_in": "in.txt", "serial_out": "out.txt", "max_cycles": 1000000,
+ *    "expect": [{"start": "0x400", "length": 64, "file": "dump.txt"}]}
+ *
+ * Only "elf" is required. "args" are machine configuration options (core,
+ * caches, memory timing) in the command line syntax, other options are
+ * rejected. Relative paths are resolved against the manifest directory.
+ * Expected dumps use the format written by --dump-range. Empty lines and
+ * lines starting with '#' are skipped.
+ *
+ * Result of each job is written as one JSON object per line in the order
+ * the jobs finish.
+ */
+class BatchRunner {
+public:
+    struct Dump {
+        machine::Address start;
+        size_t len;
+        QString path;
+    };
+    struct Job {
+        int index;
+        QString name;
+        QString elf;
+        QStringList args;
+        machine::MachineConfig config; // Built from elf and args
+        QString serial_in;
+        QString serial_out;
+        QVector<Dump> expect;
+        unsigned max_cycles; // Zero for unlimited run
+    };
+
+    /**
+     * Parses the manifest. Returns false and describes the problem in
+     * `error` when it is not valid.
+     */
+    static bool load_manifest(const QString &path, QVector<Job> &jobs, QString &error);
+
+    BatchRunner(QVector<Job> jobs, int threads, QIODevice *report);
+
+    // Runs all jobs and returns number of jobs which did not pass
+    int run();
+
+private:
+    class Task;
+
+    QVector<Job> jobs;
+    int threads;
+    QIODevice *report;
+    QMutex report_lock;
+    int failed = 0;
+
+    QJsonObject run_job(const Job &job) const;
+    void write_result(const QJsonObject &result);
+};
+
+#endif // BATCH_H
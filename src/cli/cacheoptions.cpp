@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "cacheoptions.h"
+
+#include <iostream>
+
+using namespace machine;
+
+void configure_cache(
+    CacheConfig &cacheconf,
+    const QStringList &cachearg,
+    const QString &which) {
+    if (cachearg.empty()) {
+        return;
+    }
+    cacheconf.set_enabled(true);
+    QStringList pieces = cachearg.at(cachearg.size() - 1).split(",");
+    if (pieces.size() < 3) {
+        std::cerr << "Parameters for " << which.toLocal8Bit().data()
+                  << " cache incorrect (correct lru,4,2,2,wb)." << std::endl;
+        exit(1);
+    }
+    if (pieces.at(0).size() < 1) {
+        std::cerr << "Policy for " << which.toLocal8Bit().data()
+                  << " cache is incorrect." << std::endl;
+        exit(1);
+    }
+    if (!pieces.at(0).at(0).isDigit()) {
+        if (pieces.at(0).toLower() == "random") {
+            cacheconf.set_replacement_policy(CacheConfig::RP_RAND);
+        } else if (pieces.at(0).toLower() == "lru") {
+            cacheconf.set_replacement_policy(CacheConfig::RP_LRU);
+        } else if (pieces.at(0).toLower() == "lfu") {
+            cacheconf.set_replacement_policy(CacheConfig::RP_LFU);
+        } else if (pieces.at(0).toLower() == "plru") {
+            cacheconf.set_replacement_policy(CacheConfig::RP_PLRU);
+        } else if (pieces.at(0).toLower() == "nru") {
+            cacheconf.set_replacement_policy(CacheConfig::RP_NRU);
+        } else if (pieces.at(0).toLower() == "srrip") {
+            cacheconf.set_replacement_policy(CacheConfig::RP_SRRIP);
+        } else {
+            std::cerr << "Policy for " << which.toLocal8Bit().data()
+                      << " cache is incorrect." << std::endl;
+            exit(1);
+        }
+        pieces.removeFirst();
+    }
+    if (pieces.size() < 3) {
+        std::cerr << "Parameters for " << which.toLocal8Bit().data()
+                  << " cache incorrect (correct lru,4,2,2,wb)." << std::endl;
+        exit(1);
+    }
+    cacheconf.set_set_count(pieces.at(0).toLong());
+    cacheconf.set_block_size(pieces.at(1).toLong());
+    cacheconf.set_associativity(pieces.at(2).toLong());
+    if (cacheconf.set_count() == 0 || cacheconf.block_size() == 0
+        || cacheconf.associativity() == 0) {
+        std::cerr << "Parameters for " << which.toLocal8Bit().data()
+                  << " cache cannot have zero component." << std::endl;
+        exit(1);
+    }
+    if (pieces.size() > 3) {
+        if (pieces.at(3).toLower() == "wb") {
+            cacheconf.set_write_policy(CacheConfig::WP_BACK);
+        } else if (
+            pieces.at(3).toLower() == "wt"
+            || pieces.at(3).toLower() == "wtna") {
+            cacheconf.set_write_policy(CacheConfig::WP_THROUGH_NOALLOC);
+        } else if (pieces.at(3).toLower() == "wta") {
+            cacheconf.set_write_policy(CacheConfig::WP_THROUGH_ALLOC);
+        } else {
+            std::cerr << "Write policy for " << which.toLocal8Bit().data()
+                      << " cache is incorrect (correct wb/wt/wtna/wta)."
+                      << std::endl;
+            exit(1);
+        }
+    }
+}
+
+void configure_cache_level(
+    CacheConfig &cacheconf,
+    const QStringList &cachearg,
+    const QStringList &latencyarg,
+    const QStringList &inclusionarg,
+    const QString &which) {
+    configure_cache(cacheconf, cachearg, which);
+    if (!latencyarg.empty()) {
+        bool ok;
+        unsigned latency = latencyarg.last().toUInt(&ok);
+        if (!ok || latency == 0) {
+            std::cerr << "Hit time for " << which.toLocal8Bit().data()
+                      << " cache is incorrect." << std::endl;
+            exit(1);
+        }
+        cacheconf.set_hit_latency(latency);
+    }
+    if (!inclusionarg.empty()) {
+        QString inclusion = inclusionarg.last().toLower();
+        if (inclusion == "nine") {
+            cacheconf.set_inclusion_policy(CacheConfig::IP_NINE);
+        } else if (inclusion == "inclusive") {
+            cacheconf.set_inclusion_policy(CacheConfig::IP_INCLUSIVE);
+        } else if (inclusion == "exclusive") {
+            cacheconf.set_inclusion_policy(CacheConfig::IP_EXCLUSIVE);
+        } else {
+            std::cerr << "Inclusion policy for " << which.toLocal8Bit().data()
+                      << " cache is incorrect (correct "
+                         "nine/inclusive/exclusive)."
+                      << std::endl;
+            exit(1);
+        }
+    }
+}
+
+void configure_cache_prefetcher(
+    CacheConfig &cacheconf,
+    const QStringList &prefetcharg,
+    const QString &which) {
+    if (prefetcharg.empty()) {
+        return;
+    }
+    QStringList pieces = prefetcharg.last().split(",");
+    QString kind = pieces.at(0).toLower();
+    if (kind == "none") {
+        cacheconf.set_prefetcher(CacheConfig::PF_NONE);
+    } else if (kind == "next-line") {
+        cacheconf.set_prefetcher(CacheConfig::PF_NEXT_LINE);
+    } else if (kind == "stride") {
+        cacheconf.set_prefetcher(CacheConfig::PF_STRIDE);
+    } else if (kind == "stream") {
+        cacheconf.set_prefetcher(CacheConfig::PF_STREAM);
+    } else {
+        std::cerr << "Prefetcher for " << which.toLocal8Bit().data()
+                  << " cache is incorrect (correct "
+                     "none/next-line/stride/stream)."
+                  << std::endl;
+        exit(1);
+    }
+    bool ok = true;
+    if (pieces.size() > 1) {
+        unsigned degree = pieces.at(1).toUInt(&ok);
+        ok = ok && degree > 0;
+        cacheconf.set_prefetch_degree(degree);
+    }
+    if (ok && pieces.size() > 2) {
+        unsigned table = pieces.at(2).toUInt(&ok);
+        ok = ok && table > 0;
+        cacheconf.set_prefetch_table_size(table);
+    }
+    if (!ok || pieces.size() > 3) {
+        std::cerr << "Parameters for " << which.toLocal8Bit().data()
+                  << " cache prefetcher incorrect (correct stride,2,16)."
+                  << std::endl;
+        exit(1);
+    }
+}
+
+std::vector<CacheConfig>
+expand_cache_sweep(const QStringList &sweepargs, const QString &which) {
+    std::vector<CacheConfig> configs;
+    foreach (QString sweeparg, sweepargs) {
+        QStringList combinations { "" };
+        foreach (QString field, sweeparg.split(",")) {
+            QStringList expanded;
+            foreach (QString prefix, combinations) {
+                foreach (QString alternative, field.split(":")) {
+                    expanded.append(
+                        prefix.isEmpty() ? alternative
+                                         : prefix + "," + alternative);
+                }
+            }
+            combinations = expanded;
+        }
+        foreach (QString combination, combinations) {
+            CacheConfig config;
+            configure_cache(config, { combination }, which);
+            configs.push_back(config);
+        }
+    }
+    return configs;
+}
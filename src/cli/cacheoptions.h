@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef CACHEOPTIONS_H
+#define CACHEOPTIONS_H
+
+#include "machine/machineconfig.h"
+
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+/**
+ * Configures cache from the last of command line values in format
+ * [policy,]sets,block,associativity[,write policy]. Nothing is changed when
+ * no value is given. Program exits on invalid value.
+ */
+void configure_cache(
+    machine::CacheConfig &cacheconf,
+    const QStringList &cachearg,
+    const QString &which);
+/**
+ * Configures lower level cache, hit latency and inclusion policy [nine|
+ * inclusive|exclusive] are taken from their own options.
+ */
+void configure_cache_level(
+    machine::CacheConfig &cacheconf,
+    const QStringList &cachearg,
+    const QStringList &latencyarg,
+    const QStringList &inclusionarg,
+    const QString &which);
+/**
+ * Configures cache prefetcher from the last of command line values in format
+ * kind[,degree[,table]] where kind is none/next-line/stride/stream. Degree is
+ * the number of blocks requested ahead (stream buffer depth), table is the
+ * number of stride table entries or stream buffers.
+ */
+void configure_cache_prefetcher(
+    machine::CacheConfig &cacheconf,
+    const QStringList &prefetcharg,
+    const QString &which);
+/**
+ * Expands sweep values, every field can list alternatives separated by ':'
+ * and all their combinations are returned.
+ */
+std::vector<machine::CacheConfig>
+expand_cache_sweep(const QStringList &sweepargs, const QString &which);
+
+#endif // CACHEOPTIONS_H
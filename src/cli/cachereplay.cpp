@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+/**
+ * Replays recorded memory references through the caches without simulating
+ * the core. References are read from binary trace (see `TraceWriter`, fetches
+ * go to the program cache, memory accesses to the data cache) or from text
+ * file with one reference per line: `[TYPE] ADDRESS [SIZE]`. Type is r, w or
+ * i (or Dinero 0, 1 and 2), address is hexadecimal and size defaults to four
+ * bytes.
+ */
+
+#include "cacheoptions.h"
+#include "machine/machineconfig.h"
+#include "machine/memory/backend/memory.h"
+#include "machine/memory/cache/cache.h"
+#include "machine/memory/memory_bus.h"
+#include "machine/trace/trace_reader.h"
+#include "reporter.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace machine;
+using namespace std;
+
+using ae = machine::AccessEffects; // For enum values, type is obvious from
+                                   // context.
+
+constexpr unsigned MAX_REFERENCE_SIZE = 64;
+
+void create_parser(QCommandLineParser &p) {
+    p.setApplicationDescription(
+        "QtMips cache simulator driven by recorded memory references");
+    p.addHelpOption();
+    p.addVersionOption();
+
+    p.addPositionalArgument(
+        "FILE", "Binary trace (see cli --trace-file) or text reference list.");
+    p.addOption(
+        { "d-cache",
+          "Data cache configuration in format <policy>,<sets>,<words_in_blocks>,"
+          "<associativity>,<write_policy>.",
+          "DCACHE" });
+    p.addOption(
+        { "i-cache",
+          "Instruction cache configuration in format <policy>,<sets>,"
+          "<words_in_blocks>,<associativity>.",
+          "ICACHE" });
+    p.addOption(
+        { "d-cache-prefetch",
+          "Data cache prefetcher in format <kind>,<degree>,<table>, stride "
+          "prefetcher sees all references as made by a single instruction.",
+          "PREFETCH" });
+    p.addOption(
+        { "i-cache-prefetch",
+          "Instruction cache prefetcher, see d-cache-prefetch.",
+          "PREFETCH" });
+    p.addOption({ "read-time", "Memory read access time (cycles).", "RTIME" });
+    p.addOption({ "write-time", "Memory write access time (cycles).", "WTIME" });
+    p.addOption({ "burst-time", "Memory burst access time (cycles).", "BTIME" });
+}
+
+void configure_caches(QCommandLineParser &p, MachineConfig &cc) {
+    if (p.positionalArguments().size() != 1) {
+        std::cerr << "Single reference file has to be specified" << std::endl;
+        exit(1);
+    }
+    if (p.isSet("read-time")) {
+        cc.set_memory_access_time_read(p.values("read-time").last().toLong());
+    }
+    if (p.isSet("write-time")) {
+        cc.set_memory_access_time_write(p.values("write-time").last().toLong());
+    }
+    if (p.isSet("burst-time")) {
+        cc.set_memory_access_time_burst(p.values("burst-time").last().toLong());
+    }
+    configure_cache(*cc.access_cache_data(), p.values("d-cache"), "data");
+    configure_cache(
+        *cc.access_cache_program(), p.values("i-cache"), "instruction");
+    configure_cache_prefetcher(
+        *cc.access_cache_data(), p.values("d-cache-prefetch"), "data");
+    configure_cache_prefetcher(
+        *cc.access_cache_program(), p.values("i-cache-prefetch"),
+        "instruction");
+}
+
+static void replay_access(Cache &cache, uint32_t address, unsigned size, bool write) {
+    static byte buffer[MAX_REFERENCE_SIZE] {};
+    if (write) {
+        cache.write(Address(address), buffer, size, { .type = ae::REGULAR });
+    } else {
+        cache.read(buffer, Address(address), size, { .type = ae::REGULAR });
+    }
+}
+
+static bool
+replay_binary(istream &in, Cache &cch_program, Cache &cch_data, string &error) {
+    TraceReader reader(in);
+    if (!reader.open()) {
+        error = reader.get_error();
+        return false;
+    }
+    TraceRecord rec;
+    while (reader.next(rec)) {
+        if (rec.type == TraceRecord::FETCH && (rec.flags & TraceRecord::VALID)) {
+            replay_access(cch_program, rec.address, 4, false);
+        } else if (rec.type == TraceRecord::MEM) {
+            replay_access(cch_data, rec.address, rec.size, rec.flags & TraceRecord::WRITE);
+        }
+    }
+    error = reader.get_error();
+    return error.empty();
+}
+
+static bool
+replay_text(istream &in, Cache &cch_program, Cache &cch_data, string &error) {
+    string line;
+    for (unsigned line_num = 1; getline(in, line); line_num++) {
+        line = line.substr(0, line.find('#'));
+        istringstream fields(line);
+        string type, address;
+        if (!(fields >> type)) {
+            continue; // Empty line or comment
+        }
+        if (!(fields >> address)) {
+            address = type;
+            type = "r";
+        }
+        unsigned long size = 4;
+        fields >> size;
+        size_t parsed = 0;
+        unsigned long value = 0;
+        try {
+            value = stoul(address, &parsed, 16);
+        } catch (const logic_error &) { parsed = 0; }
+        if (parsed != address.size() || value > 0xffffffff || size == 0
+            || size > MAX_REFERENCE_SIZE || !fields.eof()) {
+            error = "invalid reference on line " + to_string(line_num);
+            return false;
+        }
+        if (type == "r" || type == "R" || type == "0") {
+            replay_access(cch_data, value, size, false);
+        } else if (type == "w" || type == "W" || type == "1") {
+            replay_access(cch_data, value, size, true);
+        } else if (type == "i" || type == "I" || type == "2") {
+            replay_access(cch_program, value, size, false);
+        } else {
+            error = "unknown reference type on line " + to_string(line_num);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("cache_replay");
+    QCoreApplication::setApplicationVersion("0.8.1");
+
+    QCommandLineParser p;
+    create_parser(p);
+    p.process(app);
+
+    MachineConfig cc;
+    configure_caches(p, cc);
+
+    QString path = p.positionalArguments().at(0);
+    ifstream in(path.toLocal8Bit().constData(), ios::binary);
+    if (!in) {
+        cerr << "Cannot open reference file: " << path.toStdString() << endl;
+        return 1;
+    }
+
+    Memory memory(BIG);
+    TrivialBus bus(&memory);
+    Cache cch_program(
+        &bus, &cc.cache_program(), cc.memory_access_time_read(),
+        cc.memory_access_time_write(), cc.memory_access_time_burst());
+    Cache cch_data(
+        &bus, &cc.cache_data(), cc.memory_access_time_read(),
+        cc.memory_access_time_write(), cc.memory_access_time_burst());
+
+    char magic[sizeof(TRACE_MAGIC)] {};
+    in.read(magic, sizeof(magic));
+    bool binary = in.gcount() == sizeof(magic)
+                  && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+    in.clear();
+    in.seekg(0);
+
+    string error;
+    bool ok = binary ? replay_binary(in, cch_program, cch_data, error)
+                     : replay_text(in, cch_program, cch_data, error);
+    if (!ok) {
+        cerr << "Cannot replay " << path.toStdString() << ": " << error << endl;
+        return 1;
+    }
+    Reporter::report_cache("i-cache", &cch_program, false);
+    Reporter::report_cache("d-cache", &cch_data, true);
+    return 0;
+}
@@ -34,9 +34,12 @@
  ******************************************************************************/
 
 #include "assembler/simpleasm.h"
+#include "batch.h"
+#include "cacheoptions.h"
 #include "chariohandler.h"
 #include "common/logging.h"
 #include "common/logging_format_colors.h"
+#include "machine/jit/jit.h"
 #include "machine/machineconfig.h"
 #include "msgreport.h"
 #include "reporter.h"
@@ -49,7 +52,9 @@
 #include <cctype>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <utility>
+#include <vector>
 
 using namespace machine;
 using namespace std;
@@ -63,15 +68,50 @@ void create_parser(QCommandLineParser &p) {
     p.addVersionOption();
 
     p.addPositionalArgument(
-        "FILE", "Input ELF executable file or assembler source");
+        "FILE",
+        "Input ELF executable file or assembler source (optional when "
+        "checkpoint is loaded)");
 
     // p.addOptions({}); available only from Qt 5.4+
     p.addOption({ "asm", "Treat provided file argument as assembler source." });
     p.addOption({ "pipelined", "Configure CPU to use five stage pipeline." });
     p.addOption({ "no-delay-slot", "Disable jump delay slot." });
+    p.addOption(
+        { "jit",
+          "Translate hot code to host instructions (only for not pipelined "
+          "core, ignored when tracing stages, PC or registers, not available "
+          "with instruction cache statistics or sweep)." });
+    p.addOption(
+        { "cores",
+          "Number of cores sharing the memory. Data caches of the cores are "
+          "kept coherent by MESI protocol. The program ends when core 0 "
+          "reaches its end.",
+          "N" });
+    p.addOption(
+        { "smp-quantum",
+          "Cycles run by a core before the next core takes turn (default 1).",
+          "CYCLES" });
     p.addOption({ "hazard-unit",
                   "Specify hazard unit imeplementation [none|stall|forward].",
                   "HUKIND" });
+    p.addOption(
+        { "dual-issue",
+          "Pipelined core issues up to two instructions per cycle, the "
+          "second one has to be simple ALU instruction." });
+    p.addOption(
+        { "branch-predictor",
+          "Branch predictor of pipelined core "
+          "[none|not-taken|taken|btfn|1bit|2bit|gshare], optionally followed by "
+          "log2 of counter table size, BTB entries, RAS depth and misprediction "
+          "penalty in cycles (default 10,64,8,2).",
+          "KIND[,BITS,BTB,RAS,PENALTY]" });
+    p.addOption(
+        { "out-of-order",
+          "Use out-of-order core of given issue width, optionally followed "
+          "by entries of reorder buffer, reservation stations and load/store "
+          "queue and by latencies of multiplier and divider (default "
+          "2,32,16,8,4,20).",
+          "WIDTH[,ROB,RS,LSQ,MUL,DIV]" });
     p.addOption(
         { { "trace-fetch", "tr-fetch" },
           "Trace fetched instruction (for both pipelined and not core)." });
@@ -95,14 +135,72 @@ void create_parser(QCommandLineParser &p) {
                   "REG" });
     p.addOption({ { "trace-lo", "tr-lo" }, "Print LO register changes." });
     p.addOption({ { "trace-hi", "tr-hi" }, "Print HI register changes." });
+    p.addOption(
+        { { "trace-access", "tr-access" },
+          "Print data memory accesses (only when converting binary trace)." });
+    p.addOption(
+        { { "trace-cache", "tr-cache" },
+          "Print cache hits and misses (only when converting binary trace)." });
+    p.addOption(
+        { "trace-file",
+          "Write binary trace of core 0 (stages, registers, memory accesses "
+          "and cache hits and misses) to the file.",
+          "FNAME" });
+    p.addOption(
+        { "trace-to-text",
+          "Print binary trace file using the text format of trace options and "
+          "exit. Trace options select printed records, all are printed when "
+          "none is given.",
+          "FNAME" });
     p.addOption({ { "dump-registers", "d-regs" },
                   "Dump registers state at program exit." });
     p.addOption(
         { "dump-cache-stats", "Dump cache statistics at program exit." });
+    p.addOption(
+        { "profile",
+          "Print flat profile of core 0 (cycles, stalls, instructions and "
+          "cache misses by function) at program exit." });
+    p.addOption(
+        { "callgrind",
+          "Profile calls of core 0 and write callgrind format profile (for "
+          "KCachegrind) to the file at program exit.",
+          "FNAME" });
     p.addOption(
         { "dump-cycles", "Dump number of CPU cycles till program end." });
+    p.addOption(
+        { "dump-branch-stats",
+          "Dump branch predictor accuracy, lost cycles and statistics of "
+          "branch instructions at program exit." });
+    p.addOption(
+        { "dump-issue-stats",
+          "Dump dual-issue rate and reasons of single issue of pipelined "
+          "core at program exit." });
+    p.addOption(
+        { "dump-ooo-stats",
+          "Dump occupancy of out-of-order core structures, issued "
+          "instructions by functional units and stall reasons at program "
+          "exit." });
     p.addOption({ "dump-range", "Dump memory range.", "START,LENGTH,FNAME" });
     p.addOption({ "load-range", "Load memory range.", "START,FNAME" });
+    p.addOption(
+        { "checkpoint-load",
+          "Restore machine state from checkpoint before the run. Core and "
+          "cache options have to match the ones used when it was saved.",
+          "FNAME" });
+    p.addOption(
+        { "checkpoint-save",
+          "Save machine state to checkpoint when the simulation stops.",
+          "FNAME" });
+    p.addOption(
+        { "checkpoint-at",
+          "Stop the simulation when PC reaches this address (use with "
+          "checkpoint-save).",
+          "ADDR" });
+    p.addOption(
+        { "watch",
+          "Stop the simulation after an access to the memory range. MODE is "
+          "r (read), w (write, default) or rw (any access).",
+          "START,LENGTH[,MODE]" });
     p.addOption(
         { "expect-fail",
           "Expect that program causes CPU trap and fail if it doesn't." });
@@ -116,16 +214,89 @@ void create_parser(QCommandLineParser &p) {
     p.addOption(
         { "d-cache",
           "Data cache. Format policy,sets,words_in_blocks,associativity where "
-          "policy is random/lru/lfu",
+          "policy is random/lru/lfu/plru/nru/srrip",
           "DCACHE" });
     p.addOption(
         { "i-cache",
           "Instruction cache. Format policy,sets,words_in_blocks,associativity "
-          "where policy is random/lru/lfu",
+          "where policy is random/lru/lfu/plru/nru/srrip",
           "ICACHE" });
+    p.addOption(
+        { "d-cache-prefetch",
+          "Data cache prefetcher. Format kind[,degree[,table]] where kind is "
+          "none/next-line/stride/stream, degree is the number of blocks "
+          "fetched ahead and table the size of stride table or the number of "
+          "stream buffers.",
+          "PREFETCH" });
+    p.addOption(
+        { "i-cache-prefetch",
+          "Instruction cache prefetcher, see d-cache-prefetch.",
+          "PREFETCH" });
+    p.addOption(
+        { "l2-cache",
+          "Unified second level cache shared by instruction and data caches "
+          "of all cores. Format is the same as for d-cache.",
+          "L2CACHE" });
+    p.addOption(
+        { "l2-hit-time",
+          "Cycles to deliver a word from the second level cache.",
+          "CYCLES" });
+    p.addOption(
+        { "l2-inclusion",
+          "Relation of the second level cache to the first level "
+          "[nine|inclusive|exclusive].",
+          "POLICY" });
+    p.addOption(
+        { "l2-prefetch",
+          "Second level cache prefetcher, see d-cache-prefetch.",
+          "PREFETCH" });
+    p.addOption(
+        { "l3-cache",
+          "Unified third level cache below the second level one, see l2-cache.",
+          "L3CACHE" });
+    p.addOption(
+        { "l3-hit-time",
+          "Cycles to deliver a word from the third level cache.",
+          "CYCLES" });
+    p.addOption(
+        { "l3-inclusion",
+          "Relation of the third level cache to the second level one "
+          "[nine|inclusive|exclusive].",
+          "POLICY" });
+    p.addOption(
+        { "l3-prefetch",
+          "Third level cache prefetcher, see d-cache-prefetch.",
+          "PREFETCH" });
+    p.addOption(
+        { "d-cache-sweep",
+          "Evaluate data cache configurations on references recorded during "
+          "the run and print their statistics at program exit. Format is the "
+          "same as for d-cache, any field may list alternatives separated by "
+          "colon (lru:lfu,1:2:4,2,1:2:4,wb), all combinations are evaluated. "
+          "Miss rate of each policy is compared to LRU of the same cache.",
+          "CONFIGS" });
+    p.addOption(
+        { "i-cache-sweep",
+          "Evaluate instruction cache configurations, see d-cache-sweep.",
+          "CONFIGS" });
     p.addOption({ "read-time", "Memory read access time (cycles).", "RTIME" });
     p.addOption({ "write-time", "Memory read access time (cycles).", "WTIME" });
     p.addOption({ "burst-time", "Memory read access time (cycles).", "BTIME" });
+    p.addOption(
+        { "batch",
+          "Run jobs listed in the manifest (one JSON object per line) in "
+          "parallel, FILE argument is not used then. Jobs accept machine "
+          "configuration options only. Exit status is nonzero when a job "
+          "fails.",
+          "MANIFEST" });
+    p.addOption(
+        { "batch-threads",
+          "Number of jobs run at once (default is number of CPU threads).",
+          "N" });
+    p.addOption(
+        { "batch-report",
+          "Write the job results to the file instead of standard output.",
+          "FNAME" });
     p.addOption({ { "serial-in", "serin" },
                   "File connected to the serial port input.",
                   "FNAME" });
@@ -134,79 +305,16 @@ void create_parser(QCommandLineParser &p) {
                   "FNAME" });
 }
 
-void configure_cache(
-    CacheConfig &cacheconf,
-    const QStringList &cachearg,
-    const QString &which) {
-    if (cachearg.empty()) {
-        return;
-    }
-    cacheconf.set_enabled(true);
-    QStringList pieces = cachearg.at(cachearg.size() - 1).split(",");
-    if (pieces.size() < 3) {
-        std::cerr << "Parameters for " << which.toLocal8Bit().data()
-                  << " cache incorrect (correct lru,4,2,2,wb)." << std::endl;
-        exit(1);
-    }
-    if (pieces.at(0).size() < 1) {
-        std::cerr << "Policy for " << which.toLocal8Bit().data()
-                  << " cache is incorrect." << std::endl;
-        exit(1);
-    }
-    if (!pieces.at(0).at(0).isDigit()) {
-        if (pieces.at(0).toLower() == "random") {
-            cacheconf.set_replacement_policy(CacheConfig::RP_RAND);
-        } else if (pieces.at(0).toLower() == "lru") {
-            cacheconf.set_replacement_policy(CacheConfig::RP_LRU);
-        } else if (pieces.at(0).toLower() == "lfu") {
-            cacheconf.set_replacement_policy(CacheConfig::RP_LFU);
-        } else {
-            std::cerr << "Policy for " << which.toLocal8Bit().data()
-                      << " cache is incorrect." << std::endl;
-            exit(1);
-        }
-        pieces.removeFirst();
-    }
-    if (pieces.size() < 3) {
-        std::cerr << "Parameters for " << which.toLocal8Bit().data()
-                  << " cache incorrect (correct lru,4,2,2,wb)." << std::endl;
-        exit(1);
-    }
-    cacheconf.set_set_count(pieces.at(0).toLong());
-    cacheconf.set_block_size(pieces.at(1).toLong());
-    cacheconf.set_associativity(pieces.at(2).toLong());
-    if (cacheconf.set_count() == 0 || cacheconf.block_size() == 0
-        || cacheconf.associativity() == 0) {
-        std::cerr << "Parameters for " << which.toLocal8Bit().data()
-                  << " cache cannot have zero component." << std::endl;
-        exit(1);
-    }
-    if (pieces.size() > 3) {
-        if (pieces.at(3).toLower() == "wb") {
-            cacheconf.set_write_policy(CacheConfig::WP_BACK);
-        } else if (
-            pieces.at(3).toLower() == "wt"
-            || pieces.at(3).toLower() == "wtna") {
-            cacheconf.set_write_policy(CacheConfig::WP_THROUGH_NOALLOC);
-        } else if (pieces.at(3).toLower() == "wta") {
-            cacheconf.set_write_policy(CacheConfig::WP_THROUGH_ALLOC);
-        } else {
-            std::cerr << "Write policy for " << which.toLocal8Bit().data()
-                      << " cache is incorrect (correct wb/wt/wtna/wta)."
-                      << std::endl;
-            exit(1);
-        }
-    }
-}
-
 void configure_machine(QCommandLineParser &p, MachineConfig &cc) {
     QStringList pa = p.positionalArguments();
     int siz;
-    if (pa.size() != 1) {
+    if (pa.size() > 1 || (pa.size() == 0 && !p.isSet("checkpoint-load"))) {
         std::cerr << "Single ELF file has to be specified" << std::endl;
         exit(1);
     }
-    cc.set_elf(pa[0]);
+    if (pa.size() == 1) {
+        cc.set_elf(pa[0]);
+    }
 
     cc.set_delay_slot(!p.isSet("no-delay-slot"));
     cc.set_pipelined(p.isSet("pipelined"));
@@ -219,6 +327,75 @@ void configure_machine(QCommandLineParser &p, MachineConfig &cc) {
             exit(1);
         }
     }
+    if (p.isSet("dual-issue")) {
+        if (!p.isSet("pipelined")) {
+            std::cerr << "Dual issue is modelled only by pipelined core, ignored"
+                      << std::endl;
+        }
+        cc.set_dual_issue(true);
+    }
+
+    siz = p.values("branch-predictor").size();
+    if (siz >= 1) {
+        QStringList pieces = p.values("branch-predictor").at(siz - 1).toLower().split(",");
+        BranchPredictorConfig *bp = cc.access_branch_predictor();
+        if (!bp->set_predictor(pieces.at(0))) {
+            std::cerr << "Unknown kind of branch predictor specified" << std::endl;
+            exit(1);
+        }
+        if (pieces.size() != 1 && pieces.size() != 5) {
+            std::cerr << "Parameters of branch predictor incorrect (correct "
+                         "gshare,10,64,8,2)."
+                      << std::endl;
+            exit(1);
+        }
+        if (pieces.size() == 5) {
+            bp->set_table_bits(pieces.at(1).toUInt());
+            bp->set_btb_size(pieces.at(2).toUInt());
+            bp->set_ras_depth(pieces.at(3).toUInt());
+            bp->set_penalty(pieces.at(4).toUInt());
+        }
+        if (!p.isSet("pipelined") && !p.isSet("out-of-order")) {
+            std::cerr << "Branch prediction is modelled only by pipelined "
+                         "and out-of-order core, ignored"
+                      << std::endl;
+        }
+    }
+
+    siz = p.values("out-of-order").size();
+    if (siz >= 1) {
+        QStringList pieces = p.values("out-of-order").at(siz - 1).split(",");
+        OutOfOrderConfig *ooo = cc.access_out_of_order();
+        if (pieces.size() != 1 && pieces.size() != 6) {
+            std::cerr << "Parameters of out-of-order core incorrect (correct "
+                         "2,32,16,8,4,20)."
+                      << std::endl;
+            exit(1);
+        }
+        ooo->set_enabled(true);
+        ooo->set_issue_width(pieces.at(0).toUInt());
+        if (pieces.size() == 6) {
+            ooo->set_rob_size(pieces.at(1).toUInt());
+            ooo->set_rs_size(pieces.at(2).toUInt());
+            ooo->set_lsq_size(pieces.at(3).toUInt());
+            ooo->set_mul_latency(pieces.at(4).toUInt());
+            ooo->set_div_latency(pieces.at(5).toUInt());
+        }
+    }
+
+    siz = p.values("cores").size();
+    if (siz >= 1) {
+        unsigned cores = p.values("cores").at(siz - 1).toUInt();
+        if (cores < 1 || cores > Cop0State::EBase_CPUNum + 1) {
+            std::cerr << "Invalid number of cores" << std::endl;
+            exit(1);
+        }
+        cc.set_core_count(cores);
+    }
+    siz = p.values("smp-quantum").size();
+    if (siz >= 1) {
+        cc.set_smp_quantum(p.values("smp-quantum").at(siz - 1).toUInt());
+    }
 
     siz = p.values("read-time").size();
     if (siz >= 1) {
@@ -239,13 +416,69 @@ void configure_machine(QCommandLineParser &p, MachineConfig &cc) {
     configure_cache(*cc.access_cache_data(), p.values("d-cache"), "data");
     configure_cache(
         *cc.access_cache_program(), p.values("i-cache"), "instruction");
+    configure_cache_level(
+        *cc.access_cache_level2(), p.values("l2-cache"), p.values("l2-hit-time"),
+        p.values("l2-inclusion"), "second level");
+    configure_cache_level(
+        *cc.access_cache_level3(), p.values("l3-cache"), p.values("l3-hit-time"),
+        p.values("l3-inclusion"), "third level");
+    configure_cache_prefetcher(
+        *cc.access_cache_data(), p.values("d-cache-prefetch"), "data");
+    configure_cache_prefetcher(
+        *cc.access_cache_program(), p.values("i-cache-prefetch"),
+        "instruction");
+    configure_cache_prefetcher(
+        *cc.access_cache_level2(), p.values("l2-prefetch"), "second level");
+    configure_cache_prefetcher(
+        *cc.access_cache_level3(), p.values("l3-prefetch"), "third level");
+    if (cc.cache_level3().enabled() && !cc.cache_level2().enabled()) {
+        std::cerr << "Third level cache is used only below second level one, "
+                     "ignored"
+                  << std::endl;
+    }
+
+    // Per-stage core signals are only consumed by the pipeline tracer.
+    cc.set_headless(
+        !p.isSet("trace-fetch") && !p.isSet("trace-decode")
+        && !p.isSet("trace-execute") && !p.isSet("trace-memory")
+        && !p.isSet("trace-writeback"));
+    // Instructions of already executed blocks need not be fetched again
+    // unless instruction cache statistics are reported
+    cc.set_fetch_simulated(p.isSet("dump-cache-stats") || p.isSet("i-cache-sweep"));
+
+    if (p.isSet("jit")) {
+        if (p.isSet("pipelined")) {
+            std::cerr << "JIT is available only for not pipelined core" << std::endl;
+            exit(1);
+        }
+        if (p.isSet("dump-cache-stats") || p.isSet("i-cache-sweep")) {
+            // Instruction fetches of translated code are not simulated
+            std::cerr << "JIT cannot be combined with instruction cache statistics"
+                      << std::endl;
+            exit(1);
+        }
+        if (!JitEngine::is_supported()) {
+            std::cerr << "JIT is not supported on this host, ignored" << std::endl;
+        } else if (
+            p.isSet("trace-pc") || p.isSet("trace-gp") || p.isSet("trace-file")
+            || p.isSet("profile") || p.isSet("callgrind")) {
+            // Translated code updates PC and registers once per block
+            std::cerr << "JIT is disabled by PC, register or binary tracing and "
+                         "by profiling"
+                      << std::endl;
+        } else {
+            cc.set_jit(true);
+        }
+    }
 }
 
 void configure_tracer(QCommandLineParser &p, Tracer &tr) {
     if (p.isSet("trace-fetch")) {
         tr.fetch();
     }
-    if (p.isSet("pipelined")) { // Following are added only if we have stages
+    // Following are added only if we have stages, converted trace contains
+    // only the stages of the core it was recorded on
+    if (p.isSet("pipelined") || p.isSet("trace-to-text")) {
         if (p.isSet("trace-decode")) {
             tr.decode();
         }
@@ -289,6 +522,12 @@ void configure_tracer(QCommandLineParser &p, Tracer &tr) {
     if (p.isSet("trace-hi")) {
         tr.reg_hi();
     }
+    if (p.isSet("trace-access")) {
+        tr.access();
+    }
+    if (p.isSet("trace-cache")) {
+        tr.cache();
+    }
 
     // TODO
 }
@@ -306,6 +545,21 @@ void configure_reporter(
     if (p.isSet("dump-cycles")) {
         r.cycles();
     }
+    if (p.isSet("dump-branch-stats")) {
+        r.branch_stats();
+    }
+    if (p.isSet("dump-issue-stats")) {
+        r.issue_stats();
+    }
+    if (p.isSet("dump-ooo-stats")) {
+        r.ooo_stats();
+    }
+    if (p.isSet("profile")) {
+        r.profile();
+    }
+    if (p.isSet("callgrind")) {
+        r.callgrind(p.value("callgrind"));
+    }
 
     QStringList fail = p.values("fail-match");
     for (int i = 0; i < fail.size(); i++) {
@@ -365,6 +619,19 @@ void configure_reporter(
         r.add_dump_range(start, len, range_arg.mid(comma2 + 1));
     }
 
+    int siz = p.values("checkpoint-save").size();
+    if (siz >= 1) {
+        r.checkpoint_save(p.values("checkpoint-save").at(siz - 1));
+    }
+
+    if (p.isSet("d-cache-sweep")) {
+        r.cache_sweep(true, expand_cache_sweep(p.values("d-cache-sweep"), "data"));
+    }
+    if (p.isSet("i-cache-sweep")) {
+        r.cache_sweep(
+            false, expand_cache_sweep(p.values("i-cache-sweep"), "instruction"));
+    }
+
     // TODO
 }
 
@@ -477,6 +744,136 @@ void load_ranges(Machine &machine, const QStringList &ranges) {
     }
 }
 
+void load_checkpoint(Machine &machine, QCommandLineParser &p) {
+    int siz = p.values("checkpoint-load").size();
+    if (siz < 1) {
+        return;
+    }
+    try {
+        machine.load_checkpoint(p.values("checkpoint-load").at(siz - 1));
+    } catch (SimulatorException &e) {
+        cout << "Checkpoint load failed: " << e.msg(false).toStdString()
+             << endl;
+        exit(1);
+    }
+}
+
+void configure_checkpoint_at(Machine &machine, const QStringList &addrs) {
+    foreach (QString str, addrs) {
+        bool ok = true;
+        Address addr;
+        if (str.size() >= 1 && !str.at(0).isDigit()
+            && machine.symbol_table() != nullptr) {
+            SymbolValue _addr;
+            ok = machine.symbol_table()->name_to_value(_addr, str);
+            addr = Address(_addr);
+        } else {
+            addr = Address(str.toULong(&ok, 0));
+        }
+        if (!ok) {
+            cout << "Checkpoint address specification error." << endl;
+            exit(1);
+        }
+        machine.insert_hwbreak(addr);
+    }
+}
+
+void configure_watchpoints(Machine &machine, const QStringList &ranges) {
+    foreach (QString range_arg, ranges) {
+        QStringList args = range_arg.split(",");
+        if (args.size() < 2 || args.size() > 3) {
+            cout << "Watch range start/length missing" << endl;
+            exit(1);
+        }
+        uint64_t start, len;
+        bool ok1 = true;
+        bool ok2 = true;
+        const SymbolTable *symtab = machine.symbol_table();
+        if (args[0].size() >= 1 && !args[0].at(0).isDigit() && symtab != nullptr) {
+            ok1 = symtab->name_to_value(start, args[0]);
+        } else {
+            start = args[0].toULong(&ok1, 0);
+        }
+        if (args[1].size() >= 1 && !args[1].at(0).isDigit() && symtab != nullptr) {
+            ok2 = symtab->name_to_value(len, args[1]);
+        } else {
+            len = args[1].toULong(&ok2, 0);
+        }
+        if (!ok1 || !ok2 || len == 0) {
+            cout << "Watch range start/length specification error." << endl;
+            exit(1);
+        }
+        enum Core::WatchpointType type = Core::WATCH_WRITE;
+        if (args.size() == 3) {
+            if (args[2] == "r") {
+                type = Core::WATCH_READ;
+            } else if (args[2] == "rw") {
+                type = Core::WATCH_ACCESS;
+            } else if (args[2] != "w") {
+                cout << "Unknown watch mode: " << args[2].toStdString() << endl;
+                exit(1);
+            }
+        }
+        machine.insert_watchpoint(Address(start), Address(start + len - 1), type);
+    }
+}
+
+// Options of batch jobs, the others (traces, dumps, serial port, checkpoints,
+// expected failures) are not applied by the batch runner. JIT is left out,
+// the reported instruction cache statistics need simulated fetches.
+static const QStringList BATCH_JOB_OPTIONS = {
+    "pipelined", "no-delay-slot", "cores", "smp-quantum", "hazard-unit",
+    "dual-issue", "out-of-order", "branch-predictor", "d-cache", "i-cache",
+    "d-cache-prefetch", "i-cache-prefetch", "l2-cache", "l2-hit-time", "l2-inclusion",
+    "l2-prefetch", "l3-cache", "l3-hit-time", "l3-inclusion", "l3-prefetch",
+    "read-time", "write-time", "burst-time",
+};
+
+int run_batch(QCommandLineParser &p) {
+    QVector<BatchRunner::Job> jobs;
+    QString error;
+    if (!BatchRunner::load_manifest(p.value("batch"), jobs, error)) {
+        std::cerr << error.toLocal8Bit().data() << std::endl;
+        return 1;
+    }
+    // Machine options of the jobs are processed the same way as for a single
+    // run, invalid ones stop the batch before it starts
+    for (BatchRunner::Job &job : jobs) {
+        QCommandLineParser job_parser;
+        create_parser(job_parser);
+        if (!job_parser.parse(QStringList("cli") + job.args + QStringList(job.elf))) {
+            std::cerr << "Job " << job.name.toLocal8Bit().data() << ": "
+                      << job_parser.errorText().toLocal8Bit().data() << std::endl;
+            return 1;
+        }
+        for (const QString &option : job_parser.optionNames()) {
+            if (!BATCH_JOB_OPTIONS.contains(option)) {
+                std::cerr << "Job " << job.name.toLocal8Bit().data() << ": option --"
+                          << option.toLocal8Bit().data()
+                          << " is not supported in batch jobs" << std::endl;
+                return 1;
+            }
+        }
+        configure_machine(job_parser, job.config);
+    }
+
+    QFile report;
+    if (p.isSet("batch-report")) {
+        report.setFileName(p.value("batch-report"));
+        if (!report.open(QFile::WriteOnly | QFile::Truncate)) {
+            std::cerr << "Batch report file cannot be open for write." << std::endl;
+            return 1;
+        }
+    } else {
+        report.open(stdout, QFile::WriteOnly);
+    }
+    BatchRunner runner(jobs, p.value("batch-threads").toInt(), &report);
+    int failed = runner.run();
+    std::cerr << jobs.size() - failed << " of " << jobs.size() << " jobs passed"
+              << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
 bool assemble(Machine &machine, MsgReport &msgrep, QString filename) {
     SymbolTableDb symtab(machine.symbol_table_rw(true));
     machine::FrontendMemory *mem = machine.memory_data_bus_rw();
@@ -508,11 +905,36 @@ int main(int argc, char *argv[]) {
     create_parser(p);
     p.process(app);
 
+    if (p.isSet("batch")) {
+        return run_batch(p);
+    }
+    if (p.isSet("trace-to-text")) {
+        Tracer tr(nullptr);
+        configure_tracer(p, tr);
+        return tr.print_binary_trace(p.value("trace-to-text")) ? 0 : 1;
+    }
+
     bool asm_source = p.isSet("asm");
+    bool load_elf = !asm_source && !p.positionalArguments().isEmpty();
 
     MachineConfig cc;
     configure_machine(p, cc);
-    Machine machine(cc, !asm_source, !asm_source);
+    // Writer outlives the machine, the trace index is written at its end
+    std::ofstream trace_out;
+    std::unique_ptr<TraceWriter> trace_writer;
+    if (p.isSet("trace-file")) {
+        trace_out.open(p.value("trace-file").toLocal8Bit().constData(), std::ios::binary);
+        if (!trace_out) {
+            std::cerr << "Cannot open trace file: " << p.value("trace-file").toStdString()
+                      << std::endl;
+            exit(1);
+        }
+        trace_writer.reset(new TraceWriter(trace_out));
+    }
+    Machine machine(cc, load_elf, load_elf);
+    if (trace_writer != nullptr) {
+        machine.set_trace_writer(trace_writer.get());
+    }
 
     Tracer tr(&machine);
     configure_tracer(p, tr);
@@ -522,15 +944,20 @@ int main(int argc, char *argv[]) {
 
     configure_serial_port(p, machine.serial_port());
 
-    if (asm_source) {
+    if (asm_source && !p.positionalArguments().isEmpty()) {
         MsgReport msgrep(&app);
         if (!assemble(machine, msgrep, p.positionalArguments()[0])) {
             exit(1);
         }
     }
 
+    load_checkpoint(machine, p);
     load_ranges(machine, p.values("load-range"));
+    configure_checkpoint_at(machine, p.values("checkpoint-at"));
+    configure_watchpoints(machine, p.values("watch"));
 
+    // Run batches of instructions for up to 100 ms between event processing
+    machine.set_speed(0, 100);
     machine.play();
     return QCoreApplication::exec();
 }
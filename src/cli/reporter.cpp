@@ -35,6 +35,7 @@
 
 #include "reporter.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -53,10 +54,20 @@ Reporter::Reporter(QCoreApplication *app, Machine *machine) : QObject() {
     connect(
         machine->core(), &Core::stop_on_exception_reached, this,
         &Reporter::machine_exception_reached);
+    // Stops of the other cores are reported by core 0 as well
+    for (unsigned i = 0; i < machine->core_count(); i++) {
+        connect(
+            machine->core(i), &Core::watchpoint_reached, this,
+            &Reporter::machine_watchpoint_reached);
+    }
 
     e_regs = false;
     e_cache_stats = false;
     e_cycles = false;
+    e_branch_stats = false;
+    e_issue_stats = false;
+    e_ooo_stats = false;
+    e_profile = false;
     e_fail = (enum FailReason)0;
 }
 
@@ -72,6 +83,28 @@ void Reporter::cycles() {
     e_cycles = true;
 }
 
+void Reporter::branch_stats() {
+    e_branch_stats = true;
+}
+
+void Reporter::issue_stats() {
+    e_issue_stats = true;
+}
+
+void Reporter::ooo_stats() {
+    e_ooo_stats = true;
+}
+
+void Reporter::profile() {
+    machine->set_profiling(true);
+    e_profile = true;
+}
+
+void Reporter::callgrind(const QString &path_to_write) {
+    machine->set_profiling(true);
+    callgrind_path = path_to_write;
+}
+
 void Reporter::expect_fail(enum FailReason reason) {
     e_fail = (enum FailReason)(e_fail | reason);
 }
@@ -83,6 +116,28 @@ void Reporter::add_dump_range(
     dump_ranges.append({ start, len, path_to_write });
 }
 
+void Reporter::checkpoint_save(const QString &path_to_write) {
+    checkpoint_path = path_to_write;
+}
+
+void Reporter::cache_sweep(
+    bool data_cache,
+    const std::vector<CacheConfig> &configs) {
+    const MachineConfig &config = machine->config();
+    Cache *cache = data_cache ? machine->cache_data_rw()
+                              : machine->cache_program_rw();
+    cache_sweeps.push_back(
+        { data_cache ? "d-cache" : "i-cache",
+          std::make_unique<CacheSweep>(
+              config.memory_access_time_read(),
+              config.memory_access_time_write(),
+              config.memory_access_time_burst()),
+          configs });
+    CacheSweep *sweep = cache_sweeps.back().sweep.get();
+    cache->set_reference_observer(
+        [sweep](const CacheReference &ref) { sweep->record(ref); });
+}
+
 void Reporter::machine_exit() {
     report();
     if (e_fail != 0) {
@@ -161,6 +216,208 @@ static void out_hex(ostream &out, uint64_t val, int digits) {
     out.flags(saveflg);
 }
 
+void Reporter::machine_watchpoint_reached() {
+    auto *core = qobject_cast<const Core *>(sender());
+    const Core::WatchpointHit &hit = core->get_watchpoint_hit();
+    cout << "Machine stopped on watchpoint: "
+         << (hit.type == Core::WATCH_WRITE ? "write" : "read") << " of "
+         << hit.size << " bytes at 0x";
+    out_hex(cout, hit.mem_addr.get_raw(), 8);
+    cout << " by instruction at 0x";
+    out_hex(cout, hit.inst_addr.get_raw(), 8);
+    cout << ", value 0x";
+    out_hex(cout, hit.old_value.as_u64(), hit.size * 2);
+    cout << " -> 0x";
+    out_hex(cout, hit.new_value.as_u64(), hit.size * 2);
+    cout << endl;
+    report();
+    QCoreApplication::exit();
+}
+
+void Reporter::report_cache(const QString &name, const Cache *cache, bool writes) {
+    string prefix = name.toStdString();
+    cout << prefix << ":reads:" << cache->get_read_count() << endl;
+    if (writes) {
+        cout << prefix << ":writes:" << cache->get_write_count() << endl;
+    }
+    cout << prefix << ":hit:" << cache->get_hit_count() << endl;
+    cout << prefix << ":miss:" << cache->get_miss_count() << endl;
+    cout << prefix << ":hit-rate:" << cache->get_hit_rate() << endl;
+    cout << prefix << ":stalled-cycles:" << cache->get_stall_count() << endl;
+    cout << prefix << ":improved-speed:" << cache->get_speed_improvement()
+         << endl;
+    if (cache->get_config().prefetcher() != CacheConfig::PF_NONE) {
+        const CacheStatistics &st = cache->get_statistics();
+        cout << prefix << ":prefetches:" << st.prefetches << endl;
+        cout << prefix << ":prefetch-useful:" << st.prefetch_useful << endl;
+        cout << prefix << ":prefetch-late:" << st.prefetch_late << endl;
+        cout << prefix << ":prefetch-useless:" << st.prefetch_useless << endl;
+        cout << prefix << ":prefetch-accuracy:" << st.prefetch_accuracy()
+             << endl;
+    }
+}
+
+void Reporter::report_branch_predictor(
+    const QString &name,
+    const BranchPredictor *predictor) {
+    string prefix = name.toStdString();
+    if (predictor == nullptr) {
+        cout << prefix << ":none" << endl;
+        return;
+    }
+    const BranchPredictor::Stats &st = predictor->get_stats();
+    cout << prefix << ":branches:" << st.branches << endl;
+    cout << prefix << ":mispredictions:" << st.mispredictions() << endl;
+    cout << prefix << ":mispredicted-direction:" << st.mispredicted_direction << endl;
+    cout << prefix << ":mispredicted-target:" << st.mispredicted_target << endl;
+    cout << prefix << ":accuracy:" << st.accuracy() << endl;
+    cout << prefix << ":lost-cycles:" << st.lost_cycles << endl;
+    for (const auto &item : predictor->get_branch_stats()) {
+        cout << prefix << ":0x";
+        out_hex(cout, item.first, 8);
+        cout << ":executed:" << item.second.executed
+             << ":taken:" << item.second.taken
+             << ":mispredicted:" << item.second.mispredicted << endl;
+    }
+}
+
+void Reporter::report_dual_issue(const QString &name, const DualIssueStats *stats) {
+    string prefix = name.toStdString();
+    if (stats == nullptr) {
+        cout << prefix << ":none" << endl;
+        return;
+    }
+    cout << prefix << ":issue-cycles:" << stats->issue_cycles << endl;
+    cout << prefix << ":dual:" << stats->dual << endl;
+    cout << prefix << ":dual-rate:" << stats->dual_rate() << endl;
+    for (int i = 0; i < DualIssueStats::SI_COUNT; i++) {
+        cout << prefix << ":single:"
+             << DualIssueStats::reason_name((enum DualIssueStats::SingleIssue)i) << ":"
+             << stats->single[i] << endl;
+    }
+}
+
+void Reporter::report_out_of_order(
+    const QString &name,
+    const OutOfOrderEngine *engine) {
+    string prefix = name.toStdString();
+    if (engine == nullptr) {
+        cout << prefix << ":none" << endl;
+        return;
+    }
+    const OutOfOrderEngine::Stats &st = engine->get_stats();
+    cout << prefix << ":cycles:" << st.cycles << endl;
+    cout << prefix << ":dispatched:" << st.dispatched << endl;
+    cout << prefix << ":committed:" << st.committed << endl;
+    cout << prefix << ":ipc:" << st.ipc() << endl;
+    cout << prefix << ":forwarded-loads:" << st.forwarded_loads << endl;
+    for (int i = 0; i < OutOfOrderEngine::FU_COUNT; i++) {
+        cout << prefix << ":issued:"
+             << OutOfOrderEngine::unit_name((enum OutOfOrderEngine::Unit)i) << ":"
+             << st.issued[i] << endl;
+    }
+    const std::pair<const char *, const OutOfOrderEngine::Occupancy *> occupancies[] = {
+        { "rob", &st.rob },
+        { "rs", &st.rs },
+        { "lsq", &st.lsq },
+    };
+    for (const auto &item : occupancies) {
+        cout << prefix << ":" << item.first
+             << ":average-occupancy:" << item.second->average(st.cycles) << endl;
+        cout << prefix << ":" << item.first << ":max-occupancy:" << item.second->max
+             << endl;
+    }
+    for (int i = OutOfOrderEngine::STALL_NONE + 1; i < OutOfOrderEngine::STALL_COUNT; i++) {
+        cout << prefix << ":stall:"
+             << OutOfOrderEngine::stall_name((enum OutOfOrderEngine::Stall)i) << ":"
+             << st.stalls[i] << endl;
+    }
+}
+
+static string cache_config_name(const CacheConfig &config) {
+    if (!config.enabled()) {
+        return "disabled";
+    }
+    string name;
+    switch (config.replacement_policy()) {
+    case CacheConfig::RP_RAND: name = "random"; break;
+    case CacheConfig::RP_LRU: name = "lru"; break;
+    case CacheConfig::RP_LFU: name = "lfu"; break;
+    case CacheConfig::RP_PLRU: name = "plru"; break;
+    case CacheConfig::RP_NRU: name = "nru"; break;
+    case CacheConfig::RP_SRRIP: name = "srrip"; break;
+    }
+    name += "," + to_string(config.set_count()) + ","
+            + to_string(config.block_size()) + ","
+            + to_string(config.associativity());
+    switch (config.write_policy()) {
+    case CacheConfig::WP_THROUGH_NOALLOC: name += ",wtna"; break;
+    case CacheConfig::WP_THROUGH_ALLOC: name += ",wta"; break;
+    case CacheConfig::WP_BACK: name += ",wb"; break;
+    }
+    return name;
+}
+
+void Reporter::report_profile() {
+    const Profiler *profiler = machine->profiler();
+    const Profiler::Counters total = profiler->get_total();
+    std::ios_base::fmtflags saveflg(cout.flags());
+    cout << "Flat profile:" << endl << endl;
+    cout << "Each sample counts as one cycle." << endl;
+    cout << "  %      cumulative       self" << endl;
+    cout << " cycles      cycles     cycles     stalls  instructions"
+            "    i-miss    d-miss  name"
+         << endl;
+    uint64_t cumulative = 0;
+    for (const Profiler::Function &function : profiler->get_functions(machine->symbol_table())) {
+        const Profiler::Counters &c = function.counters;
+        cumulative += c.cycles;
+        double percent = total.cycles != 0 ? 100.0 * c.cycles / total.cycles : 0;
+        cout << fixed << setprecision(2) << setw(7) << percent << " " << setw(11)
+             << cumulative << " " << setw(10) << c.cycles << " " << setw(10)
+             << c.stalls << " " << setw(13) << c.instructions << " " << setw(9)
+             << c.icache_misses << " " << setw(9) << c.dcache_misses << "  "
+             << (function.name.isEmpty() ? string("<unknown>")
+                                         : function.name.toStdString())
+             << endl;
+    }
+    cout.flags(saveflg);
+}
+
+void Reporter::report_cache_sweep(const SweepRequest &sweep) {
+    cout << sweep.name.toStdString() << " sweep of "
+         << sweep.sweep->get_references().size() << " references:" << endl;
+    cout << "config\thit-rate\thit\tmiss\treads\twrites\tstalled-cycles"
+            "\timproved-speed\tmethod\tmiss-rate-over-lru"
+         << endl;
+    // Each configuration is compared to the same cache with LRU policy, the
+    // LRU configurations not requested are evaluated along
+    std::vector<CacheConfig> configs = sweep.configs;
+    std::vector<size_t> lru_index(sweep.configs.size());
+    for (size_t i = 0; i < sweep.configs.size(); i++) {
+        CacheConfig lru(&sweep.configs[i]);
+        lru.set_replacement_policy(CacheConfig::RP_LRU);
+        lru_index[i] = std::find(configs.begin(), configs.end(), lru)
+                       - configs.begin();
+        if (lru_index[i] == configs.size()) {
+            configs.push_back(lru);
+        }
+    }
+    const std::vector<CacheSweep::Result> results
+        = sweep.sweep->evaluate(configs);
+    for (size_t i = 0; i < sweep.configs.size(); i++) {
+        const CacheSweep::Result &res = results[i];
+        const CacheStatistics &st = res.statistics;
+        cout << cache_config_name(res.config) << "\t" << res.hit_rate << "\t"
+             << st.hit_read + st.hit_write << "\t"
+             << st.miss_read + st.miss_write << "\t" << st.mem_reads << "\t"
+             << st.mem_writes << "\t" << res.stall_count << "\t"
+             << res.speed_improvement << "\t"
+             << (res.replayed ? "replay" : "stack") << "\t"
+             << results[lru_index[i]].hit_rate - res.hit_rate << endl;
+    }
+}
+
 void Reporter::report() {
     cout << dec;
     if (e_regs) {
@@ -200,32 +457,57 @@ void Reporter::report() {
     }
     if (e_cache_stats) {
         cout << "Cache statistics report:" << endl;
-        cout << "i-cache:reads:" << machine->cache_program()->get_read_count()
-             << endl;
-        cout << "i-cache:hit:" << machine->cache_program()->get_hit_count()
-             << endl;
-        cout << "i-cache:miss:" << machine->cache_program()->get_miss_count()
-             << endl;
-        cout << "i-cache:hit-rate:" << machine->cache_program()->get_hit_rate()
-             << endl;
-        cout << "i-cache:stalled-cycles:"
-             << machine->cache_program()->get_stall_count() << endl;
-        cout << "i-cache:improved-speed:"
-             << machine->cache_program()->get_speed_improvement() << endl;
-        cout << "d-cache:reads:" << machine->cache_data()->get_read_count()
-             << endl;
-        cout << "d-cache:writes:" << machine->cache_data()->get_write_count()
-             << endl;
-        cout << "d-cache:hit:" << machine->cache_data()->get_hit_count()
-             << endl;
-        cout << "d-cache:miss:" << machine->cache_data()->get_miss_count()
-             << endl;
-        cout << "d-cache:hit-rate:" << machine->cache_data()->get_hit_rate()
-             << endl;
-        cout << "d-cache:stalled-cycles:"
-             << machine->cache_data()->get_stall_count() << endl;
-        cout << "d-cache:improved-speed:"
-             << machine->cache_data()->get_speed_improvement() << endl;
+        report_cache("i-cache", machine->cache_program(), false);
+        report_cache("d-cache", machine->cache_data(), true);
+        for (unsigned i = 1; i < machine->core_count(); i++) {
+            QString core = QString("core%1:").arg(i);
+            report_cache(core + "i-cache", machine->cache_program(i), false);
+            report_cache(core + "d-cache", machine->cache_data(i), true);
+        }
+        if (machine->cache_level2() != nullptr) {
+            report_cache("l2-cache", machine->cache_level2(), true);
+        }
+        if (machine->cache_level3() != nullptr) {
+            report_cache("l3-cache", machine->cache_level3(), true);
+        }
+        const CacheCoherence *coherence = machine->cache_coherence();
+        for (size_t i = 0; coherence != nullptr && i < coherence->participant_count(); i++) {
+            const CacheCoherence::Statistics &st = coherence->get_statistics(i);
+            string core = QString("core%1:").arg(i).toStdString();
+            cout << core << "coherence:bus-reads:" << st.bus_reads << endl;
+            cout << core << "coherence:bus-writes:" << st.bus_writes << endl;
+            cout << core << "coherence:upgrades:" << st.upgrades << endl;
+            cout << core << "coherence:invalidations:" << st.invalidations << endl;
+            cout << core << "coherence:interventions:" << st.interventions << endl;
+        }
+    }
+    for (const SweepRequest &sweep : cache_sweeps) {
+        report_cache_sweep(sweep);
+    }
+    if (e_branch_stats) {
+        cout << "Branch predictor report:" << endl;
+        report_branch_predictor("branch-predictor", machine->branch_predictor());
+        for (unsigned i = 1; i < machine->core_count(); i++) {
+            report_branch_predictor(
+                QString("core%1:branch-predictor").arg(i),
+                machine->core(i)->get_branch_predictor());
+        }
+    }
+    if (e_issue_stats) {
+        cout << "Dual issue report:" << endl;
+        report_dual_issue("issue", machine->dual_issue());
+        for (unsigned i = 1; i < machine->core_count(); i++) {
+            report_dual_issue(
+                QString("core%1:issue").arg(i), machine->core(i)->get_dual_issue());
+        }
+    }
+    if (e_ooo_stats) {
+        cout << "Out-of-order core report:" << endl;
+        report_out_of_order("ooo", machine->out_of_order());
+        for (unsigned i = 1; i < machine->core_count(); i++) {
+            report_out_of_order(
+                QString("core%1:ooo").arg(i), machine->core(i)->get_out_of_order());
+        }
     }
     if (e_cycles) {
         cout << "d-cache:stalled-cycles:"
@@ -236,6 +518,15 @@ void Reporter::report() {
     if (e_cycles) {
         cout << "cycles:" << machine->core()->get_cycle_count() << endl;
         cout << "stalls:" << machine->core()->get_stall_count() << endl;
+        for (unsigned i = 1; i < machine->core_count(); i++) {
+            cout << "core" << i << ":cycles:" << machine->core(i)->get_cycle_count()
+                 << endl;
+            cout << "core" << i << ":stalls:" << machine->core(i)->get_stall_count()
+                 << endl;
+        }
+    }
+    if (e_profile) {
+        report_profile();
     }
     foreach (DumpRange range, dump_ranges) {
         ofstream out;
@@ -255,4 +546,20 @@ void Reporter::report() {
         }
         out.close();
     }
+    if (!callgrind_path.isEmpty()) {
+        try {
+            machine->save_callgrind(callgrind_path);
+        } catch (SimulatorException &e) {
+            cout << "Callgrind profile save failed: " << e.msg(false).toStdString()
+                 << endl;
+        }
+    }
+    if (!checkpoint_path.isEmpty()) {
+        try {
+            machine->save_checkpoint(checkpoint_path);
+        } catch (SimulatorException &e) {
+            cout << "Checkpoint save failed: " << e.msg(false).toStdString()
+                 << endl;
+        }
+    }
 }
@@ -37,11 +37,14 @@
 #define REPORTER_H
 
 #include "machine/machine.h"
+#include "machine/memory/cache/cache_sweep.h"
 
 #include <QCoreApplication>
 #include <QObject>
 #include <QString>
 #include <QVector>
+#include <memory>
+#include <vector>
 
 using machine::Address;
 
@@ -54,6 +57,14 @@ public:
     void regs(); // Report status of registers
     void cache_stats();
     void cycles();
+    void branch_stats();
+    void issue_stats();
+    void ooo_stats();
+    // Profiles core 0 and prints flat profile by functions, see `Profiler`
+    void profile();
+    // Profile of core 0 with call graph is written to the file in callgrind
+    // format when the simulation stops
+    void callgrind(const QString &path_to_write);
 
     enum FailReason {
         FR_I = (1 << 0), // Unsupported Instruction
@@ -72,23 +83,61 @@ public:
         QString path_to_write;
     };
     void add_dump_range(Address start, size_t len, const QString &path_to_write);
+    /** Machine state is saved to this file when the simulation stops. */
+    void checkpoint_save(const QString &path_to_write);
+    /**
+     * References of the cache (of core 0) are recorded and all configurations
+     * are evaluated on them when the simulation stops.
+     */
+    void cache_sweep(
+        bool data_cache,
+        const std::vector<machine::CacheConfig> &configs);
+
+    // Prints cache statistics, format of `cache_stats` report
+    static void report_cache(const QString &name, const machine::Cache *cache, bool writes);
+    // Prints accuracy and lost cycles of the predictor and its branches
+    static void report_branch_predictor(
+        const QString &name,
+        const machine::BranchPredictor *predictor);
+    // Prints dual-issue rate and counts of reasons of single issue
+    static void report_dual_issue(const QString &name, const machine::DualIssueStats *stats);
+    // Prints throughput, structure occupancy and stall reasons of the core
+    static void report_out_of_order(
+        const QString &name,
+        const machine::OutOfOrderEngine *engine);
 
 private slots:
     void machine_exit();
     void machine_trap(machine::SimulatorException &e);
     void machine_exception_reached();
+    void machine_watchpoint_reached();
 
 private:
     QCoreApplication *app;
     machine::Machine *machine;
     QVector<DumpRange> dump_ranges;
+    QString checkpoint_path;
+    QString callgrind_path;
+
+    struct SweepRequest {
+        QString name;
+        std::unique_ptr<machine::CacheSweep> sweep;
+        std::vector<machine::CacheConfig> configs;
+    };
+    std::vector<SweepRequest> cache_sweeps;
 
     bool e_regs;
     bool e_cache_stats;
     bool e_cycles;
+    bool e_branch_stats;
+    bool e_issue_stats;
+    bool e_ooo_stats;
+    bool e_profile;
     enum FailReason e_fail;
 
     void report();
+    void report_cache_sweep(const SweepRequest &sweep);
+    void report_profile();
 };
 
 #endif // REPORTER_H
@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "batch.h"
+#include "machine/machine.h"
+#include "tst_cli.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QVector>
+
+using namespace machine;
+
+static QString write_manifest(const QTemporaryDir &dir, const QByteArray &content) {
+    QString path = dir.filePath("manifest.jsonl");
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(content);
+    }
+    return path;
+}
+
+// Writes big endian MIPS executable with the code loaded at 0x80020000
+static void write_elf(const QString &path, const QVector<uint32_t> &code) {
+    const quint32 entry = 0x80020000;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::BigEndian);
+    // ELF header, class 32-bit, MSB data
+    out << (quint8)0x7f << (quint8)'E' << (quint8)'L' << (quint8)'F' << (quint8)1
+        << (quint8)2 << (quint8)1;
+    for (int i = 0; i < 9; i++) {
+        out << (quint8)0;
+    }
+    out << (quint16)2 << (quint16)8 << (quint32)1 << entry << (quint32)52 << (quint32)0
+        << (quint32)0 << (quint16)52 << (quint16)32 << (quint16)1 << (quint16)40
+        << (quint16)0 << (quint16)0;
+    // Single loadable segment
+    out << (quint32)1 << (quint32)84 << entry << entry << (quint32)(code.size() * 4)
+        << (quint32)(code.size() * 4) << (quint32)5 << (quint32)4;
+    for (uint32_t word : code) {
+        out << (quint32)word;
+    }
+}
+
+void CliTests::batch_manifest() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = write_manifest(
+        dir,
+        "# comment\n"
+        "{\"elf\": \"a.elf\"}\n"
+        "\n"
+        "{\"name\": \"b\", \"elf\": \"sub/b.elf\", \"args\": [\"--pipelined\"], "
+        "\"serial_in\": \"in.txt\", \"max_cycles\": 1000, "
+        "\"expect\": [{\"start\": \"0x400\", \"length\": 64, \"file\": \"dump.txt\"}]}\n");
+
+    QVector<BatchRunner::Job> jobs;
+    QString error;
+    QVERIFY(BatchRunner::load_manifest(path, jobs, error));
+    QCOMPARE(jobs.size(), 2);
+
+    QCOMPARE(jobs[0].index, 0);
+    QCOMPARE(jobs[0].name, QString("a.elf"));
+    QCOMPARE(jobs[0].elf, QDir(dir.path()).filePath("a.elf"));
+    QVERIFY(jobs[0].args.isEmpty());
+    QVERIFY(jobs[0].serial_in.isEmpty());
+    QCOMPARE(jobs[0].max_cycles, 0u);
+    QVERIFY(jobs[0].expect.isEmpty());
+
+    QCOMPARE(jobs[1].index, 1);
+    QCOMPARE(jobs[1].name, QString("b"));
+    QCOMPARE(jobs[1].elf, QDir(dir.path()).filePath("sub/b.elf"));
+    QCOMPARE(jobs[1].args, QStringList("--pipelined"));
+    QCOMPARE(jobs[1].serial_in, QDir(dir.path()).filePath("in.txt"));
+    QCOMPARE(jobs[1].max_cycles, 1000u);
+    QCOMPARE(jobs[1].expect.size(), 1);
+    QCOMPARE(jobs[1].expect[0].start, 0x400_addr);
+    QCOMPARE(jobs[1].expect[0].len, (size_t)64);
+    QCOMPARE(jobs[1].expect[0].path, QDir(dir.path()).filePath("dump.txt"));
+}
+
+void CliTests::batch_manifest_errors_data() {
+    QTest::addColumn<QByteArray>("content");
+    QTest::addColumn<QString>("error");
+
+    QTest::newRow("missing-elf") << QByteArray("{\"elf\": \"a.elf\"}\n{\"name\": \"x\"}\n")
+                                 << QString("Manifest line 2: missing elf");
+    QTest::newRow("not-object") << QByteArray("[\"a.elf\"]\n")
+                                << QString("Manifest line 1: ");
+    QTest::newRow("expect") << QByteArray("{\"elf\": \"a.elf\", \"expect\": [{\"start\": 0}]}\n")
+                            << QString("Manifest line 1: expected dump needs start, length "
+                                       "and file");
+}
+
+void CliTests::batch_manifest_errors() {
+    QFETCH(QByteArray, content);
+    QFETCH(QString, error);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVector<BatchRunner::Job> jobs;
+    QString message;
+    QVERIFY(!BatchRunner::load_manifest(write_manifest(dir, content), jobs, message));
+    QVERIFY(message.startsWith(error));
+
+    QVERIFY(!BatchRunner::load_manifest(dir.filePath("none.jsonl"), jobs, message));
+}
+
+void CliTests::batch_run_failed() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile not_elf(dir.filePath("text.elf"));
+    QVERIFY(not_elf.open(QIODevice::WriteOnly));
+    not_elf.write("not an executable\n");
+    not_elf.close();
+
+    QVector<BatchRunner::Job> jobs;
+    QString error;
+    QVERIFY(BatchRunner::load_manifest(
+        write_manifest(dir, "{\"elf\": \"missing.elf\"}\n{\"elf\": \"text.elf\"}\n"), jobs,
+        error));
+    for (BatchRunner::Job &job : jobs) {
+        job.config.set_elf(job.elf);
+    }
+
+    // Jobs which cannot be run are reported and counted as failed
+    QBuffer report;
+    QVERIFY(report.open(QIODevice::ReadWrite));
+    BatchRunner runner(jobs, 2, &report);
+    QCOMPARE(runner.run(), 2);
+
+    QSet<int> reported;
+    for (const QByteArray &line : report.data().split('\n')) {
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonObject result = QJsonDocument::fromJson(line).object();
+        QCOMPARE(result.value("status").toString(), QString("error"));
+        QCOMPARE(result.value("passed").toBool(true), false);
+        QVERIFY(!result.value("message").toString().isEmpty());
+        reported.insert(result.value("index").toInt(-1));
+    }
+    QCOMPARE(reported, QSet<int>({ 0, 1 }));
+}
+
+void CliTests::batch_cache_stats() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QVector<uint32_t> code = {
+        0x24080064, // addiu $8, $0, 100
+        0x2508ffff, // loop: addiu $8, $8, -1
+        0x1500fffe, // bne $8, $0, loop
+        0x00000000, // nop
+    };
+    write_elf(dir.filePath("loop.elf"), code);
+
+    // Configuration as built for a job without cache statistics options
+    MachineConfig config;
+    config.set_elf(dir.filePath("loop.elf"));
+    config.set_pipelined(false);
+    config.set_headless(true);
+    config.set_fetch_simulated(false);
+    config.access_cache_program()->set_enabled(true);
+    config.access_cache_program()->set_set_count(2);
+    config.access_cache_program()->set_block_size(2);
+    config.access_cache_program()->set_associativity(1);
+
+    QVector<BatchRunner::Job> jobs;
+    QString error;
+    QVERIFY(BatchRunner::load_manifest(
+        write_manifest(dir, "{\"elf\": \"loop.elf\"}\n"), jobs, error));
+    jobs[0].config = config;
+    QBuffer report;
+    QVERIFY(report.open(QIODevice::ReadWrite));
+    BatchRunner runner(jobs, 1, &report);
+    QCOMPARE(runner.run(), 0);
+    QJsonObject result = QJsonDocument::fromJson(report.data().split('\n')[0]).object();
+    QCOMPARE(result.value("status").toString(), QString("exit"));
+    QJsonObject i_cache
+        = result.value("caches").toObject().value("i-cache").toObject();
+
+    // Same program run as with --dump-cache-stats
+    MachineConfig stats_config(config);
+    stats_config.set_fetch_simulated(true);
+    Machine machine(stats_config, true, true);
+    while (!machine.exited() && machine.run(1000) == 1000) {}
+    QVERIFY(machine.exited());
+    const Cache *cache = machine.cache_program();
+    QVERIFY(cache->get_hit_count() > 100);
+    QCOMPARE(i_cache.value("hits").toInt(), (int)cache->get_hit_count());
+    QCOMPARE(i_cache.value("misses").toInt(), (int)cache->get_miss_count());
+    QCOMPARE(i_cache.value("memory_reads").toInt(), (int)cache->get_read_count());
+    QCOMPARE(i_cache.value("stalled_cycles").toInt(), (int)cache->get_stall_count());
+    QCOMPARE(result.value("cycles").toInt(), (int)machine.core()->get_cycle_count());
+}
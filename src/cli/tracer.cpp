@@ -35,6 +35,9 @@
 
 #include "tracer.h"
 
+#include "machine/trace/trace_reader.h"
+
+#include <fstream>
 #include <iostream>
 #include <string>
 
@@ -57,7 +60,7 @@ Tracer::Tracer(Machine *machine) {
 #define CON(VAR, FROM, SIG, SLT)                                               \
     do {                                                                       \
         if (!(VAR)) {                                                          \
-            connect(FROM, SIG, this, SLT);                                     \
+            if (machine != nullptr) { connect(FROM, SIG, this, SLT); }         \
             (VAR) = true;                                                      \
         }                                                                      \
     } while (false)
@@ -110,6 +113,104 @@ void Tracer::reg_hi() {
     r_hi = true;
 }
 
+void Tracer::access() {
+    sel_access = true;
+}
+
+void Tracer::cache() {
+    sel_cache = true;
+}
+
+bool Tracer::print_binary_trace(const QString &path) {
+    ifstream in(path.toLocal8Bit().constData(), ios::binary);
+    if (!in) {
+        cerr << "Cannot open trace file: " << path.toStdString() << endl;
+        return false;
+    }
+    TraceReader reader(in);
+    if (!reader.open()) {
+        cerr << "Cannot read trace file " << path.toStdString() << ": "
+             << reader.get_error() << endl;
+        return false;
+    }
+
+    bool any_gp = false;
+    for (bool gp_reg : gp_regs) {
+        any_gp = any_gp || gp_reg;
+    }
+    if (!con_fetch && !con_decode && !con_execute && !con_memory
+        && !con_writeback && !con_regs_pc && !any_gp && !r_hi && !r_lo
+        && !sel_access && !sel_cache) {
+        fetch();
+        decode();
+        execute();
+        memory();
+        writeback();
+        reg_pc();
+        for (unsigned i = 0; i < 32; i++) {
+            reg_gp(i);
+        }
+        reg_lo();
+        reg_hi();
+        access();
+        cache();
+    }
+
+    TraceRecord rec;
+    while (reader.next(rec)) {
+        Instruction inst(rec.inst);
+        Address addr(rec.address);
+        auto excause = (ExceptionCause)rec.excause;
+        bool valid = rec.flags & TraceRecord::VALID;
+        switch (rec.type) {
+        case TraceRecord::FETCH:
+            if (con_fetch) { instruction_fetch(inst, addr, excause, valid); }
+            break;
+        case TraceRecord::DECODE:
+            if (con_decode) { instruction_decode(inst, addr, excause, valid); }
+            break;
+        case TraceRecord::EXECUTE:
+            if (con_execute) { instruction_execute(inst, addr, excause, valid); }
+            break;
+        case TraceRecord::MEMORY:
+            if (con_memory) { instruction_memory(inst, addr, excause, valid); }
+            break;
+        case TraceRecord::WRITEBACK:
+            if (con_writeback) { instruction_writeback(inst, addr, excause, valid); }
+            break;
+        case TraceRecord::PC:
+            if (con_regs_pc) { regs_pc_update(addr); }
+            break;
+        case TraceRecord::GP: regs_gp_update(rec.reg, rec.value); break;
+        case TraceRecord::HI_LO:
+            regs_hi_lo_update(rec.flags & TraceRecord::HI, rec.value);
+            break;
+        case TraceRecord::MEM:
+            if (sel_access) {
+                cout << ((rec.flags & TraceRecord::WRITE) ? "MemWrite:" : "MemRead:")
+                     << hex << rec.address << ":" << dec << (unsigned)rec.size
+                     << ":" << hex << rec.value << endl;
+            }
+            break;
+        case TraceRecord::CACHE:
+            if (sel_cache) {
+                cout << ((rec.flags & TraceRecord::DATA) ? "D-cache:" : "I-cache:")
+                     << ((rec.flags & TraceRecord::WRITE) ? "write" : "read")
+                     << ((rec.flags & TraceRecord::HIT) ? "-hit:" : "-miss:")
+                     << hex << rec.address << endl;
+            }
+            break;
+        default: break;
+        }
+    }
+    if (!reader.get_error().empty()) {
+        cerr << "Cannot read trace file " << path.toStdString() << ": "
+             << reader.get_error() << endl;
+        return false;
+    }
+    return true;
+}
+
 void Tracer::instruction_fetch(
     const machine::Instruction &inst,
     Address inst_addr,
@@ -45,6 +45,7 @@
 class Tracer : public QObject {
     Q_OBJECT
 public:
+    // Null machine only selects records printed by `print_binary_trace`
     Tracer(machine::Machine *machine);
 
     // Trace instructions in different stages/sections
@@ -58,6 +59,16 @@ public:
     void reg_gp(machine::RegisterId i);
     void reg_lo();
     void reg_hi();
+    // Available only in binary trace
+    void access();
+    void cache();
+
+    /**
+     * Prints selected records of binary trace file (see `TraceWriter`) the
+     * same way as they are printed during the run. Everything is printed when
+     * nothing is selected.
+     */
+    bool print_binary_trace(const QString &path);
 
 private slots:
     void instruction_fetch(
@@ -98,6 +109,7 @@ private:
 
     bool con_fetch {}, con_decode {}, con_execute {}, con_memory {},
         con_writeback {}, con_regs_pc, con_regs_gp, con_regs_hi_lo;
+    bool sel_access {}, sel_cache {};
 };
 
 #endif // TRACER_H
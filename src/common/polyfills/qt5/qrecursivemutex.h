@@ -0,0 +1,21 @@
+#ifndef POLYFILLS_QRECURSIVEMUTEX_H
+#define POLYFILLS_QRECURSIVEMUTEX_H
+
+#include <QMutex>
+
+/**
+ * QRecursiveMutex polyfill
+ *
+ * Recursive mode of QMutex was replaced by QRecursiveMutex in Qt 5.14 and it
+ * is not available in Qt 6.
+ */
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+using Poly_QRecursiveMutex = QRecursiveMutex;
+#else
+class Poly_QRecursiveMutex : public QMutex {
+public:
+    Poly_QRecursiveMutex() : QMutex(QMutex::Recursive) {}
+};
+#endif
+
+#endif // POLYFILLS_QRECURSIVEMUTEX_H
@@ -60,6 +60,8 @@ CacheDock::CacheDock(QWidget *parent, const QString &type)
     layout_top_form->addRow("Hit rate:", l_hit_rate);
     l_speed = new QLabel("100%", top_form);
     layout_top_form->addRow("Improved speed:", l_speed);
+    l_prefetch = new QLabel("0 / 0 / 0 / 0", top_form);
+    layout_top_form->addRow("Prefetch issued/useful/late/useless:", l_prefetch);
 
     graphicsview = new GraphicsView(top_widget);
     graphicsview->setVisible(false);
@@ -81,6 +83,7 @@ void CacheDock::setup(const machine::Cache *cache) {
     l_m_writes->setText("0");
     l_hit_rate->setText("0.000%");
     l_speed->setText("100%");
+    l_prefetch->setText("0 / 0 / 0 / 0");
     if (cache != nullptr) {
         connect(
             cache, &machine::Cache::hit_update, this, &CacheDock::hit_update);
@@ -95,14 +98,27 @@ void CacheDock::setup(const machine::Cache *cache) {
         connect(
             cache, &machine::Cache::statistics_update, this,
             &CacheDock::statistics_update);
+        connect(
+            cache, &machine::Cache::prefetch_update, this,
+            &CacheDock::prefetch_update);
     }
     top_form->setVisible(cache != nullptr);
-    no_cache->setVisible(!cache->get_config().enabled());
+    bool prefetching = cache != nullptr
+                       && cache->get_config().prefetcher()
+                              != machine::CacheConfig::PF_NONE;
+    l_prefetch->setVisible(prefetching);
+    layout_top_form->labelForField(l_prefetch)->setVisible(prefetching);
+    // Lower cache levels are not created when they are disabled
+    bool enabled = cache != nullptr && cache->get_config().enabled();
+    no_cache->setVisible(!enabled);
 
     delete cachescene;
-    cachescene = new CacheViewScene(cache);
+    cachescene = nullptr;
+    if (cache != nullptr) {
+        cachescene = new CacheViewScene(cache);
+    }
     graphicsview->setScene(cachescene);
-    graphicsview->setVisible(cache->get_config().enabled());
+    graphicsview->setVisible(enabled);
 }
 
 void CacheDock::hit_update(unsigned val) {
@@ -129,3 +145,15 @@ void CacheDock::statistics_update(
     l_hit_rate->setText(QString::number(hit_rate, 'f', 3) + QString("%"));
     l_speed->setText(QString::number(speed_improv, 'f', 0) + QString("%"));
 }
+
+void CacheDock::prefetch_update(
+    unsigned issued,
+    unsigned useful,
+    unsigned late,
+    unsigned useless) {
+    l_prefetch->setText(QString("%1 / %2 / %3 / %4")
+                            .arg(issued)
+                            .arg(useful)
+                            .arg(late)
+                            .arg(useless));
+}
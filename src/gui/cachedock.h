@@ -60,6 +60,11 @@ private slots:
         unsigned stalled_cycles,
         double speed_improv,
         double hit_rate);
+    void prefetch_update(
+        unsigned issued,
+        unsigned useful,
+        unsigned late,
+        unsigned useless);
 
 private:
     QVBoxLayout *layout_box;
@@ -68,6 +73,7 @@ private:
     QLabel *l_hit, *l_miss, *l_stalled, *l_speed, *l_hit_rate;
     QLabel *no_cache;
     QLabel *l_m_reads, *l_m_writes;
+    QLabel *l_prefetch;
     GraphicsView *graphicsview;
     CacheViewScene *cachescene;
 };
@@ -96,6 +96,10 @@ MainWindow::MainWindow(QSettings *settings, QWidget *parent)
     cache_program->hide();
     cache_data = new CacheDock(this, "Data");
     cache_data->hide();
+    cache_level2 = new CacheDock(this, "L2");
+    cache_level2->hide();
+    cache_level3 = new CacheDock(this, "L3");
+    cache_level3->hide();
     peripherals = new PeripheralsDock(this, settings);
     peripherals->hide();
     terminal = new TerminalDock(this, settings);
@@ -104,6 +108,8 @@ MainWindow::MainWindow(QSettings *settings, QWidget *parent)
     lcd_display->hide();
     cop0dock = new Cop0Dock(this);
     cop0dock->hide();
+    profiler = new ProfilerDock(this);
+    profiler->hide();
     messages = new MessagesDock(this, settings);
     messages->hide();
 
@@ -164,6 +170,12 @@ MainWindow::MainWindow(QSettings *settings, QWidget *parent)
     connect(
         ui->actionData_Cache, &QAction::triggered, this,
         &MainWindow::show_cache_data);
+    connect(
+        ui->actionL2_Cache, &QAction::triggered, this,
+        &MainWindow::show_cache_level2);
+    connect(
+        ui->actionL3_Cache, &QAction::triggered, this,
+        &MainWindow::show_cache_level3);
     connect(
         ui->actionPeripherals, &QAction::triggered, this,
         &MainWindow::show_peripherals);
@@ -176,6 +188,9 @@ MainWindow::MainWindow(QSettings *settings, QWidget *parent)
     connect(
         ui->actionCop0State, &QAction::triggered, this,
         &MainWindow::show_cop0dock);
+    connect(
+        ui->actionProfiler, &QAction::triggered, this,
+        &MainWindow::show_profiler);
     connect(
         ui->actionCore_View_show, &QAction::triggered, this,
         &MainWindow::show_hide_coreview);
@@ -247,6 +262,8 @@ MainWindow::~MainWindow() {
     delete memory;
     delete cache_program;
     delete cache_data;
+    delete cache_level2;
+    delete cache_level3;
     delete peripherals;
     delete terminal;
     delete lcd_display;
@@ -278,7 +295,8 @@ void MainWindow::show_hide_coreview(bool show) {
         return;
     }
 
-    if (machine->config().pipelined()) {
+    // Out-of-order core executes instructions by the single cycle stages
+    if (machine->config().pipelined() && !machine->config().out_of_order().enabled()) {
         corescene = new CoreViewScenePipelined(machine);
     } else {
         corescene = new CoreViewSceneSimple(machine);
@@ -326,6 +344,12 @@ void MainWindow::create_core(
     // Remove old machine
     delete machine;
     machine = new_machine;
+#ifndef __EMSCRIPTEN__
+    // Keep GUI responsive when running at maximal speed
+    machine->set_worker_thread(true);
+#endif
+    // Snapshots for stepping backwards
+    machine->set_history(100000, 64);
 
     // Create machine view
     delete corescene;
@@ -346,7 +370,7 @@ void MainWindow::create_core(
             terminal, QOverload<int, unsigned int>::of(&TerminalDock::tx_byte));
         connect(
             osemu_handler, &osemu::OsSyscallExceptionHandler::rx_byte_pool,
-            terminal, &TerminalDock::rx_byte_pool);
+            terminal, &TerminalDock::rx_byte_pool, Qt::DirectConnection);
         machine->set_step_over_exception(machine::EXCAUSE_SYSCALL, true);
         machine->set_stop_on_exception(machine::EXCAUSE_SYSCALL, false);
     } else {
@@ -363,6 +387,12 @@ void MainWindow::create_core(
         &machine::Machine::pause);
     connect(
         ui->actionStep, &QAction::triggered, machine, &machine::Machine::step);
+    connect(
+        ui->actionStepBack, &QAction::triggered, machine,
+        &machine::Machine::step_back);
+    connect(
+        ui->actionRunBack, &QAction::triggered, machine,
+        &machine::Machine::run_back);
     connect(
         ui->actionRestart, &QAction::triggered, machine,
         &machine::Machine::restart);
@@ -386,10 +416,13 @@ void MainWindow::create_core(
     memory->setup(machine);
     cache_program->setup(machine->cache_program());
     cache_data->setup(machine->cache_data());
-    terminal->setup(machine->serial_port());
-    peripherals->setup(machine->peripheral_spi_led());
+    cache_level2->setup(machine->cache_level2());
+    cache_level3->setup(machine->cache_level3());
+    terminal->setup(machine);
+    peripherals->setup(machine);
     lcd_display->setup(machine->peripheral_lcd_display());
     cop0dock->setup(machine);
+    profiler->setup(machine);
 
     // Connect signals for instruction address followup
     connect(
@@ -487,10 +520,13 @@ SHOW_HANDLER(program, Qt::LeftDockWidgetArea)
 SHOW_HANDLER(memory, Qt::RightDockWidgetArea)
 SHOW_HANDLER(cache_program, Qt::RightDockWidgetArea)
 SHOW_HANDLER(cache_data, Qt::RightDockWidgetArea)
+SHOW_HANDLER(cache_level2, Qt::RightDockWidgetArea)
+SHOW_HANDLER(cache_level3, Qt::RightDockWidgetArea)
 SHOW_HANDLER(peripherals, Qt::RightDockWidgetArea)
 SHOW_HANDLER(terminal, Qt::RightDockWidgetArea)
 SHOW_HANDLER(lcd_display, Qt::RightDockWidgetArea)
 SHOW_HANDLER(cop0dock, Qt::TopDockWidgetArea)
+SHOW_HANDLER(profiler, Qt::BottomDockWidgetArea)
 SHOW_HANDLER(messages, Qt::BottomDockWidgetArea)
 #undef SHOW_HANDLER
 
@@ -633,12 +669,16 @@ void MainWindow::machine_status(enum machine::Machine::Status st) {
         ui->actionPause->setEnabled(false);
         ui->actionRun->setEnabled(true);
         ui->actionStep->setEnabled(true);
+        ui->actionStepBack->setEnabled(true);
+        ui->actionRunBack->setEnabled(true);
         status = "Ready";
         break;
     case machine::Machine::ST_RUNNING:
         ui->actionPause->setEnabled(true);
         ui->actionRun->setEnabled(false);
         ui->actionStep->setEnabled(false);
+        ui->actionStepBack->setEnabled(false);
+        ui->actionRunBack->setEnabled(false);
         status = "Running";
         break;
     case machine::Machine::ST_BUSY:
@@ -661,6 +701,9 @@ void MainWindow::machine_exit() {
     ui->actionPause->setEnabled(false);
     ui->actionRun->setEnabled(false);
     ui->actionStep->setEnabled(false);
+    // Program can be still inspected by return to the past
+    ui->actionStepBack->setEnabled(true);
+    ui->actionRunBack->setEnabled(true);
 }
 
 void MainWindow::machine_trap(machine::SimulatorException &e) {
@@ -1160,6 +1203,8 @@ void MainWindow::compile_source() {
 
     sasm.setup(mem, &symtab, machine::Address(0x80020000));
 
+    // Program is stored to memory of possibly running machine
+    machine->state_lock();
     int ln = 1;
     for (QTextBlock block = doc->begin(); block.isValid();
          block = block.next(), ln++) {
@@ -1171,6 +1216,7 @@ void MainWindow::compile_source() {
     if (!sasm.finish()) {
         error_occured = true;
     }
+    machine->state_unlock();
 
     if (error_occured) {
         show_messages();
@@ -49,6 +49,7 @@
 #include "messagesdock.h"
 #include "newdialog.h"
 #include "peripheralsdock.h"
+#include "profilerdock.h"
 #include "programdock.h"
 #include "registersdock.h"
 #include "terminaldock.h"
@@ -110,10 +111,13 @@ public slots:
     void show_memory();
     void show_cache_data();
     void show_cache_program();
+    void show_cache_level2();
+    void show_cache_level3();
     void show_peripherals();
     void show_terminal();
     void show_lcd_display();
     void show_cop0dock();
+    void show_profiler();
     void show_hide_coreview(bool show);
     void show_symbol_dialog();
     void show_messages();
@@ -159,10 +163,12 @@ private:
     ProgramDock *program {};
     MemoryDock *memory {};
     CacheDock *cache_program {}, *cache_data {};
+    CacheDock *cache_level2 {}, *cache_level3 {};
     PeripheralsDock *peripherals {};
     TerminalDock *terminal {};
     LcdDisplayDock *lcd_display {};
     Cop0Dock *cop0dock {};
+    ProfilerDock *profiler {};
     MessagesDock *messages {};
     bool coreview_shown;
     SrcEditor *current_srceditor;
@@ -134,12 +134,15 @@ QVariant MemoryModel::data(const QModelIndex &index, int role) const {
         if (address < index0_offset) {
             return QString("");
         }
+        // Core can be running on the worker thread
+        machine->state_lock();
         switch (cell_size) {
         case CELLSIZE_BYTE: data = mem->read_u8(address,ae::INTERNAL); break;
         case CELLSIZE_HWORD: data = mem->read_u16(address,ae::INTERNAL); break;
         default:
         case CELLSIZE_WORD: data = mem->read_u32(address,ae::INTERNAL); break;
         }
+        machine->state_unlock();
 
         t = QString::number(data, 16);
         s.fill('0', cellSizeBytes() * 2 - t.count());
@@ -165,7 +168,9 @@ QVariant MemoryModel::data(const QModelIndex &index, int role) const {
         address += cellSizeBytes() * (index.column() - 1);
         if (machine->cache_data() != nullptr) {
             machine::LocationStatus loc_stat;
+            machine->state_lock();
             loc_stat = machine->cache_data()->location_status(address);
+            machine->state_unlock();
             if (loc_stat & machine::LOCSTAT_DIRTY) {
                 QBrush bgd(Qt::yellow);
                 return bgd;
@@ -182,6 +187,18 @@ QVariant MemoryModel::data(const QModelIndex &index, int role) const {
     return QVariant();
 }
 
+void MemoryModel::state_lock() const {
+    if (machine != nullptr) {
+        machine->state_lock();
+    }
+}
+
+void MemoryModel::state_unlock() const {
+    if (machine != nullptr) {
+        machine->state_unlock();
+    }
+}
+
 void MemoryModel::setup(machine::Machine *machine) {
     this->machine = machine;
     if (machine != nullptr) {
@@ -306,12 +323,15 @@ bool MemoryModel::setData(
             mem = machine->cache_data_rw();
         }
         address += cellSizeBytes() * (index.column() - 1);
+        // Core can be running on the worker thread
+        machine->state_lock();
         switch (cell_size) {
         case CELLSIZE_BYTE: mem->write_u8(address, data,ae::INTERNAL); break;
         case CELLSIZE_HWORD: mem->write_u16(address, data,ae::INTERNAL); break;
         default:
         case CELLSIZE_WORD: mem->write_u32(address, data,ae::INTERNAL); break;
         }
+        machine->state_unlock();
     }
     return true;
 }
@@ -65,6 +65,9 @@ public:
     setData(const QModelIndex &index, const QVariant &value, int role) override;
     bool adjustRowAndOffset(int &row, machine::Address address);
     void update_all();
+    // Held by the view over a repaint, cells are read in one worker pause
+    void state_lock() const;
+    void state_unlock() const;
 
     void setCellsPerRow(unsigned int cells);
 
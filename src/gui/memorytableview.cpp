@@ -240,3 +240,15 @@ void MemoryTableView::keyPressEvent(QKeyEvent *event) {
         Super::keyPressEvent(event);
     }
 }
+
+void MemoryTableView::paintEvent(QPaintEvent *event) {
+    auto *m = dynamic_cast<MemoryModel *>(model());
+    if (m == nullptr) {
+        Super::paintEvent(event);
+        return;
+    }
+    // Without the lock, the core would run a batch between the cells
+    m->state_lock();
+    Super::paintEvent(event);
+    m->state_unlock();
+}
@@ -63,6 +63,7 @@ public slots:
 
 protected:
     void keyPressEvent(QKeyEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
 private slots:
     void adjust_scroll_pos_check();
     void adjust_scroll_pos_process();
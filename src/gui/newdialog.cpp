@@ -60,6 +60,17 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
     ui_cache_p->label_writeback->hide();
     ui_cache_d = new Ui::NewDialogCache();
     ui_cache_d->setupUi(ui->tab_cache_data);
+    // Hit latency and inclusion policy apply to lower levels only
+    for (Ui::NewDialogCache *cui : { ui_cache_p, ui_cache_d }) {
+        cui->hit_latency->hide();
+        cui->label_hit_latency->hide();
+        cui->inclusion_policy->hide();
+        cui->label_inclusion->hide();
+    }
+    ui_cache_l2 = new Ui::NewDialogCache();
+    ui_cache_l2->setupUi(ui->tab_cache_level2);
+    ui_cache_l3 = new Ui::NewDialogCache();
+    ui_cache_l3->setupUi(ui->tab_cache_level3);
 
     connect(
         ui->pushButton_start_empty, &QAbstractButton::clicked, this,
@@ -106,6 +117,45 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
     connect(
         ui->hazard_stall_forward, &QAbstractButton::clicked, this,
         &NewDialog::hazard_unit_change);
+    connect(
+        ui->dual_issue, &QAbstractButton::clicked, this,
+        &NewDialog::dual_issue_change);
+    connect(
+        ui->bp_kind, QOverload<int>::of(&QComboBox::activated), this,
+        &NewDialog::bp_kind_change);
+    connect(
+        ui->bp_table_bits, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::bp_table_bits_change);
+    connect(
+        ui->bp_btb_size, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::bp_btb_size_change);
+    connect(
+        ui->bp_ras_depth, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::bp_ras_depth_change);
+    connect(
+        ui->bp_penalty, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::bp_penalty_change);
+    connect(
+        ui->out_of_order, &QGroupBox::clicked, this,
+        &NewDialog::ooo_enabled_change);
+    connect(
+        ui->ooo_issue_width, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::ooo_issue_width_change);
+    connect(
+        ui->ooo_rob_size, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::ooo_rob_size_change);
+    connect(
+        ui->ooo_rs_size, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::ooo_rs_size_change);
+    connect(
+        ui->ooo_lsq_size, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::ooo_lsq_size_change);
+    connect(
+        ui->ooo_mul_latency, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::ooo_mul_latency_change);
+    connect(
+        ui->ooo_div_latency, QOverload<int>::of(&QSpinBox::valueChanged), this,
+        &NewDialog::ooo_div_latency_change);
 
     connect(
         ui->mem_protec_exec, &QAbstractButton::clicked, this,
@@ -147,6 +197,8 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
 
     cache_handler_d = new NewDialogCacheHandler(this, ui_cache_d);
     cache_handler_p = new NewDialogCacheHandler(this, ui_cache_p);
+    cache_handler_l2 = new NewDialogCacheHandler(this, ui_cache_l2);
+    cache_handler_l3 = new NewDialogCacheHandler(this, ui_cache_l3);
 
     // TODO remove this block when protections are implemented
     ui->mem_protec_exec->setVisible(false);
@@ -158,6 +210,8 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
 NewDialog::~NewDialog() {
     delete ui_cache_d;
     delete ui_cache_p;
+    delete ui_cache_l2;
+    delete ui_cache_l3;
     delete ui;
     // Settings is freed by parent
     delete config;
@@ -268,6 +322,92 @@ void NewDialog::hazard_unit_change() {
     switch2custom();
 }
 
+void NewDialog::dual_issue_change(bool val) {
+    config->set_dual_issue(val);
+    switch2custom();
+}
+
+void NewDialog::bp_kind_change(int v) {
+    config->access_branch_predictor()->set_predictor(
+        (enum machine::BranchPredictorConfig::Predictor)v);
+    switch2custom();
+}
+
+void NewDialog::bp_table_bits_change(int v) {
+    if (config->branch_predictor().table_bits() != (unsigned)v) {
+        config->access_branch_predictor()->set_table_bits(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::bp_btb_size_change(int v) {
+    if (config->branch_predictor().btb_size() != (unsigned)v) {
+        config->access_branch_predictor()->set_btb_size(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::bp_ras_depth_change(int v) {
+    if (config->branch_predictor().ras_depth() != (unsigned)v) {
+        config->access_branch_predictor()->set_ras_depth(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::bp_penalty_change(int v) {
+    if (config->branch_predictor().penalty() != (unsigned)v) {
+        config->access_branch_predictor()->set_penalty(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::ooo_enabled_change(bool v) {
+    config->access_out_of_order()->set_enabled(v);
+    switch2custom();
+}
+
+void NewDialog::ooo_issue_width_change(int v) {
+    if (config->out_of_order().issue_width() != (unsigned)v) {
+        config->access_out_of_order()->set_issue_width(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::ooo_rob_size_change(int v) {
+    if (config->out_of_order().rob_size() != (unsigned)v) {
+        config->access_out_of_order()->set_rob_size(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::ooo_rs_size_change(int v) {
+    if (config->out_of_order().rs_size() != (unsigned)v) {
+        config->access_out_of_order()->set_rs_size(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::ooo_lsq_size_change(int v) {
+    if (config->out_of_order().lsq_size() != (unsigned)v) {
+        config->access_out_of_order()->set_lsq_size(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::ooo_mul_latency_change(int v) {
+    if (config->out_of_order().mul_latency() != (unsigned)v) {
+        config->access_out_of_order()->set_mul_latency(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::ooo_div_latency_change(int v) {
+    if (config->out_of_order().div_latency() != (unsigned)v) {
+        config->access_out_of_order()->set_div_latency(v);
+        switch2custom();
+    }
+}
+
 void NewDialog::mem_protec_exec_change(bool v) {
     config->set_memory_execute_protection(v);
     switch2custom();
@@ -351,6 +491,21 @@ void NewDialog::config_gui() {
         config->hazard_unit() == machine::MachineConfig::HU_STALL);
     ui->hazard_stall_forward->setChecked(
         config->hazard_unit() == machine::MachineConfig::HU_STALL_FORWARD);
+    ui->dual_issue->setChecked(config->dual_issue());
+    const machine::BranchPredictorConfig &bp = config->branch_predictor();
+    ui->bp_kind->setCurrentIndex((int)bp.predictor());
+    ui->bp_table_bits->setValue(bp.table_bits());
+    ui->bp_btb_size->setValue(bp.btb_size());
+    ui->bp_ras_depth->setValue(bp.ras_depth());
+    ui->bp_penalty->setValue(bp.penalty());
+    const machine::OutOfOrderConfig &ooo = config->out_of_order();
+    ui->out_of_order->setChecked(ooo.enabled());
+    ui->ooo_issue_width->setValue(ooo.issue_width());
+    ui->ooo_rob_size->setValue(ooo.rob_size());
+    ui->ooo_rs_size->setValue(ooo.rs_size());
+    ui->ooo_lsq_size->setValue(ooo.lsq_size());
+    ui->ooo_mul_latency->setValue(ooo.mul_latency());
+    ui->ooo_div_latency->setValue(ooo.div_latency());
     // Memory
     ui->mem_protec_exec->setChecked(config->memory_execute_protection());
     ui->mem_protec_write->setChecked(config->memory_write_protection());
@@ -360,6 +515,8 @@ void NewDialog::config_gui() {
     // Cache
     cache_handler_d->config_gui();
     cache_handler_p->config_gui();
+    cache_handler_l2->config_gui();
+    cache_handler_l3->config_gui();
     // Operating system and exceptions
     ui->osemu_enable->setChecked(config->osemu_enable());
     ui->osemu_known_syscall_stop->setChecked(
@@ -373,6 +530,15 @@ void NewDialog::config_gui() {
     // Disable various sections according to configuration
     ui->delay_slot->setEnabled(!config->pipelined());
     ui->hazard_unit->setEnabled(config->pipelined());
+    ui->dual_issue->setEnabled(config->pipelined());
+    ui->branch_predictor->setEnabled(
+        config->pipelined() || config->out_of_order().enabled());
+    bool bp_enabled
+        = config->branch_predictor().predictor() != machine::BranchPredictorConfig::BP_NONE;
+    ui->bp_table_bits->setEnabled(bp_enabled);
+    ui->bp_btb_size->setEnabled(bp_enabled);
+    ui->bp_ras_depth->setEnabled(bp_enabled);
+    ui->bp_penalty->setEnabled(bp_enabled);
 }
 
 unsigned NewDialog::preset_number() {
@@ -397,6 +563,8 @@ void NewDialog::load_settings() {
     config = new machine::MachineConfig(settings);
     cache_handler_d->set_config(config->access_cache_data());
     cache_handler_p->set_config(config->access_cache_program());
+    cache_handler_l2->set_config(config->access_cache_level2());
+    cache_handler_l3->set_config(config->access_cache_level3());
 
     // Load preset
     unsigned preset = settings->value("Preset", 1).toUInt();
@@ -457,6 +625,21 @@ NewDialogCacheHandler::NewDialogCacheHandler(
     connect(
         ui->writeback_policy, QOverload<int>::of(&QComboBox::activated), this,
         &NewDialogCacheHandler::writeback);
+    connect(
+        ui->hit_latency, &QAbstractSpinBox::editingFinished, this,
+        &NewDialogCacheHandler::hitlatency);
+    connect(
+        ui->inclusion_policy, QOverload<int>::of(&QComboBox::activated), this,
+        &NewDialogCacheHandler::inclusion);
+    connect(
+        ui->prefetcher, QOverload<int>::of(&QComboBox::activated), this,
+        &NewDialogCacheHandler::prefetcher);
+    connect(
+        ui->prefetch_degree, &QAbstractSpinBox::editingFinished, this,
+        &NewDialogCacheHandler::prefetchdegree);
+    connect(
+        ui->prefetch_table, &QAbstractSpinBox::editingFinished, this,
+        &NewDialogCacheHandler::prefetchtable);
 }
 
 void NewDialogCacheHandler::set_config(machine::CacheConfig *config) {
@@ -470,6 +653,11 @@ void NewDialogCacheHandler::config_gui() {
     ui->degree_of_associativity->setValue(config->associativity());
     ui->replacement_policy->setCurrentIndex((int)config->replacement_policy());
     ui->writeback_policy->setCurrentIndex((int)config->write_policy());
+    ui->hit_latency->setValue(config->hit_latency());
+    ui->inclusion_policy->setCurrentIndex((int)config->inclusion_policy());
+    ui->prefetcher->setCurrentIndex((int)config->prefetcher());
+    ui->prefetch_degree->setValue(config->prefetch_degree());
+    ui->prefetch_table->setValue(config->prefetch_table_size());
 }
 
 void NewDialogCacheHandler::enabled(bool val) {
@@ -502,3 +690,29 @@ void NewDialogCacheHandler::writeback(int val) {
     config->set_write_policy((enum machine::CacheConfig::WritePolicy)val);
     nd->switch2custom();
 }
+
+void NewDialogCacheHandler::hitlatency() {
+    config->set_hit_latency(ui->hit_latency->value());
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::inclusion(int val) {
+    config->set_inclusion_policy(
+        (enum machine::CacheConfig::InclusionPolicy)val);
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::prefetcher(int val) {
+    config->set_prefetcher((enum machine::CacheConfig::Prefetcher)val);
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::prefetchdegree() {
+    config->set_prefetch_degree(ui->prefetch_degree->value());
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::prefetchtable() {
+    config->set_prefetch_table_size(ui->prefetch_table->value());
+    nd->switch2custom();
+}
@@ -68,6 +68,19 @@ private slots:
     void pipelined_change(bool);
     void delay_slot_change(bool);
     void hazard_unit_change();
+    void dual_issue_change(bool);
+    void bp_kind_change(int);
+    void bp_table_bits_change(int);
+    void bp_btb_size_change(int);
+    void bp_ras_depth_change(int);
+    void bp_penalty_change(int);
+    void ooo_enabled_change(bool);
+    void ooo_issue_width_change(int);
+    void ooo_rob_size_change(int);
+    void ooo_rs_size_change(int);
+    void ooo_lsq_size_change(int);
+    void ooo_mul_latency_change(int);
+    void ooo_div_latency_change(int);
     void mem_protec_exec_change(bool);
     void mem_protec_write_change(bool);
     void mem_time_read_change(int);
@@ -85,6 +98,7 @@ private slots:
 private:
     Ui::NewDialog *ui {};
     Ui::NewDialogCache *ui_cache_p {}, *ui_cache_d {};
+    Ui::NewDialogCache *ui_cache_l2 {}, *ui_cache_l3 {};
     QSettings *settings;
 
     machine::MachineConfig *config;
@@ -94,6 +108,7 @@ private:
     void load_settings();
     void store_settings();
     NewDialogCacheHandler *cache_handler_p {}, *cache_handler_d {};
+    NewDialogCacheHandler *cache_handler_l2 {}, *cache_handler_l3 {};
 };
 
 class NewDialogCacheHandler : public QObject {
@@ -112,6 +127,11 @@ private slots:
     void degreeassociativity();
     void replacement(int);
     void writeback(int);
+    void hitlatency();
+    void inclusion(int);
+    void prefetcher(int);
+    void prefetchdegree();
+    void prefetchtable();
 
 private:
     NewDialog *nd;
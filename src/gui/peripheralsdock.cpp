@@ -48,6 +48,6 @@ PeripheralsDock::PeripheralsDock(QWidget *parent, QSettings *settings)
     setWindowTitle("Peripherals");
 }
 
-void PeripheralsDock::setup(const machine::PeripSpiLed *perip_spi_led) {
-    periph_view->setup(perip_spi_led);
+void PeripheralsDock::setup(machine::Machine *machine) {
+    periph_view->setup(machine);
 }
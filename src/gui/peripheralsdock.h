@@ -50,7 +50,7 @@ class PeripheralsDock : public QDockWidget {
 public:
     PeripheralsDock(QWidget *parent, QSettings *settings);
 
-    void setup(const machine::PeripSpiLed *perip_spi_led);
+    void setup(machine::Machine *machine);
 
 private:
     QVBoxLayout *layout_box;
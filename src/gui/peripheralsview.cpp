@@ -2,6 +2,8 @@
 
 #include "ui_peripheralsview.h"
 
+#include <functional>
+
 PeripheralsView::PeripheralsView(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::PeripheralsView) {
@@ -35,18 +37,34 @@ PeripheralsView::~PeripheralsView() {
     delete ui;
 }
 
-void PeripheralsView::setup(const machine::PeripSpiLed *perip_spi_led) {
+// Knobs are read by the core which can run on the worker thread
+template<typename T>
+static std::function<void(T)> locked_input(
+    machine::Machine *machine,
+    machine::PeripSpiLed *perip_spi_led,
+    void (machine::PeripSpiLed::*input)(T)) {
+    return [machine, perip_spi_led, input](T value) {
+        machine->state_lock();
+        (perip_spi_led->*input)(value);
+        machine->state_unlock();
+    };
+}
+
+void PeripheralsView::setup(machine::Machine *machine) {
+    machine::PeripSpiLed *perip_spi_led = machine->peripheral_spi_led();
     int val;
 
     connect(
         ui->spinRed, QOverload<int>::of(&QSpinBox::valueChanged), perip_spi_led,
-        &machine::PeripSpiLed::red_knob_update);
+        locked_input(machine, perip_spi_led, &machine::PeripSpiLed::red_knob_update));
     connect(
         ui->spinGreen, QOverload<int>::of(&QSpinBox::valueChanged),
-        perip_spi_led, &machine::PeripSpiLed::green_knob_update);
+        perip_spi_led,
+        locked_input(machine, perip_spi_led, &machine::PeripSpiLed::green_knob_update));
     connect(
         ui->spinBlue, QOverload<int>::of(&QSpinBox::valueChanged),
-        perip_spi_led, &machine::PeripSpiLed::blue_knob_update);
+        perip_spi_led,
+        locked_input(machine, perip_spi_led, &machine::PeripSpiLed::blue_knob_update));
 
     val = ui->spinRed->value();
     ui->spinRed->setValue(val - 1);
@@ -62,13 +80,13 @@ void PeripheralsView::setup(const machine::PeripSpiLed *perip_spi_led) {
 
     connect(
         ui->checkRed, &QAbstractButton::clicked, perip_spi_led,
-        &machine::PeripSpiLed::red_knob_push);
+        locked_input(machine, perip_spi_led, &machine::PeripSpiLed::red_knob_push));
     connect(
         ui->checkGreen, &QAbstractButton::clicked, perip_spi_led,
-        &machine::PeripSpiLed::green_knob_push);
+        locked_input(machine, perip_spi_led, &machine::PeripSpiLed::green_knob_push));
     connect(
         ui->checkBlue, &QAbstractButton::clicked, perip_spi_led,
-        &machine::PeripSpiLed::blue_knob_push);
+        locked_input(machine, perip_spi_led, &machine::PeripSpiLed::blue_knob_push));
 
     ui->checkRed->setChecked(false);
     ui->checkGreen->setChecked(false);
@@ -1,6 +1,7 @@
 #ifndef PERIPHERALSVIEW_H
 #define PERIPHERALSVIEW_H
 
+#include "machine/machine.h"
 #include "machine/memory/backend/peripspiled.h"
 
 #include <QWidget>
@@ -16,7 +17,7 @@ public:
     explicit PeripheralsView(QWidget *parent = nullptr);
     ~PeripheralsView() override;
 
-    void setup(const machine::PeripSpiLed *perip_spi_led);
+    void setup(machine::Machine *machine);
 
 public slots:
     void led_line_changed(uint val);
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "profilerdock.h"
+
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QVBoxLayout>
+
+ProfilerDock::ProfilerDock(QWidget *parent) : QDockWidget(parent) {
+    setObjectName("Profiler");
+    setWindowTitle("Profiler");
+
+    QWidget *content = new QWidget(this);
+    table = new QTableWidget(0, COL_COUNT, content);
+    table->setHorizontalHeaderLabels(
+        { "Function", "Address", "Cycles", "%", "Stalls", "Instructions",
+          "I-cache misses", "D-cache misses" });
+    table->verticalHeader()->hide();
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setSortingEnabled(true);
+    table->sortByColumn(COL_CYCLES, Qt::DescendingOrder);
+    total = new QLabel(content);
+    export_button = new QPushButton("Export callgrind...", content);
+    export_button->setToolTip("Save profile with call graph for KCachegrind");
+    connect(
+        export_button, &QPushButton::clicked, this,
+        &ProfilerDock::export_callgrind);
+
+    QHBoxLayout *bottom = new QHBoxLayout;
+    bottom->addWidget(total, 1);
+    bottom->addWidget(export_button);
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->addWidget(table);
+    layout->addLayout(bottom);
+    content->setLayout(layout);
+    setWidget(content);
+
+    // Profile is not refreshed while the dock is hidden
+    connect(
+        this, &QDockWidget::visibilityChanged, this,
+        &ProfilerDock::visibility_changed);
+}
+
+void ProfilerDock::setup(machine::Machine *machine) {
+    this->machine = machine;
+    table->setRowCount(0);
+    total->setText("");
+    if (machine == nullptr) {
+        return;
+    }
+    // Profiling slows down the simulation
+    machine->set_profiling(!isHidden());
+    connect(
+        machine, &machine::Machine::post_tick, this,
+        &ProfilerDock::update_profile);
+}
+
+void ProfilerDock::visibility_changed() {
+    // Dock covered by another tab or minimized window keeps collecting
+    bool enable = !isHidden();
+    if (machine != nullptr && enable != (machine->profiler() != nullptr)) {
+        machine->set_profiling(enable);
+    }
+    update_profile();
+}
+
+void ProfilerDock::export_callgrind() {
+    if (machine == nullptr || machine->profiler() == nullptr) {
+        return;
+    }
+    QString path = QFileDialog::getSaveFileName(
+        this, "Export callgrind profile", "callgrind.out",
+        "Callgrind profile (callgrind.out*);;All files (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+    try {
+        machine->save_callgrind(path);
+    } catch (machine::SimulatorException &e) {
+        QMessageBox::critical(this, "Profiler", e.msg(false));
+    }
+}
+
+void ProfilerDock::update_profile() {
+    if (!isVisible() || machine == nullptr || machine->profiler() == nullptr) {
+        return;
+    }
+    // Dock shown while the core runs on the worker thread
+    machine->state_lock();
+    const machine::Profiler *profiler = machine->profiler();
+    const machine::Profiler::Counters sum = profiler->get_total();
+    std::vector<machine::Profiler::Function> functions
+        = profiler->get_functions(machine->symbol_table());
+    machine->state_unlock();
+
+    // Sorting is suspended, rows would be moved while they are filled
+    table->setSortingEnabled(false);
+    table->setRowCount(functions.size());
+    for (size_t row = 0; row < functions.size(); row++) {
+        const machine::Profiler::Function &function = functions[row];
+        const machine::Profiler::Counters &c = function.counters;
+        auto set_number = [this, row](int column, const QVariant &value) {
+            auto *item = new QTableWidgetItem();
+            item->setData(Qt::DisplayRole, value);
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            table->setItem(row, column, item);
+        };
+        table->setItem(
+            row, COL_NAME,
+            new QTableWidgetItem(function.name.isEmpty() ? "<unknown>" : function.name));
+        table->setItem(
+            row, COL_ADDRESS,
+            new QTableWidgetItem(
+                function.name.isEmpty()
+                    ? QString()
+                    : QString("0x%1").arg(function.start.get_raw(), 8, 16, QChar('0'))));
+        set_number(COL_CYCLES, (qulonglong)c.cycles);
+        set_number(
+            COL_PERCENT,
+            sum.cycles != 0 ? qRound(10000.0 * c.cycles / sum.cycles) / 100.0 : 0.0);
+        set_number(COL_STALLS, (qulonglong)c.stalls);
+        set_number(COL_INSTRUCTIONS, (qulonglong)c.instructions);
+        set_number(COL_ICACHE_MISSES, (qulonglong)c.icache_misses);
+        set_number(COL_DCACHE_MISSES, (qulonglong)c.dcache_misses);
+    }
+    table->setSortingEnabled(true);
+    total->setText(
+        QString("Total: %1 cycles, %2 stalls, %3 instructions")
+            .arg(sum.cycles)
+            .arg(sum.stalls)
+            .arg(sum.instructions));
+}
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef PROFILERDOCK_H
+#define PROFILERDOCK_H
+
+#include "machine/machine.h"
+
+#include <QDockWidget>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+
+/**
+ * Flat profile of the program by functions (see `machine::Profiler`),
+ * columns can be sorted. Updated while visible. The machine collects the
+ * profile only while the dock is open, closing it drops the profile.
+ */
+class ProfilerDock : public QDockWidget {
+    Q_OBJECT
+public:
+    ProfilerDock(QWidget *parent);
+
+    void setup(machine::Machine *machine);
+
+private slots:
+    void visibility_changed();
+    void update_profile();
+    void export_callgrind();
+
+private:
+    enum Column {
+        COL_NAME,
+        COL_ADDRESS,
+        COL_CYCLES,
+        COL_PERCENT,
+        COL_STALLS,
+        COL_INSTRUCTIONS,
+        COL_ICACHE_MISSES,
+        COL_DCACHE_MISSES,
+        COL_COUNT
+    };
+
+    machine::Machine *machine = nullptr;
+    QTableWidget *table;
+    QLabel *total;
+    QPushButton *export_button;
+};
+
+#endif // PROFILERDOCK_H
@@ -123,7 +123,10 @@ QVariant ProgramModel::data(const QModelIndex &index, int role) const {
             return QString(" ");
         }
 
+        // Core can be running on the worker thread
+        machine->state_lock();
         machine::Instruction inst(mem->read_u32(address));
+        machine->state_unlock();
 
         switch (index.column()) {
         case 0:
@@ -147,7 +150,9 @@ QVariant ProgramModel::data(const QModelIndex &index, int role) const {
         }
         if (index.column() == 2 && machine->cache_program() != nullptr) {
             machine::LocationStatus loc_stat;
+            machine->state_lock();
             loc_stat = machine->cache_program()->location_status(address);
+            machine->state_unlock();
             if (loc_stat & machine::LOCSTAT_CACHED) {
                 QBrush bgd(Qt::lightGray);
                 return bgd;
@@ -175,12 +180,32 @@ QVariant ProgramModel::data(const QModelIndex &index, int role) const {
         }
         return QVariant();
     }
+    if (role == Qt::ToolTipRole) {
+        machine::Address address;
+        if (index.column() != 0 || !get_row_address(address, index.row())
+            || machine == nullptr || !machine->is_hwbreak(address)) {
+            return QVariant();
+        }
+        return tr("Breakpoint hits: %1").arg(machine->get_hwbreak_count(address));
+    }
     if (role == Qt::FontRole) {
         return data_font;
     }
     return QVariant();
 }
 
+void ProgramModel::state_lock() const {
+    if (machine != nullptr) {
+        machine->state_lock();
+    }
+}
+
+void ProgramModel::state_unlock() const {
+    if (machine != nullptr) {
+        machine->state_unlock();
+    }
+}
+
 void ProgramModel::setup(machine::Machine *machine) {
     this->machine = machine;
     for (auto &i : stage_addr) {
@@ -306,7 +331,10 @@ bool ProgramModel::setData(
             if (!ok) {
                 return false;
             }
+            // Core can be running on the worker thread
+            machine->state_lock();
             mem->write_u32(address, data,ae::INTERNAL);
+            machine->state_unlock();
             break;
         case 3:
             if (machine::Instruction::code_from_string(
@@ -317,7 +345,9 @@ bool ProgramModel::setData(
 
                 return false;
             }
+            machine->state_lock();
             mem->write_u32(address, data,ae::INTERNAL);
+            machine->state_unlock();
             break;
         default: return false;
         }
@@ -58,6 +58,9 @@ public:
     bool
     setData(const QModelIndex &index, const QVariant &value, int role) override;
     bool adjustRowAndOffset(int &row, machine::Address address);
+    // Held by the view over a repaint, rows are read in one worker pause
+    void state_lock() const;
+    void state_unlock() const;
 
     inline const QFont *getFont() const {
         return &data_font;
@@ -222,3 +222,15 @@ void ProgramTableView::keyPressEvent(QKeyEvent *event) {
         Super::keyPressEvent(event);
     }
 }
+
+void ProgramTableView::paintEvent(QPaintEvent *event) {
+    auto *m = dynamic_cast<ProgramModel *>(model());
+    if (m == nullptr) {
+        Super::paintEvent(event);
+        return;
+    }
+    // Without the lock, the core would run a batch between the cells
+    m->state_lock();
+    Super::paintEvent(event);
+    m->state_unlock();
+}
@@ -37,6 +37,7 @@
 
 #include "machine/memory/backend/serialport.h"
 
+#include <QMutexLocker>
 #include <QString>
 #include <QTextBlock>
 #include <QTextCursor>
@@ -57,6 +58,9 @@ TerminalDock::TerminalDock(QWidget *parent, QSettings *settings)
     input_edit = new QLineEdit();
     layout_bottom_box->addWidget(input_edit);
     layout_box->addLayout(layout_bottom_box);
+    connect(
+        input_edit, &QLineEdit::textChanged, this,
+        &TerminalDock::input_changed);
 
     setObjectName("Terminal");
     setWindowTitle("Terminal");
@@ -66,7 +70,8 @@ TerminalDock::~TerminalDock() {
     delete append_cursor;
 }
 
-void TerminalDock::setup(machine::SerialPort *ser_port) {
+void TerminalDock::setup(machine::Machine *machine) {
+    machine::SerialPort *ser_port = machine->serial_port();
     if (ser_port == nullptr) {
         return;
     }
@@ -75,10 +80,14 @@ void TerminalDock::setup(machine::SerialPort *ser_port) {
         QOverload<unsigned int>::of(&TerminalDock::tx_byte));
     connect(
         ser_port, &machine::SerialPort::rx_byte_pool, this,
-        &TerminalDock::rx_byte_pool);
-    connect(
-        input_edit, &QLineEdit::textChanged, ser_port,
-        &machine::SerialPort::rx_queue_check);
+        &TerminalDock::rx_byte_pool, Qt::DirectConnection);
+    // Received byte raises interrupt of the core which can run on the worker
+    // thread
+    connect(input_edit, &QLineEdit::textChanged, ser_port, [machine, ser_port]() {
+        machine->state_lock();
+        ser_port->rx_queue_check();
+        machine->state_unlock();
+    });
 }
 
 void TerminalDock::tx_byte(unsigned int data) {
@@ -102,11 +111,30 @@ void TerminalDock::tx_byte(int fd, unsigned int data) {
 
 void TerminalDock::rx_byte_pool(int fd, unsigned int &data, bool &available) {
     (void)fd;
-    QString str = input_edit->text();
+    QMutexLocker locker(&rx_lock);
     available = false;
-    if (str.count() > 0) {
-        data = str[0].toLatin1();
-        input_edit->setText(str.remove(0, 1));
+    if (rx_pending.count() > 0) {
+        data = rx_pending[0].toLatin1();
+        rx_pending.remove(0, 1);
+        rx_consumed++;
         available = true;
+        QMetaObject::invokeMethod(this, "input_consumed", Qt::QueuedConnection);
+    }
+}
+
+void TerminalDock::input_changed(const QString &text) {
+    QMutexLocker locker(&rx_lock);
+    rx_pending = text.mid(rx_consumed);
+}
+
+void TerminalDock::input_consumed() {
+    int consumed;
+    {
+        QMutexLocker locker(&rx_lock);
+        consumed = rx_consumed;
+        rx_consumed = 0;
+    }
+    if (consumed > 0) {
+        input_edit->setText(input_edit->text().mid(consumed));
     }
 }
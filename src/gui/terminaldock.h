@@ -42,6 +42,7 @@
 #include <QFormLayout>
 #include <QLabel>
 #include <QLineEdit>
+#include <QMutex>
 #include <QTextCursor>
 #include <QTextEdit>
 
@@ -51,13 +52,18 @@ public:
     TerminalDock(QWidget *parent, QSettings *settings);
     ~TerminalDock() override;
 
-    void setup(machine::SerialPort *ser_port);
+    void setup(machine::Machine *machine);
 
 public slots:
     void tx_byte(unsigned int data);
     void tx_byte(int fd, unsigned int data);
+    // Can be called (direct connection) from the thread running the machine
     void rx_byte_pool(int fd, unsigned int &data, bool &available);
 
+private slots:
+    void input_changed(const QString &text);
+    void input_consumed();
+
 private:
     QVBoxLayout *layout_box;
     QHBoxLayout *layout_bottom_box;
@@ -66,6 +72,12 @@ private:
     QTextEdit *terminal_text;
     QTextCursor *append_cursor;
     QLineEdit *input_edit;
+
+    // Input not yet read by the machine, characters already read are removed
+    // from input_edit later in the GUI thread
+    QMutex rx_lock;
+    QString rx_pending;
+    int rx_consumed = 0;
 };
 
 #endif // TERMINALDOCK_H
@@ -0,0 +1,322 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "basicblock.h"
+
+#include "alu.h"
+#include "utils.h"
+
+#include <algorithm>
+
+using namespace machine;
+
+/*
+ * Handlers below implement the same data path as `Core::decode`,
+ * `Core::execute`, `Core::memory`, `Core::writeback` and `Core::handle_pc`
+ * for instructions which cannot raise an exception. Any change of the
+ * semantics there has to be reflected here.
+ */
+
+static inline bool
+update_pc(const BasicBlockOp &op, Registers *regs, const RegisterValue &val_rs, const RegisterValue &val_rt) {
+    if (op.flags & IMF_JUMP) {
+        if (!(op.flags & IMF_BJR_REQ_RS)) {
+            regs->pc_abs_jmp_28(Address(op.jump_target));
+        } else {
+            regs->pc_abs_jmp(Address(val_rs.as_u32()));
+        }
+        return true;
+    }
+
+    bool branch = false;
+    if (op.flags & IMF_BRANCH) {
+        if (op.flags & IMF_BJR_REQ_RT) {
+            branch = val_rs.as_u32() == val_rt.as_u32();
+        } else if (!(op.flags & IMF_BGTZ_BLEZ)) {
+            branch = val_rs.as_i32() < 0;
+        } else {
+            branch = val_rs.as_i32() <= 0;
+        }
+        if (op.flags & IMF_BJ_NOT) { branch = !branch; }
+    }
+
+    if (branch) {
+        regs->pc_abs_jmp(Address(op.branch_target));
+    } else {
+        regs->pc_inc();
+    }
+    return branch;
+}
+
+// Any supported instruction without exception and with regular or no memory access
+static bool op_generic(const BasicBlockOp &op, Registers *regs, FrontendMemory *mem_data) {
+    bool discard;
+    enum ExceptionCause excause = EXCAUSE_NONE;
+    RegisterValue val_rs = regs->read_gp(op.num_rs);
+    RegisterValue val_rt = regs->read_gp(op.num_rt);
+    if (op.flags & (IMF_PC8_TO_RT | IMF_PC_TO_R31)) { val_rt = op.link_val; }
+
+    RegisterValue alu_sec = val_rt;
+    if (op.flags & IMF_ALUSRC) { alu_sec = op.immediate_val; }
+    RegisterValue alu_val
+        = alu_operate(op.alu_op, val_rs, alu_sec, op.shamt, op.num_rd, regs, discard, excause);
+
+    RegisterValue towrite_val = alu_val;
+    if (op.flags & IMF_MEMWRITE) {
+        mem_data->write_ctl(op.mem_ctl, Address(alu_val.as_u32()), val_rt);
+    }
+    if (op.flags & IMF_MEMREAD) {
+        towrite_val = mem_data->read_ctl(op.mem_ctl, Address(alu_val.as_u32()));
+    }
+    if ((op.flags & IMF_REGWRITE) && !discard) { regs->write_gp(op.rwrite, towrite_val); }
+
+    return update_pc(op, regs, val_rs, val_rt);
+}
+
+// ALU operation without memory access and control transfer
+static bool op_alu(const BasicBlockOp &op, Registers *regs, FrontendMemory *mem_data) {
+    UNUSED(mem_data)
+    bool discard;
+    enum ExceptionCause excause = EXCAUSE_NONE;
+    RegisterValue alu_sec;
+    if (op.flags & IMF_ALUSRC) {
+        alu_sec = op.immediate_val;
+    } else {
+        alu_sec = regs->read_gp(op.num_rt);
+    }
+    RegisterValue alu_val = alu_operate(
+        op.alu_op, regs->read_gp(op.num_rs), alu_sec, op.shamt, op.num_rd, regs, discard, excause);
+    if (!discard) { regs->write_gp(op.rwrite, alu_val); }
+    regs->pc_inc();
+    return false;
+}
+
+// Regular load with base + offset addressing
+static bool op_load(const BasicBlockOp &op, Registers *regs, FrontendMemory *mem_data) {
+    Address mem_addr(regs->read_gp(op.num_rs).as_u32() + op.immediate_val);
+    regs->write_gp(op.rwrite, mem_data->read_ctl(op.mem_ctl, mem_addr));
+    regs->pc_inc();
+    return false;
+}
+
+// Regular store with base + offset addressing
+static bool op_store(const BasicBlockOp &op, Registers *regs, FrontendMemory *mem_data) {
+    Address mem_addr(regs->read_gp(op.num_rs).as_u32() + op.immediate_val);
+    mem_data->write_ctl(op.mem_ctl, mem_addr, regs->read_gp(op.num_rt));
+    regs->pc_inc();
+    return false;
+}
+
+// Conditional branch without link
+static bool op_branch(const BasicBlockOp &op, Registers *regs, FrontendMemory *mem_data) {
+    UNUSED(mem_data)
+    RegisterValue val_rs = regs->read_gp(op.num_rs);
+    RegisterValue val_rt = regs->read_gp(op.num_rt);
+    return update_pc(op, regs, val_rs, val_rt);
+}
+
+BasicBlockCache::BasicBlockCache(bool delay_slot)
+    : delay_slot(delay_slot)
+    , code_pages(1u << (32 - PAGE_BITS), 0) {}
+
+BasicBlockCache::~BasicBlockCache() {
+    invalidate();
+}
+
+BasicBlock *BasicBlockCache::lookup(Address start_addr) {
+    BasicBlock *bb = blocks.value(start_addr.get_raw());
+    if (bb != nullptr) {
+        return bb;
+    }
+    if (blocks.size() >= MAX_BLOCKS) {
+        invalidate();
+    }
+    bb = new BasicBlock();
+    bb->start_addr = start_addr.get_raw();
+    bb->closed = false;
+    bb->epoch = epoch - 1;
+    blocks.insert(bb->start_addr, bb);
+    return bb;
+}
+
+BasicBlock *BasicBlockCache::lookup_verified(Address start_addr, FrontendMemory *mem_program) {
+    BasicBlock *bb = blocks.value(start_addr.get_raw());
+    if (bb == nullptr || !bb->closed) {
+        return nullptr;
+    }
+    if (bb->epoch == epoch) {
+        return bb;
+    }
+    Address addr = start_addr;
+    for (size_t i = 0; i < bb->ops.size(); i++, addr += 4) {
+        if (mem_program->read_u32(addr, ae::INTERNAL) != bb->ops[i].inst_word) {
+            truncate(bb, i);
+            return nullptr;
+        }
+        code_pages[addr.get_raw() >> PAGE_BITS] = 1;
+    }
+    bb->epoch = epoch;
+    return bb;
+}
+
+const BasicBlockOp &
+BasicBlockCache::append(BasicBlock *bb, Address inst_addr, const Instruction &inst) const {
+    Q_ASSERT(!bb->closed);
+    Q_ASSERT(inst_addr.get_raw() == bb->start_addr + 4 * bb->ops.size());
+    bb->ops.emplace_back();
+    BasicBlockOp &op = bb->ops.back();
+    translate_op(op, inst_addr, inst);
+
+    if (bb->ops.size() >= MAX_OPS) {
+        bb->closed = true;
+    } else if (bb->ops.size() >= 2 && delay_slot) {
+        // Delay slot of the control transfer ends the block
+        const BasicBlockOp &prev = bb->ops[bb->ops.size() - 2];
+        if (prev.flags & (IMF_JUMP | IMF_BRANCH)) {
+            bb->closed = true;
+        }
+    }
+    if (!delay_slot && (op.flags & (IMF_JUMP | IMF_BRANCH))) {
+        bb->closed = true;
+    }
+    return op;
+}
+
+void BasicBlockCache::truncate(BasicBlock *bb, size_t pos) const {
+    bb->ops.resize(pos);
+    bb->closed = false;
+    bb->epoch = epoch - 1;
+}
+
+bool BasicBlockCache::is_code(Address addr) const {
+    // Unaligned and wider accesses cannot cross page boundary by more
+    // than a few bytes, check both ends
+    return code_pages[addr.get_raw() >> PAGE_BITS]
+           || code_pages[(addr.get_raw() + 7) >> PAGE_BITS];
+}
+
+void BasicBlockCache::memory_written(Address addr) {
+    if (is_code(addr)) {
+        epoch++;
+    }
+}
+
+void BasicBlockCache::memory_may_have_changed() {
+    epoch++;
+}
+
+void BasicBlockCache::invalidate() {
+    qDeleteAll(blocks);
+    blocks.clear();
+    std::fill(code_pages.begin(), code_pages.end(), 0);
+    epoch++;
+}
+
+int BasicBlockCache::get_block_count() const {
+    return blocks.size();
+}
+
+void BasicBlockCache::translate_op(BasicBlockOp &op, Address inst_addr, const Instruction &inst) {
+    PredecodedInstruction pd {};
+    PredecodeCache::decode(pd, inst_addr, inst);
+
+    op.inst_word = inst.data();
+    op.flags = pd.flags;
+    op.alu_op = pd.alu_op;
+    op.mem_ctl = pd.mem_ctl;
+    op.num_rs = pd.num_rs;
+    op.num_rt = pd.num_rt;
+    op.num_rd = pd.num_rd;
+    op.rwrite = (pd.flags & IMF_PC_TO_R31) ? 31 : (pd.flags & IMF_REGD) ? pd.num_rd : pd.num_rt;
+    op.shamt = inst.shamt();
+    op.immediate_val = pd.immediate_val;
+    op.link_val = (inst_addr + 8).get_raw();
+    int32_t rel_offset = inst.immediate() << 2;
+    if (rel_offset & (1 << 17)) { rel_offset -= 1 << 18; }
+    op.branch_target = (inst_addr + rel_offset + 4).get_raw();
+    op.jump_target = (inst.address() << 2).get_raw();
+    op.handler = nullptr;
+
+    const enum InstructionFlags flags = pd.flags;
+    if (!(flags & IMF_SUPPORTED) || (flags & (IMF_EXCEPTION | IMF_STOP_IF))) {
+        return;
+    }
+    switch (pd.alu_op) {
+    case ALU_OP_ADD:
+    case ALU_OP_SUB:
+    case ALU_OP_TGE:
+    case ALU_OP_TGEU:
+    case ALU_OP_TLT:
+    case ALU_OP_TLTU:
+    case ALU_OP_TEQ:
+    case ALU_OP_TNE:
+    case ALU_OP_BREAK:
+    case ALU_OP_SYSCALL:
+    case ALU_OP_RDHWR:
+    case ALU_OP_MTC0:
+    case ALU_OP_MFC0:
+    case ALU_OP_MFMC0:
+    case ALU_OP_ERET:
+    case ALU_OP_UNKNOWN:
+        return; // Can raise exception or needs core state
+    default: break;
+    }
+
+    const bool memread = flags & IMF_MEMREAD;
+    const bool memwrite = flags & IMF_MEMWRITE;
+    if (memread || memwrite) {
+        if (!is_regular_access(pd.mem_ctl)) {
+            return;
+        }
+    } else if (pd.mem_ctl != AC_NONE) {
+        return;
+    }
+
+    const bool control = flags & (IMF_JUMP | IMF_BRANCH);
+    const bool link = flags & (IMF_PC8_TO_RT | IMF_PC_TO_R31);
+    const bool base_offset = pd.alu_op == ALU_OP_ADDU && (flags & IMF_ALUSRC) && !control && !link;
+
+    if (memread && !memwrite && base_offset && (flags & IMF_REGWRITE)) {
+        op.handler = op_load;
+    } else if (memwrite && !memread && base_offset && !(flags & IMF_REGWRITE)) {
+        op.handler = op_store;
+    } else if (!memread && !memwrite && !control && !link && (flags & IMF_REGWRITE)) {
+        op.handler = op_alu;
+    } else if (!memread && !memwrite && (flags & IMF_BRANCH) && !link && !(flags & IMF_REGWRITE)) {
+        op.handler = op_branch;
+    } else {
+        op.handler = op_generic;
+    }
+}
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef BASICBLOCK_H
+#define BASICBLOCK_H
+
+#include "machinedefs.h"
+#include "memory/address.h"
+#include "memory/frontend_memory.h"
+#include "predecode.h"
+#include "registers.h"
+
+#include <QHash>
+#include <cstdint>
+#include <vector>
+
+namespace machine {
+
+struct BasicBlockOp;
+
+/**
+ * Handler executing single translated instruction including register
+ * writeback and program counter update.
+ *
+ * @return  true when branch or jump has been taken (same meaning as
+ *          result of `Core::handle_pc`)
+ */
+typedef bool (*BasicBlockHandler)(
+    const BasicBlockOp &op,
+    Registers *regs,
+    FrontendMemory *mem_data);
+
+/**
+ * Translated form of one instruction of the basic block.
+ *
+ * Operation without handler cannot be executed by the block interpreter
+ * (coprocessor 0 access, traps, syscalls, special memory accesses, ...)
+ * and has to be processed by generic core stages.
+ */
+struct BasicBlockOp {
+    BasicBlockHandler handler;      // nullptr for generic processing
+    uint32_t inst_word;             // Instruction word the op was built from
+    enum InstructionFlags flags;
+    enum AluOp alu_op;
+    enum AccessControl mem_ctl;
+    uint8_t num_rs;
+    uint8_t num_rt;
+    uint8_t num_rd;
+    uint8_t rwrite;                 // Destination register number
+    uint8_t shamt;
+    uint32_t immediate_val;
+    uint32_t link_val;              // Address of instruction + 8
+    uint32_t branch_target;         // Target of relative branch
+    uint32_t jump_target;           // Target field of J and JAL (shifted)
+};
+
+/**
+ * Straight line sequence of instructions ending with control transfer
+ * (and its delay slot when enabled) or after `BasicBlockCache::MAX_OPS`.
+ */
+struct BasicBlock {
+    uint32_t start_addr;
+    bool closed;    // No more ops can be appended
+    uint32_t epoch; // Epoch in which ops have been verified against memory
+    std::vector<BasicBlockOp> ops;
+};
+
+/**
+ * Translation cache of basic blocks for the single cycle core interpreter.
+ *
+ * Blocks are built from instruction words really fetched by the core when
+ * the block is executed for the first time, so translation does not cause
+ * any additional memory (and cache statistics) traffic. Each executed op is
+ * compared with the fetched word and the rest of the block is retranslated
+ * on mismatch, so stores to program memory are handled the same way as in
+ * `PredecodeCache`.
+ *
+ * Closed blocks can also be run without fetching their instructions. Such
+ * block is verified against program memory (internal reads without
+ * statistics) whenever memory may have been modified since the last
+ * verification. Stores to pages (4 KiB) with blocks are reported by
+ * `memory_written`, other modifications by `memory_may_have_changed`.
+ */
+class BasicBlockCache {
+public:
+    explicit BasicBlockCache(bool delay_slot);
+    ~BasicBlockCache();
+
+    static constexpr unsigned MAX_OPS = 64;
+    static constexpr int MAX_BLOCKS = 16384;
+
+    // Returns block starting at given address, empty one is created when missing.
+    BasicBlock *lookup(Address start_addr);
+    // Returns closed block starting at given address with ops matching
+    // program memory or nullptr.
+    BasicBlock *lookup_verified(Address start_addr, FrontendMemory *mem_program);
+    // Translates instruction and appends it to the end of the open block.
+    const BasicBlockOp &append(BasicBlock *bb, Address inst_addr, const Instruction &inst) const;
+    // Drops ops from given position on and opens the block again.
+    void truncate(BasicBlock *bb, size_t pos) const;
+
+    // Whether the access may modify instructions of some block
+    bool is_code(Address addr) const;
+    void memory_written(Address addr);
+    void memory_may_have_changed();
+    void invalidate(); // Drop all blocks
+
+    int get_block_count() const;
+
+private:
+    static void translate_op(BasicBlockOp &op, Address inst_addr, const Instruction &inst);
+
+    static constexpr unsigned PAGE_BITS = 12;
+
+    const bool delay_slot;
+    uint32_t epoch = 0;
+    QHash<uint32_t, BasicBlock *> blocks;
+    std::vector<uint8_t> code_pages; // Pages containing some block
+};
+
+} // namespace machine
+
+#endif // BASICBLOCK_H
@@ -0,0 +1,338 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "branch_predictor.h"
+
+#include "utils.h"
+
+#include <QDataStream>
+#include <algorithm>
+
+using namespace machine;
+
+void DirectionPredictor::reset() {}
+
+void DirectionPredictor::save_state(QDataStream &out) const {
+    UNUSED(out)
+}
+
+void DirectionPredictor::load_state(QDataStream &in) {
+    UNUSED(in)
+}
+
+std::unique_ptr<DirectionPredictor>
+DirectionPredictor::get_predictor_instance(const BranchPredictorConfig *config) {
+    switch (config->predictor()) {
+    case BranchPredictorConfig::BP_BIMODAL_1BIT:
+        return std::make_unique<DirectionPredictorBimodal>(config->table_bits(), 1);
+    case BranchPredictorConfig::BP_BIMODAL_2BIT:
+        return std::make_unique<DirectionPredictorBimodal>(config->table_bits(), 2);
+    case BranchPredictorConfig::BP_GSHARE:
+        return std::make_unique<DirectionPredictorGshare>(config->table_bits());
+    default: return std::make_unique<DirectionPredictorStatic>(config->predictor());
+    }
+}
+
+DirectionPredictorStatic::DirectionPredictorStatic(
+    enum BranchPredictorConfig::Predictor kind)
+    : kind(kind) {}
+
+bool DirectionPredictorStatic::predict(Address inst_addr, Address target) const {
+    switch (kind) {
+    case BranchPredictorConfig::BP_STATIC_TAKEN: return true;
+    case BranchPredictorConfig::BP_BTFN: return target <= inst_addr;
+    default: return false;
+    }
+}
+
+void DirectionPredictorStatic::update(Address inst_addr, bool taken) {
+    UNUSED(inst_addr)
+    UNUSED(taken)
+}
+
+DirectionPredictorBimodal::DirectionPredictorBimodal(
+    unsigned table_bits,
+    unsigned counter_bits)
+    : counters(1U << table_bits)
+    , mask((1U << table_bits) - 1)
+    , counter_max((1U << counter_bits) - 1) {
+    DirectionPredictorBimodal::reset();
+}
+
+bool DirectionPredictorBimodal::predict(Address inst_addr, Address target) const {
+    UNUSED(target)
+    return counters[index(inst_addr)] > counter_max / 2;
+}
+
+void DirectionPredictorBimodal::update(Address inst_addr, bool taken) {
+    uint8_t &counter = counters[index(inst_addr)];
+    if (taken && counter < counter_max) {
+        counter++;
+    } else if (!taken && counter > 0) {
+        counter--;
+    }
+}
+
+void DirectionPredictorBimodal::reset() {
+    // Weakly not taken
+    std::fill(counters.begin(), counters.end(), counter_max / 2);
+}
+
+void DirectionPredictorBimodal::save_state(QDataStream &out) const {
+    for (uint8_t counter : counters) {
+        out << (quint8)counter;
+    }
+}
+
+void DirectionPredictorBimodal::load_state(QDataStream &in) {
+    quint8 val;
+    for (uint8_t &counter : counters) {
+        in >> val;
+        counter = val;
+    }
+}
+
+uint32_t DirectionPredictorBimodal::index(Address inst_addr) const {
+    return (inst_addr.get_raw() >> 2) & mask;
+}
+
+DirectionPredictorGshare::DirectionPredictorGshare(unsigned table_bits)
+    : DirectionPredictorBimodal(table_bits, 2) {}
+
+void DirectionPredictorGshare::update(Address inst_addr, bool taken) {
+    DirectionPredictorBimodal::update(inst_addr, taken);
+    history = ((history << 1) | (taken ? 1 : 0)) & mask;
+}
+
+void DirectionPredictorGshare::reset() {
+    DirectionPredictorBimodal::reset();
+    history = 0;
+}
+
+void DirectionPredictorGshare::save_state(QDataStream &out) const {
+    DirectionPredictorBimodal::save_state(out);
+    out << (quint32)history;
+}
+
+void DirectionPredictorGshare::load_state(QDataStream &in) {
+    DirectionPredictorBimodal::load_state(in);
+    quint32 val;
+    in >> val;
+    history = val & mask;
+}
+
+uint32_t DirectionPredictorGshare::index(Address inst_addr) const {
+    return ((inst_addr.get_raw() >> 2) ^ history) & mask;
+}
+
+uint64_t BranchPredictor::Stats::mispredictions() const {
+    return mispredicted_direction + mispredicted_target;
+}
+
+double BranchPredictor::Stats::accuracy() const {
+    if (branches == 0) {
+        return 100.0;
+    }
+    return 100.0 * (branches - mispredictions()) / branches;
+}
+
+BranchPredictor::BranchPredictor(const BranchPredictorConfig &config)
+    : config(config)
+    , direction(DirectionPredictor::get_predictor_instance(&config))
+    , btb(config.btb_size())
+    , ras(config.ras_depth()) {
+    reset();
+}
+
+unsigned BranchPredictor::resolve(
+    Address inst_addr,
+    enum Kind kind,
+    bool taken,
+    Address target,
+    bool call) {
+    bool predicted_taken = true;
+    if (kind == BK_CONDITIONAL) {
+        predicted_taken = direction->predict(inst_addr, target);
+        direction->update(inst_addr, taken);
+    }
+    bool mispredicted = false;
+    if (predicted_taken != taken) {
+        stats.mispredicted_direction++;
+        mispredicted = true;
+    } else if (taken) {
+        Address predicted;
+        if (!predict_target(inst_addr, kind, target, predicted) || predicted != target) {
+            stats.mispredicted_target++;
+            mispredicted = true;
+        }
+    }
+    update_target(inst_addr, kind, taken, target, call);
+
+    BranchStats &branch = branch_stats[inst_addr.get_raw()];
+    branch.executed++;
+    stats.branches++;
+    if (taken) {
+        branch.taken++;
+    }
+    if (!mispredicted) {
+        return 0;
+    }
+    branch.mispredicted++;
+    stats.lost_cycles += config.penalty();
+    return config.penalty();
+}
+
+void BranchPredictor::reset() {
+    direction->reset();
+    std::fill(btb.begin(), btb.end(), BtbEntry { false, 0, 0 });
+    ras_top = 0;
+    ras_count = 0;
+    stats = Stats();
+    branch_stats.clear();
+}
+
+const BranchPredictorConfig &BranchPredictor::get_config() const {
+    return config;
+}
+
+const BranchPredictor::Stats &BranchPredictor::get_stats() const {
+    return stats;
+}
+
+const std::map<uint32_t, BranchPredictor::BranchStats> &
+BranchPredictor::get_branch_stats() const {
+    return branch_stats;
+}
+
+void BranchPredictor::save_state(QDataStream &out) const {
+    direction->save_state(out);
+    for (const BtbEntry &entry : btb) {
+        out << entry.valid << (quint32)entry.tag << (quint32)entry.target;
+    }
+    for (uint32_t address : ras) {
+        out << (quint32)address;
+    }
+    out << (quint32)ras_top << (quint32)ras_count;
+    out << (quint64)stats.branches << (quint64)stats.mispredicted_direction
+        << (quint64)stats.mispredicted_target << (quint64)stats.lost_cycles;
+    out << (quint32)branch_stats.size();
+    for (const auto &item : branch_stats) {
+        out << (quint32)item.first << (quint64)item.second.executed
+            << (quint64)item.second.taken << (quint64)item.second.mispredicted;
+    }
+}
+
+void BranchPredictor::load_state(QDataStream &in) {
+    quint32 val32, address;
+    quint64 executed, taken, mispredicted;
+    uint64_t *counters[] = { &stats.branches, &stats.mispredicted_direction,
+                             &stats.mispredicted_target, &stats.lost_cycles };
+    direction->load_state(in);
+    for (BtbEntry &entry : btb) {
+        in >> entry.valid >> val32;
+        entry.tag = val32;
+        in >> val32;
+        entry.target = val32;
+    }
+    for (uint32_t &item : ras) {
+        in >> val32;
+        item = val32;
+    }
+    in >> val32;
+    ras_top = ras.empty() ? 0 : val32 % ras.size();
+    in >> val32;
+    ras_count = std::min<size_t>(val32, ras.size());
+    for (uint64_t *counter : counters) {
+        in >> executed;
+        *counter = executed;
+    }
+    branch_stats.clear();
+    in >> val32;
+    for (quint32 i = 0; i < val32 && in.status() == QDataStream::Ok; i++) {
+        in >> address >> executed >> taken >> mispredicted;
+        branch_stats[address] = { executed, taken, mispredicted };
+    }
+}
+
+bool BranchPredictor::predict_target(
+    Address inst_addr,
+    enum Kind kind,
+    Address target,
+    Address &predicted) const {
+    if (kind == BK_RETURN && !ras.empty()) {
+        if (ras_count == 0) {
+            return false;
+        }
+        predicted = Address(ras[(ras_top + ras.size() - 1) % ras.size()]);
+        return true;
+    }
+    if (!btb.empty()) {
+        const BtbEntry &entry = btb[(inst_addr.get_raw() >> 2) % btb.size()];
+        if (!entry.valid || entry.tag != inst_addr.get_raw()) {
+            return false;
+        }
+        predicted = Address(entry.target);
+        return true;
+    }
+    // Without BTB only targets encoded in the instruction are known
+    if (kind == BK_CONDITIONAL || kind == BK_DIRECT) {
+        predicted = target;
+        return true;
+    }
+    return false;
+}
+
+void BranchPredictor::update_target(
+    Address inst_addr,
+    enum Kind kind,
+    bool taken,
+    Address target,
+    bool call) {
+    if (kind == BK_RETURN && !ras.empty()) {
+        if (ras_count > 0) {
+            ras_top = (ras_top + ras.size() - 1) % ras.size();
+            ras_count--;
+        }
+    } else if (taken && !btb.empty()) {
+        btb[(inst_addr.get_raw() >> 2) % btb.size()]
+            = { true, (uint32_t)inst_addr.get_raw(), (uint32_t)target.get_raw() };
+    }
+    if (call && !ras.empty()) {
+        // Return skips the delay slot
+        ras[ras_top] = (uint32_t)(inst_addr + 8).get_raw();
+        ras_top = (ras_top + 1) % ras.size();
+        ras_count = std::min(ras_count + 1, ras.size());
+    }
+}
@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef BRANCH_PREDICTOR_H
+#define BRANCH_PREDICTOR_H
+
+#include "machineconfig.h"
+#include "memory/address.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+class QDataStream;
+
+namespace machine {
+
+/**
+ * Direction predictor of conditional branches interface.
+ *
+ * Unconditional jumps are always taken, they are not passed to direction
+ * predictors.
+ */
+class DirectionPredictor {
+public:
+    virtual bool predict(Address inst_addr, Address target) const = 0;
+    virtual void update(Address inst_addr, bool taken) = 0;
+    virtual void reset();
+
+    // Checkpoint support, stateless predictors keep the default (nothing stored)
+    virtual void save_state(QDataStream &out) const;
+    virtual void load_state(QDataStream &in);
+
+    virtual ~DirectionPredictor() = default;
+
+    static std::unique_ptr<DirectionPredictor>
+    get_predictor_instance(const BranchPredictorConfig *config);
+};
+
+/**
+ * Static prediction, always taken, always not taken or backward taken and
+ * forward not taken (loops are taken, skipped code is not).
+ */
+class DirectionPredictorStatic final : public DirectionPredictor {
+public:
+    explicit DirectionPredictorStatic(enum BranchPredictorConfig::Predictor kind);
+
+    bool predict(Address inst_addr, Address target) const final;
+    void update(Address inst_addr, bool taken) final;
+
+private:
+    const enum BranchPredictorConfig::Predictor kind;
+};
+
+/**
+ * Table of saturating counters indexed by instruction address. One bit
+ * counter predicts the last outcome of the branch, two bit counter changes
+ * the prediction after two mispredictions.
+ */
+class DirectionPredictorBimodal : public DirectionPredictor {
+public:
+    DirectionPredictorBimodal(unsigned table_bits, unsigned counter_bits);
+
+    bool predict(Address inst_addr, Address target) const override;
+    void update(Address inst_addr, bool taken) override;
+    void reset() override;
+
+    void save_state(QDataStream &out) const override;
+    void load_state(QDataStream &in) override;
+
+protected:
+    virtual uint32_t index(Address inst_addr) const;
+
+    std::vector<uint8_t> counters;
+    const uint32_t mask;
+    const uint8_t counter_max;
+};
+
+/**
+ * Two bit counters indexed by instruction address xor global history of
+ * conditional branch outcomes.
+ */
+class DirectionPredictorGshare final : public DirectionPredictorBimodal {
+public:
+    explicit DirectionPredictorGshare(unsigned table_bits);
+
+    void update(Address inst_addr, bool taken) final;
+    void reset() final;
+
+    void save_state(QDataStream &out) const final;
+    void load_state(QDataStream &in) final;
+
+private:
+    uint32_t index(Address inst_addr) const final;
+
+    uint32_t history = 0;
+};
+
+/**
+ * Front end branch prediction model of pipelined core.
+ *
+ * Core resolves control transfer instructions in decode stage and reports
+ * them here. Prediction is evaluated as it would be done at fetch: direction
+ * by `DirectionPredictor`, target of taken ones by branch target buffer,
+ * return address stack for returns (`jr $ra`). Predictor is trained by the
+ * resolved outcome and the number of cycles the core has to stall for a
+ * misprediction is returned. Program semantic (delay slot) is not affected.
+ */
+class BranchPredictor {
+public:
+    explicit BranchPredictor(const BranchPredictorConfig &config);
+
+    enum Kind {
+        BK_CONDITIONAL, // Conditional branch with target in instruction
+        BK_DIRECT,      // J and JAL
+        BK_INDIRECT,    // JR and JALR
+        BK_RETURN       // JR $ra
+    };
+
+    struct Stats {
+        uint64_t branches = 0;
+        uint64_t mispredicted_direction = 0;
+        uint64_t mispredicted_target = 0;
+        uint64_t lost_cycles = 0;
+
+        uint64_t mispredictions() const;
+        double accuracy() const; // In percent, 100 without branches
+    };
+    struct BranchStats {
+        uint64_t executed = 0;
+        uint64_t taken = 0;
+        uint64_t mispredicted = 0;
+    };
+
+    /**
+     * @param call      instruction writes return address (JAL, JALR and
+     *                  taken BAL family branches)
+     * @return          cycles lost by misprediction
+     */
+    unsigned resolve(Address inst_addr, enum Kind kind, bool taken, Address target, bool call);
+    void reset();
+
+    const BranchPredictorConfig &get_config() const;
+    const Stats &get_stats() const;
+    // Statistics by instruction address
+    const std::map<uint32_t, BranchStats> &get_branch_stats() const;
+
+    void save_state(QDataStream &out) const;
+    void load_state(QDataStream &in);
+
+private:
+    struct BtbEntry {
+        bool valid;
+        uint32_t tag;
+        uint32_t target;
+    };
+
+    const BranchPredictorConfig config;
+    std::unique_ptr<DirectionPredictor> direction;
+    std::vector<BtbEntry> btb;
+    std::vector<uint32_t> ras; // Circular, the oldest entries are overwritten
+    size_t ras_top = 0;
+    size_t ras_count = 0;
+    Stats stats;
+    std::map<uint32_t, BranchStats> branch_stats;
+
+    bool predict_target(Address inst_addr, enum Kind kind, Address target, Address &predicted) const;
+    void update_target(Address inst_addr, enum Kind kind, bool taken, Address target, bool call);
+};
+
+} // namespace machine
+
+#endif // BRANCH_PREDICTOR_H
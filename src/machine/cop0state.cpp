@@ -39,6 +39,8 @@
 #include "machinedefs.h"
 #include "simulator_exception.h"
 
+#include <QDataStream>
+
 using namespace machine;
 
 #define COUNTER_IRQ_LEVEL 7
@@ -109,7 +111,7 @@ const Cop0State::cop0reg_desc_t Cop0State::cop0reg_desc[Cop0State::COP0REGS_CNT]
           = { "EPC", 0xffffffff, 0x00000000, &Cop0State::read_cop0reg_default,
               &Cop0State::write_cop0reg_default },
           [Cop0State::EBase]
-          = { "EBase", 0xfffffffc, 0x80000000, &Cop0State::read_cop0reg_default,
+          = { "EBase", 0xfffffc00, 0x80000000, &Cop0State::read_cop0reg_default,
               &Cop0State::write_cop0reg_default },
           [Cop0State::Config] = { "Config", 0x00000000, 0x00000000,
                                   &Cop0State::read_cop0reg_default,
@@ -123,6 +125,7 @@ Cop0State::Cop0State(Core *core) : QObject() {
 
 Cop0State::Cop0State(const Cop0State &orig) : QObject() {
     this->core = orig.core;
+    this->cpu_num = orig.cpu_num;
     for (int i = 0; i < COP0REGS_CNT; i++) {
         this->cop0reg[i] = orig.read_cop0reg((enum Cop0Registers)i);
     }
@@ -211,6 +214,31 @@ void Cop0State::reset() {
         emit cop0reg_update((enum Cop0Registers)i, cop0reg[i]);
     }
     last_core_cycles = 0;
+    set_cpu_num(cpu_num);
+}
+
+void Cop0State::set_cpu_num(unsigned num) {
+    cpu_num = num & EBase_CPUNum;
+    cop0reg[(int)EBase] = (cop0reg[(int)EBase] & ~EBase_CPUNum) | cpu_num;
+    emit cop0reg_update(EBase, cop0reg[(int)EBase]);
+}
+
+void Cop0State::save_state(QDataStream &out) const {
+    for (int i = 1; i < COP0REGS_CNT; i++) {
+        out << (quint32)cop0reg[i];
+    }
+    out << (quint32)last_core_cycles;
+}
+
+void Cop0State::load_state(QDataStream &in) {
+    quint32 val;
+    for (int i = 1; i < COP0REGS_CNT; i++) {
+        in >> val;
+        cop0reg[i] = val;
+        emit cop0reg_update((enum Cop0Registers)i, cop0reg[i]);
+    }
+    in >> val;
+    last_core_cycles = val;
 }
 
 void Cop0State::update_execption_cause(enum ExceptionCause excause, bool in_delay_slot) {
@@ -264,7 +292,7 @@ void Cop0State::set_status_exl(bool value) {
 }
 
 Address Cop0State::exception_pc_address() {
-    return Address(cop0reg[(int)EBase] + 0x180);
+    return Address((cop0reg[(int)EBase] & ~EBase_CPUNum) + 0x180);
 }
 
 void Cop0State::write_cop0reg_count_compare(
@@ -44,6 +44,8 @@
 #include <QString>
 #include <cstdint>
 
+class QDataStream;
+
 namespace machine {
 
 class Core;
@@ -76,6 +78,10 @@ public:
         Status_Int0 = 0x00000100,
     };
 
+    enum EBaseReg {
+        EBase_CPUNum = 0x000003ff, // Read only number of the core
+    };
+
     Cop0State(Core *core = nullptr);
     Cop0State(const Cop0State &);
 
@@ -93,6 +99,12 @@ public:
     bool operator!=(const Cop0State &c) const;
 
     void reset(); // Reset all values to zero
+    // Number of the core in multiprocessor, kept by reset
+    void set_cpu_num(unsigned num);
+
+    // Checkpoint support, see Machine::save_checkpoint
+    void save_state(QDataStream &out) const;
+    void load_state(QDataStream &in);
 
     bool core_interrupt_request();
     Address exception_pc_address();
@@ -133,6 +145,7 @@ private:
     Core *core;
     uint32_t cop0reg[COP0REGS_CNT] {}; // coprocessor 0 registers
     uint32_t last_core_cycles {};
+    uint32_t cpu_num {};
 };
 
 } // namespace machine
@@ -35,19 +35,172 @@
 
 #include "core.h"
 
+#include "memory/cache/cache.h"
 #include "programloader.h"
 #include "utils.h"
 
+#include <QDataStream>
+#include <type_traits>
+
 using namespace machine;
 
+namespace {
+
+// Field visitors used to serialize pipeline latches, see `latch_fields`
+class LatchWriter {
+public:
+    explicit LatchWriter(QDataStream &out) : out(out) {}
+    void operator()(bool val) { out << val; }
+    void operator()(uint8_t val) { out << (quint8)val; }
+    void operator()(uint32_t val) { out << (quint32)val; }
+    void operator()(Address val) { out << (quint64)val.get_raw(); }
+    void operator()(RegisterValue val) { out << (quint64)val.as_u64(); }
+    void operator()(const Instruction &val) { out << (quint32)val.data(); }
+    template<class E>
+    void operator()(E val) {
+        static_assert(std::is_enum<E>::value, "unsupported latch field");
+        out << (qint32)val;
+    }
+
+private:
+    QDataStream &out;
+};
+
+class LatchReader {
+public:
+    explicit LatchReader(QDataStream &in) : in(in) {}
+    void operator()(bool &val) { in >> val; }
+    void operator()(uint8_t &val) {
+        quint8 tmp;
+        in >> tmp;
+        val = tmp;
+    }
+    void operator()(uint32_t &val) {
+        quint32 tmp;
+        in >> tmp;
+        val = tmp;
+    }
+    void operator()(Address &val) {
+        quint64 tmp;
+        in >> tmp;
+        val = Address(tmp);
+    }
+    void operator()(RegisterValue &val) {
+        quint64 tmp;
+        in >> tmp;
+        val = RegisterValue((uint64_t)tmp);
+    }
+    void operator()(Instruction &val) {
+        quint32 tmp;
+        in >> tmp;
+        val = Instruction((uint32_t)tmp);
+    }
+    template<class E>
+    void operator()(E &val) {
+        static_assert(std::is_enum<E>::value, "unsupported latch field");
+        qint32 tmp;
+        in >> tmp;
+        val = (E)tmp;
+    }
+
+private:
+    QDataStream &in;
+};
+
+// Every latch field has to be listed here to be stored in checkpoints
+template<class IO, class Dt>
+void fetch_fields(IO &io, Dt &dt) {
+    io(dt.inst);
+    io(dt.inst_addr);
+    io(dt.excause);
+    io(dt.in_delay_slot);
+    io(dt.is_valid);
+}
+
+template<class IO, class Dt>
+void decode_fields(IO &io, Dt &dt) {
+    io(dt.inst);
+    io(dt.memread);
+    io(dt.memwrite);
+    io(dt.alusrc);
+    io(dt.regd);
+    io(dt.regd31);
+    io(dt.regwrite);
+    io(dt.alu_req_rs);
+    io(dt.alu_req_rt);
+    io(dt.bjr_req_rs);
+    io(dt.bjr_req_rt);
+    io(dt.branch);
+    io(dt.jump);
+    io(dt.bj_not);
+    io(dt.bgt_blez);
+    io(dt.nb_skip_ds);
+    io(dt.forward_m_d_rs);
+    io(dt.forward_m_d_rt);
+    io(dt.aluop);
+    io(dt.memctl);
+    io(dt.num_rs);
+    io(dt.num_rt);
+    io(dt.num_rd);
+    io(dt.val_rs);
+    io(dt.val_rt);
+    io(dt.immediate_val);
+    io(dt.rwrite);
+    io(dt.ff_rs);
+    io(dt.ff_rt);
+    io(dt.inst_addr);
+    io(dt.excause);
+    io(dt.in_delay_slot);
+    io(dt.stall);
+    io(dt.stop_if);
+    io(dt.is_valid);
+}
+
+template<class IO, class Dt>
+void execute_fields(IO &io, Dt &dt) {
+    io(dt.inst);
+    io(dt.memread);
+    io(dt.memwrite);
+    io(dt.regwrite);
+    io(dt.memctl);
+    io(dt.val_rt);
+    io(dt.rwrite);
+    io(dt.alu_val);
+    io(dt.inst_addr);
+    io(dt.excause);
+    io(dt.in_delay_slot);
+    io(dt.stop_if);
+    io(dt.is_valid);
+}
+
+template<class IO, class Dt>
+void memory_fields(IO &io, Dt &dt) {
+    io(dt.inst);
+    io(dt.memtoreg);
+    io(dt.regwrite);
+    io(dt.rwrite);
+    io(dt.towrite_val);
+    io(dt.mem_addr);
+    io(dt.inst_addr);
+    io(dt.excause);
+    io(dt.in_delay_slot);
+    io(dt.stop_if);
+    io(dt.is_valid);
+}
+
+} // namespace
+
 Core::Core(
     Registers *regs,
     FrontendMemory *mem_program,
     FrontendMemory *mem_data,
     unsigned int min_cache_row_size,
-    Cop0State *cop0state)
-    : ex_handlers()
-    , hw_breaks() {
+    Cop0State *cop0state,
+    bool headless)
+    : headless(headless)
+    , ex_handlers()
+    , hw_breaks()
+    , hwbreak_filter() {
     cycle_c = 0;
     stall_c = 0;
     this->regs = regs;
@@ -65,6 +218,12 @@ Core::Core(
         step_over_exception[i] = true;
     }
     step_over_exception[EXCAUSE_INT] = false;
+    // Stop can be requested by exception handlers as well (e.g. syscalls
+    // of the OS emulation), batched run has to end after such instruction.
+    // Direct connection, the core can be run from other than its own thread.
+    connect(
+        this, &Core::stop_on_exception_reached, this,
+        [this]() { stop_requested = true; }, Qt::DirectConnection);
 }
 
 Core::~Core() {
@@ -73,16 +232,80 @@ Core::~Core() {
 
 void Core::step(bool skip_break) {
     cycle_c++;
-    emit cycle_c_value(cycle_c);
+    if (!headless) { emit cycle_c_value(cycle_c); }
+    if (trace != nullptr) { trace->cycle(cycle_c); }
     do_step(skip_break);
+    if (profiler != nullptr) { profiler->cycle(); }
+}
+
+unsigned Core::run(unsigned max_cycles, bool skip_break, Address end_addr) {
+    stop_requested = false;
+    run_end_addr = end_addr;
+    return do_run(max_cycles, skip_break);
+}
+
+unsigned Core::do_run(unsigned max_cycles, bool skip_break) {
+    unsigned cycles = 0;
+    while (cycles < max_cycles && !stop_requested
+           && (cycles == 0 || regs->read_pc() < run_end_addr)) {
+        step(skip_break);
+        skip_break = false;
+        cycles++;
+    }
+    return cycles;
 }
 
 void Core::reset() {
     cycle_c = 0;
     stall_c = 0;
+    ll_valid = false;
+    predecode.invalidate();
     do_reset();
 }
 
+void Core::save_state(QDataStream &out) const {
+    out << (quint32)cycle_c << (quint32)stall_c << (quint32)hwr_userlocal;
+    out << ll_valid << (quint64)ll_addr.get_raw();
+    out << (quint32)(ex_handlers.size() + 1);
+    ex_default_handler->save_state(out);
+    for (auto i = ex_handlers.begin(); i != ex_handlers.end(); i++) {
+        out << (qint32)i.key();
+        i.value()->save_state(out);
+    }
+    do_save_state(out);
+}
+
+void Core::load_state(QDataStream &in) {
+    reset();
+    quint32 cycles, stalls, userlocal, handlers;
+    quint64 reserved;
+    in >> cycles >> stalls >> userlocal;
+    in >> ll_valid >> reserved >> handlers;
+    cycle_c = cycles;
+    stall_c = stalls;
+    hwr_userlocal = userlocal;
+    ll_addr = Address(reserved);
+    if (handlers != (quint32)ex_handlers.size() + 1) {
+        throw SIMULATOR_EXCEPTION(
+            Input, "Exception handlers do not match checkpoint", "");
+    }
+    ex_default_handler->load_state(in);
+    for (auto i = ex_handlers.begin(); i != ex_handlers.end(); i++) {
+        qint32 excause;
+        in >> excause;
+        if (excause != (qint32)i.key()) {
+            throw SIMULATOR_EXCEPTION(
+                Input, "Exception handlers do not match checkpoint", "");
+        }
+        i.value()->load_state(in);
+    }
+    do_load_state(in);
+    if (!headless) {
+        emit cycle_c_value(cycle_c);
+        emit stall_c_value(stall_c);
+    }
+}
+
 unsigned Core::get_cycle_count() const {
     return cycle_c;
 }
@@ -107,23 +330,54 @@ FrontendMemory *Core::get_mem_program() {
     return mem_program;
 }
 
-Core::hwBreak::hwBreak(Address addr) : addr(addr) {
-    flags = 0;
+Core::hwBreak::hwBreak(Address addr, unsigned ignore_count)
+    : addr(addr)
+    , ignore_count(ignore_count) {
     count = 0;
 }
 
-void Core::insert_hwbreak(Address address) {
-    hw_breaks.insert(address, new hwBreak(address));
+void Core::insert_hwbreak(Address address, unsigned ignore_count) {
+    hw_breaks.insert(address, hwBreak(address, ignore_count));
+    hwbreaks_update();
 }
 
 void Core::remove_hwbreak(Address address) {
-    hwBreak *hwbrk = hw_breaks.take(address);
-    delete hwbrk;
+    hw_breaks.remove(address);
+    hwbreaks_update();
 }
 
-bool Core::is_hwbreak(Address address) {
-    hwBreak *hwbrk = hw_breaks.value(address);
-    return hwbrk != nullptr;
+bool Core::is_hwbreak(Address address) const {
+    return hw_breaks.contains(address);
+}
+
+unsigned Core::get_hwbreak_count(Address address) const {
+    return hw_breaks.value(address).count;
+}
+
+void Core::reset_hwbreak_counts() {
+    for (hwBreak &brk : hw_breaks) {
+        brk.count = 0;
+    }
+}
+
+bool Core::hwbreak_hit(Address address, bool refetch) {
+    auto brk = hw_breaks.find(address);
+    if (brk == hw_breaks.end()) {
+        return false;
+    }
+    if (refetch) {
+        return brk->count >= brk->ignore_count;
+    }
+    brk->count++;
+    return brk->count > brk->ignore_count;
+}
+
+void Core::hwbreaks_update() {
+    hwbreak_filter.reset();
+    for (const hwBreak &brk : hw_breaks) {
+        hwbreak_filter.set(hwbreak_filter_index(brk.addr));
+    }
+    hwbreaks_active = hwbreaks_enabled && !hw_breaks.isEmpty();
 }
 
 void Core::set_stop_on_exception(enum ExceptionCause excause, bool value) {
@@ -155,6 +409,32 @@ void Core::register_exception_handler(
     }
 }
 
+ExceptionHandler *Core::take_exception_handler(ExceptionCause excause) {
+    if (excause == EXCAUSE_NONE) {
+        ExceptionHandler *old = ex_default_handler;
+        ex_default_handler = nullptr;
+        return old;
+    }
+    return ex_handlers.take(excause);
+}
+
+bool Core::set_io_journal(IoJournal *journal) {
+    bool journaled = true;
+    if (ex_default_handler != nullptr) {
+        journaled = ex_default_handler->set_io_journal(journal);
+    }
+    for (ExceptionHandler *handler : ex_handlers) {
+        journaled = handler->set_io_journal(journal) && journaled;
+    }
+    return journaled;
+}
+
+void Core::cancel_ll_reservation(Address start, Address last) {
+    if (ll_valid && ll_addr + 3 >= start && ll_addr <= last) {
+        ll_valid = false;
+    }
+}
+
 bool Core::handle_exception(
     Core *core,
     Registers *regs,
@@ -171,6 +451,9 @@ bool Core::handle_exception(
         } else {
             regs->pc_abs_jmp(inst_addr);
         }
+    } else {
+        // Like ERET, exception breaks the LL/SC sequence
+        ll_valid = false;
     }
 
     if (cop0state != nullptr) {
@@ -180,7 +463,7 @@ bool Core::handle_exception(
             cop0state->write_cop0reg(Cop0State::EPC, inst_addr.get_raw());
         }
         cop0state->update_execption_cause(excause, in_delay_slot);
-        if (cop0state->read_cop0reg(Cop0State::EBase) != 0
+        if ((cop0state->read_cop0reg(Cop0State::EBase) & ~Cop0State::EBase_CPUNum) != 0
             && !get_step_over_exception(excause)) {
             cop0state->set_status_exl(true);
             regs->pc_abs_jmp(cop0state->exception_pc_address());
@@ -202,6 +485,176 @@ bool Core::handle_exception(
     return ret;
 }
 
+void Core::set_hwbreaks_enabled(bool enable) {
+    hwbreaks_enabled = enable;
+    hwbreaks_active = hwbreaks_enabled && !hw_breaks.isEmpty();
+    watchpoints_active = hwbreaks_enabled && !watchpoints.isEmpty();
+}
+
+void Core::insert_watchpoint(Address start, Address last, enum WatchpointType type) {
+    watchpoints.insert(start, { start, last, type });
+    watchpoints_update();
+}
+
+void Core::remove_watchpoint(Address start) {
+    watchpoints.remove(start);
+    watchpoints_update();
+}
+
+bool Core::has_watchpoints() const {
+    return watchpoints_active;
+}
+
+const Core::WatchpointHit &Core::get_watchpoint_hit() const {
+    return watchpoint_hit;
+}
+
+void Core::watchpoints_update() {
+    watchpoint_filter.reset();
+    for (const Watchpoint &wp : watchpoints) {
+        uint64_t first_page = wp.start.get_raw() >> 12;
+        uint64_t last_page = wp.last.get_raw() >> 12;
+        if (last_page - first_page >= WATCHPOINT_FILTER_BITS) {
+            watchpoint_filter.set();
+            break;
+        }
+        for (uint64_t page = first_page; page <= last_page; page++) {
+            watchpoint_filter.set(watchpoint_filter_index(page << 12));
+        }
+    }
+    watchpoints_active = hwbreaks_enabled && !watchpoints.isEmpty();
+}
+
+// Size of data memory access, zero for controls without data access
+static unsigned access_size(enum AccessControl memctl) {
+    switch (memctl) {
+    case AC_I8:
+    case AC_U8: return 1;
+    case AC_I16:
+    case AC_U16: return 2;
+    case AC_I32:
+    case AC_U32: return 4;
+    case AC_I64:
+    case AC_U64: return 8;
+    case AC_LOAD_LINKED:
+    case AC_STORE_CONDITIONAL:
+    case AC_WORD_RIGHT:
+    case AC_WORD_LEFT: return 4;
+    default: return 0;
+    }
+}
+
+bool Core::watchpoint_access(
+    enum AccessControl memctl,
+    Address mem_addr,
+    bool memread,
+    bool memwrite) {
+    unsigned size = access_size(memctl);
+    if (size == 0) {
+        return false;
+    }
+    if (memctl == AC_WORD_RIGHT || memctl == AC_WORD_LEFT) {
+        // Unaligned access is done on the whole aligned word
+        mem_addr = Address(mem_addr.get_raw() & ~3u);
+    }
+    Address mem_last = mem_addr + (size - 1);
+    if (!watchpoint_filter.test(watchpoint_filter_index(mem_addr.get_raw()))
+        && !watchpoint_filter.test(watchpoint_filter_index(mem_last.get_raw()))) {
+        return false;
+    }
+
+    unsigned access = (memread ? WATCH_READ : 0) | (memwrite ? WATCH_WRITE : 0);
+    unsigned matched = 0;
+    for (const Watchpoint &wp : watchpoints) {
+        if (wp.start <= mem_last && mem_addr <= wp.last) {
+            matched |= wp.type & access;
+        }
+    }
+    if (matched == 0) {
+        return false;
+    }
+    watchpoint_hit.mem_addr = mem_addr;
+    watchpoint_hit.size = size;
+    watchpoint_hit.type = (matched & WATCH_WRITE) ? WATCH_WRITE : WATCH_READ;
+    watchpoint_hit.old_value = watched_value(mem_addr, size);
+    return true;
+}
+
+RegisterValue Core::watched_value(Address address, unsigned size) const {
+    // Internal access does not change caches state and statistics
+    switch (size) {
+    case 1: return mem_data->read_u8(address, ae::INTERNAL);
+    case 2: return mem_data->read_u16(address, ae::INTERNAL);
+    case 4: return mem_data->read_u32(address, ae::INTERNAL);
+    default: return mem_data->read_u64(address, ae::INTERNAL);
+    }
+}
+
+bool Core::has_hwbreaks() const {
+    return hwbreaks_active;
+}
+
+bool Core::hwbreak_may_hit(Address address) const {
+    return hwbreaks_active && hwbreak_filter.test(hwbreak_filter_index(address));
+}
+
+bool Core::is_headless() const {
+    return headless;
+}
+
+void Core::set_headless(bool value) {
+    headless = value;
+}
+
+bool Core::is_fetch_simulated() const {
+    return fetch_simulated;
+}
+
+void Core::set_fetch_simulated(bool value) {
+    fetch_simulated = value;
+}
+
+void Core::set_trace_writer(TraceWriter *writer) {
+    trace = writer;
+}
+
+void Core::set_profiler(Profiler *profiler) {
+    this->profiler = profiler;
+}
+
+const BranchPredictor *Core::get_branch_predictor() const {
+    return nullptr;
+}
+
+const OutOfOrderEngine *Core::get_out_of_order() const {
+    return nullptr;
+}
+
+const DualIssueStats *Core::get_dual_issue() const {
+    return nullptr;
+}
+
+void Core::trace_stage(
+    enum TraceRecord::Type stage,
+    const Instruction &inst,
+    Address inst_addr,
+    enum ExceptionCause excause,
+    bool valid) {
+    trace->stage(stage, inst_addr.get_raw(), inst.data(), excause, valid);
+}
+
+void Core::trace_access(
+    enum AccessControl memctl,
+    Address mem_addr,
+    bool memwrite,
+    RegisterValue value) {
+    unsigned size = access_size(memctl);
+    if (size == 0) {
+        return;
+    }
+    trace->mem(mem_addr.get_raw(), size, memwrite, size == 8 ? value.as_u64() : value.as_u32());
+}
+
 void Core::set_c0_userlocal(uint32_t address) {
     hwr_userlocal = address;
     if (cop0state != nullptr) {
@@ -234,14 +687,23 @@ enum ExceptionCause Core::memory_special(
         if (!memwrite) {
             break;
         }
-        mem_data->write_u32(mem_addr, rt_value.as_u32());
-        towrite_val = 1;
+        // Store happens only when no other core wrote to the address since
+        // the paired LL
+        if (ll_valid && ll_addr == mem_addr) {
+            mem_data->write_u32(mem_addr, rt_value.as_u32());
+            towrite_val = 1;
+        } else {
+            towrite_val = 0;
+        }
+        ll_valid = false;
         break;
     case AC_LOAD_LINKED:
         if (!memread) {
             break;
         }
         towrite_val = mem_data->read_u32(mem_addr);
+        ll_valid = true;
+        ll_addr = mem_addr;
         break;
     case AC_WORD_RIGHT:
         if (mem_data->simulated_machine_endian == LITTLE) {
@@ -311,16 +773,16 @@ enum ExceptionCause Core::memory_special(
     return EXCAUSE_NONE;
 }
 
-struct Core::dtFetch Core::fetch(bool skip_break) {
+struct Core::dtFetch Core::fetch(bool skip_break, bool refetch) {
     enum ExceptionCause excause = EXCAUSE_NONE;
     Address inst_addr = Address(regs->read_pc());
+    mem_program->access_hint(inst_addr, cycle_c);
     Instruction inst(mem_program->read_u32(inst_addr));
 
-    if (!skip_break) {
-        hwBreak *brk = hw_breaks.value(inst_addr);
-        if (brk != nullptr) {
-            excause = EXCAUSE_HWBREAK;
-        }
+    if (!skip_break && hwbreaks_active
+        && hwbreak_filter.test(hwbreak_filter_index(inst_addr))
+        && hwbreak_hit(inst_addr, refetch)) {
+        excause = EXCAUSE_HWBREAK;
     }
     if (cop0state != nullptr && excause == EXCAUSE_NONE) {
         if (cop0state->core_interrupt_request()) {
@@ -328,8 +790,12 @@ struct Core::dtFetch Core::fetch(bool skip_break) {
         }
     }
 
-    emit fetch_inst_addr_value(inst_addr);
-    emit instruction_fetched(inst, inst_addr, excause, true);
+    if (!headless) {
+        emit fetch_inst_addr_value(inst_addr);
+        emit instruction_fetched(inst, inst_addr, excause, true);
+    }
+    if (trace != nullptr) { trace_stage(TraceRecord::FETCH, inst, inst_addr, excause, true); }
+    if (profiler != nullptr) { profiler->fetched(inst_addr); }
     return {
         .inst = inst,
         .inst_addr = inst_addr,
@@ -341,12 +807,10 @@ struct Core::dtFetch Core::fetch(bool skip_break) {
 
 struct Core::dtDecode Core::decode(const struct dtFetch &dt) {
     uint8_t rwrite;
-    enum InstructionFlags flags;
-    enum AluOp alu_op;
-    enum AccessControl mem_ctl;
     enum ExceptionCause excause = dt.excause;
 
-    dt.inst.flags_alu_op_mem_ctl(flags, alu_op, mem_ctl);
+    const PredecodedInstruction &pd = predecode.lookup(dt.inst_addr, dt.inst);
+    const enum InstructionFlags flags = pd.flags;
 
     if (!(flags & IMF_SUPPORTED)) {
         throw SIMULATOR_EXCEPTION(
@@ -354,12 +818,12 @@ struct Core::dtDecode Core::decode(const struct dtFetch &dt) {
             QString::number(dt.inst.data(), 16));
     }
 
-    uint8_t num_rs = dt.inst.rs();
-    uint8_t num_rt = dt.inst.rt();
-    uint8_t num_rd = dt.inst.rd();
+    uint8_t num_rs = pd.num_rs;
+    uint8_t num_rt = pd.num_rt;
+    uint8_t num_rd = pd.num_rd;
     RegisterValue val_rs = regs->read_gp(num_rs);
     RegisterValue val_rt = regs->read_gp(num_rt);
-    uint32_t immediate_val;
+    uint32_t immediate_val = pd.immediate_val;
     bool regwrite = flags & IMF_REGWRITE;
     bool regd = flags & IMF_REGD;
     bool regd31 = flags & IMF_PC_TO_R31;
@@ -370,32 +834,31 @@ struct Core::dtDecode Core::decode(const struct dtFetch &dt) {
     // requires rt for beq, bne
     bool bjr_req_rt = flags & IMF_BJR_REQ_RT;
 
-    if (flags & IMF_ZERO_EXTEND) {
-        immediate_val = dt.inst.immediate();
-    } else {
-        immediate_val = sign_extend(dt.inst.immediate());
+    if ((flags & IMF_EXCEPTION) && (excause == EXCAUSE_NONE)) {
+        excause = pd.excause;
     }
 
-    if ((flags & IMF_EXCEPTION) && (excause == EXCAUSE_NONE)) {
-        excause = dt.inst.encoded_exception();
-    }
-
-    emit decode_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
-    emit instruction_decoded(dt.inst, dt.inst_addr, excause, dt.is_valid);
-    emit decode_instruction_value(dt.inst.data());
-    emit decode_reg1_value(val_rs.as_u32());
-    emit decode_reg2_value(val_rt.as_u32());
-    emit decode_immediate_value(immediate_val);
-    emit decode_regw_value((bool)(flags & IMF_REGWRITE));
-    emit decode_memtoreg_value((bool)(flags & IMF_MEMREAD));
-    emit decode_memwrite_value((bool)(flags & IMF_MEMWRITE));
-    emit decode_memread_value((bool)(flags & IMF_MEMREAD));
-    emit decode_alusrc_value((bool)(flags & IMF_ALUSRC));
-    emit decode_regdest_value((bool)(flags & IMF_REGD));
-    emit decode_rs_num_value(num_rs);
-    emit decode_rt_num_value(num_rt);
-    emit decode_rd_num_value(num_rd);
-    emit decode_regd31_value(regd31);
+    if (!headless) {
+        emit decode_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
+        emit instruction_decoded(dt.inst, dt.inst_addr, excause, dt.is_valid);
+        emit decode_instruction_value(dt.inst.data());
+        emit decode_reg1_value(val_rs.as_u32());
+        emit decode_reg2_value(val_rt.as_u32());
+        emit decode_immediate_value(immediate_val);
+        emit decode_regw_value((bool)(flags & IMF_REGWRITE));
+        emit decode_memtoreg_value((bool)(flags & IMF_MEMREAD));
+        emit decode_memwrite_value((bool)(flags & IMF_MEMWRITE));
+        emit decode_memread_value((bool)(flags & IMF_MEMREAD));
+        emit decode_alusrc_value((bool)(flags & IMF_ALUSRC));
+        emit decode_regdest_value((bool)(flags & IMF_REGD));
+        emit decode_rs_num_value(num_rs);
+        emit decode_rt_num_value(num_rt);
+        emit decode_rd_num_value(num_rd);
+        emit decode_regd31_value(regd31);
+    }
+    if (trace != nullptr) {
+        trace_stage(TraceRecord::DECODE, dt.inst, dt.inst_addr, excause, dt.is_valid);
+    }
 
     if (regd31) { val_rt = (dt.inst_addr + 8).get_raw(); }
 
@@ -420,8 +883,8 @@ struct Core::dtDecode Core::decode(const struct dtFetch &dt) {
         .nb_skip_ds = !!(flags & IMF_NB_SKIP_DS),
         .forward_m_d_rs = false,
         .forward_m_d_rt = false,
-        .aluop = alu_op,
-        .memctl = mem_ctl,
+        .aluop = pd.alu_op,
+        .memctl = pd.mem_ctl,
         .num_rs = num_rs,
         .num_rt = num_rt,
         .num_rd = num_rd,
@@ -463,7 +926,12 @@ struct Core::dtExecute Core::execute(const struct dtDecode &dt) {
         case ALU_OP_RDHWR:
             switch (dt.num_rd) {
             case 0: // CPUNum
-                alu_val = 0;
+                if (cop0state != nullptr) {
+                    alu_val = cop0state->read_cop0reg(Cop0State::EBase)
+                              & Cop0State::EBase_CPUNum;
+                } else {
+                    alu_val = 0;
+                }
                 break;
             case 1: // SYNCI_Step
                 alu_val = min_cache_row_size;
@@ -514,30 +982,35 @@ struct Core::dtExecute Core::execute(const struct dtDecode &dt) {
         }
     }
 
-    emit execute_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
-    emit instruction_executed(dt.inst, dt.inst_addr, excause, dt.is_valid);
-    emit execute_alu_value(alu_val.as_u32());
-    emit execute_reg1_value(dt.val_rs.as_u32());
-    emit execute_reg2_value(dt.val_rt.as_u32());
-    emit execute_reg1_ff_value(dt.ff_rs);
-    emit execute_reg2_ff_value(dt.ff_rt);
-    emit execute_immediate_value(dt.immediate_val);
-    emit execute_regw_value(dt.regwrite);
-    emit execute_memtoreg_value(dt.memread);
-    emit execute_memread_value(dt.memread);
-    emit execute_memwrite_value(dt.memwrite);
-    emit execute_alusrc_value(dt.alusrc);
-    emit execute_regdest_value(dt.regd);
-    emit execute_regw_num_value(dt.rwrite);
-    emit execute_rs_num_value(dt.num_rs);
-    emit execute_rt_num_value(dt.num_rt);
-    emit execute_rd_num_value(dt.num_rd);
-    if (dt.stall) {
-        emit execute_stall_forward_value(1);
-    } else if (dt.ff_rs != FORWARD_NONE || dt.ff_rt != FORWARD_NONE) {
-        emit execute_stall_forward_value(2);
-    } else {
-        emit execute_stall_forward_value(0);
+    if (!headless) {
+        emit execute_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
+        emit instruction_executed(dt.inst, dt.inst_addr, excause, dt.is_valid);
+        emit execute_alu_value(alu_val.as_u32());
+        emit execute_reg1_value(dt.val_rs.as_u32());
+        emit execute_reg2_value(dt.val_rt.as_u32());
+        emit execute_reg1_ff_value(dt.ff_rs);
+        emit execute_reg2_ff_value(dt.ff_rt);
+        emit execute_immediate_value(dt.immediate_val);
+        emit execute_regw_value(dt.regwrite);
+        emit execute_memtoreg_value(dt.memread);
+        emit execute_memread_value(dt.memread);
+        emit execute_memwrite_value(dt.memwrite);
+        emit execute_alusrc_value(dt.alusrc);
+        emit execute_regdest_value(dt.regd);
+        emit execute_regw_num_value(dt.rwrite);
+        emit execute_rs_num_value(dt.num_rs);
+        emit execute_rt_num_value(dt.num_rt);
+        emit execute_rd_num_value(dt.num_rd);
+        if (dt.stall) {
+            emit execute_stall_forward_value(1);
+        } else if (dt.ff_rs != FORWARD_NONE || dt.ff_rt != FORWARD_NONE) {
+            emit execute_stall_forward_value(2);
+        } else {
+            emit execute_stall_forward_value(0);
+        }
+    }
+    if (trace != nullptr) {
+        trace_stage(TraceRecord::EXECUTE, dt.inst, dt.inst_addr, excause, dt.is_valid);
     }
 
     return {
@@ -565,7 +1038,13 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
     bool regwrite = dt.regwrite;
 
     enum ExceptionCause excause = dt.excause;
+    bool watched = excause == EXCAUSE_NONE && watchpoints_active
+                   && (memread || memwrite)
+                   && watchpoint_access(dt.memctl, mem_addr, memread, memwrite);
     if (excause == EXCAUSE_NONE) {
+        if (memread || memwrite) {
+            mem_data->access_hint(dt.inst_addr, cycle_c);
+        }
         if (is_special_access(dt.memctl)) {
             excause = memory_special(
                 dt.memctl, dt.inst.rt(), memread, memwrite, towrite_val,
@@ -588,18 +1067,37 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
         memwrite = false;
         regwrite = false;
     }
+    // Failed SC does not access the memory
+    if (trace != nullptr && excause == EXCAUSE_NONE && (memread || memwrite)
+        && (dt.memctl != AC_STORE_CONDITIONAL || towrite_val.as_u32() != 0)) {
+        trace_access(dt.memctl, mem_addr, memwrite, memwrite ? dt.val_rt : towrite_val);
+    }
+    if (profiler != nullptr && dt.is_valid) { profiler->memory_accessed(dt.inst_addr); }
+    if (watched) {
+        watchpoint_hit.inst_addr = dt.inst_addr;
+        watchpoint_hit.new_value
+            = watched_value(watchpoint_hit.mem_addr, watchpoint_hit.size);
+        // The instruction is finished, the stop is not an exception
+        stop_requested = true;
+        emit watchpoint_reached();
+    }
 
-    emit memory_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
-    emit instruction_memory(dt.inst, dt.inst_addr, dt.excause, dt.is_valid);
-    emit memory_alu_value(dt.alu_val.as_u32());
-    emit memory_rt_value(dt.val_rt.as_u32());
-    emit memory_mem_value(memread ? towrite_val.as_u32() : 0);
-    emit memory_regw_value(regwrite);
-    emit memory_memtoreg_value(dt.memread);
-    emit memory_memread_value(dt.memread);
-    emit memory_memwrite_value(memwrite);
-    emit memory_regw_num_value(dt.rwrite);
-    emit memory_excause_value(excause);
+    if (!headless) {
+        emit memory_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
+        emit instruction_memory(dt.inst, dt.inst_addr, dt.excause, dt.is_valid);
+        emit memory_alu_value(dt.alu_val.as_u32());
+        emit memory_rt_value(dt.val_rt.as_u32());
+        emit memory_mem_value(memread ? towrite_val.as_u32() : 0);
+        emit memory_regw_value(regwrite);
+        emit memory_memtoreg_value(dt.memread);
+        emit memory_memread_value(dt.memread);
+        emit memory_memwrite_value(memwrite);
+        emit memory_regw_num_value(dt.rwrite);
+        emit memory_excause_value(excause);
+    }
+    if (trace != nullptr) {
+        trace_stage(TraceRecord::MEMORY, dt.inst, dt.inst_addr, excause, dt.is_valid);
+    }
 
     return {
         .inst = dt.inst,
@@ -617,31 +1115,47 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
 }
 
 void Core::writeback(const struct dtMemory &dt) {
-    emit writeback_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
-    emit instruction_writeback(dt.inst, dt.inst_addr, dt.excause, dt.is_valid);
-    emit writeback_value(dt.towrite_val.as_u32());
-    emit writeback_memtoreg_value(dt.memtoreg);
-    emit writeback_regw_value(dt.regwrite);
-    emit writeback_regw_num_value(dt.rwrite);
+    if (!headless) {
+        emit writeback_inst_addr_value(dt.is_valid ? dt.inst_addr : STAGEADDR_NONE);
+        emit instruction_writeback(dt.inst, dt.inst_addr, dt.excause, dt.is_valid);
+        emit writeback_value(dt.towrite_val.as_u32());
+        emit writeback_memtoreg_value(dt.memtoreg);
+        emit writeback_regw_value(dt.regwrite);
+        emit writeback_regw_num_value(dt.rwrite);
+    }
+    if (trace != nullptr) {
+        trace_stage(TraceRecord::WRITEBACK, dt.inst, dt.inst_addr, dt.excause, dt.is_valid);
+    }
+    if (profiler != nullptr && dt.is_valid) { profiler->retired(dt.inst_addr); }
     if (dt.regwrite) { regs->write_gp(dt.rwrite, dt.towrite_val); }
 }
 
 bool Core::handle_pc(const struct dtDecode &dt) {
     bool branch = false;
-    emit instruction_program_counter(
-        dt.inst, dt.inst_addr, EXCAUSE_NONE, dt.is_valid);
+    if (!headless) {
+        emit instruction_program_counter(
+            dt.inst, dt.inst_addr, EXCAUSE_NONE, dt.is_valid);
+    }
 
     if (dt.jump) {
         if (!dt.bjr_req_rs) {
             regs->pc_abs_jmp_28(dt.inst.address() << 2);
-            emit fetch_jump_value(true);
-            emit fetch_jump_reg_value(false);
         } else {
             regs->pc_abs_jmp(Address(dt.val_rs.as_u32()));
-            emit fetch_jump_value(false);
-            emit fetch_jump_reg_value(true);
         }
-        emit fetch_branch_value(false);
+        if (profiler != nullptr && dt.is_valid) {
+            // JAL and JALR write the return address, JR $ra returns
+            if (dt.regwrite) {
+                profiler->called(dt.inst_addr, regs->read_pc());
+            } else if (dt.bjr_req_rs && dt.num_rs == 31) {
+                profiler->returned(regs->read_pc());
+            }
+        }
+        if (!headless) {
+            emit fetch_jump_value(!dt.bjr_req_rs);
+            emit fetch_jump_reg_value(dt.bjr_req_rs);
+            emit fetch_branch_value(false);
+        }
         return true;
     }
 
@@ -657,20 +1171,40 @@ bool Core::handle_pc(const struct dtDecode &dt) {
         if (dt.bj_not) { branch = !branch; }
     }
 
-    emit fetch_jump_value(false);
-    emit fetch_jump_reg_value(false);
-    emit fetch_branch_value(branch);
+    if (!headless) {
+        emit fetch_jump_value(false);
+        emit fetch_jump_reg_value(false);
+        emit fetch_branch_value(branch);
+    }
 
     if (branch) {
-        int32_t rel_offset = dt.inst.immediate() << 2;
-        if (rel_offset & (1 << 17)) { rel_offset -= 1 << 18; }
-        regs->pc_abs_jmp(dt.inst_addr + rel_offset + 4);
+        regs->pc_abs_jmp(branch_target(dt));
+        if (profiler != nullptr && dt.is_valid && dt.regd31) {
+            profiler->called(dt.inst_addr, regs->read_pc());
+        }
     } else {
         regs->pc_inc();
     }
     return branch;
 }
 
+Address Core::branch_target(const struct dtDecode &dt) {
+    int32_t rel_offset = dt.inst.immediate() << 2;
+    if (rel_offset & (1 << 17)) { rel_offset -= 1 << 18; }
+    return dt.inst_addr + rel_offset + 4;
+}
+
+enum BranchPredictor::Kind Core::branch_kind(const struct dtDecode &dt) {
+    if (dt.branch) {
+        return BranchPredictor::BK_CONDITIONAL;
+    } else if (!dt.bjr_req_rs) {
+        return BranchPredictor::BK_DIRECT;
+    } else if (!dt.regwrite && dt.num_rs == 31) {
+        return BranchPredictor::BK_RETURN;
+    }
+    return BranchPredictor::BK_INDIRECT;
+}
+
 void Core::dtFetchInit(struct dtFetch &dt) {
     dt.inst = Instruction(0x00);
     dt.excause = EXCAUSE_NONE;
@@ -684,10 +1218,14 @@ void Core::dtDecodeInit(struct dtDecode &dt) {
     dt.memwrite = false;
     dt.alusrc = false;
     dt.regd = false;
+    dt.regd31 = false;
     dt.regwrite = false;
+    dt.alu_req_rs = false;
+    dt.alu_req_rt = false;
     dt.bjr_req_rs = false; // requires rs for beq, bne, blez, bgtz, jr nad
                            // jalr
     dt.bjr_req_rt = false; // requires rt for beq, bne
+    dt.branch = false;
     dt.jump = false;
     dt.bj_not = false;
     dt.bgt_blez = false;
@@ -740,14 +1278,56 @@ void Core::dtMemoryInit(struct dtMemory &dt) {
     dt.is_valid = false;
 }
 
+void Core::save_latch(QDataStream &out, const struct dtFetch &dt) {
+    LatchWriter io(out);
+    fetch_fields(io, dt);
+}
+
+void Core::save_latch(QDataStream &out, const struct dtDecode &dt) {
+    LatchWriter io(out);
+    decode_fields(io, dt);
+}
+
+void Core::save_latch(QDataStream &out, const struct dtExecute &dt) {
+    LatchWriter io(out);
+    execute_fields(io, dt);
+}
+
+void Core::save_latch(QDataStream &out, const struct dtMemory &dt) {
+    LatchWriter io(out);
+    memory_fields(io, dt);
+}
+
+void Core::load_latch(QDataStream &in, struct dtFetch &dt) {
+    LatchReader io(in);
+    fetch_fields(io, dt);
+}
+
+void Core::load_latch(QDataStream &in, struct dtDecode &dt) {
+    LatchReader io(in);
+    decode_fields(io, dt);
+}
+
+void Core::load_latch(QDataStream &in, struct dtExecute &dt) {
+    LatchReader io(in);
+    execute_fields(io, dt);
+}
+
+void Core::load_latch(QDataStream &in, struct dtMemory &dt) {
+    LatchReader io(in);
+    memory_fields(io, dt);
+}
+
 CoreSingle::CoreSingle(
     Registers *regs,
     FrontendMemory *mem_program,
     FrontendMemory *mem_data,
     bool jmp_delay_slot,
     unsigned int min_cache_row_size,
-    Cop0State *cop0state)
-    : Core(regs, mem_program, mem_data, min_cache_row_size, cop0state) {
+    Cop0State *cop0state,
+    bool headless)
+    : Core(regs, mem_program, mem_data, min_cache_row_size, cop0state, headless)
+    , blocks(jmp_delay_slot) {
     if (jmp_delay_slot) {
         dt_f = new struct Core::dtFetch();
     } else {
@@ -757,9 +1337,27 @@ CoreSingle::CoreSingle(
 }
 
 CoreSingle::~CoreSingle() {
+    delete jit;
     delete dt_f;
 }
 
+bool CoreSingle::set_jit_enabled(bool enable) {
+    if (!enable || !JitEngine::is_supported()) {
+        delete jit;
+        jit = nullptr;
+        jit_regs_loaded = false;
+        return !enable;
+    }
+    if (jit == nullptr) {
+        jit = new JitEngine(dt_f != nullptr, mem_program, mem_data);
+    }
+    return true;
+}
+
+bool CoreSingle::is_jit_enabled() const {
+    return jit != nullptr;
+}
+
 void CoreSingle::do_step(bool skip_break) {
     struct dtFetch f = fetch(skip_break);
     if (dt_f != nullptr) {
@@ -767,19 +1365,254 @@ void CoreSingle::do_step(bool skip_break) {
         *dt_f = f;
         f = f_swap;
     }
-    struct dtDecode d = decode(f);
+    struct dtDecode d;
+    struct dtMemory m;
+    step_fetched(f, d, m);
+}
+
+unsigned CoreSingle::do_run(unsigned max_cycles, bool skip_break) {
+    if (!headless || trace != nullptr || profiler != nullptr) {
+        return Core::do_run(max_cycles, skip_break);
+    }
+
+    BasicBlock *bb = nullptr;
+    uint32_t bb_addr = 0; // Address of the next op in the block
+    size_t bb_pos = 0;
+    unsigned cycles = 0;
+    // Memory could have been modified by anybody since the last run
+    blocks.memory_may_have_changed();
+    while (cycles < max_cycles && !stop_requested
+           && (cycles == 0 || regs->read_pc() < run_end_addr)) {
+        if (jit != nullptr) {
+            // Translated code is entered only at interpreter block boundaries
+            Address next = (dt_f != nullptr) ? dt_f->inst_addr : regs->read_pc();
+            if (bb == nullptr || bb_addr != next.get_raw()
+                || (bb_pos >= bb->ops.size() && bb->closed)) {
+                unsigned executed = jit_run(next, max_cycles - cycles);
+                if (executed != 0) {
+                    cycles += executed;
+                    bb = nullptr;
+                    continue;
+                }
+            }
+            jit_sync_registers();
+        }
+        if (!fetch_simulated && !skip_break) {
+            Address next = (dt_f != nullptr) ? dt_f->inst_addr : regs->read_pc();
+            if (bb == nullptr || bb_addr != next.get_raw()
+                || (bb_pos >= bb->ops.size() && bb->closed)) {
+                unsigned executed = block_run(next, max_cycles - cycles, bb, bb_pos);
+                if (executed != 0) {
+                    // Rest of the block is continued by the regular path
+                    cycles += executed;
+                    bb_addr = next.get_raw() + 4 * executed;
+                    continue;
+                }
+            }
+        }
+        cycle_c++;
+        cycles++;
+        struct dtFetch f = fetch(skip_break);
+        skip_break = false;
+        if (dt_f != nullptr) {
+            struct dtFetch f_swap = *dt_f;
+            *dt_f = f;
+            f = f_swap;
+        }
+
+        const BasicBlockOp *op = nullptr;
+        if (f.is_valid && f.excause == EXCAUSE_NONE) {
+            if (bb == nullptr || bb_addr != f.inst_addr.get_raw()
+                || (bb_pos >= bb->ops.size() && bb->closed)) {
+                bb = blocks.lookup(f.inst_addr);
+                bb_pos = 0;
+                if (jit != nullptr && bb->closed) { jit->profile(bb); }
+            }
+            if (bb_pos < bb->ops.size()) {
+                op = &bb->ops[bb_pos];
+                if (op->inst_word != f.inst.data()) {
+                    // Code has been modified since the translation
+                    blocks.truncate(bb, bb_pos);
+                    op = nullptr;
+                }
+            }
+            if (op == nullptr) {
+                op = &blocks.append(bb, f.inst_addr, f.inst);
+            }
+            bb_pos++;
+            bb_addr = f.inst_addr.get_raw() + 4;
+        }
+
+        if (op == nullptr || op->handler == nullptr
+            || ((op->flags & IMF_MEM) && has_watchpoints())) {
+            struct dtDecode d;
+            struct dtMemory m;
+            step_fetched(f, d, m);
+            if (m.excause != EXCAUSE_NONE || m.stop_if) {
+                // Exception handlers and emulated syscalls access memory
+                blocks.memory_may_have_changed();
+            } else if (d.memwrite) {
+                blocks.memory_written(m.mem_addr);
+            }
+            if (jit != nullptr) { jit->memory_may_have_changed(); }
+            continue;
+        }
+
+        if (op->flags & IMF_MEMWRITE) {
+            Address mem_addr(regs->read_gp(op->num_rs).as_u32() + op->immediate_val);
+            blocks.memory_written(mem_addr);
+            if (jit != nullptr) { jit->memory_written(mem_addr); }
+        }
+        bool branch_taken = op->handler(*op, regs, mem_data);
+        if (dt_f != nullptr) {
+            dt_f->in_delay_slot = branch_taken;
+            if ((op->flags & IMF_NB_SKIP_DS) && !branch_taken) {
+                dtFetchInit(*dt_f);
+            }
+        }
+        prev_inst_addr = f.inst_addr;
+    }
+    jit_sync_registers();
+    return cycles;
+}
+
+unsigned
+CoreSingle::block_run(Address addr, unsigned max_cycles, BasicBlock *&bb, size_t &bb_pos) {
+    // Breakpoints and interrupts are checked when the next instruction is
+    // fetched, which is one instruction ahead with delay slot. Blocks are
+    // not run with breakpoints on such core nor with enabled interrupts.
+    if (has_watchpoints() || (dt_f != nullptr && has_hwbreaks())) { return 0; }
+    if (cop0state != nullptr
+        && (cop0state->read_cop0reg(Cop0State::Status) & Cop0State::Status_IntMask)) {
+        return 0;
+    }
+    if (dt_f != nullptr
+        && (!dt_f->is_valid || dt_f->excause != EXCAUSE_NONE || dt_f->in_delay_slot
+            || regs->read_pc() != addr + 4)) {
+        return 0;
+    }
+    BasicBlock *block = blocks.lookup_verified(addr, mem_program);
+    if (block == nullptr) { return 0; }
+    // Delay slot latch holds the word really fetched
+    if (dt_f != nullptr && dt_f->inst.data() != block->ops[0].inst_word) { return 0; }
+    if (jit != nullptr) { jit->profile(block); }
+
+    unsigned executed = 0;
+    bool branch_taken = false;
+    Address inst_addr = addr; // Address of the next executed instruction
+    for (const BasicBlockOp &op : block->ops) {
+        if (executed >= max_cycles || op.handler == nullptr
+            || (executed != 0 && regs->read_pc() >= run_end_addr)) {
+            break;
+        }
+        if (hwbreak_may_hit(inst_addr)) { break; }
+        if (op.flags & IMF_NB_SKIP_DS) {
+            break; // Not taken branch discards the delay slot
+        }
+        if (op.flags & IMF_MEMWRITE) {
+            // Stores to the code are done by the regular path, it compares
+            // the fetched words with the ops
+            Address mem_addr(regs->read_gp(op.num_rs).as_u32() + op.immediate_val);
+            if (blocks.is_code(mem_addr)) { break; }
+            if (jit != nullptr) { jit->memory_written(mem_addr); }
+        }
+        // With delay slot the next instruction is the one the program
+        // counter pointed to before the op (it would have been latched)
+        const Address pc = regs->read_pc();
+        branch_taken = op.handler(op, regs, mem_data);
+        executed++;
+        prev_inst_addr = inst_addr;
+        inst_addr = (dt_f != nullptr) ? pc : regs->read_pc();
+    }
+    if (executed == 0) { return 0; }
+
+    cycle_c += executed;
+    if (dt_f != nullptr) {
+        // Refill the fetch latch the same way as the interpreter would
+        const Address next_pc = regs->read_pc();
+        regs->pc_abs_jmp(inst_addr);
+        *dt_f = fetch(false);
+        dt_f->in_delay_slot = branch_taken;
+        regs->pc_abs_jmp(next_pc);
+    }
+    bb = block;
+    bb_pos = executed;
+    return executed;
+}
+
+unsigned CoreSingle::jit_run(Address addr, unsigned max_cycles) {
+    // Interrupts and hardware breakpoints are checked at each fetch and
+    // watchpoints at each memory access, translated code cannot honor them
+    if (has_hwbreaks() || has_watchpoints()) { return 0; }
+    if (cop0state != nullptr
+        && (cop0state->read_cop0reg(Cop0State::Status) & Cop0State::Status_IntMask)) {
+        return 0;
+    }
+    if (dt_f != nullptr
+        && (!dt_f->is_valid || dt_f->excause != EXCAUSE_NONE || dt_f->in_delay_slot
+            || regs->read_pc() != addr + 4)) {
+        return 0;
+    }
+
+    const JitBlock *jb = jit->lookup(addr);
+    if (jb == nullptr || jb->length > max_cycles) { return 0; }
+    // PC may not reach the end of the run inside of the block
+    if (addr + 4 * (jb->length + 2) > run_end_addr) { return 0; }
+    if (dt_f != nullptr && dt_f->inst.data() != jb->words[0]) { return 0; }
+
+    if (!jit_regs_loaded) {
+        jit->load_registers(regs);
+        jit_regs_loaded = true;
+    }
+    const uint32_t next = jit->execute(jb);
+    const JitContext &ctx = jit->context();
+    if (ctx.executed == 0) { return 0; }
+
+    cycle_c += ctx.executed;
+    prev_inst_addr = Address(ctx.last_addr);
+    regs->pc_abs_jmp(Address(next));
+    if (dt_f != nullptr) {
+        // Refill the fetch latch the same way as the interpreter would
+        *dt_f = fetch(false);
+        if (ctx.exit_in_ds) {
+            // Block has been left before the delay slot of its control transfer
+            dt_f->in_delay_slot = ctx.branch_taken;
+            regs->pc_abs_jmp(Address(ctx.branch_taken ? ctx.branch_target : next + 4));
+        } else {
+            regs->pc_inc();
+        }
+    }
+    return ctx.executed;
+}
+
+void CoreSingle::jit_sync_registers() {
+    if (jit_regs_loaded) {
+        jit->store_registers(regs);
+        jit_regs_loaded = false;
+    }
+}
+
+bool CoreSingle::step_fetched(struct dtFetch &f, struct dtDecode &d, struct dtMemory &m) {
+    bool branch_taken = false;
+    d = decode(f);
     struct dtExecute e = execute(d);
-    struct dtMemory m = memory(e);
+    m = memory(e);
     writeback(m);
 
     // Handle PC before instruction following jump leaves decode stage
 
     if ((m.stop_if || (m.excause != EXCAUSE_NONE)) && dt_f != nullptr) {
         dtFetchInit(*dt_f);
-        emit instruction_fetched(dt_f->inst, dt_f->inst_addr, dt_f->excause, dt_f->is_valid);
-        emit fetch_inst_addr_value(STAGEADDR_NONE);
+        if (!headless) {
+            emit instruction_fetched(dt_f->inst, dt_f->inst_addr, dt_f->excause, dt_f->is_valid);
+            emit fetch_inst_addr_value(STAGEADDR_NONE);
+        }
+        if (trace != nullptr) {
+            trace_stage(
+                TraceRecord::FETCH, dt_f->inst, dt_f->inst_addr, dt_f->excause, dt_f->is_valid);
+        }
     } else {
-        bool branch_taken = handle_pc(d);
+        branch_taken = handle_pc(d);
         if (dt_f != nullptr) {
             dt_f->in_delay_slot = branch_taken;
             if (d.nb_skip_ds && !branch_taken) {
@@ -796,12 +1629,18 @@ void CoreSingle::do_step(bool skip_break) {
         handle_exception(
             this, regs, m.excause, m.inst_addr, regs->read_pc(), prev_inst_addr, m.in_delay_slot,
             m.mem_addr);
-        return;
+        return branch_taken;
     }
     prev_inst_addr = m.inst_addr;
+    return branch_taken;
 }
 
 void CoreSingle::do_reset() {
+    blocks.invalidate();
+    if (jit != nullptr) {
+        jit->invalidate();
+        jit_regs_loaded = false;
+    }
     if (dt_f != nullptr) {
         Core::dtFetchInit(*dt_f);
         dt_f->inst_addr = Address::null();
@@ -809,52 +1648,129 @@ void CoreSingle::do_reset() {
     prev_inst_addr = Address::null();
 }
 
+void CoreSingle::do_save_state(QDataStream &out) const {
+    out << (dt_f != nullptr);
+    if (dt_f != nullptr) { save_latch(out, *dt_f); }
+    out << (quint64)prev_inst_addr.get_raw();
+}
+
+void CoreSingle::do_load_state(QDataStream &in) {
+    bool delay_slot;
+    in >> delay_slot;
+    if (delay_slot != (dt_f != nullptr)) {
+        throw SIMULATOR_EXCEPTION(
+            Input, "Delay slot configuration does not match checkpoint", "");
+    }
+    if (dt_f != nullptr) { load_latch(in, *dt_f); }
+    quint64 addr;
+    in >> addr;
+    prev_inst_addr = Address(addr);
+    if (dt_f != nullptr && !headless) {
+        emit instruction_fetched(dt_f->inst, dt_f->inst_addr, dt_f->excause, dt_f->is_valid);
+        emit fetch_inst_addr_value(dt_f->inst_addr);
+    }
+}
+
+double DualIssueStats::dual_rate() const {
+    return issue_cycles != 0 ? (double)dual / (double)issue_cycles : 0.0;
+}
+
+const char *DualIssueStats::reason_name(enum SingleIssue reason) {
+    switch (reason) {
+    case SI_EMPTY: return "empty";
+    case SI_FIRST: return "first";
+    case SI_PIPE: return "pipe";
+    case SI_DEPENDENCY: return "dependency";
+    case SI_HAZARD: return "hazard";
+    default: return "none";
+    }
+}
+
 CorePipelined::CorePipelined(
     Registers *regs,
     FrontendMemory *mem_program,
     FrontendMemory *mem_data,
     enum MachineConfig::HazardUnit hazard_unit,
     unsigned int min_cache_row_size,
-    Cop0State *cop0state)
-    : Core(regs, mem_program, mem_data, min_cache_row_size, cop0state) {
+    Cop0State *cop0state,
+    bool headless,
+    const BranchPredictorConfig &branch_predictor,
+    bool dual_issue)
+    : Core(regs, mem_program, mem_data, min_cache_row_size, cop0state, headless) {
     this->hazard_unit = hazard_unit;
+    this->dual_issue = dual_issue;
+    if (branch_predictor.predictor() != BranchPredictorConfig::BP_NONE) {
+        predictor = std::make_unique<BranchPredictor>(branch_predictor);
+    }
     reset();
 }
 
+const BranchPredictor *CorePipelined::get_branch_predictor() const {
+    return predictor.get();
+}
+
+const DualIssueStats *CorePipelined::get_dual_issue() const {
+    return dual_issue ? &issue_stats : nullptr;
+}
+
 void CorePipelined::do_step(bool skip_break) {
     bool stall = false;
     bool branch_stall = false;
     bool excpt_in_progress;
     Address jump_branch_pc = dt_m.inst_addr;
 
-    // Process stages
+    // Process stages, results of the first pipe are written back first as
+    // it holds the older instruction of the pair
     writeback(dt_m);
+    if (dual_issue) { step_second_pipe(); }
     dt_m = memory(dt_e);
     dt_e = execute(dt_d);
     dt_d = decode(dt_f);
 
-    // Resolve exceptions
+    // Resolve exceptions, the younger instruction of the pair is discarded
+    // along with the excepting one
+    Address next_inst_addr = dt_m1.is_valid ? dt_m1.inst_addr : dt_e.inst_addr;
     excpt_in_progress = dt_m.excause != EXCAUSE_NONE;
     if (excpt_in_progress) {
+        dtMemoryInit(dt_m1);
         dtExecuteInit(dt_e);
-        emit instruction_executed(dt_e.inst, dt_e.inst_addr, dt_e.excause, dt_e.is_valid);
-        emit execute_inst_addr_value(STAGEADDR_NONE);
+        if (!headless) {
+            emit instruction_executed(dt_e.inst, dt_e.inst_addr, dt_e.excause, dt_e.is_valid);
+            emit execute_inst_addr_value(STAGEADDR_NONE);
+        }
+        if (trace != nullptr) {
+            trace_stage(TraceRecord::EXECUTE, dt_e.inst, dt_e.inst_addr, dt_e.excause, dt_e.is_valid);
+        }
     }
     excpt_in_progress = excpt_in_progress || dt_e.excause != EXCAUSE_NONE;
     if (excpt_in_progress) {
+        dtExecuteInit(dt_e1);
         dtDecodeInit(dt_d);
-        emit instruction_decoded(dt_d.inst, dt_d.inst_addr, dt_d.excause, dt_d.is_valid);
-        emit decode_inst_addr_value(STAGEADDR_NONE);
+        dtDecodeInit(dt_d1);
+        if (!headless) {
+            emit instruction_decoded(dt_d.inst, dt_d.inst_addr, dt_d.excause, dt_d.is_valid);
+            emit decode_inst_addr_value(STAGEADDR_NONE);
+        }
+        if (trace != nullptr) {
+            trace_stage(TraceRecord::DECODE, dt_d.inst, dt_d.inst_addr, dt_d.excause, dt_d.is_valid);
+        }
     }
     excpt_in_progress = excpt_in_progress || dt_e.excause != EXCAUSE_NONE;
     if (excpt_in_progress) {
         dtFetchInit(dt_f);
-        emit instruction_fetched(dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
-        emit fetch_inst_addr_value(STAGEADDR_NONE);
+        dtFetchInit(dt_f1);
+        if (!headless) {
+            emit instruction_fetched(dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
+            emit fetch_inst_addr_value(STAGEADDR_NONE);
+        }
+        if (trace != nullptr) {
+            trace_stage(TraceRecord::FETCH, dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
+        }
+        bp_stall = 0;
         if (dt_m.excause != EXCAUSE_NONE) {
-            regs->pc_abs_jmp(dt_e.inst_addr);
+            regs->pc_abs_jmp(next_inst_addr);
             handle_exception(
-                this, regs, dt_m.excause, dt_m.inst_addr, dt_e.inst_addr, jump_branch_pc,
+                this, regs, dt_m.excause, dt_m.inst_addr, next_inst_addr, jump_branch_pc,
                 dt_m.in_delay_slot, dt_m.mem_addr);
         }
         return;
@@ -864,84 +1780,16 @@ void CorePipelined::do_step(bool skip_break) {
     dt_d.ff_rt = FORWARD_NONE;
 
     if (hazard_unit != MachineConfig::HU_NONE) {
-        // Note: We make exception with $0 as that has no effect when
-        // written and is used in nop instruction
-
-#define HAZARD(STAGE)                                                                              \
-    ((STAGE).regwrite && (STAGE).rwrite != 0                                                       \
-     && ((dt_d.alu_req_rs && (STAGE).rwrite == dt_d.num_rs)                                        \
-         || (dt_d.alu_req_rt && (STAGE).rwrite == dt_d.num_rt))) // Note: We make exception with
-                                                                 // $0 as that has no effect and
-                                                                 // is used in nop instruction
-
-        // Write back stage combinatoricly propagates written instruction to
-        // decode stage so nothing has to be done for that stage
-        if (HAZARD(dt_m)) {
-            // Hazard with instruction in memory stage
-            if (hazard_unit == MachineConfig::HU_STALL_FORWARD) {
-                // Forward result value
-                if (dt_d.alu_req_rs && dt_m.rwrite == dt_d.num_rs) {
-                    dt_d.val_rs = dt_m.towrite_val;
-                    dt_d.ff_rs = FORWARD_FROM_W;
-                }
-                if (dt_d.alu_req_rt && dt_m.rwrite == dt_d.num_rt) {
-                    dt_d.val_rt = dt_m.towrite_val;
-                    dt_d.ff_rt = FORWARD_FROM_W;
-                }
-            } else {
-                stall = true;
-            }
+        stall = resolve_hazards(dt_d, branch_stall);
+        if (!headless) {
+            emit forward_m_d_rs_value(dt_d.forward_m_d_rs);
+            emit forward_m_d_rt_value(dt_d.forward_m_d_rt);
         }
-        if (HAZARD(dt_e)) {
-            // Hazard with instruction in execute stage
-            if (hazard_unit == MachineConfig::HU_STALL_FORWARD) {
-                if (dt_e.memread) {
-                    stall = true;
-                } else {
-                    // Forward result value
-                    if (dt_d.alu_req_rs && dt_e.rwrite == dt_d.num_rs) {
-                        dt_d.val_rs = dt_e.alu_val;
-                        dt_d.ff_rs = FORWARD_FROM_M;
-                    }
-                    if (dt_d.alu_req_rt && dt_e.rwrite == dt_d.num_rt) {
-                        dt_d.val_rt = dt_e.alu_val;
-                        dt_d.ff_rt = FORWARD_FROM_M;
-                    }
-                }
-            } else {
-                stall = true;
-            }
-        }
-#undef HAZARD
-        if (dt_e.rwrite != 0 && dt_e.regwrite
-            && ((dt_d.bjr_req_rs && dt_d.num_rs == dt_e.rwrite)
-                || (dt_d.bjr_req_rt && dt_d.num_rt == dt_e.rwrite))) {
-            stall = true;
-            branch_stall = true;
-        } else {
-            if (hazard_unit != MachineConfig::HU_STALL_FORWARD || dt_m.memtoreg) {
-                if (dt_m.rwrite != 0 && dt_m.regwrite
-                    && ((dt_d.bjr_req_rs && dt_d.num_rs == dt_m.rwrite)
-                        || (dt_d.bjr_req_rt && dt_d.num_rt == dt_m.rwrite))) {
-                    stall = true;
-                }
-            } else {
-                if (dt_m.rwrite != 0 && dt_m.regwrite && dt_d.bjr_req_rs
-                    && dt_d.num_rs == dt_m.rwrite) {
-                    dt_d.val_rs = dt_m.towrite_val;
-                    dt_d.forward_m_d_rs = true;
-                }
-                if (dt_m.rwrite != 0 && dt_m.regwrite && dt_d.bjr_req_rt
-                    && dt_d.num_rt == dt_m.rwrite) {
-                    dt_d.val_rt = dt_m.towrite_val;
-                    dt_d.forward_m_d_rt = true;
-                }
-            }
-        }
-        emit forward_m_d_rs_value(dt_d.forward_m_d_rs);
-        emit forward_m_d_rt_value(dt_d.forward_m_d_rt);
     }
-    emit branch_forward_value((dt_d.forward_m_d_rs || dt_d.forward_m_d_rt) ? 2 : branch_stall);
+    if (!headless) {
+        emit branch_forward_value(
+            (dt_d.forward_m_d_rs || dt_d.forward_m_d_rt) ? 2 : branch_stall);
+    }
 #if 0
     if (stall)
         printf("STALL\n");
@@ -958,25 +1806,43 @@ void CorePipelined::do_step(bool skip_break) {
 #endif
 
     if (dt_e.stop_if || dt_m.stop_if) { stall = true; }
+    if (bp_stall > 0) {
+        // Front end is redirected after branch misprediction
+        bp_stall--;
+        stall = true;
+    }
 
-    emit hu_stall_value(stall);
+    if (!headless) { emit hu_stall_value(stall); }
 
     // Now process program counter (loop connections from decode stage)
-    if (!stall && !dt_d.stop_if) {
+    if (!stall && !dt_d.stop_if && dual_issue) {
+        dt_d.stall = false;
+        issue_dual(skip_break);
+    } else if (!stall && !dt_d.stop_if) {
         dt_d.stall = false;
         dt_f = fetch(skip_break);
-        if (handle_pc(dt_d)) {
+        bool branch_taken = handle_pc(dt_d);
+        if (predictor != nullptr) { predict_branch(branch_taken); }
+        if (branch_taken) {
             dt_f.in_delay_slot = true;
         } else {
             if (dt_d.nb_skip_ds) {
                 dtFetchInit(dt_f);
-                emit instruction_fetched(dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
-                emit fetch_inst_addr_value(STAGEADDR_NONE);
+                if (!headless) {
+                    emit instruction_fetched(
+                        dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
+                    emit fetch_inst_addr_value(STAGEADDR_NONE);
+                }
+                if (trace != nullptr) {
+                    trace_stage(
+                        TraceRecord::FETCH, dt_f.inst, dt_f.inst_addr, dt_f.excause,
+                        dt_f.is_valid);
+                }
             }
         }
     } else {
         // Run fetch stage on empty
-        fetch(skip_break);
+        fetch(skip_break, true);
         // clear decode latch (insert nope to execute stage)
         if (!dt_d.stop_if) {
             dtDecodeInit(dt_d);
@@ -984,13 +1850,234 @@ void CorePipelined::do_step(bool skip_break) {
         } else {
             dtFetchInit(dt_f);
         }
+        if (dual_issue) {
+            if (dt_d.stop_if) {
+                // The instruction following the serializing one is fetched
+                // again after it
+                if (dt_f1.is_valid) { regs->pc_abs_jmp(dt_f1.inst_addr); }
+                dtFetchInit(dt_f1);
+                if (dt_d.is_valid) {
+                    issue_stats.issue_cycles++;
+                    issue_stats.single[DualIssueStats::SI_FIRST]++;
+                }
+            }
+            dtDecodeInit(dt_d1);
+        }
         // emit instruction_decoded(dt_d.inst, dt_d.inst_addr, dt_d.excause,
         // dt_d.is_valid);
     }
     if (stall || dt_d.stop_if) {
         stall_c++;
-        emit stall_c_value(stall_c);
+        if (profiler != nullptr) { profiler->stalled(dt_d.inst_addr); }
+        if (!headless) { emit stall_c_value(stall_c); }
+    }
+}
+
+bool CorePipelined::resolve_hazards(struct dtDecode &dt, bool &branch_stall) {
+    bool stall = false;
+
+#define HAZARD(STAGE)                                                                              \
+    ((STAGE).regwrite && (STAGE).rwrite != 0                                                       \
+     && ((dt.alu_req_rs && (STAGE).rwrite == dt.num_rs)                                            \
+         || (dt.alu_req_rt && (STAGE).rwrite == dt.num_rt))) // Note: We make exception with
+                                                             // $0 as that has no effect and
+                                                             // is used in nop instruction
+
+    // Write back stage combinatoricly propagates written instruction to
+    // decode stage so nothing has to be done for that stage. The second
+    // pipe holds the younger instruction of the pair, so its result takes
+    // precedence.
+    for (const struct dtMemory *m : { &dt_m, &dt_m1 }) {
+        if (HAZARD(*m)) {
+            // Hazard with instruction in memory stage
+            if (hazard_unit == MachineConfig::HU_STALL_FORWARD) {
+                // Forward result value
+                if (dt.alu_req_rs && m->rwrite == dt.num_rs) {
+                    dt.val_rs = m->towrite_val;
+                    dt.ff_rs = FORWARD_FROM_W;
+                }
+                if (dt.alu_req_rt && m->rwrite == dt.num_rt) {
+                    dt.val_rt = m->towrite_val;
+                    dt.ff_rt = FORWARD_FROM_W;
+                }
+            } else {
+                stall = true;
+            }
+        }
+    }
+    for (const struct dtExecute *e : { &dt_e, &dt_e1 }) {
+        if (HAZARD(*e)) {
+            // Hazard with instruction in execute stage
+            if (hazard_unit == MachineConfig::HU_STALL_FORWARD) {
+                if (e->memread) {
+                    stall = true;
+                } else {
+                    // Forward result value
+                    if (dt.alu_req_rs && e->rwrite == dt.num_rs) {
+                        dt.val_rs = e->alu_val;
+                        dt.ff_rs = FORWARD_FROM_M;
+                    }
+                    if (dt.alu_req_rt && e->rwrite == dt.num_rt) {
+                        dt.val_rt = e->alu_val;
+                        dt.ff_rt = FORWARD_FROM_M;
+                    }
+                }
+            } else {
+                stall = true;
+            }
+        }
+    }
+#undef HAZARD
+    for (const struct dtExecute *e : { &dt_e, &dt_e1 }) {
+        if (e->rwrite != 0 && e->regwrite
+            && ((dt.bjr_req_rs && dt.num_rs == e->rwrite)
+                || (dt.bjr_req_rt && dt.num_rt == e->rwrite))) {
+            stall = true;
+            branch_stall = true;
+        }
+    }
+    if (branch_stall) { return stall; }
+    for (const struct dtMemory *m : { &dt_m, &dt_m1 }) {
+        if (hazard_unit != MachineConfig::HU_STALL_FORWARD || m->memtoreg) {
+            if (m->rwrite != 0 && m->regwrite
+                && ((dt.bjr_req_rs && dt.num_rs == m->rwrite)
+                    || (dt.bjr_req_rt && dt.num_rt == m->rwrite))) {
+                stall = true;
+            }
+        } else {
+            if (m->rwrite != 0 && m->regwrite && dt.bjr_req_rs && dt.num_rs == m->rwrite) {
+                dt.val_rs = m->towrite_val;
+                dt.forward_m_d_rs = true;
+            }
+            if (m->rwrite != 0 && m->regwrite && dt.bjr_req_rt && dt.num_rt == m->rwrite) {
+                dt.val_rt = m->towrite_val;
+                dt.forward_m_d_rt = true;
+            }
+        }
+    }
+    return stall;
+}
+
+void CorePipelined::step_second_pipe() {
+    bool was_headless = headless;
+    headless = true;
+    writeback(dt_m1);
+    dt_m1 = memory(dt_e1);
+    dt_e1 = execute(dt_d1);
+    dt_d1 = decode(dt_f1);
+    headless = was_headless;
+}
+
+struct Core::dtFetch CorePipelined::fetch_quiet(bool skip_break) {
+    bool was_headless = headless;
+    headless = true;
+    struct dtFetch dt = fetch(skip_break);
+    headless = was_headless;
+    return dt;
+}
+
+bool CorePipelined::second_pipe_capable(const struct dtDecode &dt) {
+    if (dt.memread || dt.memwrite || dt.branch || dt.jump || dt.stop_if) { return false; }
+    switch (dt.aluop) {
+    case ALU_OP_NOP:
+    case ALU_OP_SLL:
+    case ALU_OP_SRL:
+    case ALU_OP_ROTR:
+    case ALU_OP_SRA:
+    case ALU_OP_SLLV:
+    case ALU_OP_SRLV:
+    case ALU_OP_ROTRV:
+    case ALU_OP_SRAV:
+    case ALU_OP_MOVZ:
+    case ALU_OP_MOVN:
+    case ALU_OP_ADDU:
+    case ALU_OP_SUBU:
+    case ALU_OP_AND:
+    case ALU_OP_OR:
+    case ALU_OP_XOR:
+    case ALU_OP_NOR:
+    case ALU_OP_SLT:
+    case ALU_OP_SLTU:
+    case ALU_OP_LUI:
+    case ALU_OP_WSBH:
+    case ALU_OP_SEB:
+    case ALU_OP_SEH:
+    case ALU_OP_EXT:
+    case ALU_OP_INS:
+    case ALU_OP_CLZ:
+    case ALU_OP_CLO: return true;
+    default: return false;
+    }
+}
+
+bool CorePipelined::can_pair(enum DualIssueStats::SingleIssue &reason) {
+    if (!dt_d1.is_valid) {
+        reason = DualIssueStats::SI_EMPTY;
+        return false;
+    }
+    // Skipped delay slot cannot issue before the branch is resolved
+    if (!dt_d.is_valid || dt_d.excause != EXCAUSE_NONE || dt_d.nb_skip_ds) {
+        reason = DualIssueStats::SI_FIRST;
+        return false;
+    }
+    if (dt_d1.excause != EXCAUSE_NONE || !second_pipe_capable(dt_d1)) {
+        reason = DualIssueStats::SI_PIPE;
+        return false;
+    }
+    if (dt_d.regwrite && dt_d.rwrite != 0
+        && ((dt_d1.alu_req_rs && dt_d1.num_rs == dt_d.rwrite)
+            || (dt_d1.alu_req_rt && dt_d1.num_rt == dt_d.rwrite))) {
+        reason = DualIssueStats::SI_DEPENDENCY;
+        return false;
+    }
+    dt_d1.ff_rs = FORWARD_NONE;
+    dt_d1.ff_rt = FORWARD_NONE;
+    bool branch_stall = false;
+    if (hazard_unit != MachineConfig::HU_NONE && resolve_hazards(dt_d1, branch_stall)) {
+        reason = DualIssueStats::SI_HAZARD;
+        return false;
     }
+    return true;
+}
+
+void CorePipelined::issue_dual(bool skip_break) {
+    enum DualIssueStats::SingleIssue reason = DualIssueStats::SI_EMPTY;
+    bool paired = can_pair(reason);
+    if (dt_d.is_valid) {
+        issue_stats.issue_cycles++;
+        if (paired) {
+            issue_stats.dual++;
+        } else {
+            issue_stats.single[reason]++;
+        }
+    }
+
+    // Program counter points behind the second instruction already. The
+    // delay slot has been fetched along with the branch, so the branch is
+    // resolved as if the delay slot were being fetched now.
+    Address fetch_pc = regs->read_pc();
+    bool control = dt_d.branch || dt_d.jump;
+    if (control) { regs->pc_abs_jmp(dt_d.inst_addr + 4); }
+    bool branch_taken = handle_pc(dt_d);
+    if (!control) { regs->pc_abs_jmp(fetch_pc); }
+    if (predictor != nullptr) { predict_branch(branch_taken); }
+
+    if (paired) {
+        dt_d1.stall = false;
+        dt_d1.in_delay_slot = branch_taken;
+    } else {
+        dtDecodeInit(dt_d1);
+    }
+    if (!paired && dt_f1.is_valid && !(dt_d.nb_skip_ds && !branch_taken)) {
+        // The second instruction issues from the first slot next cycle
+        dt_f = dt_f1;
+        dt_f.in_delay_slot = branch_taken;
+    } else {
+        dt_f = fetch(skip_break);
+        regs->pc_inc();
+    }
+    dt_f1 = fetch_quiet(false);
+    regs->pc_inc();
 }
 
 void CorePipelined::do_reset() {
@@ -1002,6 +2089,267 @@ void CorePipelined::do_reset() {
     dt_e.inst_addr = 0x0_addr;
     dtMemoryInit(dt_m);
     dt_m.inst_addr = 0x0_addr;
+    dtFetchInit(dt_f1);
+    dt_f1.inst_addr = 0x0_addr;
+    dtDecodeInit(dt_d1);
+    dt_d1.inst_addr = 0x0_addr;
+    dtExecuteInit(dt_e1);
+    dt_e1.inst_addr = 0x0_addr;
+    dtMemoryInit(dt_m1);
+    dt_m1.inst_addr = 0x0_addr;
+    issue_stats = DualIssueStats();
+    bp_stall = 0;
+    if (predictor != nullptr) { predictor->reset(); }
+}
+
+void CorePipelined::predict_branch(bool taken) {
+    if (!dt_d.is_valid || !(dt_d.branch || dt_d.jump)) { return; }
+    enum BranchPredictor::Kind kind = branch_kind(dt_d);
+    // Handled instruction has already set the next PC
+    Address target = dt_d.branch ? branch_target(dt_d) : regs->read_pc();
+    bool call = dt_d.jump ? dt_d.regwrite : taken && dt_d.regd31;
+    bp_stall += predictor->resolve(dt_d.inst_addr, kind, taken, target, call);
+}
+
+void CorePipelined::do_save_state(QDataStream &out) const {
+    save_latch(out, dt_f);
+    save_latch(out, dt_d);
+    save_latch(out, dt_e);
+    save_latch(out, dt_m);
+    out << (quint32)bp_stall;
+    if (predictor != nullptr) { predictor->save_state(out); }
+    if (dual_issue) {
+        save_latch(out, dt_f1);
+        save_latch(out, dt_d1);
+        save_latch(out, dt_e1);
+        save_latch(out, dt_m1);
+        out << (quint64)issue_stats.issue_cycles << (quint64)issue_stats.dual;
+        for (uint64_t count : issue_stats.single) {
+            out << (quint64)count;
+        }
+    }
+}
+
+void CorePipelined::do_load_state(QDataStream &in) {
+    load_latch(in, dt_f);
+    load_latch(in, dt_d);
+    load_latch(in, dt_e);
+    load_latch(in, dt_m);
+    quint32 stall;
+    in >> stall;
+    bp_stall = stall;
+    if (predictor != nullptr) { predictor->load_state(in); }
+    if (dual_issue) {
+        load_latch(in, dt_f1);
+        load_latch(in, dt_d1);
+        load_latch(in, dt_e1);
+        load_latch(in, dt_m1);
+        quint64 issue_cycles, dual;
+        in >> issue_cycles >> dual;
+        issue_stats.issue_cycles = issue_cycles;
+        issue_stats.dual = dual;
+        for (uint64_t &count : issue_stats.single) {
+            quint64 value;
+            in >> value;
+            count = value;
+        }
+    }
+    if (!headless) {
+        emit instruction_fetched(dt_f.inst, dt_f.inst_addr, dt_f.excause, dt_f.is_valid);
+        emit instruction_decoded(dt_d.inst, dt_d.inst_addr, dt_d.excause, dt_d.is_valid);
+        emit instruction_executed(dt_e.inst, dt_e.inst_addr, dt_e.excause, dt_e.is_valid);
+        emit instruction_memory(dt_m.inst, dt_m.inst_addr, dt_m.excause, dt_m.is_valid);
+    }
+}
+
+CoreOutOfOrder::CoreOutOfOrder(
+    Registers *regs,
+    FrontendMemory *mem_program,
+    FrontendMemory *mem_data,
+    bool jmp_delay_slot,
+    const OutOfOrderConfig &config,
+    unsigned int min_cache_row_size,
+    Cop0State *cop0state,
+    bool headless,
+    const BranchPredictorConfig &branch_predictor)
+    : CoreSingle(
+        regs, mem_program, mem_data, jmp_delay_slot, min_cache_row_size, cop0state, headless)
+    , engine(config) {
+    if (branch_predictor.predictor() != BranchPredictorConfig::BP_NONE) {
+        predictor = std::make_unique<BranchPredictor>(branch_predictor);
+    }
+    reset();
+}
+
+void CoreOutOfOrder::set_memory_timing(const Cache *program_cache, const Cache *data_cache) {
+    cache_program = program_cache;
+    cache_data = data_cache;
+}
+
+const BranchPredictor *CoreOutOfOrder::get_branch_predictor() const {
+    return predictor.get();
+}
+
+const OutOfOrderEngine *CoreOutOfOrder::get_out_of_order() const {
+    return &engine;
+}
+
+void CoreOutOfOrder::do_step(bool skip_break) {
+    engine.commit();
+    for (unsigned i = 0; i < engine.get_config().issue_width(); i++) {
+        if (!has_pending) {
+            if (!engine.front_end_ready()) { break; }
+            has_pending = execute_instruction(skip_break);
+            skip_break = false;
+            // Empty delay slot takes the dispatch slot
+            if (!has_pending) { continue; }
+        }
+        if (!engine.dispatch(pending)) { break; }
+        has_pending = false;
+        if (pending.end_group) { break; }
+    }
+    if (engine.end_cycle()) {
+        stall_c++;
+        if (!headless) { emit stall_c_value(stall_c); }
+    }
+}
+
+bool CoreOutOfOrder::execute_instruction(bool skip_break) {
+    // Lower cache levels are shared, their stalls caused by the fetch are
+    // not attributed to the data access
+    uint32_t fetch_stalls
+        = cache_program != nullptr ? cache_program->get_hierarchy_stall_count() : 0;
+    struct dtFetch f = fetch(skip_break);
+    uint32_t data_stalls
+        = cache_data != nullptr ? cache_data->get_hierarchy_stall_count() : 0;
+    if (dt_f != nullptr) {
+        struct dtFetch f_swap = *dt_f;
+        *dt_f = f;
+        f = f_swap;
+    }
+    struct dtDecode d;
+    struct dtMemory m;
+    bool branch_taken = step_fetched(f, d, m);
+    if (!f.is_valid) { return false; }
+
+    OutOfOrderEngine::Op &op = pending;
+    op = OutOfOrderEngine::Op();
+    op.inst_addr = f.inst_addr;
+    op.fetch_ready = engine.cycle();
+    if (cache_program != nullptr) {
+        op.fetch_ready += cache_program->get_hierarchy_stall_count() - fetch_stalls;
+    }
+
+    unsigned src = 0;
+    if (d.alu_req_rs || d.bjr_req_rs) { op.src[src++] = d.num_rs; }
+    if (d.memwrite) {
+        op.store_data = d.num_rt;
+    } else if (d.alu_req_rt || d.bjr_req_rt) {
+        op.src[src++] = d.num_rt;
+    }
+    if (d.regwrite) { op.dst[0] = d.rwrite; }
+
+    const OutOfOrderConfig &config = engine.get_config();
+    switch (d.aluop) {
+    case ALU_OP_MFHI: op.src[src] = OutOfOrderEngine::REG_HI; break;
+    case ALU_OP_MFLO: op.src[src] = OutOfOrderEngine::REG_LO; break;
+    case ALU_OP_MTHI: op.dst[0] = OutOfOrderEngine::REG_HI; break;
+    case ALU_OP_MTLO: op.dst[0] = OutOfOrderEngine::REG_LO; break;
+    case ALU_OP_MADD:
+    case ALU_OP_MADDU:
+    case ALU_OP_MSUB:
+    case ALU_OP_MSUBU:
+        op.src[src++] = OutOfOrderEngine::REG_HI;
+        op.src[src] = OutOfOrderEngine::REG_LO;
+        FALLTROUGH
+    case ALU_OP_MULT:
+    case ALU_OP_MULTU:
+        op.dst[0] = OutOfOrderEngine::REG_HI;
+        op.dst[1] = OutOfOrderEngine::REG_LO;
+        FALLTROUGH
+    case ALU_OP_MUL:
+        op.unit = OutOfOrderEngine::FU_MUL;
+        op.latency = config.mul_latency();
+        break;
+    case ALU_OP_DIV:
+    case ALU_OP_DIVU:
+        op.dst[0] = OutOfOrderEngine::REG_HI;
+        op.dst[1] = OutOfOrderEngine::REG_LO;
+        op.unit = OutOfOrderEngine::FU_DIV;
+        op.latency = config.div_latency();
+        break;
+    default: break;
+    }
+
+    if (d.memread || d.memwrite) {
+        op.unit = OutOfOrderEngine::FU_MEM;
+        op.memread = d.memread;
+        op.memwrite = d.memwrite;
+        op.mem_addr = m.mem_addr.get_raw();
+        if (d.memread && cache_data != nullptr) {
+            op.latency += cache_data->get_hierarchy_stall_count() - data_stalls;
+        }
+    }
+
+    op.serialize = m.excause != EXCAUSE_NONE || d.stop_if;
+    if ((d.branch || d.jump) && !op.serialize) {
+        op.end_group = branch_taken;
+        if (predictor != nullptr) {
+            // Handled instruction has already set the next PC
+            Address target = d.branch ? branch_target(d) : regs->read_pc();
+            bool call = d.jump ? d.regwrite : branch_taken && d.regd31;
+            uint64_t mispredictions = predictor->get_stats().mispredictions();
+            op.penalty = predictor->resolve(d.inst_addr, branch_kind(d), branch_taken, target, call);
+            op.mispredicted = predictor->get_stats().mispredictions() != mispredictions;
+        }
+    }
+    return true;
+}
+
+void CoreOutOfOrder::do_reset() {
+    CoreSingle::do_reset();
+    engine.reset();
+    has_pending = false;
+    if (predictor != nullptr) { predictor->reset(); }
+}
+
+unsigned CoreOutOfOrder::do_run(unsigned max_cycles, bool skip_break) {
+    // Translated blocks of the single cycle core would bypass the timing
+    return Core::do_run(max_cycles, skip_break);
+}
+
+void CoreOutOfOrder::do_save_state(QDataStream &out) const {
+    CoreSingle::do_save_state(out);
+    engine.save_state(out);
+    out << has_pending;
+    if (has_pending) { OutOfOrderEngine::save_op(out, pending); }
+    if (predictor != nullptr) { predictor->save_state(out); }
+}
+
+void CoreOutOfOrder::do_load_state(QDataStream &in) {
+    CoreSingle::do_load_state(in);
+    engine.load_state(in);
+    in >> has_pending;
+    if (has_pending) { OutOfOrderEngine::load_op(in, pending); }
+    if (predictor != nullptr) { predictor->load_state(in); }
+}
+
+void ExceptionHandler::save_state(QDataStream &out) const {
+    UNUSED(out)
+}
+
+void ExceptionHandler::load_state(QDataStream &in) {
+    UNUSED(in)
+}
+
+bool ExceptionHandler::set_io_journal(IoJournal *journal) {
+    UNUSED(journal)
+    return false;
+}
+
+bool StopExceptionHandler::set_io_journal(IoJournal *journal) {
+    UNUSED(journal)
+    return true; // Only stops the core
 }
 
 bool StopExceptionHandler::handle_exception(
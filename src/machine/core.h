@@ -37,21 +37,57 @@
 #define CORE_H
 
 #include "alu.h"
+#include "basicblock.h"
+#include "branch_predictor.h"
 #include "cop0state.h"
 #include "instruction.h"
+#include "iojournal.h"
+#include "jit/jit.h"
 #include "machineconfig.h"
 #include "memory/address.h"
 #include "memory/frontend_memory.h"
+#include "out_of_order.h"
+#include "predecode.h"
+#include "profiler.h"
 #include "register_value.h"
 #include "registers.h"
 #include "simulator_exception.h"
+#include "trace/trace_writer.h"
 
 #include <QObject>
+#include <bitset>
+
+class QDataStream;
 
 namespace machine {
 
+class Cache;
 class Core;
 
+/**
+ * Issue statistics of the pipelined core in dual-issue mode. Each cycle
+ * which issues an instruction either issues the pair or the older
+ * instruction alone for one of the reasons.
+ */
+struct DualIssueStats {
+    enum SingleIssue {
+        SI_EMPTY,      // There is no second instruction
+        SI_FIRST,      // The first instruction has to issue alone
+        SI_PIPE,       // The second instruction is not simple ALU one
+        SI_DEPENDENCY, // The second instruction reads result of the first
+        SI_HAZARD,     // The second instruction waits for older result
+        SI_COUNT,
+    };
+
+    uint64_t issue_cycles = 0;
+    uint64_t dual = 0;
+    uint64_t single[SI_COUNT] {};
+
+    // Fraction of issue cycles which issued both instructions
+    double dual_rate() const;
+    static const char *reason_name(enum SingleIssue reason);
+};
+
 class ExceptionHandler : public QObject {
     Q_OBJECT
 public:
@@ -65,6 +101,16 @@ public:
         bool in_delay_slot,
         Address mem_ref_addr)
         = 0;
+
+    // Checkpoint support, stateless handlers keep the default (nothing stored)
+    virtual void save_state(QDataStream &out) const;
+    virtual void load_state(QDataStream &in);
+    /**
+     * Handlers with effects outside of the simulated machine journal them,
+     * see `IoJournal`. Returns false when the handler cannot suppress them
+     * on re-execution, which is the default. Null journal detaches it.
+     */
+    virtual bool set_io_journal(IoJournal *journal);
 };
 
 class StopExceptionHandler : public ExceptionHandler {
@@ -79,6 +125,7 @@ public:
         Address jump_branch_pc,
         bool in_delay_slot,
         Address mem_ref_addr) override;
+    bool set_io_journal(IoJournal *journal) override;
 };
 
 class Core : public QObject {
@@ -89,13 +136,29 @@ public:
         FrontendMemory *mem_program,
         FrontendMemory *mem_data,
         unsigned int min_cache_row_size = 1,
-        Cop0State *cop0state = nullptr);
+        Cop0State *cop0state = nullptr,
+        bool headless = false);
     ~Core() override;
 
     void step(bool skip_break = false); // Do single step
+    // Run up to max_cycles cycles, the run ends early after an exception
+    // which requests stop or when PC reaches end_addr. Returns number of
+    // executed cycles.
+    unsigned run(
+        unsigned max_cycles,
+        bool skip_break = false,
+        Address end_addr = Address(UINT64_MAX));
     void reset(); // Reset core (only core, memory and registers has to be
                   // reseted separately)
 
+    /**
+     * Checkpoint support. Stores counters, pipeline latches and state of the
+     * registered exception handlers. Registers, memory and caches are stored
+     * separately. Hardware breakpoints are a debugger setting and are kept.
+     */
+    void save_state(QDataStream &out) const;
+    void load_state(QDataStream &in);
+
     unsigned get_cycle_count() const; // Returns number of executed
                                       // get_cycle_count
     unsigned get_stall_count() const; // Returns number of stall get_cycle_count
@@ -107,9 +170,53 @@ public:
     void register_exception_handler(
         ExceptionCause excause,
         ExceptionHandler *exhandler);
-    void insert_hwbreak(Address address);
+    // Unregisters the handler without deleting it, the caller owns it then
+    ExceptionHandler *take_exception_handler(ExceptionCause excause);
+    // Returns false when some of the exception handlers cannot use the journal
+    bool set_io_journal(IoJournal *journal);
+    /**
+     * Clears reservation of the last LL instruction when it lies in the
+     * range [start, last]. Called for writes of other cores, the paired SC
+     * fails then.
+     */
+    void cancel_ll_reservation(Address start, Address last);
+    /**
+     * Inserts hardware breakpoint. The first `ignore_count` hits of the
+     * breakpoint do not stop the execution.
+     */
+    void insert_hwbreak(Address address, unsigned ignore_count = 0);
     void remove_hwbreak(Address address);
-    bool is_hwbreak(Address address);
+    bool is_hwbreak(Address address) const;
+    // Number of times the breakpoint was reached by fetch, ignored hits included
+    unsigned get_hwbreak_count(Address address) const;
+    void reset_hwbreak_counts();
+    // Disabled breakpoints and watchpoints are kept but do not stop the
+    // execution
+    void set_hwbreaks_enabled(bool enable);
+
+    enum WatchpointType {
+        WATCH_READ = 1 << 0,
+        WATCH_WRITE = 1 << 1,
+        WATCH_ACCESS = WATCH_READ | WATCH_WRITE,
+    };
+    struct WatchpointHit {
+        Address inst_addr;        // Instruction which accessed the memory
+        Address mem_addr;         // Start of the access
+        unsigned size;            // Access size in bytes
+        enum WatchpointType type; // Read or write
+        RegisterValue old_value;  // Memory content before the access
+        RegisterValue new_value;  // Memory content after the access
+    };
+    /**
+     * Inserts data watchpoint on address range [start, last]. Execution stops
+     * after the instruction which accesses the range the given way and
+     * watchpoint_reached is emitted. Watchpoint with the same start address
+     * is replaced.
+     */
+    void insert_watchpoint(Address start, Address last, enum WatchpointType type);
+    void remove_watchpoint(Address start);
+    bool has_watchpoints() const;
+    const WatchpointHit &get_watchpoint_hit() const;
     void set_stop_on_exception(enum ExceptionCause excause, bool value);
     bool get_stop_on_exception(enum ExceptionCause excause) const;
     void set_step_over_exception(enum ExceptionCause excause, bool value);
@@ -117,6 +224,32 @@ public:
 
     void set_c0_userlocal(uint32_t address);
 
+    // Headless core does not emit per-stage visualization signals
+    bool is_headless() const;
+    void set_headless(bool value);
+    /**
+     * Headless core may run predecoded instructions without fetching them
+     * when cleared. Program memory (instruction cache) traffic and its
+     * statistics are not simulated for such instructions then. Set by default.
+     */
+    bool is_fetch_simulated() const;
+    void set_fetch_simulated(bool value);
+
+    /**
+     * Stage, cycle and data memory access records are written to the trace,
+     * see `Machine::set_trace_writer`. Traced core does not use translated
+     * blocks. Null disables tracing.
+     */
+    void set_trace_writer(TraceWriter *writer);
+    // Profiled core does not use translated blocks either, null disables
+    void set_profiler(Profiler *profiler);
+    // Null when the core does not model branch prediction
+    virtual const BranchPredictor *get_branch_predictor() const;
+    // Null for in-order cores
+    virtual const OutOfOrderEngine *get_out_of_order() const;
+    // Null unless the core issues two instructions per cycle
+    virtual const DualIssueStats *get_dual_issue() const;
+
     enum ForwardFrom {
         FORWARD_NONE = 0b00,
         FORWARD_FROM_W = 0b01,
@@ -217,10 +350,22 @@ signals:
     void stall_c_value(uint32_t);
 
     void stop_on_exception_reached();
+    void watchpoint_reached();
 
 protected:
     virtual void do_step(bool skip_break = false) = 0;
     virtual void do_reset() = 0;
+    virtual unsigned do_run(unsigned max_cycles, bool skip_break);
+    virtual void do_save_state(QDataStream &out) const = 0;
+    virtual void do_load_state(QDataStream &in) = 0;
+
+    /**
+     * Per-stage visualization signals (stage values, latches, hazard unit and
+     * cycle/stall counter updates) are not emitted when set. Only the state
+     * and the exception/stop path remain observable.
+     */
+    bool headless;
+    bool fetch_simulated = true;
 
     bool handle_exception(
         Core *core,
@@ -316,12 +461,15 @@ protected:
         bool is_valid;
     };
 
-    struct dtFetch fetch(bool skip_break = false);
+    // Repeated fetch of a stalled pipeline does not count breakpoint hits
+    struct dtFetch fetch(bool skip_break = false, bool refetch = false);
     struct dtDecode decode(const struct dtFetch &);
     struct dtExecute execute(const struct dtDecode &);
     struct dtMemory memory(const struct dtExecute &);
     void writeback(const struct dtMemory &);
     bool handle_pc(const struct dtDecode &);
+    static Address branch_target(const struct dtDecode &);
+    static enum BranchPredictor::Kind branch_kind(const struct dtDecode &);
 
     enum ExceptionCause memory_special(
         enum AccessControl memctl,
@@ -338,20 +486,85 @@ protected:
     static void dtExecuteInit(struct dtExecute &dt);
     static void dtMemoryInit(struct dtMemory &dt);
 
+    // Checkpoint serialization of the latches
+    static void save_latch(QDataStream &out, const struct dtFetch &dt);
+    static void save_latch(QDataStream &out, const struct dtDecode &dt);
+    static void save_latch(QDataStream &out, const struct dtExecute &dt);
+    static void save_latch(QDataStream &out, const struct dtMemory &dt);
+    static void load_latch(QDataStream &in, struct dtFetch &dt);
+    static void load_latch(QDataStream &in, struct dtDecode &dt);
+    static void load_latch(QDataStream &in, struct dtExecute &dt);
+    static void load_latch(QDataStream &in, struct dtMemory &dt);
+
 protected:
+    unsigned int cycle_c;
     unsigned int stall_c;
+    PredecodeCache predecode;
+    bool stop_requested = false; // Set by exception which stops the run
+    Address run_end_addr {};     // PC which ends the run
+    TraceWriter *trace = nullptr;
+    Profiler *profiler = nullptr;
+
+    bool has_hwbreaks() const;
+    // False when fetch of the address surely does not hit any breakpoint
+    bool hwbreak_may_hit(Address address) const;
+    void trace_stage(
+        enum TraceRecord::Type stage,
+        const Instruction &inst,
+        Address inst_addr,
+        enum ExceptionCause excause,
+        bool valid);
+    void trace_access(
+        enum AccessControl memctl,
+        Address mem_addr,
+        bool memwrite,
+        RegisterValue value);
 
 private:
     struct hwBreak {
-        hwBreak(Address addr);
+        explicit hwBreak(Address addr = Address::null(), unsigned ignore_count = 0);
         Address addr;
-        unsigned int flags;
-        unsigned int count;
+        unsigned int ignore_count; // Hits which do not stop the execution
+        unsigned int count;        // Number of hits
     };
-    unsigned int cycle_c;
+    bool hwbreak_hit(Address address, bool refetch);
+    void hwbreaks_update();
+    // Breakpoints are looked up only for addresses passing this filter
+    static constexpr unsigned HWBREAK_FILTER_BITS = 4096;
+    static unsigned hwbreak_filter_index(Address address) {
+        return (address.get_raw() >> 2) % HWBREAK_FILTER_BITS;
+    }
+
     unsigned int min_cache_row_size;
     uint32_t hwr_userlocal;
-    QMap<Address, hwBreak *> hw_breaks;
+    bool ll_valid = false; // Reservation of LL, SC succeeds only when set
+    Address ll_addr {};
+    QMap<Address, hwBreak> hw_breaks;
+    std::bitset<HWBREAK_FILTER_BITS> hwbreak_filter;
+    bool hwbreaks_enabled = true;
+    bool hwbreaks_active = false; // Enabled and not empty
+
+    struct Watchpoint {
+        Address start;
+        Address last;
+        enum WatchpointType type;
+    };
+    bool watchpoint_access(
+        enum AccessControl memctl,
+        Address mem_addr,
+        bool memread,
+        bool memwrite);
+    RegisterValue watched_value(Address address, unsigned size) const;
+    void watchpoints_update();
+    // Accesses are compared with watchpoints only for pages passing this filter
+    static constexpr unsigned WATCHPOINT_FILTER_BITS = 4096;
+    static unsigned watchpoint_filter_index(uint64_t address) {
+        return (address >> 12) % WATCHPOINT_FILTER_BITS;
+    }
+    QMap<Address, Watchpoint> watchpoints;
+    std::bitset<WATCHPOINT_FILTER_BITS> watchpoint_filter;
+    bool watchpoints_active = false; // Enabled and not empty
+    WatchpointHit watchpoint_hit {};
     bool stop_on_exception[EXCAUSE_COUNT] {};
     bool step_over_exception[EXCAUSE_COUNT] {};
 };
@@ -364,16 +577,46 @@ public:
         FrontendMemory *mem_data,
         bool jmp_delay_slot,
         unsigned int min_cache_row_size = 1,
-        Cop0State *cop0state = nullptr);
+        Cop0State *cop0state = nullptr,
+        bool headless = false);
     ~CoreSingle() override;
 
+    // Enables translation of hot blocks to host code, see `JitEngine`.
+    // Returns false when the host is not supported.
+    bool set_jit_enabled(bool enable);
+    bool is_jit_enabled() const;
+
 protected:
     void do_step(bool skip_break = false) override;
     void do_reset() override;
+    void do_save_state(QDataStream &out) const override;
+    void do_load_state(QDataStream &in) override;
+    /**
+     * Headless core runs translated basic blocks, see `BasicBlockCache`.
+     * Instructions which need full core state or can raise an exception are
+     * processed by the regular stages, so results and cycle counts match
+     * `do_step` exactly. Traced or profiled core runs the regular stages only.
+     * Without fetch simulation the closed blocks are run from their ops
+     * without fetching, see `block_run`.
+     */
+    unsigned do_run(unsigned max_cycles, bool skip_break) override;
+
+    // Processes fetched instruction by the remaining stages, the decoded and
+    // memory stage latches are returned for timing models. Returns whether
+    // the control transfer is taken.
+    bool step_fetched(struct dtFetch &f, struct dtDecode &d, struct dtMemory &m);
 
-private:
     struct Core::dtFetch *dt_f;
+
+private:
+    unsigned block_run(Address addr, unsigned max_cycles, BasicBlock *&bb, size_t &bb_pos);
+    unsigned jit_run(Address addr, unsigned max_cycles);
+    void jit_sync_registers();
+
     Address prev_inst_addr {};
+    BasicBlockCache blocks;
+    JitEngine *jit = nullptr;
+    bool jit_regs_loaded = false; // Register values are owned by the JIT
 };
 
 class CorePipelined : public Core {
@@ -385,11 +628,19 @@ public:
         enum MachineConfig::HazardUnit hazard_unit
         = MachineConfig::HU_STALL_FORWARD,
         unsigned int min_cache_row_size = 1,
-        Cop0State *cop0state = nullptr);
+        Cop0State *cop0state = nullptr,
+        bool headless = false,
+        const BranchPredictorConfig &branch_predictor = BranchPredictorConfig(),
+        bool dual_issue = false);
+
+    const BranchPredictor *get_branch_predictor() const override;
+    const DualIssueStats *get_dual_issue() const override;
 
 protected:
     void do_step(bool skip_break = false) override;
     void do_reset() override;
+    void do_save_state(QDataStream &out) const override;
+    void do_load_state(QDataStream &in) override;
 
 private:
     struct Core::dtFetch dt_f;
@@ -398,6 +649,84 @@ private:
     struct Core::dtMemory dt_m;
 
     enum MachineConfig::HazardUnit hazard_unit;
+
+    // Sets forwarding of the decoded instruction from the older ones,
+    // returns true when it has to stall
+    bool resolve_hazards(struct dtDecode &dt, bool &branch_stall);
+
+    // Second pipe of dual-issue mode. It executes the younger instruction
+    // of the issued pair, only simple ALU instructions which cannot raise
+    // an exception are accepted. Its stages are not visualized.
+    bool dual_issue;
+    struct Core::dtFetch dt_f1;
+    struct Core::dtDecode dt_d1;
+    struct Core::dtExecute dt_e1;
+    struct Core::dtMemory dt_m1;
+    DualIssueStats issue_stats;
+    void step_second_pipe();
+    // Returns false and the reason when the second instruction cannot issue
+    // along with the first one
+    bool can_pair(enum DualIssueStats::SingleIssue &reason);
+    static bool second_pipe_capable(const struct dtDecode &dt);
+    // Issues decoded instruction or the pair and fetches the following ones
+    void issue_dual(bool skip_break);
+    struct Core::dtFetch fetch_quiet(bool skip_break);
+
+    // Reports control transfer resolved in decode to the predictor
+    void predict_branch(bool taken);
+    std::unique_ptr<BranchPredictor> predictor;
+    // Remaining stall cycles of branch misprediction
+    unsigned bp_stall = 0;
+};
+
+/**
+ * Superscalar out-of-order core. Instructions are executed by the stages of
+ * `CoreSingle` in program order when they are dispatched to the reorder
+ * buffer, `OutOfOrderEngine` models when they issue, complete and commit.
+ * Cycle and stall counters follow the timing model, so the cycle can
+ * dispatch several instructions or none. Register and memory state is the
+ * one of the dispatched instructions.
+ */
+class CoreOutOfOrder : public CoreSingle {
+public:
+    CoreOutOfOrder(
+        Registers *regs,
+        FrontendMemory *mem_program,
+        FrontendMemory *mem_data,
+        bool jmp_delay_slot,
+        const OutOfOrderConfig &config,
+        unsigned int min_cache_row_size = 1,
+        Cop0State *cop0state = nullptr,
+        bool headless = false,
+        const BranchPredictorConfig &branch_predictor = BranchPredictorConfig());
+
+    // Latencies of fetches and loads are the stall cycles accounted by the
+    // caches and the levels below them, accesses take single cycle without
+    // them.
+    void set_memory_timing(const Cache *program_cache, const Cache *data_cache);
+
+    const BranchPredictor *get_branch_predictor() const override;
+    const OutOfOrderEngine *get_out_of_order() const override;
+
+protected:
+    void do_step(bool skip_break = false) override;
+    void do_reset() override;
+    unsigned do_run(unsigned max_cycles, bool skip_break) override;
+    void do_save_state(QDataStream &out) const override;
+    void do_load_state(QDataStream &in) override;
+
+private:
+    // Executes the next instruction and describes it in `pending`. Returns
+    // false when there is no valid instruction (empty delay slot).
+    bool execute_instruction(bool skip_break);
+
+    OutOfOrderEngine engine;
+    std::unique_ptr<BranchPredictor> predictor;
+    const Cache *cache_program = nullptr;
+    const Cache *cache_data = nullptr;
+    // Executed instruction which has not been dispatched yet
+    OutOfOrderEngine::Op pending;
+    bool has_pending = false;
 };
 
 } // namespace machine
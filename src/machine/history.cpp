@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "history.h"
+
+#include <QDataStream>
+#include <utility>
+
+using namespace machine;
+
+ExecutionHistory::Snapshot::Snapshot(
+    unsigned cycle,
+    uint64_t io_position,
+    const Memory &memory)
+    : cycle(cycle)
+    , io_position(io_position)
+    , memory(memory) {}
+
+ExecutionHistory::ExecutionHistory(
+    Core *core,
+    Memory *memory,
+    QVector<Cache *> caches,
+    QVector<BackendMemory *> devices,
+    unsigned interval,
+    unsigned depth)
+    : core(core)
+    , memory(memory)
+    , caches(std::move(caches))
+    , devices(std::move(devices))
+    , interval(interval > 0 ? interval : 1)
+    , depth(depth > 0 ? depth : 1) {
+    attach_io_journal();
+}
+
+ExecutionHistory::~ExecutionHistory() {
+    core->set_io_journal(nullptr);
+    for (BackendMemory *device : devices) {
+        device->set_io_journal(nullptr);
+    }
+}
+
+void ExecutionHistory::attach_io_journal() {
+    io_journaled = core->set_io_journal(&io_journal);
+    for (BackendMemory *device : devices) {
+        device->set_io_journal(&io_journal);
+    }
+}
+
+void ExecutionHistory::record(bool force) {
+    const unsigned cycle = core->get_cycle_count();
+    discard_after(cycle);
+    if (!snapshots.empty()) {
+        const Snapshot &last = snapshots.back();
+        if (last.cycle == cycle || (!force && cycle - last.cycle < interval)) {
+            return;
+        }
+    }
+
+    snapshots.emplace_back(cycle, io_journal.position(), *memory);
+    Snapshot &snap = snapshots.back();
+    QDataStream out(&snap.state, QIODevice::WriteOnly);
+    core->get_regs()->save_state(out);
+    if (core->get_cop0state() != nullptr) {
+        core->get_cop0state()->save_state(out);
+    }
+    for (const Cache *cache : caches) {
+        cache->save_state(out);
+    }
+    core->save_state(out);
+
+    QDataStream devices_out(&snap.devices, QIODevice::WriteOnly);
+    for (const BackendMemory *device : devices) {
+        device->save_state(devices_out);
+    }
+    // Framebuffer is large and it rarely changes
+    if (snapshots.size() > 1) {
+        const Snapshot &prev = snapshots[snapshots.size() - 2];
+        if (prev.devices == snap.devices) {
+            snap.devices = prev.devices;
+        }
+    }
+
+    if (snapshots.size() > depth) {
+        snapshots.pop_front();
+        io_journal.discard_before(snapshots.front().io_position);
+    }
+}
+
+unsigned ExecutionHistory::cycles_to_record() const {
+    if (snapshots.empty()) {
+        return 0;
+    }
+    const unsigned elapsed = core->get_cycle_count() - snapshots.back().cycle;
+    return elapsed < interval ? interval - elapsed : 0;
+}
+
+unsigned ExecutionHistory::first_cycle() const {
+    if (snapshots.empty()) {
+        return core->get_cycle_count();
+    }
+    return snapshots.front().cycle;
+}
+
+bool ExecutionHistory::travel_to(unsigned cycle) {
+    if (cycle == core->get_cycle_count()) {
+        return true;
+    }
+    const Snapshot *snap = find(cycle);
+    if (snap == nullptr || cycle > core->get_cycle_count() || !can_replay(*snap)) {
+        return false;
+    }
+    restore(*snap);
+    replay(cycle - snap->cycle);
+    discard_after(cycle);
+    return true;
+}
+
+bool ExecutionHistory::travel_to_break() {
+    const unsigned current = core->get_cycle_count();
+    Registers *regs = core->get_regs();
+    // Snapshots older than one which cannot be replayed cannot be either
+    size_t first = snapshots.size();
+    while (first > 0 && can_replay(snapshots[first - 1])) {
+        first--;
+    }
+    // Search segments between snapshots from the newest one
+    for (size_t i = snapshots.size(); i-- > first;) {
+        const Snapshot &snap = snapshots[i];
+        if (snap.cycle >= current) {
+            continue;
+        }
+        unsigned end = current;
+        if (i + 1 < snapshots.size() && snapshots[i + 1].cycle < end) {
+            end = snapshots[i + 1].cycle;
+        }
+        restore(snap);
+        // Breakpoint stops the core when it fetches from its address, stall
+        // repeating the same fetch is not a new hit
+        bool found = false;
+        unsigned hit = 0;
+        Address prev_pc = Address(UINT64_MAX);
+        core->set_hwbreaks_enabled(false);
+        try {
+            for (unsigned cycle = snap.cycle; cycle < end; cycle++) {
+                Address pc = regs->read_pc();
+                if (pc != prev_pc && core->is_hwbreak(pc)) {
+                    found = true;
+                    hit = cycle;
+                }
+                prev_pc = pc;
+                core->step(false);
+            }
+        } catch (SimulatorException &) {
+            core->set_hwbreaks_enabled(true);
+            throw;
+        }
+        core->set_hwbreaks_enabled(true);
+        if (found) {
+            restore(snap);
+            replay(hit - snap.cycle);
+            discard_after(hit);
+            return true;
+        }
+    }
+    if (first < snapshots.size()) {
+        travel_to(snapshots[first].cycle);
+    }
+    return false;
+}
+
+void ExecutionHistory::clear() {
+    snapshots.clear();
+    io_journal.clear();
+}
+
+void ExecutionHistory::restore(const Snapshot &snap) {
+    // Handlers restore their state differently when re-execution follows
+    io_journal.seek(snap.io_position);
+    memory->reset(snap.memory);
+    QDataStream in(snap.state);
+    core->get_regs()->load_state(in);
+    if (core->get_cop0state() != nullptr) {
+        core->get_cop0state()->load_state(in);
+    }
+    for (Cache *cache : caches) {
+        cache->load_state(in);
+    }
+    core->load_state(in);
+
+    QDataStream devices_in(snap.devices);
+    for (BackendMemory *device : devices) {
+        device->load_state(devices_in);
+    }
+}
+
+void ExecutionHistory::replay(unsigned cycles) {
+    // Breakpoint stops are not part of the recorded execution
+    core->set_hwbreaks_enabled(false);
+    try {
+        while (cycles > 0) {
+            unsigned executed = core->run(cycles);
+            if (executed == 0) {
+                break;
+            }
+            cycles -= executed;
+        }
+    } catch (SimulatorException &) {
+        core->set_hwbreaks_enabled(true);
+        throw;
+    }
+    core->set_hwbreaks_enabled(true);
+}
+
+void ExecutionHistory::discard_after(unsigned cycle) {
+    while (!snapshots.empty() && snapshots.back().cycle > cycle) {
+        snapshots.pop_back();
+    }
+}
+
+bool ExecutionHistory::can_replay(const Snapshot &snap) const {
+    return io_journaled && !io_journal.has_async_since(snap.io_position);
+}
+
+const ExecutionHistory::Snapshot *ExecutionHistory::find(unsigned cycle) const {
+    // Snapshots are ordered by cycle, the nearest older one is used
+    for (size_t i = snapshots.size(); i-- > 0;) {
+        if (snapshots[i].cycle <= cycle) {
+            return &snapshots[i];
+        }
+    }
+    return nullptr;
+}
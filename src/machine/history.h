@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "core.h"
+#include "iojournal.h"
+#include "memory/backend/backend_memory.h"
+#include "memory/backend/memory.h"
+#include "memory/cache/cache.h"
+
+#include <QByteArray>
+#include <QVector>
+#include <deque>
+
+namespace machine {
+
+/**
+ * Execution history which allows to return to an already executed cycle.
+ *
+ * Snapshots of the complete simulated state are recorded periodically while
+ * the core runs. Memory of a snapshot shares all sections with the live
+ * memory (see `Memory` copy constructor), so taking it is O(1) and only
+ * sections written after the snapshot are duplicated later. The rest of the
+ * state (core with pipeline latches, registers, coprocessor 0, caches and
+ * peripherals) is small and it is serialized.
+ *
+ * Past cycle is reached by restore of the nearest older snapshot and
+ * re-execution of the remaining cycles, so the cost is proportional to the
+ * snapshot interval and not to the length of the program.
+ *
+ * Operations with effects outside of the machine (emulated syscalls, serial
+ * port) are journaled, see `IoJournal`. Re-execution takes their results
+ * from the journal and does not repeat their effects. Travel is refused when
+ * some exception handler cannot journal its operations and to cycles before
+ * serial port input received while the core has not been running, which
+ * cannot be replayed at the same cycle.
+ *
+ * Replay does not stop on hardware breakpoints, the run has to be split by
+ * a forced snapshot where it was stopped by one.
+ */
+class ExecutionHistory {
+public:
+    /**
+     * @param core      recorded core, its registers and cop0 are included
+     * @param memory    main memory
+     * @param caches    caches of the core
+     * @param devices   peripherals with internal state
+     * @param interval  number of cycles between periodic snapshots
+     * @param depth     maximal number of kept snapshots
+     */
+    ExecutionHistory(
+        Core *core,
+        Memory *memory,
+        QVector<Cache *> caches,
+        QVector<BackendMemory *> devices,
+        unsigned interval,
+        unsigned depth);
+    ~ExecutionHistory();
+
+    /**
+     * Attaches the journal to the core exception handlers and devices. Has
+     * to be called again when exception handlers are registered.
+     */
+    void attach_io_journal();
+
+    /**
+     * Takes snapshot when the interval elapsed since the previous one or when
+     * forced. It has to be forced after the core has been stopped by
+     * a hardware breakpoint. Snapshots newer than the current cycle (left
+     * there by a return to the past) are dropped.
+     */
+    void record(bool force = false);
+
+    // Number of cycles the core can run before the next snapshot is due
+    unsigned cycles_to_record() const;
+
+    // The oldest cycle which can be reached
+    unsigned first_cycle() const;
+
+    /**
+     * Returns the machine to the given already executed cycle.
+     *
+     * @return  false when the cycle is not covered by the history
+     */
+    bool travel_to(unsigned cycle);
+
+    /**
+     * Returns the machine to the last cycle before the current one, at which
+     * an enabled hardware breakpoint would stop the execution. The oldest
+     * recorded cycle is used when there is no such cycle.
+     *
+     * @return  true when a breakpoint has been found
+     */
+    bool travel_to_break();
+
+    void clear(); // Drop all snapshots
+
+private:
+    struct Snapshot {
+        Snapshot(unsigned cycle, uint64_t io_position, const Memory &memory);
+
+        unsigned cycle;
+        uint64_t io_position; // Position in the journal
+        Memory memory;        // Shares sections with the live memory
+        QByteArray state;     // Core, registers, cop0 and caches
+        QByteArray devices;   // Shared with the previous snapshot when equal
+    };
+
+    void restore(const Snapshot &snap);
+    void replay(unsigned cycles);
+    void discard_after(unsigned cycle);
+    const Snapshot *find(unsigned cycle) const;
+    bool can_replay(const Snapshot &snap) const;
+
+    Core *const core;
+    Memory *const memory;
+    const QVector<Cache *> caches;
+    const QVector<BackendMemory *> devices;
+    const unsigned interval;
+    const unsigned depth;
+    std::deque<Snapshot> snapshots;
+    IoJournal io_journal;
+    bool io_journaled = false; // All handlers use the journal
+};
+
+} // namespace machine
+
+#endif // HISTORY_H
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "iojournal.h"
+
+#include <algorithm>
+
+using namespace machine;
+
+bool IoJournal::replay(Operation op, int32_t &result, QByteArray *data) {
+    if (cursor >= end) {
+        return false;
+    }
+    const Entry &entry = entries[find(cursor)];
+    if (entry.op != op) {
+        truncate();
+        return false;
+    }
+    result = entry.result;
+    if (data != nullptr) {
+        *data = entry.data;
+    }
+    cursor++;
+    return true;
+}
+
+void IoJournal::record(Operation op, int32_t result, const QByteArray &data) {
+    truncate();
+    if (!entries.empty()) {
+        Entry &last = entries.back();
+        if (last.op == op && last.result == result && last.data.isEmpty() && data.isEmpty()) {
+            // Polling without input
+            last.count++;
+            cursor = ++end;
+            return;
+        }
+    }
+    entries.push_back({ end, 1, op, result, data });
+    cursor = ++end;
+    if (op == OP_SERIAL_RX_ASYNC) {
+        async_end = end;
+    }
+}
+
+uint64_t IoJournal::position() const {
+    return cursor;
+}
+
+void IoJournal::seek(uint64_t position) {
+    const uint64_t first = entries.empty() ? end : entries.front().position;
+    cursor = std::max(first, std::min(position, end));
+}
+
+bool IoJournal::replaying() const {
+    return cursor < end;
+}
+
+bool IoJournal::has_async_since(uint64_t position) const {
+    return async_end > position;
+}
+
+void IoJournal::discard_before(uint64_t position) {
+    while (!entries.empty()
+           && entries.front().position + entries.front().count <= position) {
+        entries.pop_front();
+    }
+}
+
+void IoJournal::clear() {
+    entries.clear();
+    cursor = 0;
+    end = 0;
+    async_end = 0;
+}
+
+size_t IoJournal::find(uint64_t position) const {
+    auto it = std::upper_bound(
+        entries.begin(), entries.end(), position,
+        [](uint64_t pos, const Entry &entry) { return pos < entry.position; });
+    return it - entries.begin() - 1;
+}
+
+void IoJournal::truncate() {
+    if (cursor >= end) {
+        return;
+    }
+    size_t i = find(cursor);
+    Entry &entry = entries[i];
+    if (entry.position < cursor) {
+        entry.count = cursor - entry.position;
+        i++;
+    }
+    entries.erase(entries.begin() + i, entries.end());
+    end = cursor;
+    if (async_end > end) {
+        async_end = 0;
+        for (size_t k = entries.size(); k-- > 0;) {
+            if (entries[k].op == OP_SERIAL_RX_ASYNC) {
+                async_end = entries[k].position + entries[k].count;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef IOJOURNAL_H
+#define IOJOURNAL_H
+
+#include <QByteArray>
+#include <cstdint>
+#include <deque>
+
+namespace machine {
+
+/**
+ * Journal of operations with effects outside of the simulated machine
+ * (host files, terminal input and output).
+ *
+ * Execution history (see `ExecutionHistory`) returns to the past by
+ * re-execution from a snapshot. Operations repeated by the re-execution
+ * take the results of the original ones from the journal and their outside
+ * effects are suppressed, so output is not written twice, input is not
+ * consumed again and host file positions are kept. Once the re-execution
+ * reaches the end of the journal, operations are executed and appended.
+ *
+ * Operation which does not match the journaled one means that execution has
+ * diverged (e.g. memory has been modified in the past), the rest of the
+ * journal is dropped then.
+ */
+class IoJournal {
+public:
+    enum Operation : uint8_t {
+        OP_SERIAL_RX,       // Byte polled by serial port, -1 when none
+        OP_SERIAL_RX_ASYNC, // Byte received while the core is not running
+        OP_SERIAL_TX,       // Byte sent by serial port
+        OP_HOST_OPEN,       // Host descriptor or negative error
+        OP_HOST_CLOSE,
+        OP_HOST_READ, // Result and read data
+        OP_HOST_WRITE,
+        OP_HOST_TRUNCATE,
+    };
+
+    /**
+     * Takes the result of the operation from the journal. Returns false when
+     * the operation is not journaled, it has to be executed and recorded.
+     */
+    bool replay(Operation op, int32_t &result, QByteArray *data = nullptr);
+    // Appends executed operation, journaled operations after it are dropped
+    void record(Operation op, int32_t result, const QByteArray &data = QByteArray());
+
+    // Number of operations done before the current one
+    uint64_t position() const;
+    void seek(uint64_t position);
+    // Current operation is taken from the journal
+    bool replaying() const;
+    /**
+     * Asynchronous input cannot be replayed at the cycle it has been received
+     * at. Returns true when some has been journaled at or after position.
+     */
+    bool has_async_since(uint64_t position) const;
+    // Drops operations which cannot be replayed anymore
+    void discard_before(uint64_t position);
+    void clear();
+
+private:
+    struct Entry {
+        uint64_t position; // Position of the first operation
+        uint32_t count;    // Number of equal operations without data
+        Operation op;
+        int32_t result;
+        QByteArray data;
+    };
+
+    // Index of the entry containing the position
+    size_t find(uint64_t position) const;
+    void truncate();
+
+    std::deque<Entry> entries;
+    uint64_t cursor = 0;
+    uint64_t end = 0;
+    uint64_t async_end = 0; // Position after the last asynchronous input
+};
+
+} // namespace machine
+
+#endif // IOJOURNAL_H
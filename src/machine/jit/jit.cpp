@@ -0,0 +1,588 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "jit/jit.h"
+
+#include "jit/x86_64_emitter.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__x86_64__) && defined(__linux__)
+    #define JIT_HOST_SUPPORTED 1
+    #include <sys/mman.h>
+    #include <unistd.h>
+#else
+    #define JIT_HOST_SUPPORTED 0
+#endif
+
+using namespace machine;
+
+typedef uint32_t (*JitFunction)(JitContext *ctx);
+
+static constexpr size_t ARENA_SIZE = 8 * 1024 * 1024;
+static constexpr unsigned PAGE_BITS = 12;
+
+#define CTX(FIELD) ((int32_t)offsetof(JitContext, FIELD))
+#define GPR(NUM) ((int32_t)(offsetof(JitContext, gpr) + 8 * (NUM)))
+
+using X = X86Emitter;
+
+enum OpClass {
+    OC_NONE,
+    OC_ALU,
+    OC_LOAD,
+    OC_STORE,
+    OC_CONTROL,
+};
+
+static bool is_control(const BasicBlockOp &op) {
+    return op.flags & (IMF_JUMP | IMF_BRANCH);
+}
+
+static enum OpClass classify(const BasicBlockOp &op) {
+    const enum InstructionFlags flags = op.flags;
+    if (op.handler == nullptr || (flags & IMF_NB_SKIP_DS)) {
+        return OC_NONE;
+    }
+    const bool memread = flags & IMF_MEMREAD;
+    const bool memwrite = flags & IMF_MEMWRITE;
+    const bool regwrite = flags & IMF_REGWRITE;
+    const bool link = flags & (IMF_PC8_TO_RT | IMF_PC_TO_R31);
+    const bool base_offset = op.alu_op == ALU_OP_ADDU && (flags & IMF_ALUSRC);
+
+    if (is_control(op)) {
+        if (memread || memwrite) {
+            return OC_NONE;
+        }
+        if (link) {
+            return (regwrite && op.alu_op == ALU_OP_PASS_T) ? OC_CONTROL : OC_NONE;
+        }
+        return regwrite ? OC_NONE : OC_CONTROL;
+    }
+    if (link) {
+        return OC_NONE;
+    }
+    if (memread && !memwrite && regwrite && base_offset) {
+        return OC_LOAD;
+    }
+    if (memwrite && !memread && !regwrite && base_offset) {
+        return OC_STORE;
+    }
+    if (memread || memwrite || !regwrite) {
+        return OC_NONE;
+    }
+    switch (op.alu_op) {
+    case ALU_OP_ADDU:
+    case ALU_OP_SUBU:
+    case ALU_OP_AND:
+    case ALU_OP_OR:
+    case ALU_OP_XOR:
+    case ALU_OP_NOR:
+    case ALU_OP_SLT:
+    case ALU_OP_SLTU:
+    case ALU_OP_SLL:
+    case ALU_OP_SRL:
+    case ALU_OP_SRA:
+    case ALU_OP_SLLV:
+    case ALU_OP_SRLV:
+    case ALU_OP_SRAV:
+    case ALU_OP_LUI:
+    case ALU_OP_MUL: return OC_ALU;
+    default: return OC_NONE;
+    }
+}
+
+// Loads ALU second operand (immediate or register t) into given register
+static void emit_alu_t(X &e, const BasicBlockOp &op, X::Reg reg) {
+    if (op.flags & IMF_ALUSRC) {
+        e.mov_imm32(reg, op.immediate_val);
+    } else {
+        e.load32(reg, GPR(op.num_rt));
+    }
+}
+
+// Result of the ALU operation is computed in EAX (results of `alu_operate`
+// are zero extended to 64 bits except SRA and SRAV which are sign extended).
+static void emit_alu(X &e, const BasicBlockOp &op) {
+    if (op.rwrite == 0) {
+        return; // No side effect at all
+    }
+    bool sign_extend = false;
+    switch (op.alu_op) {
+    case ALU_OP_ADDU:
+    case ALU_OP_SUBU:
+    case ALU_OP_AND:
+    case ALU_OP_OR:
+    case ALU_OP_XOR:
+    case ALU_OP_NOR:
+    case ALU_OP_SLT:
+    case ALU_OP_SLTU:
+    case ALU_OP_MUL:
+        e.load32(X::RAX, GPR(op.num_rs));
+        emit_alu_t(e, op, X::RCX);
+        switch (op.alu_op) {
+        case ALU_OP_ADDU: e.alu(X::X_ADD, X::RAX, X::RCX); break;
+        case ALU_OP_SUBU: e.alu(X::X_SUB, X::RAX, X::RCX); break;
+        case ALU_OP_AND: e.alu(X::X_AND, X::RAX, X::RCX); break;
+        case ALU_OP_OR: e.alu(X::X_OR, X::RAX, X::RCX); break;
+        case ALU_OP_XOR: e.alu(X::X_XOR, X::RAX, X::RCX); break;
+        case ALU_OP_NOR:
+            e.alu(X::X_OR, X::RAX, X::RCX);
+            e.not32(X::RAX);
+            break;
+        case ALU_OP_SLT:
+        case ALU_OP_SLTU:
+            e.alu(X::X_CMP, X::RAX, X::RCX);
+            e.setcc(op.alu_op == ALU_OP_SLT ? X::CC_L : X::CC_B, X::RAX);
+            e.movzx8(X::RAX, X::RAX);
+            break;
+        case ALU_OP_MUL: e.imul32(X::RAX, X::RCX); break;
+        default: break;
+        }
+        break;
+    case ALU_OP_SLL:
+    case ALU_OP_SRL:
+    case ALU_OP_SRA:
+        emit_alu_t(e, op, X::RAX);
+        if (op.shamt != 0) {
+            e.shift_imm(
+                op.alu_op == ALU_OP_SLL ? X::X_SHL : op.alu_op == ALU_OP_SRL ? X::X_SHR : X::X_SAR,
+                X::RAX, op.shamt);
+        }
+        sign_extend = op.alu_op == ALU_OP_SRA;
+        break;
+    case ALU_OP_SLLV:
+    case ALU_OP_SRLV:
+    case ALU_OP_SRAV:
+        emit_alu_t(e, op, X::RAX);
+        e.load32(X::RCX, GPR(op.num_rs));
+        e.shift_cl(
+            op.alu_op == ALU_OP_SLLV ? X::X_SHL : op.alu_op == ALU_OP_SRLV ? X::X_SHR : X::X_SAR,
+            X::RAX);
+        sign_extend = op.alu_op == ALU_OP_SRAV;
+        break;
+    case ALU_OP_LUI:
+        emit_alu_t(e, op, X::RAX);
+        e.shift_imm(X::X_SHL, X::RAX, 16);
+        break;
+    default: break;
+    }
+    if (sign_extend) {
+        e.movsxd(X::RAX, X::RAX);
+    }
+    e.store64(GPR(op.rwrite), X::RAX);
+}
+
+// Computes mem address into ESI and prepares remaining helper arguments
+static void emit_mem_args(X &e, const BasicBlockOp &op) {
+    e.load32(X::RSI, GPR(op.num_rs));
+    e.alu_imm(X::X_ADD, X::RSI, op.immediate_val);
+    e.mov64(X::RDI, X::RBX);
+    e.mov_imm32(X::RDX, op.mem_ctl);
+}
+
+// Evaluates control transfer, stores result to branch_taken/branch_target
+// (jump_target has to be already resolved to absolute address)
+static void emit_control(X &e, const BasicBlockOp &op) {
+    if (op.flags & IMF_JUMP) {
+        if (op.flags & IMF_BJR_REQ_RS) {
+            e.load32(X::RAX, GPR(op.num_rs));
+            e.store32(CTX(branch_target), X::RAX);
+        } else {
+            e.store32_imm(CTX(branch_target), op.jump_target);
+        }
+        e.store8_imm(CTX(branch_taken), 1);
+    } else {
+        X::Cond cc;
+        e.load32(X::RAX, GPR(op.num_rs));
+        if (op.flags & IMF_BJR_REQ_RT) {
+            e.load32(X::RCX, GPR(op.num_rt));
+            e.alu(X::X_CMP, X::RAX, X::RCX);
+            cc = (op.flags & IMF_BJ_NOT) ? X::CC_NE : X::CC_E;
+        } else if (!(op.flags & IMF_BGTZ_BLEZ)) {
+            e.test32(X::RAX, X::RAX);
+            cc = (op.flags & IMF_BJ_NOT) ? X::CC_NS : X::CC_S;
+        } else {
+            e.alu_imm(X::X_CMP, X::RAX, 0);
+            cc = (op.flags & IMF_BJ_NOT) ? X::CC_G : X::CC_LE;
+        }
+        e.setcc(cc, X::RAX);
+        e.store8(CTX(branch_taken), X::RAX);
+        e.store32_imm(CTX(branch_target), op.branch_target);
+    }
+    if ((op.flags & IMF_REGWRITE) && op.rwrite != 0) {
+        e.mov_imm32(X::RAX, op.link_val);
+        e.store64(GPR(op.rwrite), X::RAX);
+    }
+}
+
+static void emit_exit(X &e, uint32_t executed, uint32_t last_addr, bool in_ds) {
+    e.store32_imm(CTX(executed), executed);
+    if (executed != 0) {
+        e.store32_imm(CTX(last_addr), last_addr);
+    }
+    e.store8_imm(CTX(exit_in_ds), in_ds ? 1 : 0);
+    e.epilogue();
+}
+
+JitEngine::JitEngine(bool delay_slot, FrontendMemory *mem_program, FrontendMemory *mem_data)
+    : delay_slot(delay_slot)
+    , mem_program(mem_program)
+    , code_pages(1u << (32 - PAGE_BITS), 0) {
+    ctx.mem_data = mem_data;
+    ctx.engine = this;
+#if JIT_HOST_SUPPORTED
+    void *mem = mmap(
+        nullptr, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem != MAP_FAILED) {
+        arena = (uint8_t *)mem;
+        arena_size = ARENA_SIZE;
+    }
+#endif
+}
+
+JitEngine::~JitEngine() {
+    invalidate();
+#if JIT_HOST_SUPPORTED
+    if (arena != nullptr) {
+        munmap(arena, arena_size);
+    }
+#endif
+}
+
+bool JitEngine::is_supported() {
+    return JIT_HOST_SUPPORTED;
+}
+
+const JitBlock *JitEngine::lookup(Address start_addr) {
+    JitBlock *jb = blocks.value(start_addr.get_raw());
+    if (jb == nullptr || jb->code == nullptr) {
+        return nullptr;
+    }
+    if (jb->epoch != epoch && !verify(jb)) {
+        return nullptr;
+    }
+    return jb;
+}
+
+void JitEngine::profile(const BasicBlock *bb) {
+    JitBlock *jb = blocks.value(bb->start_addr);
+    if (jb == nullptr) {
+        jb = new JitBlock();
+        jb->start_addr = bb->start_addr;
+        jb->length = 0;
+        jb->epoch = epoch;
+        jb->heat = 0;
+        jb->code = nullptr;
+        blocks.insert(jb->start_addr, jb);
+    }
+    if (jb->code != nullptr || jb->heat > HOT_THRESHOLD) {
+        return; // Translated or translation failed
+    }
+    if (++jb->heat == HOT_THRESHOLD) {
+        translate(jb, bb);
+        if (jb->code == nullptr) {
+            jb->heat = HOT_THRESHOLD + 1;
+        }
+    }
+}
+
+uint32_t JitEngine::execute(const JitBlock *jb) {
+    ctx.fault = 0;
+    ctx.code_modified = 0;
+    ctx.exit_in_ds = 0;
+    ctx.executed = 0;
+    uint32_t next = ((JitFunction)(jb->code))(&ctx);
+    if (ctx.code_modified) {
+        memory_may_have_changed();
+    }
+    return next;
+}
+
+void JitEngine::load_registers(const Registers *regs) {
+    for (int i = 0; i < 32; i++) {
+        synced_gpr[i] = regs->read_gp(i).as_u64();
+        ctx.gpr[i] = synced_gpr[i];
+    }
+}
+
+void JitEngine::store_registers(Registers *regs) {
+    for (int i = 1; i < 32; i++) {
+        if (ctx.gpr[i] != synced_gpr[i]) {
+            regs->write_gp(i, RegisterValue(ctx.gpr[i]));
+            synced_gpr[i] = ctx.gpr[i];
+        }
+    }
+}
+
+void JitEngine::memory_may_have_changed() {
+    epoch++;
+}
+
+void JitEngine::memory_written(Address addr) {
+    // Unaligned and wider accesses cannot cross page boundary by more
+    // than a few bytes, check both ends
+    if (code_pages[addr.get_raw() >> PAGE_BITS]
+        || code_pages[(addr.get_raw() + 7) >> PAGE_BITS]) {
+        epoch++;
+    }
+}
+
+void JitEngine::invalidate() {
+    qDeleteAll(blocks);
+    blocks.clear();
+    std::fill(code_pages.begin(), code_pages.end(), 0);
+    arena_used = 0;
+    epoch++;
+}
+
+const JitContext &JitEngine::context() const {
+    return ctx;
+}
+
+uint32_t JitEngine::get_translated_count() const {
+    return translated;
+}
+
+bool JitEngine::verify(JitBlock *jb) {
+    Address addr(jb->start_addr);
+    for (uint32_t word : jb->words) {
+        if (mem_program->read_u32(addr, ae::INTERNAL) != word) {
+            // Drop translation, block is profiled and translated again
+            jb->code = nullptr;
+            jb->heat = 0;
+            jb->words.clear();
+            return false;
+        }
+        addr += 4;
+    }
+    jb->epoch = epoch;
+    return true;
+}
+
+void JitEngine::translate(JitBlock *jb, const BasicBlock *bb) {
+    if (arena == nullptr) {
+        return;
+    }
+
+    // Select translatable prefix of the block
+    size_t count = 0;
+    bool ends_with_control = false;
+    while (count < bb->ops.size()) {
+        const BasicBlockOp &op = bb->ops[count];
+        enum OpClass oc = classify(op);
+        if (oc == OC_NONE) {
+            break;
+        }
+        if (oc == OC_CONTROL) {
+            if (delay_slot) {
+                if (count + 1 >= bb->ops.size()) {
+                    break;
+                }
+                const BasicBlockOp &ds = bb->ops[count + 1];
+                if (is_control(ds) || classify(ds) == OC_NONE) {
+                    break;
+                }
+                count += 2;
+            } else {
+                count += 1;
+            }
+            ends_with_control = true;
+            break;
+        }
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    X e;
+    std::vector<std::pair<X::Label, size_t>> fault_exits, modified_exits;
+    X::Label end = e.new_label();
+    const size_t control_pos = ends_with_control ? count - (delay_slot ? 2 : 1) : count;
+    e.prologue();
+    for (size_t k = 0; k < count; k++) {
+        const BasicBlockOp &op = bb->ops[k];
+        const uint32_t inst_addr = bb->start_addr + 4 * k;
+        switch (classify(op)) {
+        case OC_ALU: emit_alu(e, op); break;
+        case OC_LOAD: {
+            X::Label fault = e.new_label();
+            emit_mem_args(e, op);
+            e.call((const void *)&JitEngine::helper_load);
+            e.cmp8_imm(CTX(fault), 0);
+            e.jcc(X::CC_NE, fault);
+            if (op.rwrite != 0) {
+                e.store64(GPR(op.rwrite), X::RAX);
+            }
+            fault_exits.emplace_back(fault, k);
+            break;
+        }
+        case OC_STORE: {
+            X::Label fault = e.new_label();
+            emit_mem_args(e, op);
+            e.load64(X::RCX, GPR(op.num_rt));
+            e.call((const void *)&JitEngine::helper_store);
+            e.cmp8_imm(CTX(fault), 0);
+            e.jcc(X::CC_NE, fault);
+            fault_exits.emplace_back(fault, k);
+            e.cmp8_imm(CTX(code_modified), 0);
+            if (k > control_pos) {
+                e.jcc(X::CC_NE, end); // Store in delay slot, resolve the branch
+            } else {
+                X::Label modified = e.new_label();
+                e.jcc(X::CC_NE, modified);
+                modified_exits.emplace_back(modified, k);
+            }
+            break;
+        }
+        case OC_CONTROL: {
+            BasicBlockOp op_abs = op;
+            if (!(op.flags & IMF_BJR_REQ_RS)) {
+                // Same as Registers::pc_abs_jmp_28 with PC of the fetch stage
+                const uint32_t pc = delay_slot ? inst_addr + 4 : inst_addr;
+                op_abs.jump_target = (pc & 0xf0000000) | (op.jump_target & 0x0fffffff);
+            }
+            emit_control(e, op_abs);
+            break;
+        }
+        default: Q_ASSERT(false); break;
+        }
+    }
+
+    const uint32_t last_addr = bb->start_addr + 4 * (count - 1);
+    e.bind(end);
+    if (ends_with_control) {
+        X::Label not_taken = e.new_label();
+        X::Label done = e.new_label();
+        e.cmp8_imm(CTX(branch_taken), 0);
+        e.jcc(X::CC_E, not_taken);
+        e.load32(X::RAX, CTX(branch_target));
+        e.jmp(done);
+        e.bind(not_taken);
+        e.mov_imm32(X::RAX, last_addr + 4);
+        e.bind(done);
+    } else {
+        e.mov_imm32(X::RAX, last_addr + 4);
+    }
+    emit_exit(e, count, last_addr, false);
+
+    for (const auto &fe : fault_exits) {
+        // Instruction k has not been executed, instructions before it are
+        // committed and the interpreter continues with k. Stores preceding
+        // the failed access are therefore never repeated.
+        const uint32_t k = fe.second;
+        e.bind(fe.first);
+        e.mov_imm32(X::RAX, bb->start_addr + 4 * k);
+        emit_exit(e, k, bb->start_addr + 4 * (k - 1), ends_with_control && k > control_pos);
+    }
+    for (const auto &me : modified_exits) {
+        const uint32_t k = me.second;
+        e.bind(me.first);
+        e.mov_imm32(X::RAX, bb->start_addr + 4 * (k + 1));
+        emit_exit(e, k + 1, bb->start_addr + 4 * k, false);
+    }
+
+    if (!e.finalize()) {
+        return;
+    }
+    jb->length = count;
+    jb->words.clear();
+    for (size_t k = 0; k < count; k++) {
+        jb->words.push_back(bb->ops[k].inst_word);
+    }
+    if (!install(jb, e.code())) {
+        return;
+    }
+    for (size_t k = 0; k < count; k++) {
+        code_pages[(bb->start_addr + 4 * k) >> PAGE_BITS] = 1;
+    }
+    jb->epoch = epoch;
+    translated++;
+}
+
+bool JitEngine::install(JitBlock *jb, const std::vector<uint8_t> &code) {
+#if JIT_HOST_SUPPORTED
+    if (arena_used + code.size() > arena_size) {
+        // Arena is full, start over. Called only between block executions.
+        blocks.take(jb->start_addr);
+        invalidate();
+        blocks.insert(jb->start_addr, jb);
+    }
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t first = arena_used & ~(page - 1);
+    const size_t last = (arena_used + code.size() + page - 1) & ~(page - 1);
+    if (mprotect(arena + first, last - first, PROT_READ | PROT_WRITE) != 0) {
+        return false;
+    }
+    std::copy(code.begin(), code.end(), arena + arena_used);
+    if (mprotect(arena + first, last - first, PROT_READ | PROT_EXEC) != 0) {
+        return false;
+    }
+    jb->code = arena + arena_used;
+    arena_used += (code.size() + 15) & ~(size_t)15;
+    return true;
+#else
+    UNUSED(jb)
+    UNUSED(code)
+    return false;
+#endif
+}
+
+uint64_t JitEngine::helper_load(JitContext *ctx, uint32_t addr, uint32_t ctl) {
+    // Exceptions cannot be propagated through translated code, block is left
+    // before the failed instruction and only this instruction is executed
+    // again by the interpreter which reports the problem. Only the failed
+    // access is repeated, memory backends fail before modifying their state.
+    try {
+        return ctx->mem_data->read_ctl((enum AccessControl)ctl, Address(addr)).as_u64();
+    } catch (...) {
+        ctx->fault = 1;
+        return 0;
+    }
+}
+
+void JitEngine::helper_store(JitContext *ctx, uint32_t addr, uint32_t ctl, uint64_t value) {
+    try {
+        ctx->mem_data->write_ctl((enum AccessControl)ctl, Address(addr), RegisterValue(value));
+    } catch (...) {
+        ctx->fault = 1;
+        return;
+    }
+    if (ctx->engine->code_pages[addr >> PAGE_BITS]) {
+        ctx->code_modified = 1;
+    }
+}
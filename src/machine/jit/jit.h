@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "basicblock.h"
+#include "memory/address.h"
+#include "memory/frontend_memory.h"
+#include "registers.h"
+
+#include <QHash>
+#include <cstdint>
+#include <vector>
+
+namespace machine {
+
+class JitEngine;
+
+/**
+ * State shared between translated code and the engine.
+ *
+ * Translated code addresses fields relative to the pointer passed as its
+ * only argument, layout is therefore fixed (see offsetof use in jit.cpp).
+ */
+struct JitContext {
+    uint64_t gpr[32];       // General purpose registers owned by the JIT
+    uint32_t executed;      // Number of instructions executed by last block
+    uint32_t last_addr;     // Address of last executed instruction
+    uint32_t branch_target; // Target of control transfer of the block
+    uint8_t branch_taken;   // Control transfer of the block is taken
+    uint8_t exit_in_ds;     // Block left before its delay slot instruction
+    uint8_t fault;          // Memory access helper failed, see `executed`
+    uint8_t code_modified;  // Store has hit page with translated code
+    FrontendMemory *mem_data;
+    JitEngine *engine;
+};
+
+/**
+ * Translated basic block.
+ */
+struct JitBlock {
+    uint32_t start_addr;
+    uint32_t length;            // Maximal number of executed instructions
+    uint32_t epoch;             // Epoch in which words have been verified
+    unsigned heat;              // Number of interpreted executions
+    std::vector<uint32_t> words; // Translated instruction words
+    const uint8_t *code;        // nullptr when block is not translated
+};
+
+/**
+ * Dynamic binary translator of hot basic blocks to host x86-64 code.
+ *
+ * Blocks are taken from `BasicBlockCache` after they have been interpreted
+ * `HOT_THRESHOLD` times. Only instructions which cannot raise an exception
+ * and do not depend on coprocessor state are translated (ALU, regular
+ * loads/stores and branches/jumps), the block is cut before the first other
+ * instruction and the core falls back to the interpreter for it.
+ *
+ * Memory accesses are done by calls to the data memory frontend, so data
+ * caches, peripherals and uncached I/O ranges behave as in the interpreter.
+ * Instruction fetches are not simulated for translated code.
+ *
+ * Translations are verified against program memory content whenever memory
+ * may have been modified outside of translated code (`memory_may_have_changed`)
+ * and translated stores to pages containing translated code end the block.
+ *
+ * The engine is available only on x86-64 Linux hosts, `is_supported`
+ * reports false elsewhere and no block is ever translated.
+ */
+class JitEngine {
+public:
+    JitEngine(bool delay_slot, FrontendMemory *mem_program, FrontendMemory *mem_data);
+    ~JitEngine();
+
+    static bool is_supported();
+
+    static constexpr unsigned HOT_THRESHOLD = 8;
+
+    // Returns verified translated block starting at the address or nullptr
+    const JitBlock *lookup(Address start_addr);
+    // Counts interpreted execution of the block, translates it when hot
+    void profile(const BasicBlock *bb);
+    // Runs translated block, returns address of the next instruction
+    uint32_t execute(const JitBlock *jb);
+
+    void load_registers(const Registers *regs);
+    void store_registers(Registers *regs);
+
+    void memory_may_have_changed();
+    // Store done outside of translated code, cheaper than the above
+    void memory_written(Address addr);
+    void invalidate(); // Drop all translations
+
+    const JitContext &context() const;
+    uint32_t get_translated_count() const;
+
+private:
+    void translate(JitBlock *jb, const BasicBlock *bb);
+    bool install(JitBlock *jb, const std::vector<uint8_t> &code);
+    bool verify(JitBlock *jb);
+
+    static uint64_t helper_load(JitContext *ctx, uint32_t addr, uint32_t ctl);
+    static void helper_store(JitContext *ctx, uint32_t addr, uint32_t ctl, uint64_t value);
+
+    const bool delay_slot;
+    FrontendMemory *mem_program;
+    JitContext ctx {};
+    uint64_t synced_gpr[32] {};
+    uint32_t epoch = 0;
+    uint32_t translated = 0;
+    QHash<uint32_t, JitBlock *> blocks;
+    std::vector<uint8_t> code_pages; // Pages (4 KiB) with translated code
+
+    uint8_t *arena = nullptr;
+    size_t arena_size = 0;
+    size_t arena_used = 0;
+};
+
+} // namespace machine
+
+#endif // JIT_H
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef X86_64_EMITTER_H
+#define X86_64_EMITTER_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Minimal x86-64 machine code emitter used by the dynamic translator.
+ *
+ * Only the instruction forms used by `JitEngine` are provided. Memory
+ * operands are always addressed relative to the context register RBX
+ * with 32 bit displacement. Generated code follows System V AMD64 ABI.
+ */
+class X86Emitter {
+public:
+    enum Reg : uint8_t {
+        RAX = 0,
+        RCX = 1,
+        RDX = 2,
+        RBX = 3,
+        RSP = 4,
+        RBP = 5,
+        RSI = 6,
+        RDI = 7,
+    };
+
+    enum Cond : uint8_t {
+        CC_B = 0x2,
+        CC_AE = 0x3,
+        CC_E = 0x4,
+        CC_NE = 0x5,
+        CC_S = 0x8,
+        CC_NS = 0x9,
+        CC_L = 0xc,
+        CC_GE = 0xd,
+        CC_LE = 0xe,
+        CC_G = 0xf,
+    };
+
+    enum AluOpcode : uint8_t {
+        // Opcode of "op r/m32, r32" form, the /digit of "op r/m32, imm32"
+        // form is (opcode >> 3).
+        X_ADD = 0x01,
+        X_OR = 0x09,
+        X_AND = 0x21,
+        X_SUB = 0x29,
+        X_XOR = 0x31,
+        X_CMP = 0x39,
+    };
+
+    enum ShiftOp : uint8_t {
+        X_SHL = 4,
+        X_SHR = 5,
+        X_SAR = 7,
+    };
+
+    typedef size_t Label;
+
+    const std::vector<uint8_t> &code() const { return buf; }
+    size_t size() const { return buf.size(); }
+
+    // Prologue/epilogue, RBX holds the context pointer passed in RDI
+    void prologue() {
+        byte(0x53);                      // push rbx
+        rex_w();
+        byte(0x89);
+        modrm(3, RDI, RBX);              // mov rbx, rdi
+    }
+    void epilogue() {
+        byte(0x5b); // pop rbx
+        byte(0xc3); // ret
+    }
+
+    // mov r32, [rbx + disp]
+    void load32(Reg dst, int32_t disp) {
+        byte(0x8b);
+        mem_rbx(dst, disp);
+    }
+    // mov r64, [rbx + disp]
+    void load64(Reg dst, int32_t disp) {
+        rex_w();
+        byte(0x8b);
+        mem_rbx(dst, disp);
+    }
+    // mov [rbx + disp], r32
+    void store32(int32_t disp, Reg src) {
+        byte(0x89);
+        mem_rbx(src, disp);
+    }
+    // mov [rbx + disp], r64
+    void store64(int32_t disp, Reg src) {
+        rex_w();
+        byte(0x89);
+        mem_rbx(src, disp);
+    }
+    // mov [rbx + disp], r8 (only AL, CL, DL, BL)
+    void store8(int32_t disp, Reg src) {
+        byte(0x88);
+        mem_rbx(src, disp);
+    }
+    // mov dword [rbx + disp], imm32
+    void store32_imm(int32_t disp, uint32_t imm) {
+        byte(0xc7);
+        mem_rbx(0, disp);
+        imm32(imm);
+    }
+    // mov byte [rbx + disp], imm8
+    void store8_imm(int32_t disp, uint8_t imm) {
+        byte(0xc6);
+        mem_rbx(0, disp);
+        byte(imm);
+    }
+    // cmp byte [rbx + disp], imm8
+    void cmp8_imm(int32_t disp, uint8_t imm) {
+        byte(0x80);
+        mem_rbx(7, disp);
+        byte(imm);
+    }
+    // mov r32, imm32 (zero extends to 64 bits)
+    void mov_imm32(Reg dst, uint32_t imm) {
+        byte(0xb8 + dst);
+        imm32(imm);
+    }
+    // mov r64, imm64
+    void mov_imm64(Reg dst, uint64_t imm) {
+        rex_w();
+        byte(0xb8 + dst);
+        imm32((uint32_t)imm);
+        imm32((uint32_t)(imm >> 32));
+    }
+    // mov r64, r64
+    void mov64(Reg dst, Reg src) {
+        rex_w();
+        byte(0x89);
+        modrm(3, src, dst);
+    }
+    // op r32, r32
+    void alu(AluOpcode op, Reg dst, Reg src) {
+        byte(op);
+        modrm(3, src, dst);
+    }
+    // op r32, imm32
+    void alu_imm(AluOpcode op, Reg dst, uint32_t imm) {
+        byte(0x81);
+        modrm(3, op >> 3, dst);
+        imm32(imm);
+    }
+    // not r32
+    void not32(Reg dst) {
+        byte(0xf7);
+        modrm(3, 2, dst);
+    }
+    // test r32, r32
+    void test32(Reg a, Reg b) {
+        byte(0x85);
+        modrm(3, b, a);
+    }
+    // imul r32, r32
+    void imul32(Reg dst, Reg src) {
+        byte(0x0f);
+        byte(0xaf);
+        modrm(3, dst, src);
+    }
+    // shl/shr/sar r32, imm8
+    void shift_imm(ShiftOp op, Reg dst, uint8_t count) {
+        byte(0xc1);
+        modrm(3, op, dst);
+        byte(count);
+    }
+    // shl/shr/sar r32, cl
+    void shift_cl(ShiftOp op, Reg dst) {
+        byte(0xd3);
+        modrm(3, op, dst);
+    }
+    // setcc r8 (only AL, CL, DL, BL)
+    void setcc(Cond cc, Reg dst) {
+        byte(0x0f);
+        byte(0x90 + cc);
+        modrm(3, 0, dst);
+    }
+    // movzx r32, r8 (only AL, CL, DL, BL)
+    void movzx8(Reg dst, Reg src) {
+        byte(0x0f);
+        byte(0xb6);
+        modrm(3, dst, src);
+    }
+    // movsxd r64, r32
+    void movsxd(Reg dst, Reg src) {
+        rex_w();
+        byte(0x63);
+        modrm(3, dst, src);
+    }
+    // mov rax, imm64; call rax
+    void call(const void *fn) {
+        mov_imm64(RAX, (uint64_t)(uintptr_t)fn);
+        byte(0xff);
+        modrm(3, 2, RAX);
+    }
+
+    Label new_label() {
+        labels.push_back((size_t)UNBOUND);
+        return labels.size() - 1;
+    }
+    void bind(Label l) { labels[l] = buf.size(); }
+    void jmp(Label l) {
+        byte(0xe9);
+        fixup(l);
+    }
+    void jcc(Cond cc, Label l) {
+        byte(0x0f);
+        byte(0x80 + cc);
+        fixup(l);
+    }
+
+    // Resolves label references, returns false when some label is unbound
+    bool finalize() {
+        for (const auto &f : fixups) {
+            if (labels[f.label] == UNBOUND) {
+                return false;
+            }
+            int32_t rel = (int32_t)(labels[f.label] - (f.pos + 4));
+            std::memcpy(&buf[f.pos], &rel, 4);
+        }
+        fixups.clear();
+        return true;
+    }
+
+private:
+    enum : size_t { UNBOUND = (size_t)-1 };
+
+    struct Fixup {
+        size_t pos;
+        Label label;
+    };
+
+    void byte(uint8_t b) { buf.push_back(b); }
+    void imm32(uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            byte((uint8_t)(v >> (8 * i)));
+        }
+    }
+    void rex_w() { byte(0x48); }
+    void modrm(uint8_t mod, uint8_t reg, uint8_t rm) {
+        byte((uint8_t)((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+    }
+    void mem_rbx(uint8_t reg, int32_t disp) {
+        modrm(2, reg, RBX);
+        imm32((uint32_t)disp);
+    }
+    void fixup(Label l) {
+        fixups.push_back({ buf.size(), l });
+        imm32(0);
+    }
+
+    std::vector<uint8_t> buf;
+    std::vector<size_t> labels;
+    std::vector<Fixup> fixups;
+};
+
+} // namespace machine
+
+#endif // X86_64_EMITTER_H
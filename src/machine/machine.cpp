@@ -37,11 +37,36 @@
 
 #include "programloader.h"
 
+#include <QDataStream>
+#include <QFile>
 #include <QTime>
+#include <algorithm>
+#include <climits>
+#include <fstream>
 #include <utility>
 
 using namespace machine;
 
+// Time limited runs are split to batches of this size to check the time
+constexpr unsigned RUN_BATCH_CYCLES = 4096;
+
+constexpr quint32 CHECKPOINT_MAGIC = 0x514d4350; // "QMCP"
+constexpr quint32 CHECKPOINT_VERSION = 8;
+
+class Machine::RunThread : public QThread {
+public:
+    RunThread(Machine *machine, bool skip_break)
+        : machine(machine)
+        , skip_break(skip_break) {}
+
+protected:
+    void run() override { machine->worker_loop(skip_break); }
+
+private:
+    Machine *machine;
+    bool skip_break;
+};
+
 Machine::Machine(MachineConfig config, bool load_symtab, bool load_executable)
     : machine_config(std::move(config))
     , stat(ST_READY) {
@@ -73,16 +98,44 @@ Machine::Machine(MachineConfig config, bool load_symtab, bool load_executable)
     setup_perip_spi_led();
     setup_lcd_display();
 
-    cch_program = new Cache(
-        data_bus, &machine_config.cache_program(),
-        machine_config.memory_access_time_read(),
-        machine_config.memory_access_time_write(),
-        machine_config.memory_access_time_burst());
-    cch_data = new Cache(
-        data_bus, &machine_config.cache_data(),
-        machine_config.memory_access_time_read(),
-        machine_config.memory_access_time_write(),
-        machine_config.memory_access_time_burst());
+    // Lower levels are shared by all cores. Each level accesses the one
+    // below it with its hit latency, the first word of a block takes the
+    // latency and the rest of the block follows in a burst.
+    FrontendMemory *l1_memory = data_bus;
+    unsigned l1_read = machine_config.memory_access_time_read();
+    unsigned l1_write = machine_config.memory_access_time_write();
+    unsigned l1_burst = machine_config.memory_access_time_burst();
+    if (machine_config.cache_level2().enabled()) {
+        FrontendMemory *l2_memory = data_bus;
+        unsigned l2_read = l1_read, l2_write = l1_write, l2_burst = l1_burst;
+        if (machine_config.cache_level3().enabled()) {
+            cch_level3 = new Cache(
+                data_bus, &machine_config.cache_level3(), l1_read, l1_write,
+                l1_burst);
+            l2_memory = cch_level3;
+            l2_read = l2_write = machine_config.cache_level3().hit_latency();
+            l2_burst = 1;
+        }
+        cch_level2 = new Cache(
+            l2_memory, &machine_config.cache_level2(), l2_read, l2_write,
+            l2_burst);
+        if (cch_level3 != nullptr) {
+            cch_level3->add_upper_level(cch_level2);
+        }
+        l1_memory = cch_level2;
+        l1_read = l1_write = machine_config.cache_level2().hit_latency();
+        l1_burst = 1;
+    }
+    auto new_l1_cache = [&](const CacheConfig *cc) {
+        Cache *cch = new Cache(l1_memory, cc, l1_read, l1_write, l1_burst);
+        if (cch_level2 != nullptr) {
+            cch_level2->add_upper_level(cch);
+        }
+        return cch;
+    };
+
+    cch_program = new_l1_cache(&machine_config.cache_program());
+    cch_data = new_l1_cache(&machine_config.cache_data());
 
     unsigned int min_cache_row_size = 16;
     if (machine_config.cache_data().enabled()) {
@@ -95,21 +148,55 @@ Machine::Machine(MachineConfig config, bool load_symtab, bool load_executable)
     }
 
     cop0st = new Cop0State();
-
-    if (machine_config.pipelined()) {
-        cr = new CorePipelined(
-            regs, cch_program, cch_data, machine_config.hazard_unit(), min_cache_row_size, cop0st);
-    } else {
-        cr = new CoreSingle(
-            regs, cch_program, cch_data, machine_config.delay_slot(), min_cache_row_size, cop0st);
-    }
+    cr = create_core(
+        regs, cch_program, cch_data, cop0st, min_cache_row_size,
+        machine_config.headless());
+    // Interrupts are raised by peripherals from the thread running the core
     connect(
         this, &Machine::set_interrupt_signal, cop0st,
-        &Cop0State::set_interrupt_signal);
+        &Cop0State::set_interrupt_signal, Qt::DirectConnection);
+
+    // Other cores start at the same entry point, the program distinguishes
+    // them by CPUNum. They are not visualized.
+    for (unsigned i = 1; i < machine_config.core_count(); i++) {
+        SmpCore unit {};
+        unit.regs = new Registers(*regs);
+        unit.cch_program = new_l1_cache(&machine_config.cache_program());
+        unit.cch_data = new_l1_cache(&machine_config.cache_data());
+        unit.cop0st = new Cop0State();
+        unit.cop0st->set_cpu_num(i);
+        unit.cr = create_core(
+            unit.regs, unit.cch_program, unit.cch_data, unit.cop0st,
+            min_cache_row_size, true);
+        // Stops of all cores are reported by core 0
+        connect(
+            unit.cr, &Core::stop_on_exception_reached, cr,
+            &Core::stop_on_exception_reached, Qt::DirectConnection);
+        smp_cores.append(unit);
+    }
+    // Watchpoint hit pauses the machine, the user interface only reports it
+    for (unsigned i = 0; i < core_count(); i++) {
+        connect(smp_core(i), &Core::watchpoint_reached, this, &Machine::pause);
+    }
+    if (!smp_cores.isEmpty()) {
+        coherence = new CacheCoherence();
+        for (unsigned i = 0; i < core_count(); i++) {
+            Core *core = smp_core(i);
+            coherence->add(
+                i == 0 ? cch_data : smp_cores[i - 1].cch_data,
+                [core](Address start, Address last) {
+                    core->cancel_ll_reservation(start, last);
+                });
+        }
+    }
+    smp_left = machine_config.smp_quantum();
 
     run_t = new QTimer(this);
     set_speed(0); // In default run as fast as possible
     connect(run_t, &QTimer::timeout, this, &Machine::step_timer);
+    worker_display_t = new QTimer(this);
+    connect(
+        worker_display_t, &QTimer::timeout, this, &Machine::worker_display);
 
     for (int i = 0; i < EXCAUSE_COUNT; i++) {
         if (i != EXCAUSE_INT && i != EXCAUSE_BREAK && i != EXCAUSE_HWBREAK) {
@@ -123,6 +210,35 @@ Machine::Machine(MachineConfig config, bool load_symtab, bool load_executable)
     set_stop_on_exception(EXCAUSE_INT, machine_config.osemu_interrupt_stop());
     set_step_over_exception(EXCAUSE_INT, false);
 }
+Core *Machine::create_core(
+    Registers *core_regs,
+    Cache *core_cch_program,
+    Cache *core_cch_data,
+    Cop0State *core_cop0st,
+    unsigned min_cache_row_size,
+    bool headless) {
+    if (machine_config.out_of_order().enabled()) {
+        auto *core = new CoreOutOfOrder(
+            core_regs, core_cch_program, core_cch_data, machine_config.delay_slot(),
+            machine_config.out_of_order(), min_cache_row_size, core_cop0st, headless,
+            machine_config.branch_predictor());
+        core->set_memory_timing(core_cch_program, core_cch_data);
+        return core;
+    }
+    if (machine_config.pipelined()) {
+        return new CorePipelined(
+            core_regs, core_cch_program, core_cch_data, machine_config.hazard_unit(),
+            min_cache_row_size, core_cop0st, headless, machine_config.branch_predictor(),
+            machine_config.dual_issue());
+    }
+    auto *core = new CoreSingle(
+        core_regs, core_cch_program, core_cch_data, machine_config.delay_slot(),
+        min_cache_row_size, core_cop0st, headless);
+    core->set_jit_enabled(machine_config.jit());
+    core->set_fetch_simulated(machine_config.fetch_simulated());
+    return core;
+}
+
 void Machine::setup_lcd_display() {
     perip_lcd_display = new LcdDisplay(machine_config.get_simulated_endian());
     memory_bus_insert_range(
@@ -139,12 +255,32 @@ void Machine::setup_serial_port() {
     memory_bus_insert_range(ser_port, 0xffff0000_addr, 0xffff003f_addr, false);
     connect(
         ser_port, &SerialPort::signal_interrupt, this,
-        &Machine::set_interrupt_signal);
+        &Machine::set_interrupt_signal, Qt::DirectConnection);
 }
 
 Machine::~Machine() {
+    worker_stop();
+    delete worker_display_t;
+    worker_display_t = nullptr;
     delete run_t;
     run_t = nullptr;
+    delete history;
+    history = nullptr;
+    delete prof;
+    prof = nullptr;
+    for (SmpCore &unit : smp_cores) {
+        for (ExceptionCause excause : smp_shared_handlers) {
+            unit.cr->take_exception_handler(excause);
+        }
+        delete unit.cr;
+        delete unit.cop0st;
+        delete unit.regs;
+        delete unit.cch_program;
+        delete unit.cch_data;
+    }
+    smp_cores.clear();
+    delete coherence;
+    coherence = nullptr;
     delete cr;
     cr = nullptr;
     delete cop0st;
@@ -157,6 +293,10 @@ Machine::~Machine() {
     cch_program = nullptr;
     delete cch_data;
     cch_data = nullptr;
+    delete cch_level2;
+    cch_level2 = nullptr;
+    delete cch_level3;
+    cch_level3 = nullptr;
     delete data_bus;
     data_bus = nullptr;
     delete mem_program_only;
@@ -170,8 +310,20 @@ const MachineConfig &Machine::config() {
 }
 
 void Machine::set_speed(unsigned int ips, unsigned int time_chunk) {
+    bool restart_worker = worker_stop();
     this->time_chunk = time_chunk;
     run_t->setInterval(ips);
+    if (restart_worker && stat == ST_READY) {
+        // Speed changed while running, continue in the new mode
+        play();
+    }
+}
+
+void Machine::set_worker_thread(bool enable) {
+    if (!enable) {
+        worker_stop();
+    }
+    worker_enabled = enable;
 }
 
 const Registers *Machine::registers() {
@@ -198,17 +350,100 @@ const Cache *Machine::cache_data() {
     return cch_data;
 }
 
+Cache *Machine::cache_program_rw() {
+    return cch_program;
+}
+
 Cache *Machine::cache_data_rw() {
     return cch_data;
 }
 
+const Cache *Machine::cache_level2() {
+    return cch_level2;
+}
+
+const Cache *Machine::cache_level3() {
+    return cch_level3;
+}
+
+void Machine::set_trace_writer(TraceWriter *writer) {
+    cr->set_trace_writer(writer);
+    regs->set_trace_writer(writer);
+    if (cch_program != nullptr) {
+        cch_program->set_trace_writer(writer, false);
+    }
+    if (cch_data != nullptr) {
+        cch_data->set_trace_writer(writer, true);
+    }
+}
+
+void Machine::set_profiling(bool enable) {
+    bool restart_worker = worker_stop();
+    cr->set_profiler(nullptr);
+    delete prof;
+    prof = nullptr;
+    if (enable) {
+        prof = new Profiler(cch_program, cch_data);
+        cr->set_profiler(prof);
+    }
+    if (restart_worker && stat == ST_READY) {
+        // Enabled while running, profile is collected from now on
+        play();
+    }
+}
+
+const Profiler *Machine::profiler() const {
+    return prof;
+}
+
+void Machine::save_callgrind(const QString &filename) {
+    if (prof == nullptr) {
+        throw SIMULATOR_EXCEPTION(Input, "Profiling is not enabled", "");
+    }
+    std::ofstream out(filename.toLocal8Bit().data(), std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        throw SIMULATOR_EXCEPTION(Input, "Cannot create profile file", filename);
+    }
+    state_lock();
+    prof->write_callgrind(out, symtab, machine_config.elf());
+    state_unlock();
+    out.close();
+    if (out.fail()) {
+        throw SIMULATOR_EXCEPTION(Input, "Profile write failed", filename);
+    }
+}
+
+const BranchPredictor *Machine::branch_predictor() const {
+    return cr != nullptr ? cr->get_branch_predictor() : nullptr;
+}
+
+const OutOfOrderEngine *Machine::out_of_order() const {
+    return cr != nullptr ? cr->get_out_of_order() : nullptr;
+}
+
+const DualIssueStats *Machine::dual_issue() const {
+    return cr != nullptr ? cr->get_dual_issue() : nullptr;
+}
+
 void Machine::cache_sync() {
+    state_lock();
     if (cch_program != nullptr) {
         cch_program->sync();
     }
     if (cch_data != nullptr) {
         cch_data->sync();
     }
+    for (SmpCore &unit : smp_cores) {
+        unit.cch_program->sync();
+        unit.cch_data->sync();
+    }
+    // Upper levels have written back their blocks to the lower ones
+    for (Cache *cch : { cch_level2, cch_level3 }) {
+        if (cch != nullptr) {
+            cch->sync();
+        }
+    }
+    state_unlock();
 }
 
 const MemoryDataBus *Machine::memory_data_bus() {
@@ -270,6 +505,38 @@ bool Machine::executable_loaded() const {
     return (mem_program_only != nullptr);
 }
 
+unsigned Machine::core_count() const {
+    return smp_cores.size() + 1;
+}
+
+Core *Machine::smp_core(unsigned index) {
+    return index == 0 ? cr : smp_cores.at(index - 1).cr;
+}
+
+const Core *Machine::core(unsigned index) {
+    return smp_core(index);
+}
+
+const Registers *Machine::registers(unsigned index) {
+    return index == 0 ? regs : smp_cores.at(index - 1).regs;
+}
+
+const Cop0State *Machine::cop0state(unsigned index) {
+    return index == 0 ? cop0st : smp_cores.at(index - 1).cop0st;
+}
+
+const Cache *Machine::cache_program(unsigned index) {
+    return index == 0 ? cch_program : smp_cores.at(index - 1).cch_program;
+}
+
+const Cache *Machine::cache_data(unsigned index) {
+    return index == 0 ? cch_data : smp_cores.at(index - 1).cch_data;
+}
+
+const CacheCoherence *Machine::cache_coherence() const {
+    return coherence;
+}
+
 enum Machine::Status Machine::status() {
     return stat;
 }
@@ -289,6 +556,10 @@ bool Machine::exited() {
 void Machine::play() {
     CTL_GUARD;
     set_status(ST_RUNNING);
+    if (worker_enabled && time_chunk != 0) {
+        worker_start(true);
+        return;
+    }
     run_t->start();
     step_internal(true);
 }
@@ -297,26 +568,69 @@ void Machine::pause() {
     if (stat != ST_BUSY) {
         CTL_GUARD;
     }
+    worker_stop();
+    if (exited()) {
+        return; // Program ended while the worker was stopped
+    }
     set_status(ST_READY);
     run_t->stop();
 }
 
 void Machine::step_internal(bool skip_break) {
-    CTL_GUARD;
+    if (time_chunk == 0 || skip_break) {
+        run_internal(1, 0, skip_break);
+    } else {
+        run_internal(UINT_MAX, time_chunk, false);
+    }
+}
+
+unsigned Machine::run(unsigned max_cycles) {
+    return run_internal(max_cycles, 0, false);
+}
+
+unsigned Machine::run_internal(unsigned max_cycles, unsigned time_limit, bool skip_break) {
+    if (exited() || stat == ST_BUSY || max_cycles == 0 || worker != nullptr) {
+        return 0;
+    }
     enum Status stat_prev = stat;
     set_status(ST_BUSY);
     emit tick();
+    unsigned cycles = 0;
     try {
         QTime start_time = QTime::currentTime();
-        do {
-            cr->step(skip_break);
-        } while (time_chunk != 0 && stat == ST_BUSY && !skip_break
-                 && start_time.msecsTo(QTime::currentTime()) < (int)time_chunk);
+        if (history != nullptr) {
+            history->record();
+        }
+        while (true) {
+            unsigned batch = max_cycles - cycles;
+            if (time_limit != 0) {
+                batch = std::min(batch, RUN_BATCH_CYCLES);
+            }
+            if (history != nullptr) {
+                batch = std::min(batch, history->cycles_to_record());
+            }
+            unsigned executed = run_cores(batch, skip_break);
+            skip_break = false;
+            cycles += executed;
+            if (history != nullptr) {
+                // Replay does not stop on breakpoints
+                history->record(
+                    executed < batch
+                    && get_exception_cause() == EXCAUSE_HWBREAK);
+            }
+            if (executed < batch || cycles >= max_cycles || stat != ST_BUSY
+                || regs->read_pc() >= program_end) {
+                break;
+            }
+            if (time_limit == 0 || start_time.msecsTo(QTime::currentTime()) >= (int)time_limit) {
+                break;
+            }
+        }
     } catch (SimulatorException &e) {
         run_t->stop();
         set_status(ST_TRAPPED);
         emit program_trap(e);
-        return;
+        return cycles;
     }
     if (regs->read_pc() >= program_end) {
         run_t->stop();
@@ -328,12 +642,363 @@ void Machine::step_internal(bool skip_break) {
         }
     }
     emit post_tick();
+    return cycles;
 }
 
 void Machine::step() {
     step_internal(true);
 }
 
+unsigned Machine::run_cores(unsigned max_cycles, bool skip_break) {
+    if (smp_cores.isEmpty()) {
+        return cr->run(max_cycles, skip_break, program_end);
+    }
+    // Cores take turns of the quantum length. The position in the round is
+    // kept between the calls, the interleaving does not depend on the batch
+    // sizes and stops then.
+    unsigned cycles = 0;
+    while (cycles < max_cycles) {
+        Core *core = smp_core(smp_turn);
+        bool finished = core->get_regs()->read_pc() >= program_end;
+        if (!finished) {
+            unsigned batch = std::min(smp_left, max_cycles - cycles);
+            unsigned executed = core->run(batch, skip_break, program_end);
+            skip_break = false;
+            cycles += executed;
+            smp_left -= std::min(smp_left, executed);
+            finished = core->get_regs()->read_pc() >= program_end;
+            if (finished ? smp_turn == 0 : executed < batch) {
+                // Program exit (core 0 ends the run of all cores) or the
+                // core stopped
+                return cycles;
+            }
+        }
+        if (finished || smp_left == 0) {
+            smp_turn = (smp_turn + 1) % core_count();
+            smp_left = machine_config.smp_quantum();
+        }
+    }
+    return cycles;
+}
+
+void Machine::worker_start(bool skip_break) {
+    if (worker != nullptr) {
+        return;
+    }
+    run_t->stop();
+    // Per-instruction signals would be queued to the receivers in the thread
+    // of the machine, only the state snapshots are published instead.
+    worker_core_headless = cr->is_headless();
+    cr->set_headless(true);
+    worker_regs_shown = new Registers(*regs);
+    for (int i = 1; i < Cop0State::COP0REGS_CNT; i++) {
+        worker_cop0_shown[i]
+            = cop0st->read_cop0reg((enum Cop0State::Cop0Registers)i);
+    }
+    regs->blockSignals(true);
+    cop0st->blockSignals(true);
+    block_cache_signals(true);
+
+    worker_stop_request = false;
+    worker_exception = nullptr;
+    worker = new RunThread(this, skip_break);
+    connect(worker, &QThread::finished, this, [this]() {
+        // Worker can be already collected by worker_stop
+        if (worker != nullptr && worker->isFinished()) {
+            worker_done();
+        }
+    });
+    worker_display_t->start(time_chunk);
+    worker->start();
+}
+
+bool Machine::worker_stop() {
+    if (worker == nullptr) {
+        return false;
+    }
+    worker_stop_request = true;
+    worker->wait();
+    worker_done();
+    return true;
+}
+
+void Machine::worker_loop(bool skip_break) {
+    try {
+        while (!worker_stop_request) {
+            // Let other threads access the state between batches
+            while (worker_waiters != 0) {
+                QThread::yieldCurrentThread();
+            }
+            QMutexLocker locker(&worker_lock);
+            unsigned batch = RUN_BATCH_CYCLES;
+            if (history != nullptr) {
+                history->record();
+                batch = std::min(batch, history->cycles_to_record());
+            }
+            unsigned executed = run_cores(batch, skip_break);
+            skip_break = false;
+            if (history != nullptr) {
+                history->record(
+                    executed < batch
+                    && get_exception_cause() == EXCAUSE_HWBREAK);
+            }
+            if (executed < batch || regs->read_pc() >= program_end) {
+                break;
+            }
+        }
+    } catch (...) { worker_exception = std::current_exception(); }
+}
+
+void Machine::worker_done() {
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+    worker_display_t->stop();
+
+    regs->blockSignals(false);
+    cop0st->blockSignals(false);
+    block_cache_signals(false);
+    cr->set_headless(worker_core_headless);
+
+    emit tick();
+    worker_publish();
+    delete worker_regs_shown;
+    worker_regs_shown = nullptr;
+
+    if (worker_exception) {
+        std::exception_ptr exception = worker_exception;
+        worker_exception = nullptr;
+        set_status(ST_TRAPPED);
+        try {
+            std::rethrow_exception(exception);
+        } catch (SimulatorException &e) { emit program_trap(e); }
+        return;
+    }
+    if (regs->read_pc() >= program_end) {
+        set_status(ST_EXIT);
+        emit program_exit();
+    } else {
+        // Core stopped on breakpoint or exception
+        set_status(ST_READY);
+    }
+    emit post_tick();
+}
+
+void Machine::worker_display() {
+    if (worker == nullptr) {
+        return;
+    }
+    state_lock();
+    regs->blockSignals(false);
+    cop0st->blockSignals(false);
+    block_cache_signals(false);
+
+    emit tick();
+    worker_publish();
+    emit post_tick();
+
+    regs->blockSignals(true);
+    cop0st->blockSignals(true);
+    block_cache_signals(true);
+    state_unlock();
+}
+
+void Machine::worker_publish() {
+    // Emit updates for the state changed since the last snapshot
+    if (regs->read_pc() != worker_regs_shown->read_pc()) {
+        emit regs->pc_update(regs->read_pc());
+    }
+    for (uint8_t i = 1; i < REGISTER_COUNT; i++) {
+        RegisterValue val = regs->read_gp(i);
+        if (val.as_u32() != worker_regs_shown->read_gp(i).as_u32()) {
+            emit regs->gp_update(i, val);
+        }
+    }
+    for (bool hi : { false, true }) {
+        RegisterValue val = regs->read_hi_lo(hi);
+        if (val.as_u32() != worker_regs_shown->read_hi_lo(hi).as_u32()) {
+            emit regs->hi_lo_update(hi, val);
+        }
+    }
+    delete worker_regs_shown;
+    worker_regs_shown = new Registers(*regs);
+
+    for (int i = 1; i < Cop0State::COP0REGS_CNT; i++) {
+        auto reg = (enum Cop0State::Cop0Registers)i;
+        uint32_t val = cop0st->read_cop0reg(reg);
+        if (val != worker_cop0_shown[i]) {
+            worker_cop0_shown[i] = val;
+            emit cop0st->cop0reg_update(reg, val);
+        }
+    }
+
+    for (const Cache *cch : shown_caches()) {
+        emit cch->hit_update(cch->get_hit_count());
+        emit cch->miss_update(cch->get_miss_count());
+        emit cch->memory_reads_update(cch->get_read_count());
+        emit cch->memory_writes_update(cch->get_write_count());
+        emit cch->statistics_update(
+            cch->get_stall_count(), cch->get_speed_improvement(),
+            cch->get_hit_rate());
+        const CacheStatistics &st = cch->get_statistics();
+        emit cch->prefetch_update(
+            st.prefetches, st.prefetch_useful, st.prefetch_late,
+            st.prefetch_useless);
+    }
+    emit cr->cycle_c_value(cr->get_cycle_count());
+    emit cr->stall_c_value(cr->get_stall_count());
+    emit cr->fetch_inst_addr_value(regs->read_pc());
+}
+
+QVector<Cache *> Machine::shown_caches() const {
+    QVector<Cache *> caches { cch_program, cch_data };
+    for (Cache *cch : { cch_level2, cch_level3 }) {
+        if (cch != nullptr) {
+            caches.append(cch);
+        }
+    }
+    return caches;
+}
+
+void Machine::block_cache_signals(bool block) {
+    for (Cache *cch : shown_caches()) {
+        cch->blockSignals(block);
+    }
+}
+
+void Machine::state_lock() {
+    worker_waiters++;
+    worker_lock.lock();
+}
+
+void Machine::state_unlock() {
+    worker_lock.unlock();
+    worker_waiters--;
+}
+
+// Configuration the checkpoint state layout depends on
+static void checkpoint_config(QDataStream &out, const MachineConfig &config) {
+    out << config.pipelined() << config.delay_slot() << (qint32)config.hazard_unit()
+        << config.dual_issue() << (qint32)config.get_simulated_endian();
+    for (const CacheConfig *cc :
+         { &config.cache_program(), &config.cache_data(), &config.cache_level2(),
+           &config.cache_level3() }) {
+        out << cc->enabled() << (quint32)cc->set_count() << (quint32)cc->block_size()
+            << (quint32)cc->associativity() << (qint32)cc->replacement_policy()
+            << (qint32)cc->write_policy() << (qint32)cc->inclusion_policy()
+            << (qint32)cc->prefetcher() << (quint32)cc->prefetch_degree()
+            << (quint32)cc->prefetch_table_size();
+    }
+    const BranchPredictorConfig &bp = config.branch_predictor();
+    out << (qint32)bp.predictor() << (quint32)bp.table_bits() << (quint32)bp.btb_size()
+        << (quint32)bp.ras_depth() << (quint32)bp.penalty();
+    const OutOfOrderConfig &ooo = config.out_of_order();
+    out << ooo.enabled() << (quint32)ooo.issue_width() << (quint32)ooo.rob_size()
+        << (quint32)ooo.rs_size() << (quint32)ooo.lsq_size() << (quint32)ooo.mul_latency()
+        << (quint32)ooo.div_latency();
+}
+
+void Machine::save_state(QDataStream &out) {
+    if (!smp_cores.isEmpty()) {
+        throw SIMULATOR_EXCEPTION(
+            Input, "Checkpoint of multiprocessor is not supported", "");
+    }
+    state_lock();
+    QByteArray fingerprint;
+    QDataStream fingerprint_out(&fingerprint, QIODevice::WriteOnly);
+    checkpoint_config(fingerprint_out, machine_config);
+
+    out.setVersion(QDataStream::Qt_5_0);
+    out << CHECKPOINT_MAGIC << CHECKPOINT_VERSION << fingerprint;
+    out << (quint64)program_end.get_raw();
+    regs->save_state(out);
+    cop0st->save_state(out);
+    mem->save_state(out);
+    for (const Cache *cch : shown_caches()) {
+        cch->save_state(out);
+    }
+    ser_port->save_state(out);
+    perip_spi_led->save_state(out);
+    perip_lcd_display->save_state(out);
+    cr->save_state(out);
+    state_unlock();
+}
+
+void Machine::load_state(QDataStream &in) {
+    if (!smp_cores.isEmpty()) {
+        throw SIMULATOR_EXCEPTION(
+            Input, "Checkpoint of multiprocessor is not supported", "");
+    }
+    worker_stop();
+    run_t->stop();
+
+    QByteArray fingerprint, expected;
+    QDataStream expected_out(&expected, QIODevice::WriteOnly);
+    checkpoint_config(expected_out, machine_config);
+
+    quint32 magic, version;
+    in.setVersion(QDataStream::Qt_5_0);
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != CHECKPOINT_MAGIC) {
+        throw SIMULATOR_EXCEPTION(Input, "Not a checkpoint file", "");
+    }
+    if (version != CHECKPOINT_VERSION) {
+        throw SIMULATOR_EXCEPTION(
+            Input, "Unsupported checkpoint version", QString::number(version));
+    }
+    in >> fingerprint;
+    if (fingerprint != expected) {
+        throw SIMULATOR_EXCEPTION(
+            Input, "Checkpoint was created with different core or cache configuration", "");
+    }
+    quint64 end;
+    in >> end;
+    program_end = Address(end);
+    regs->load_state(in);
+    cop0st->load_state(in);
+    mem->load_state(in);
+    for (Cache *cch : shown_caches()) {
+        cch->load_state(in);
+    }
+    ser_port->load_state(in);
+    perip_spi_led->load_state(in);
+    perip_lcd_display->load_state(in);
+    cr->load_state(in);
+    if (in.status() != QDataStream::Ok) {
+        throw SIMULATOR_EXCEPTION(Input, "Checkpoint file is truncated or corrupted", "");
+    }
+    if (history != nullptr) {
+        history->clear();
+    }
+
+    set_status(ST_READY);
+    emit tick();
+    emit post_tick();
+}
+
+void Machine::save_checkpoint(const QString &filename) {
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        throw SIMULATOR_EXCEPTION(Input, "Cannot create checkpoint file", filename);
+    }
+    QDataStream out(&file);
+    save_state(out);
+    if (out.status() != QDataStream::Ok || !file.flush()) {
+        throw SIMULATOR_EXCEPTION(Input, "Checkpoint write failed", filename);
+    }
+}
+
+void Machine::load_checkpoint(const QString &filename) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw SIMULATOR_EXCEPTION(Input, "Cannot open checkpoint file", filename);
+    }
+    // Buffered load, memory sections are small and stored interleaved with
+    // their addresses, so they cannot be backed by a mapping of the file
+    QDataStream in(&file);
+    load_state(in);
+}
+
 void Machine::step_timer() {
     step_internal();
 }
@@ -344,10 +1009,106 @@ void Machine::restart() {
     if (mem_program_only != nullptr) {
         mem->reset(*mem_program_only);
     }
-    cch_program->reset();
-    cch_data->reset();
+    for (Cache *cch : shown_caches()) {
+        cch->reset();
+    }
     cr->reset();
+    cr->reset_hwbreak_counts();
+    for (SmpCore &unit : smp_cores) {
+        unit.regs->reset();
+        unit.cch_program->reset();
+        unit.cch_data->reset();
+        unit.cr->reset();
+        unit.cr->reset_hwbreak_counts();
+    }
+    if (coherence != nullptr) {
+        coherence->reset_statistics();
+    }
+    smp_turn = 0;
+    smp_left = machine_config.smp_quantum();
+    if (history != nullptr) {
+        history->clear();
+    }
+    if (prof != nullptr) {
+        prof->clear();
+    }
+    set_status(ST_READY);
+}
+
+void Machine::set_history(unsigned interval, unsigned depth) {
+    worker_stop();
+    delete history;
+    history = nullptr;
+    if (depth != 0 && smp_cores.isEmpty()) {
+        history = new ExecutionHistory(
+            cr, mem, shown_caches(),
+            { ser_port, perip_spi_led, perip_lcd_display }, interval, depth);
+    }
+}
+
+bool Machine::travel_to(unsigned cycle) {
+    return history_travel(cycle, false);
+}
+
+void Machine::step_back() {
+    if (cr->get_cycle_count() > 0) {
+        history_travel(cr->get_cycle_count() - 1, false);
+    }
+}
+
+void Machine::run_back() {
+    history_travel(0, true);
+}
+
+bool Machine::history_travel(unsigned cycle, bool to_break) {
+    if (history == nullptr || stat == ST_BUSY) {
+        return false;
+    }
+    worker_stop();
+    run_t->stop();
+    // Replayed cycles are not shown, only the resulting state is published
+    // the same way as after the worker run
+    bool core_headless = cr->is_headless();
+    cr->set_headless(true);
+    worker_regs_shown = new Registers(*regs);
+    for (int i = 1; i < Cop0State::COP0REGS_CNT; i++) {
+        worker_cop0_shown[i]
+            = cop0st->read_cop0reg((enum Cop0State::Cop0Registers)i);
+    }
+    regs->blockSignals(true);
+    cop0st->blockSignals(true);
+    block_cache_signals(true);
+
+    bool found = false;
+    std::exception_ptr exception = nullptr;
+    try {
+        found = to_break ? history->travel_to_break()
+                         : history->travel_to(cycle);
+    } catch (...) { exception = std::current_exception(); }
+
+    regs->blockSignals(false);
+    cop0st->blockSignals(false);
+    block_cache_signals(false);
+    cr->set_headless(core_headless);
+
+    emit tick();
+    worker_publish();
+    delete worker_regs_shown;
+    worker_regs_shown = nullptr;
+    for (const Cache *cch : shown_caches()) {
+        cch->publish_state();
+    }
+
+    if (exception) {
+        set_status(ST_TRAPPED);
+        try {
+            std::rethrow_exception(exception);
+        } catch (SimulatorException &e) { emit program_trap(e); }
+        return false;
+    }
     set_status(ST_READY);
+    emit post_tick();
+    return found;
 }
 
 void Machine::set_status(enum Status st) {
@@ -361,8 +1122,28 @@ void Machine::set_status(enum Status st) {
 void Machine::register_exception_handler(
     ExceptionCause excause,
     ExceptionHandler *exhandler) {
-    if (cr != nullptr) {
-        cr->register_exception_handler(excause, exhandler);
+    if (cr == nullptr) {
+        return;
+    }
+    // Handler is shared by all cores, only core 0 owns it
+    bool shared = smp_shared_handlers.contains(excause);
+    for (SmpCore &unit : smp_cores) {
+        ExceptionHandler *old = unit.cr->take_exception_handler(excause);
+        if (!shared) {
+            delete old;
+        }
+    }
+    cr->register_exception_handler(excause, exhandler);
+    for (SmpCore &unit : smp_cores) {
+        unit.cr->register_exception_handler(excause, exhandler);
+    }
+    if (!shared && !smp_cores.isEmpty()) {
+        smp_shared_handlers.append(excause);
+    }
+    if (history != nullptr) {
+        // Recorded states belong to the replaced handler
+        history->clear();
+        history->attach_io_journal();
     }
 }
 
@@ -378,15 +1159,25 @@ bool Machine::memory_bus_insert_range(
         mem_acces, start_addr, last_addr, move_ownership);
 }
 
-void Machine::insert_hwbreak(Address address) {
+void Machine::insert_hwbreak(Address address, unsigned ignore_count) {
     if (cr != nullptr) {
-        cr->insert_hwbreak(address);
+        state_lock();
+        cr->insert_hwbreak(address, ignore_count);
+        for (SmpCore &unit : smp_cores) {
+            unit.cr->insert_hwbreak(address, ignore_count);
+        }
+        state_unlock();
     }
 }
 
 void Machine::remove_hwbreak(Address address) {
     if (cr != nullptr) {
+        state_lock();
         cr->remove_hwbreak(address);
+        for (SmpCore &unit : smp_cores) {
+            unit.cr->remove_hwbreak(address);
+        }
+        state_unlock();
     }
 }
 
@@ -397,9 +1188,49 @@ bool Machine::is_hwbreak(Address address) {
     return false;
 }
 
+void Machine::insert_watchpoint(
+    Address start,
+    Address last,
+    enum Core::WatchpointType type) {
+    if (cr != nullptr) {
+        state_lock();
+        cr->insert_watchpoint(start, last, type);
+        for (SmpCore &unit : smp_cores) {
+            unit.cr->insert_watchpoint(start, last, type);
+        }
+        state_unlock();
+    }
+}
+
+void Machine::remove_watchpoint(Address start) {
+    if (cr != nullptr) {
+        state_lock();
+        cr->remove_watchpoint(start);
+        for (SmpCore &unit : smp_cores) {
+            unit.cr->remove_watchpoint(start);
+        }
+        state_unlock();
+    }
+}
+
+unsigned Machine::get_hwbreak_count(Address address) {
+    unsigned count = 0;
+    if (cr != nullptr) {
+        state_lock();
+        count = cr->get_hwbreak_count(address);
+        state_unlock();
+    }
+    return count;
+}
+
 void Machine::set_stop_on_exception(enum ExceptionCause excause, bool value) {
     if (cr != nullptr) {
+        state_lock();
         cr->set_stop_on_exception(excause, value);
+        for (SmpCore &unit : smp_cores) {
+            unit.cr->set_stop_on_exception(excause, value);
+        }
+        state_unlock();
     }
 }
 
@@ -412,7 +1243,12 @@ bool Machine::get_stop_on_exception(enum ExceptionCause excause) const {
 
 void Machine::set_step_over_exception(enum ExceptionCause excause, bool value) {
     if (cr != nullptr) {
+        state_lock();
         cr->set_step_over_exception(excause, value);
+        for (SmpCore &unit : smp_cores) {
+            unit.cr->set_step_over_exception(excause, value);
+        }
+        state_unlock();
     }
 }
 
@@ -36,21 +36,29 @@
 #ifndef MACHINE_H
 #define MACHINE_H
 
+#include "common/polyfills/qt5/qrecursivemutex.h"
 #include "core.h"
+#include "history.h"
 #include "machineconfig.h"
 #include "memory/backend/lcddisplay.h"
 #include "memory/backend/peripheral.h"
 #include "memory/backend/peripspiled.h"
 #include "memory/backend/serialport.h"
 #include "memory/cache/cache.h"
+#include "memory/cache/cache_coherence.h"
 #include "memory/memory_bus.h"
 #include "registers.h"
 #include "simulator_exception.h"
 #include "symboltable.h"
 
+#include <QMutex>
 #include <QObject>
+#include <QThread>
 #include <QTimer>
+#include <QVector>
+#include <atomic>
 #include <cstdint>
+#include <exception>
 
 namespace machine {
 
@@ -65,6 +73,78 @@ public:
 
     const MachineConfig &config();
     void set_speed(unsigned int ips, unsigned int time_chunk = 0);
+    /**
+     * Runs up to max_cycles cycles as a single batch. The batch ends early
+     * when the program exits or traps and after an exception which stops
+     * the core. Status is changed and tick/post_tick are emitted only once
+     * per batch. Returns number of executed cycles.
+     */
+    unsigned run(unsigned max_cycles);
+    /**
+     * Runs the simulation on a dedicated worker thread when playing at
+     * maximal speed (set_speed with time_chunk). Machine components keep
+     * their thread affinity, their state is published (tick, changed
+     * registers, statistics, post_tick) only once per time chunk while the
+     * worker is paused between batches. Exception and stop handling has to
+     * use direct connections then.
+     */
+    void set_worker_thread(bool enable);
+    /**
+     * Serializes access to the simulated state (memory edits, peripheral
+     * inputs and reads for the views) with the worker thread, which is held
+     * between its batches. Calls can nest within one thread, a view holds
+     * the lock over the whole repaint and its model takes it for each read.
+     */
+    void state_lock();
+    void state_unlock();
+
+    /**
+     * Checkpoint support. Complete simulated state (core with its latches,
+     * registers, coprocessor 0, memory, caches and peripherals) is written
+     * to the stream. Restore requires a machine with the same core and cache
+     * configuration, SimulatorExceptionInput is thrown otherwise. The machine
+     * is paused and ready after restore. Multiprocessor state cannot be
+     * saved.
+     */
+    void save_state(QDataStream &out);
+    void load_state(QDataStream &in);
+    void save_checkpoint(const QString &filename);
+    void load_checkpoint(const QString &filename);
+
+    /**
+     * Records execution history for stepping backwards, see
+     * `ExecutionHistory`. Snapshot is taken each `interval` cycles and
+     * `depth` most recent ones are kept. Zero depth disables the history.
+     * History is not available for multiprocessor.
+     */
+    void set_history(unsigned interval, unsigned depth);
+    /**
+     * Returns the machine to an already executed cycle. Returns false when
+     * the cycle is not covered by the history.
+     */
+    bool travel_to(unsigned cycle);
+
+    /**
+     * Writes binary trace of core 0 (stages, registers, memory accesses and
+     * cache hits and misses) to `writer`, see `trace/trace_format.h`. Writer
+     * is not owned, null stops tracing.
+     */
+    void set_trace_writer(TraceWriter *writer);
+    /**
+     * Collects flat profile of core 0, see `Profiler`. The profile is cleared
+     * by restart, it is not rewound by history travel. Disabling drops it.
+     */
+    void set_profiling(bool enable);
+    // Null when profiling is disabled
+    const Profiler *profiler() const;
+    // Writes the profile with call graph in callgrind format
+    void save_callgrind(const QString &filename);
+    // Branch predictor of core 0, null when it is not configured
+    const BranchPredictor *branch_predictor() const;
+    // Timing model of core 0, null when the core is not out-of-order
+    const OutOfOrderEngine *out_of_order() const;
+    // Issue statistics of core 0, null unless it is dual-issue pipelined one
+    const DualIssueStats *dual_issue() const;
 
     const Registers *registers();
     const Cop0State *cop0state();
@@ -72,7 +152,11 @@ public:
     Memory *memory_rw();
     const Cache *cache_program();
     const Cache *cache_data();
+    Cache *cache_program_rw();
     Cache *cache_data_rw();
+    // Unified lower cache levels shared by all cores, null when disabled
+    const Cache *cache_level2();
+    const Cache *cache_level3();
     void cache_sync();
     const MemoryDataBus *memory_data_bus();
     MemoryDataBus *memory_data_bus_rw();
@@ -92,6 +176,20 @@ public:
     const CorePipelined *core_pipelined();
     bool executable_loaded() const;
 
+    /**
+     * Shared memory multiprocessor (see MachineConfig::set_core_count).
+     * Accessors above return units of core 0, which is the only visualized
+     * one. Program ends when core 0 reaches its end, other cores stop there.
+     */
+    unsigned core_count() const;
+    const Core *core(unsigned index);
+    const Registers *registers(unsigned index);
+    const Cop0State *cop0state(unsigned index);
+    const Cache *cache_program(unsigned index);
+    const Cache *cache_data(unsigned index);
+    // Protocol keeping the data caches coherent, null for single core
+    const CacheCoherence *cache_coherence() const;
+
     enum Status {
         ST_READY,   // Machine is ready to be started or step to be called
         ST_RUNNING, // Machine is running
@@ -111,9 +209,17 @@ public:
         Address last_addr,
         bool move_ownership);
 
-    void insert_hwbreak(Address address);
+    void insert_hwbreak(Address address, unsigned ignore_count = 0);
     void remove_hwbreak(Address address);
     bool is_hwbreak(Address address);
+    unsigned get_hwbreak_count(Address address);
+    // Watchpoints are set by the command line interface only, the machine
+    // is paused when one is hit
+    void insert_watchpoint(
+        Address start,
+        Address last,
+        enum Core::WatchpointType type);
+    void remove_watchpoint(Address start);
     void set_stop_on_exception(enum ExceptionCause excause, bool value);
     bool get_stop_on_exception(enum ExceptionCause excause) const;
     void set_step_over_exception(enum ExceptionCause excause, bool value);
@@ -125,6 +231,8 @@ public slots:
     void pause();
     void step();
     void restart();
+    void step_back();
+    void run_back(); // Back to the previous hardware breakpoint hit
 
 signals:
     void program_exit();
@@ -136,9 +244,31 @@ signals:
 
 private slots:
     void step_timer();
+    void worker_display();
 
 private:
+    class RunThread;
+
     void step_internal(bool skip_break = false);
+    unsigned run_internal(unsigned max_cycles, unsigned time_limit, bool skip_break);
+    void worker_start(bool skip_break);
+    bool worker_stop();
+    void worker_loop(bool skip_break);
+    void worker_done();
+    void worker_publish();
+    // Caches shown by the GUI: the ones of core 0 and lower levels
+    QVector<Cache *> shown_caches() const;
+    void block_cache_signals(bool block);
+    bool history_travel(unsigned cycle, bool to_break);
+    Core *create_core(
+        Registers *core_regs,
+        Cache *core_cch_program,
+        Cache *core_cch_data,
+        Cop0State *core_cop0st,
+        unsigned min_cache_row_size,
+        bool headless);
+    Core *smp_core(unsigned index);
+    unsigned run_cores(unsigned max_cycles, bool skip_break);
     MachineConfig machine_config;
 
     Registers *regs = nullptr;
@@ -155,12 +285,43 @@ private:
     LcdDisplay *perip_lcd_display = nullptr;
     Cache *cch_program = nullptr;
     Cache *cch_data = nullptr;
+    Cache *cch_level2 = nullptr;
+    Cache *cch_level3 = nullptr;
     Cop0State *cop0st = nullptr;
     Core *cr = nullptr;
+    ExecutionHistory *history = nullptr;
+    Profiler *prof = nullptr;
+
+    // Units of the other cores of multiprocessor, core 0 uses the ones above
+    struct SmpCore {
+        Registers *regs;
+        Cop0State *cop0st;
+        Cache *cch_program;
+        Cache *cch_data;
+        Core *cr;
+    };
+    QVector<SmpCore> smp_cores;
+    CacheCoherence *coherence = nullptr;
+    // Exception handlers registered to all cores, owned by core 0
+    QVector<ExceptionCause> smp_shared_handlers;
+    unsigned smp_turn = 0; // Core running in the current round
+    unsigned smp_left = 0; // Cycles left from its quantum
 
     QTimer *run_t = nullptr;
     unsigned int time_chunk = { 0 };
 
+    bool worker_enabled = false;
+    RunThread *worker = nullptr;
+    std::atomic<bool> worker_stop_request { false };
+    std::atomic<int> worker_waiters { 0 };
+    // Held by the worker for each batch, others lock it to access the state
+    Poly_QRecursiveMutex worker_lock;
+    QTimer *worker_display_t = nullptr;
+    std::exception_ptr worker_exception;
+    bool worker_core_headless = false;
+    Registers *worker_regs_shown = nullptr;
+    uint32_t worker_cop0_shown[Cop0State::COP0REGS_CNT] = {};
+
     SymbolTable *symtab = nullptr;
     Address program_end = 0xffff0000_addr;
     enum Status stat = ST_READY;
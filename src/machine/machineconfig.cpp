@@ -47,12 +47,15 @@ using namespace machine;
 #define DF_PIPELINE false
 #define DF_DELAYSLOT true
 #define DF_HUNIT HU_STALL_FORWARD
+#define DF_DUAL_ISSUE false
 #define DF_EXEC_PROTEC false
 #define DF_WRITE_PROTEC false
 #define DF_MEM_ACC_READ 10
 #define DF_MEM_ACC_WRITE 10
 #define DF_MEM_ACC_BURST 0
 #define DF_ELF QString("")
+#define DF_CORE_COUNT 1
+#define DF_SMP_QUANTUM 1
 //////////////////////////////////////////////////////////////////////////////
 /// Default config of CacheConfig
 #define DFC_EN false
@@ -61,6 +64,27 @@ using namespace machine;
 #define DFC_ASSOC 1
 #define DFC_REPLAC RP_RAND
 #define DFC_WRITE WP_THROUGH_NOALLOC
+#define DFC_HIT_LAT 4
+#define DFC_INCLUSION IP_NINE
+#define DFC_PREFETCHER PF_NONE
+#define DFC_PF_DEGREE 1
+#define DFC_PF_TABLE 8
+//////////////////////////////////////////////////////////////////////////////
+/// Default config of BranchPredictorConfig
+#define DFB_PREDICTOR BP_NONE
+#define DFB_TABLE_BITS 10
+#define DFB_BTB 64
+#define DFB_RAS 8
+#define DFB_PENALTY 2
+//////////////////////////////////////////////////////////////////////////////
+/// Default config of OutOfOrderConfig
+#define DFO_EN false
+#define DFO_WIDTH 2
+#define DFO_ROB 32
+#define DFO_RS 16
+#define DFO_LSQ 8
+#define DFO_MUL_LAT 4
+#define DFO_DIV_LAT 20
 //////////////////////////////////////////////////////////////////////////////
 
 CacheConfig::CacheConfig() {
@@ -70,6 +94,11 @@ CacheConfig::CacheConfig() {
     d_associativity = DFC_ASSOC;
     replac_pol = DFC_REPLAC;
     write_pol = DFC_WRITE;
+    hit_lat = DFC_HIT_LAT;
+    incl_pol = DFC_INCLUSION;
+    pf = DFC_PREFETCHER;
+    pf_degree = DFC_PF_DEGREE;
+    pf_table = DFC_PF_TABLE;
 }
 
 CacheConfig::CacheConfig(const CacheConfig *cc) {
@@ -79,6 +108,11 @@ CacheConfig::CacheConfig(const CacheConfig *cc) {
     d_associativity = cc->associativity();
     replac_pol = cc->replacement_policy();
     write_pol = cc->write_policy();
+    hit_lat = cc->hit_latency();
+    incl_pol = cc->inclusion_policy();
+    pf = cc->prefetcher();
+    pf_degree = cc->prefetch_degree();
+    pf_table = cc->prefetch_table_size();
 }
 
 #define N(STR) (prefix + QString(STR))
@@ -92,6 +126,14 @@ CacheConfig::CacheConfig(const QSettings *sts, const QString &prefix) {
         = (enum ReplacementPolicy)sts->value(N("Replacement"), DFC_REPLAC)
               .toUInt();
     write_pol = (enum WritePolicy)sts->value(N("Write"), DFC_WRITE).toUInt();
+    set_hit_latency(sts->value(N("HitLatency"), DFC_HIT_LAT).toUInt());
+    incl_pol
+        = (enum InclusionPolicy)sts->value(N("Inclusion"), DFC_INCLUSION)
+              .toUInt();
+    pf = (enum Prefetcher)sts->value(N("Prefetcher"), DFC_PREFETCHER).toUInt();
+    set_prefetch_degree(sts->value(N("PrefetchDegree"), DFC_PF_DEGREE).toUInt());
+    set_prefetch_table_size(
+        sts->value(N("PrefetchTable"), DFC_PF_TABLE).toUInt());
 }
 
 void CacheConfig::store(QSettings *sts, const QString &prefix) const {
@@ -101,6 +143,11 @@ void CacheConfig::store(QSettings *sts, const QString &prefix) const {
     sts->setValue(N("Associativity"), associativity());
     sts->setValue(N("Replacement"), (unsigned)replacement_policy());
     sts->setValue(N("Write"), (unsigned)write_policy());
+    sts->setValue(N("HitLatency"), hit_latency());
+    sts->setValue(N("Inclusion"), (unsigned)inclusion_policy());
+    sts->setValue(N("Prefetcher"), (unsigned)prefetcher());
+    sts->setValue(N("PrefetchDegree"), prefetch_degree());
+    sts->setValue(N("PrefetchTable"), prefetch_table_size());
 }
 
 #undef N
@@ -145,6 +192,26 @@ void CacheConfig::set_write_policy(enum WritePolicy v) {
     write_pol = v;
 }
 
+void CacheConfig::set_hit_latency(unsigned v) {
+    hit_lat = v > 0 ? v : 1;
+}
+
+void CacheConfig::set_inclusion_policy(enum InclusionPolicy v) {
+    incl_pol = v;
+}
+
+void CacheConfig::set_prefetcher(enum Prefetcher v) {
+    pf = v;
+}
+
+void CacheConfig::set_prefetch_degree(unsigned v) {
+    pf_degree = v > 0 ? v : 1;
+}
+
+void CacheConfig::set_prefetch_table_size(unsigned v) {
+    pf_table = v > 0 ? v : 1;
+}
+
 bool CacheConfig::enabled() const {
     return en;
 }
@@ -169,11 +236,33 @@ enum CacheConfig::WritePolicy CacheConfig::write_policy() const {
     return write_pol;
 }
 
+unsigned CacheConfig::hit_latency() const {
+    return hit_lat;
+}
+
+enum CacheConfig::InclusionPolicy CacheConfig::inclusion_policy() const {
+    return incl_pol;
+}
+
+enum CacheConfig::Prefetcher CacheConfig::prefetcher() const {
+    return pf;
+}
+
+unsigned CacheConfig::prefetch_degree() const {
+    return pf_degree;
+}
+
+unsigned CacheConfig::prefetch_table_size() const {
+    return pf_table;
+}
+
 bool CacheConfig::operator==(const CacheConfig &c) const {
 #define CMP(GETTER) (GETTER)() == (c.GETTER)()
     return CMP(enabled) && CMP(set_count) && CMP(block_size)
            && CMP(associativity) && CMP(replacement_policy)
-           && CMP(write_policy);
+           && CMP(write_policy) && CMP(hit_latency)
+           && CMP(inclusion_policy) && CMP(prefetcher) && CMP(prefetch_degree)
+           && CMP(prefetch_table_size);
 #undef CMP
 }
 
@@ -181,10 +270,211 @@ bool CacheConfig::operator!=(const CacheConfig &c) const {
     return !operator==(c);
 }
 
+BranchPredictorConfig::BranchPredictorConfig() {
+    pred = DFB_PREDICTOR;
+    t_bits = DFB_TABLE_BITS;
+    n_btb = DFB_BTB;
+    n_ras = DFB_RAS;
+    d_penalty = DFB_PENALTY;
+}
+
+#define N(STR) (prefix + QString(STR))
+
+BranchPredictorConfig::BranchPredictorConfig(
+    const QSettings *sts,
+    const QString &prefix) {
+    pred = (enum Predictor)sts->value(N("Predictor"), DFB_PREDICTOR).toUInt();
+    set_table_bits(sts->value(N("TableBits"), DFB_TABLE_BITS).toUInt());
+    n_btb = sts->value(N("BtbSize"), DFB_BTB).toUInt();
+    n_ras = sts->value(N("RasDepth"), DFB_RAS).toUInt();
+    d_penalty = sts->value(N("Penalty"), DFB_PENALTY).toUInt();
+}
+
+void BranchPredictorConfig::store(QSettings *sts, const QString &prefix) const {
+    sts->setValue(N("Predictor"), (unsigned)predictor());
+    sts->setValue(N("TableBits"), table_bits());
+    sts->setValue(N("BtbSize"), btb_size());
+    sts->setValue(N("RasDepth"), ras_depth());
+    sts->setValue(N("Penalty"), penalty());
+}
+
+#undef N
+
+void BranchPredictorConfig::set_predictor(enum Predictor v) {
+    pred = v;
+}
+
+bool BranchPredictorConfig::set_predictor(const QString &kind) {
+    static QMap<QString, enum Predictor> kind_map = {
+        { "none", BP_NONE },
+        { "not-taken", BP_STATIC_NOT_TAKEN },
+        { "taken", BP_STATIC_TAKEN },
+        { "btfn", BP_BTFN },
+        { "1bit", BP_BIMODAL_1BIT },
+        { "2bit", BP_BIMODAL_2BIT },
+        { "bimodal", BP_BIMODAL_2BIT },
+        { "gshare", BP_GSHARE },
+    };
+    if (!kind_map.contains(kind)) {
+        return false;
+    }
+    set_predictor(kind_map.value(kind));
+    return true;
+}
+
+void BranchPredictorConfig::set_table_bits(unsigned v) {
+    t_bits = v < 1 ? 1 : (v > 20 ? 20 : v);
+}
+
+void BranchPredictorConfig::set_btb_size(unsigned v) {
+    n_btb = v;
+}
+
+void BranchPredictorConfig::set_ras_depth(unsigned v) {
+    n_ras = v;
+}
+
+void BranchPredictorConfig::set_penalty(unsigned v) {
+    d_penalty = v;
+}
+
+enum BranchPredictorConfig::Predictor BranchPredictorConfig::predictor() const {
+    return pred;
+}
+
+unsigned BranchPredictorConfig::table_bits() const {
+    return t_bits;
+}
+
+unsigned BranchPredictorConfig::btb_size() const {
+    return n_btb;
+}
+
+unsigned BranchPredictorConfig::ras_depth() const {
+    return n_ras;
+}
+
+unsigned BranchPredictorConfig::penalty() const {
+    return d_penalty;
+}
+
+bool BranchPredictorConfig::operator==(const BranchPredictorConfig &c) const {
+#define CMP(GETTER) (GETTER)() == (c.GETTER)()
+    return CMP(predictor) && CMP(table_bits) && CMP(btb_size) && CMP(ras_depth)
+           && CMP(penalty);
+#undef CMP
+}
+
+bool BranchPredictorConfig::operator!=(const BranchPredictorConfig &c) const {
+    return !operator==(c);
+}
+
+OutOfOrderConfig::OutOfOrderConfig() {
+    en = DFO_EN;
+    width = DFO_WIDTH;
+    n_rob = DFO_ROB;
+    n_rs = DFO_RS;
+    n_lsq = DFO_LSQ;
+    mul_lat = DFO_MUL_LAT;
+    div_lat = DFO_DIV_LAT;
+}
+
+#define N(STR) (prefix + QString(STR))
+
+OutOfOrderConfig::OutOfOrderConfig(const QSettings *sts, const QString &prefix) {
+    en = sts->value(N("Enabled"), DFO_EN).toBool();
+    set_issue_width(sts->value(N("IssueWidth"), DFO_WIDTH).toUInt());
+    set_rob_size(sts->value(N("RobSize"), DFO_ROB).toUInt());
+    set_rs_size(sts->value(N("RsSize"), DFO_RS).toUInt());
+    set_lsq_size(sts->value(N("LsqSize"), DFO_LSQ).toUInt());
+    set_mul_latency(sts->value(N("MulLatency"), DFO_MUL_LAT).toUInt());
+    set_div_latency(sts->value(N("DivLatency"), DFO_DIV_LAT).toUInt());
+}
+
+void OutOfOrderConfig::store(QSettings *sts, const QString &prefix) const {
+    sts->setValue(N("Enabled"), enabled());
+    sts->setValue(N("IssueWidth"), issue_width());
+    sts->setValue(N("RobSize"), rob_size());
+    sts->setValue(N("RsSize"), rs_size());
+    sts->setValue(N("LsqSize"), lsq_size());
+    sts->setValue(N("MulLatency"), mul_latency());
+    sts->setValue(N("DivLatency"), div_latency());
+}
+
+#undef N
+
+void OutOfOrderConfig::set_enabled(bool v) {
+    en = v;
+}
+
+void OutOfOrderConfig::set_issue_width(unsigned v) {
+    width = v < 1 ? 1 : (v > 8 ? 8 : v);
+}
+
+void OutOfOrderConfig::set_rob_size(unsigned v) {
+    n_rob = v < 1 ? 1 : (v > 1024 ? 1024 : v);
+}
+
+void OutOfOrderConfig::set_rs_size(unsigned v) {
+    n_rs = v < 1 ? 1 : (v > 1024 ? 1024 : v);
+}
+
+void OutOfOrderConfig::set_lsq_size(unsigned v) {
+    n_lsq = v < 1 ? 1 : (v > 1024 ? 1024 : v);
+}
+
+void OutOfOrderConfig::set_mul_latency(unsigned v) {
+    mul_lat = v < 1 ? 1 : v;
+}
+
+void OutOfOrderConfig::set_div_latency(unsigned v) {
+    div_lat = v < 1 ? 1 : v;
+}
+
+bool OutOfOrderConfig::enabled() const {
+    return en;
+}
+
+unsigned OutOfOrderConfig::issue_width() const {
+    return width;
+}
+
+unsigned OutOfOrderConfig::rob_size() const {
+    return n_rob;
+}
+
+unsigned OutOfOrderConfig::rs_size() const {
+    return n_rs;
+}
+
+unsigned OutOfOrderConfig::lsq_size() const {
+    return n_lsq;
+}
+
+unsigned OutOfOrderConfig::mul_latency() const {
+    return mul_lat;
+}
+
+unsigned OutOfOrderConfig::div_latency() const {
+    return div_lat;
+}
+
+bool OutOfOrderConfig::operator==(const OutOfOrderConfig &c) const {
+#define CMP(GETTER) (GETTER)() == (c.GETTER)()
+    return CMP(enabled) && CMP(issue_width) && CMP(rob_size) && CMP(rs_size)
+           && CMP(lsq_size) && CMP(mul_latency) && CMP(div_latency);
+#undef CMP
+}
+
+bool OutOfOrderConfig::operator!=(const OutOfOrderConfig &c) const {
+    return !operator==(c);
+}
+
 MachineConfig::MachineConfig() {
     pipeline = DF_PIPELINE;
     delayslot = DF_DELAYSLOT;
     hunit = DF_HUNIT;
+    dualissue = DF_DUAL_ISSUE;
     exec_protect = DF_EXEC_PROTEC;
     write_protect = DF_WRITE_PROTEC;
     mem_acc_read = DF_MEM_ACC_READ;
@@ -197,15 +487,25 @@ MachineConfig::MachineConfig() {
     osem_exception_stop = true;
     osem_fs_root = "";
     res_at_compile = true;
+    headless_mode = false;
+    jit_enable = false;
+    fetch_simulation = true;
+    n_cores = DF_CORE_COUNT;
+    smp_quant = DF_SMP_QUANTUM;
     elf_path = DF_ELF;
     cch_program = CacheConfig();
     cch_data = CacheConfig();
+    cch_level2 = CacheConfig();
+    cch_level3 = CacheConfig();
+    bp = BranchPredictorConfig();
+    ooo = OutOfOrderConfig();
 }
 
 MachineConfig::MachineConfig(const MachineConfig *config) {
     pipeline = config->pipelined();
     delayslot = config->delay_slot();
     hunit = config->hazard_unit();
+    dualissue = config->dual_issue();
     exec_protect = config->memory_execute_protection();
     write_protect = config->memory_write_protection();
     mem_acc_read = config->memory_access_time_read();
@@ -218,9 +518,18 @@ MachineConfig::MachineConfig(const MachineConfig *config) {
     osem_exception_stop = config->osemu_exception_stop();
     osem_fs_root = config->osemu_fs_root();
     res_at_compile = config->reset_at_compile();
+    headless_mode = config->headless();
+    jit_enable = config->jit();
+    fetch_simulation = config->fetch_simulated();
+    n_cores = config->core_count();
+    smp_quant = config->smp_quantum();
     elf_path = config->elf();
     cch_program = config->cache_program();
     cch_data = config->cache_data();
+    cch_level2 = config->cache_level2();
+    cch_level3 = config->cache_level3();
+    bp = config->branch_predictor();
+    ooo = config->out_of_order();
 }
 
 #define N(STR) (prefix + QString(STR))
@@ -229,6 +538,7 @@ MachineConfig::MachineConfig(const QSettings *sts, const QString &prefix) {
     pipeline = sts->value(N("Pipelined"), DF_PIPELINE).toBool();
     delayslot = sts->value(N("DelaySlot"), DF_DELAYSLOT).toBool();
     hunit = (enum HazardUnit)sts->value(N("HazardUnit"), DF_HUNIT).toUInt();
+    dualissue = sts->value(N("DualIssue"), DF_DUAL_ISSUE).toBool();
     exec_protect
         = sts->value(N("MemoryExecuteProtection"), DF_EXEC_PROTEC).toBool();
     write_protect
@@ -245,15 +555,25 @@ MachineConfig::MachineConfig(const QSettings *sts, const QString &prefix) {
     osem_exception_stop = sts->value(N("OsemuExceptionStop"), true).toBool();
     osem_fs_root = sts->value(N("OsemuFilesystemRoot"), "").toString();
     res_at_compile = sts->value(N("ResetAtCompile"), true).toBool();
+    headless_mode = false;
+    jit_enable = false;
+    fetch_simulation = true;
+    n_cores = sts->value(N("CoreCount"), DF_CORE_COUNT).toUInt();
+    smp_quant = sts->value(N("SmpQuantum"), DF_SMP_QUANTUM).toUInt();
     elf_path = sts->value(N("Elf"), DF_ELF).toString();
     cch_program = CacheConfig(sts, N("ProgramCache_"));
     cch_data = CacheConfig(sts, N("DataCache_"));
+    cch_level2 = CacheConfig(sts, N("Level2Cache_"));
+    cch_level3 = CacheConfig(sts, N("Level3Cache_"));
+    bp = BranchPredictorConfig(sts, N("BranchPredictor_"));
+    ooo = OutOfOrderConfig(sts, N("OutOfOrder_"));
 }
 
 void MachineConfig::store(QSettings *sts, const QString &prefix) {
     sts->setValue(N("Pipelined"), pipelined());
     sts->setValue(N("DelaySlot"), delay_slot());
     sts->setValue(N("HazardUnit"), (unsigned)hazard_unit());
+    sts->setValue(N("DualIssue"), dual_issue());
     sts->setValue(N("MemoryRead"), memory_access_time_read());
     sts->setValue(N("MemoryWrite"), memory_access_time_write());
     sts->setValue(N("MemoryBurts"), memory_access_time_burst());
@@ -264,9 +584,15 @@ void MachineConfig::store(QSettings *sts, const QString &prefix) {
     sts->setValue(N("OsemuExceptionStop"), osemu_exception_stop());
     sts->setValue(N("OsemuFilesystemRoot"), osemu_fs_root());
     sts->setValue(N("ResetAtCompile"), reset_at_compile());
+    sts->setValue(N("CoreCount"), core_count());
+    sts->setValue(N("SmpQuantum"), smp_quantum());
     sts->setValue(N("Elf"), elf_path);
     cch_program.store(sts, N("ProgramCache_"));
     cch_data.store(sts, N("DataCache_"));
+    cch_level2.store(sts, N("Level2Cache_"));
+    cch_level3.store(sts, N("Level3Cache_"));
+    bp.store(sts, N("BranchPredictor_"));
+    ooo.store(sts, N("OutOfOrder_"));
 }
 
 #undef N
@@ -290,6 +616,7 @@ void MachineConfig::preset(enum ConfigPresets p) {
         break;
     }
     // Some common configurations
+    set_dual_issue(DF_DUAL_ISSUE);
     set_memory_execute_protection(DF_EXEC_PROTEC);
     set_memory_write_protection(DF_WRITE_PROTEC);
     set_memory_access_time_read(DF_MEM_ACC_READ);
@@ -298,6 +625,10 @@ void MachineConfig::preset(enum ConfigPresets p) {
 
     access_cache_program()->preset(p);
     access_cache_data()->preset(p);
+    set_cache_level2(CacheConfig());
+    set_cache_level3(CacheConfig());
+    set_branch_predictor(BranchPredictorConfig());
+    set_out_of_order(OutOfOrderConfig());
 }
 
 void MachineConfig::set_pipelined(bool v) {
@@ -312,6 +643,10 @@ void MachineConfig::set_hazard_unit(enum MachineConfig::HazardUnit hu) {
     hunit = hu;
 }
 
+void MachineConfig::set_dual_issue(bool v) {
+    dualissue = v;
+}
+
 bool MachineConfig::set_hazard_unit(const QString &hukind) {
     static QMap<QString, enum HazardUnit> hukind_map = {
         { "none", HU_NONE },
@@ -374,6 +709,26 @@ void MachineConfig::set_reset_at_compile(bool v) {
     res_at_compile = v;
 }
 
+void MachineConfig::set_headless(bool v) {
+    headless_mode = v;
+}
+
+void MachineConfig::set_jit(bool v) {
+    jit_enable = v;
+}
+
+void MachineConfig::set_fetch_simulated(bool v) {
+    fetch_simulation = v;
+}
+
+void MachineConfig::set_core_count(unsigned v) {
+    n_cores = v;
+}
+
+void MachineConfig::set_smp_quantum(unsigned v) {
+    smp_quant = v;
+}
+
 void MachineConfig::set_elf(QString path) {
     elf_path = std::move(path);
 }
@@ -386,6 +741,22 @@ void MachineConfig::set_cache_data(const CacheConfig &c) {
     cch_data = c;
 }
 
+void MachineConfig::set_cache_level2(const CacheConfig &c) {
+    cch_level2 = c;
+}
+
+void MachineConfig::set_cache_level3(const CacheConfig &c) {
+    cch_level3 = c;
+}
+
+void MachineConfig::set_branch_predictor(const BranchPredictorConfig &c) {
+    bp = c;
+}
+
+void MachineConfig::set_out_of_order(const OutOfOrderConfig &c) {
+    ooo = c;
+}
+
 void MachineConfig::set_simulated_endian(Endian endian) {
     MachineConfig::simulated_endian = endian;
 }
@@ -404,6 +775,11 @@ enum MachineConfig::HazardUnit MachineConfig::hazard_unit() const {
     return pipeline ? hunit : machine::MachineConfig::HU_NONE;
 }
 
+bool MachineConfig::dual_issue() const {
+    // Dual issue is a mode of the pipelined core only
+    return pipeline && dualissue;
+}
+
 bool MachineConfig::memory_execute_protection() const {
     return exec_protect;
 }
@@ -448,6 +824,26 @@ bool MachineConfig::reset_at_compile() const {
     return res_at_compile;
 }
 
+bool MachineConfig::headless() const {
+    return headless_mode;
+}
+
+bool MachineConfig::jit() const {
+    return jit_enable;
+}
+
+bool MachineConfig::fetch_simulated() const {
+    return fetch_simulation;
+}
+
+unsigned MachineConfig::core_count() const {
+    return n_cores > 1 ? n_cores : 1;
+}
+
+unsigned MachineConfig::smp_quantum() const {
+    return smp_quant > 1 ? smp_quant : 1;
+}
+
 QString MachineConfig::elf() const {
     return elf_path;
 }
@@ -460,6 +856,22 @@ const CacheConfig &MachineConfig::cache_data() const {
     return cch_data;
 }
 
+const CacheConfig &MachineConfig::cache_level2() const {
+    return cch_level2;
+}
+
+const CacheConfig &MachineConfig::cache_level3() const {
+    return cch_level3;
+}
+
+const BranchPredictorConfig &MachineConfig::branch_predictor() const {
+    return bp;
+}
+
+const OutOfOrderConfig &MachineConfig::out_of_order() const {
+    return ooo;
+}
+
 CacheConfig *MachineConfig::access_cache_program() {
     return &cch_program;
 }
@@ -468,6 +880,22 @@ CacheConfig *MachineConfig::access_cache_data() {
     return &cch_data;
 }
 
+CacheConfig *MachineConfig::access_cache_level2() {
+    return &cch_level2;
+}
+
+CacheConfig *MachineConfig::access_cache_level3() {
+    return &cch_level3;
+}
+
+BranchPredictorConfig *MachineConfig::access_branch_predictor() {
+    return &bp;
+}
+
+OutOfOrderConfig *MachineConfig::access_out_of_order() {
+    return &ooo;
+}
+
 Endian MachineConfig::get_simulated_endian() const {
     return simulated_endian;
 }
@@ -475,10 +903,13 @@ Endian MachineConfig::get_simulated_endian() const {
 bool MachineConfig::operator==(const MachineConfig &c) const {
 #define CMP(GETTER) (GETTER)() == (c.GETTER)()
     return CMP(pipelined) && CMP(delay_slot) && CMP(hazard_unit)
-           && CMP(memory_execute_protection) && CMP(memory_write_protection)
+           && CMP(dual_issue) && CMP(memory_execute_protection)
+           && CMP(memory_write_protection)
            && CMP(memory_access_time_read) && CMP(memory_access_time_write)
-           && CMP(memory_access_time_burst) && CMP(elf) && CMP(cache_program)
-           && CMP(cache_data);
+           && CMP(memory_access_time_burst) && CMP(core_count)
+           && CMP(smp_quantum) && CMP(elf) && CMP(cache_program)
+           && CMP(cache_data) && CMP(cache_level2) && CMP(cache_level3)
+           && CMP(branch_predictor) && CMP(out_of_order);
 #undef CMP
 }
 
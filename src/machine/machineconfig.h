@@ -63,7 +63,10 @@ public:
     enum ReplacementPolicy {
         RP_RAND, // Random
         RP_LRU,  // Least recently used
-        RP_LFU   // Least frequently used
+        RP_LFU,  // Least frequently used
+        RP_PLRU, // Tree pseudo least recently used
+        RP_NRU,  // Not recently used
+        RP_SRRIP // Static re-reference interval prediction
     };
 
     enum WritePolicy {
@@ -72,6 +75,20 @@ public:
         WP_BACK             // Write back
     };
 
+    // Relation of lower level (L2, L3) cache content to the levels above it
+    enum InclusionPolicy {
+        IP_NINE,      // Neither inclusive nor exclusive
+        IP_INCLUSIVE, // Evicted blocks are invalidated in upper levels too
+        IP_EXCLUSIVE  // Only blocks evicted from upper levels are held
+    };
+
+    enum Prefetcher {
+        PF_NONE,      // Blocks are fetched on demand only
+        PF_NEXT_LINE, // Following blocks on miss or use of prefetched block
+        PF_STRIDE,    // Stride of instruction accesses, see CachePrefetcherStride
+        PF_STREAM     // Sequential blocks after miss kept in stream buffers
+    };
+
     // If cache should be used or not
     void set_enabled(bool);
     void set_set_count(unsigned);     // Number of sets
@@ -80,6 +97,14 @@ public:
                                       // ways)
     void set_replacement_policy(enum ReplacementPolicy);
     void set_write_policy(enum WritePolicy);
+    // Cycles to deliver a word to the upper level, lower levels only
+    void set_hit_latency(unsigned);
+    void set_inclusion_policy(enum InclusionPolicy);
+    void set_prefetcher(enum Prefetcher);
+    // Number of blocks fetched ahead (depth of stream buffers)
+    void set_prefetch_degree(unsigned);
+    // Entries of stride prediction table or number of stream buffers
+    void set_prefetch_table_size(unsigned);
 
     bool enabled() const;
     unsigned set_count() const;
@@ -87,6 +112,11 @@ public:
     unsigned associativity() const;
     enum ReplacementPolicy replacement_policy() const;
     enum WritePolicy write_policy() const;
+    unsigned hit_latency() const;
+    enum InclusionPolicy inclusion_policy() const;
+    enum Prefetcher prefetcher() const;
+    unsigned prefetch_degree() const;
+    unsigned prefetch_table_size() const;
 
     bool operator==(const CacheConfig &c) const;
     bool operator!=(const CacheConfig &c) const;
@@ -96,6 +126,91 @@ private:
     unsigned n_sets, n_blocks, d_associativity;
     enum ReplacementPolicy replac_pol;
     enum WritePolicy write_pol;
+    unsigned hit_lat;
+    enum InclusionPolicy incl_pol;
+    enum Prefetcher pf;
+    unsigned pf_degree, pf_table;
+};
+
+class BranchPredictorConfig {
+public:
+    BranchPredictorConfig();
+    explicit BranchPredictorConfig(const QSettings *, const QString &prefix = "");
+
+    void store(QSettings *, const QString &prefix = "") const;
+
+    enum Predictor {
+        BP_NONE,             // Branches resolved in decode without penalty
+        BP_STATIC_NOT_TAKEN, // Conditional branches predicted not taken
+        BP_STATIC_TAKEN,     // Conditional branches predicted taken
+        BP_BTFN,             // Backward taken, forward not taken
+        BP_BIMODAL_1BIT,     // Last outcome of the branch
+        BP_BIMODAL_2BIT,     // Saturating counter of the branch
+        BP_GSHARE            // Saturating counter indexed by PC xor history
+    };
+
+    void set_predictor(enum Predictor);
+    bool set_predictor(const QString &kind);
+    // Log2 of number of bimodal and gshare counters, it is also the length
+    // of gshare global history.
+    void set_table_bits(unsigned);
+    // Entries of direct mapped branch target buffer. Without BTB targets of
+    // direct branches are known from the fetched instruction and indirect
+    // jumps are always mispredicted.
+    void set_btb_size(unsigned);
+    // Depth of return address stack, zero predicts returns by BTB.
+    void set_ras_depth(unsigned);
+    // Cycles lost by each misprediction
+    void set_penalty(unsigned);
+
+    enum Predictor predictor() const;
+    unsigned table_bits() const;
+    unsigned btb_size() const;
+    unsigned ras_depth() const;
+    unsigned penalty() const;
+
+    bool operator==(const BranchPredictorConfig &c) const;
+    bool operator!=(const BranchPredictorConfig &c) const;
+
+private:
+    enum Predictor pred;
+    unsigned t_bits, n_btb, n_ras, d_penalty;
+};
+
+class OutOfOrderConfig {
+public:
+    OutOfOrderConfig();
+    explicit OutOfOrderConfig(const QSettings *, const QString &prefix = "");
+
+    void store(QSettings *, const QString &prefix = "") const;
+
+    // Out-of-order core is used instead of single cycle or pipelined one
+    void set_enabled(bool);
+    // Instructions dispatched, issued and committed per cycle. It is also
+    // the number of ALUs.
+    void set_issue_width(unsigned);
+    // Entries of reorder buffer, reservation stations and load/store queue
+    void set_rob_size(unsigned);
+    void set_rs_size(unsigned);
+    void set_lsq_size(unsigned);
+    // Latencies of pipelined multiplier and of not pipelined divider
+    void set_mul_latency(unsigned);
+    void set_div_latency(unsigned);
+
+    bool enabled() const;
+    unsigned issue_width() const;
+    unsigned rob_size() const;
+    unsigned rs_size() const;
+    unsigned lsq_size() const;
+    unsigned mul_latency() const;
+    unsigned div_latency() const;
+
+    bool operator==(const OutOfOrderConfig &c) const;
+    bool operator!=(const OutOfOrderConfig &c) const;
+
+private:
+    bool en;
+    unsigned width, n_rob, n_rs, n_lsq, mul_lat, div_lat;
 };
 
 class MachineConfig {
@@ -120,6 +235,9 @@ public:
     // Hazard unit
     void set_hazard_unit(enum HazardUnit);
     bool set_hazard_unit(const QString &hukind);
+    // Issue up to two instructions per cycle in pipelined core. The second
+    // pipe executes only simple ALU instructions.
+    void set_dual_issue(bool);
     // Protect data memory from execution. Only program sections can be
     // executed.
     void set_memory_execute_protection(bool);
@@ -138,17 +256,45 @@ public:
     void set_osemu_fs_root(QString v);
     // reset machine befor internal compile/reload after external make
     void set_reset_at_compile(bool);
+    // Do not emit per-stage visualization signals from the core. This is
+    // runtime only option and it is not stored in settings.
+    void set_headless(bool);
+    // Translate hot code of single cycle headless core to host code. This is
+    // runtime only option and it is not stored in settings.
+    void set_jit(bool);
+    // Fetch instructions run by single cycle headless core from program
+    // memory, see `Core::set_fetch_simulated`. Cleared only when instruction
+    // cache statistics are not needed. This is runtime only option and it is
+    // not stored in settings.
+    void set_fetch_simulated(bool);
+    // Number of cores of shared memory multiprocessor. Each core has its own
+    // registers, coprocessor 0 and caches, data caches are kept coherent.
+    // The program ends when core 0 reaches its end, the other cores are not
+    // waited for.
+    void set_core_count(unsigned);
+    // Cores of multiprocessor take turns, each runs this number of cycles
+    // before the next one is run.
+    void set_smp_quantum(unsigned);
     // Set path to source elf file. This has to be set before core is
     // initialized.
     void set_elf(QString path);
     // Configure cache
     void set_cache_program(const CacheConfig &);
     void set_cache_data(const CacheConfig &);
+    // Unified lower levels shared by program and data caches of all cores.
+    // Level 3 is used only when level 2 is enabled.
+    void set_cache_level2(const CacheConfig &);
+    void set_cache_level3(const CacheConfig &);
+    // Branch prediction of pipelined and out-of-order core
+    void set_branch_predictor(const BranchPredictorConfig &);
+    // Out-of-order core, it takes precedence over pipelined one when enabled
+    void set_out_of_order(const OutOfOrderConfig &);
     void set_simulated_endian(Endian endian);
 
     bool pipelined() const;
     bool delay_slot() const;
     enum HazardUnit hazard_unit() const;
+    bool dual_issue() const;
     bool memory_execute_protection() const;
     bool memory_write_protection() const;
     unsigned memory_access_time_read() const;
@@ -161,13 +307,26 @@ public:
     bool osemu_exception_stop() const;
     QString osemu_fs_root() const;
     bool reset_at_compile() const;
+    bool headless() const;
+    bool jit() const;
+    bool fetch_simulated() const;
+    unsigned core_count() const;
+    unsigned smp_quantum() const;
     QString elf() const;
     const CacheConfig &cache_program() const;
     const CacheConfig &cache_data() const;
+    const CacheConfig &cache_level2() const;
+    const CacheConfig &cache_level3() const;
+    const BranchPredictorConfig &branch_predictor() const;
+    const OutOfOrderConfig &out_of_order() const;
     Endian get_simulated_endian() const;
 
     CacheConfig *access_cache_program();
     CacheConfig *access_cache_data();
+    CacheConfig *access_cache_level2();
+    CacheConfig *access_cache_level3();
+    BranchPredictorConfig *access_branch_predictor();
+    OutOfOrderConfig *access_out_of_order();
 
     bool operator==(const MachineConfig &c) const;
     bool operator!=(const MachineConfig &c) const;
@@ -175,14 +334,22 @@ public:
 private:
     bool pipeline, delayslot;
     enum HazardUnit hunit;
+    bool dualissue;
     bool exec_protect, write_protect;
     unsigned mem_acc_read, mem_acc_write, mem_acc_burst;
     bool osem_enable, osem_known_syscall_stop, osem_unknown_syscall_stop;
     bool osem_interrupt_stop, osem_exception_stop;
     bool res_at_compile;
+    bool headless_mode;
+    bool jit_enable;
+    bool fetch_simulation;
+    unsigned n_cores, smp_quant;
     QString osem_fs_root;
     QString elf_path;
     CacheConfig cch_program, cch_data;
+    CacheConfig cch_level2, cch_level3;
+    BranchPredictorConfig bp;
+    OutOfOrderConfig ooo;
     Endian simulated_endian = BIG;
 };
 
@@ -39,11 +39,14 @@
 #define BACKEND_MEMORY_H
 
 #include "common/endian.h"
+#include "iojournal.h"
 #include "machinedefs.h"
 #include "memory/memory_utils.h"
 
 #include <QObject>
 
+class QDataStream;
+
 // Shortcut for enum class values, type is obvious from context.
 using ae = machine::AccessEffects;
 
@@ -131,6 +134,18 @@ public:
      */
     virtual enum LocationStatus location_status(Offset offset) const = 0;
 
+    /**
+     * Store and restore internal state of the device (checkpoints and
+     * execution history). Devices without state keep the empty defaults.
+     */
+    virtual void save_state(QDataStream &out) const;
+    virtual void load_state(QDataStream &in);
+    /**
+     * Devices with effects outside of the simulated machine (terminal)
+     * journal them, see `IoJournal`. Null journal detaches it.
+     */
+    virtual void set_io_journal(IoJournal *journal);
+
     /**
      * Endian of the simulated CPU/memory system.
      * @see BackendMemory docs
@@ -156,6 +171,12 @@ signals:
 inline BackendMemory::BackendMemory(Endian simulated_machine_endian)
     : simulated_machine_endian(simulated_machine_endian) {}
 
+inline void BackendMemory::save_state(QDataStream &) const {}
+
+inline void BackendMemory::load_state(QDataStream &) {}
+
+inline void BackendMemory::set_io_journal(IoJournal *) {}
+
 } // namespace machine
 
 #endif // BACKEND_MEMORY_H
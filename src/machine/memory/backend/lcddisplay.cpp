@@ -39,6 +39,8 @@
 
 #include "common/endian.h"
 
+#include <QDataStream>
+
 #ifdef DEBUG_LCD
     #undef DEBUG_LCD
     #define DEBUG_LCD true
@@ -179,6 +181,28 @@ LcdDisplay::get_pixel_from_address(size_t address) const {
     return std::make_tuple(x, y);
 }
 
+void LcdDisplay::save_state(QDataStream &out) const {
+    out << (quint32)fb_data.size();
+    out.writeRawData((const char *)fb_data.data(), (int)fb_data.size());
+}
+
+void LcdDisplay::load_state(QDataStream &in) {
+    quint32 size;
+    in >> size;
+    if (size != fb_data.size()) {
+        throw SIMULATOR_EXCEPTION(
+            Input, "LCD framebuffer size does not match checkpoint", "");
+    }
+    std::vector<byte> data(size);
+    in.readRawData((char *)data.data(), (int)size);
+    // Go through register writes to let the view repaint changed pixels only
+    for (size_t offset = 0; offset + 1 < size; offset += 2) {
+        uint16_t pixel;
+        memcpy(&pixel, &data[offset], sizeof(pixel));
+        write_raw_pixel(offset, pixel);
+    }
+}
+
 size_t LcdDisplay::get_fb_line_size() const {
     return (fb_bits_per_pixel > 12) ? ((fb_bits_per_pixel + 7) >> 3u) * fb_width
                                     : (fb_bits_per_pixel * fb_width + 7) >> 3u;
@@ -75,6 +75,10 @@ public:
 
     LocationStatus location_status(Offset offset) const override;
 
+    /** Checkpoint support - stores the raw framebuffer content. */
+    void save_state(QDataStream &out) const override;
+    void load_state(QDataStream &in) override;
+
     /**
      * @return  framebuffer width in pixels
      */
@@ -40,6 +40,7 @@
 #include "common/endian.h"
 #include "simulator_exception.h"
 
+#include <QDataStream>
 #include <memory>
 
 namespace machine {
@@ -178,51 +179,67 @@ Memory::Memory(Endian simulated_machine_endian)
 
 Memory::Memory(const Memory &other)
     : BackendMemory(other.simulated_machine_endian) {
-    this->mt_root = copy_section_tree(other.get_memory_tree_root(), 0);
+    this->mt_root = share_section_tree(other.mt_root);
 }
 
 Memory::~Memory() {
     free_section_tree(this->mt_root, 0);
-    delete[] this->mt_root;
 }
 
 void Memory::reset() {
     free_section_tree(this->mt_root, 0);
-    delete[] this->mt_root;
     this->mt_root = allocate_section_tree();
+    change_counter++;
 }
 
 void Memory::reset(const Memory &m) {
+    // Take the reference first, m can share the tree with this memory
+    struct MemoryTreeNode *root = share_section_tree(m.mt_root);
     free_section_tree(this->mt_root, 0);
-    this->mt_root = copy_section_tree(m.get_memory_tree_root(), 0);
+    this->mt_root = root;
+    change_counter++;
 }
 
-MemorySection *Memory::get_section(size_t offset, bool create) const {
-    union MemoryTree *w = this->mt_root;
+MemorySection *Memory::get_section(size_t offset, bool create) {
+    if (!create && get_section(offset) == nullptr) {
+        return nullptr;
+    }
+    struct MemoryTreeNode **w = &this->mt_root;
     size_t row_num;
     // Walk memory tree branch from root to leaf and create new nodes when
-    // needed and requested (`create` flag).
+    // needed. Nodes shared with other memories are copied on the way, as the
+    // returned section can be modified.
     for (size_t i = 0; i < (MEMORY_TREE_DEPTH - 1); i++) {
+        unshare_section_tree(w, i);
         row_num = get_tree_row(offset, i);
-        if (w[row_num].subtree == nullptr) {
+        if ((*w)->row[row_num].subtree == nullptr) {
             // We don't have this tree so allocate it.
-            if (!create) {
-                // If we shouldn't be creating it than just return// null.
-                return nullptr;
-            }
-            w[row_num].subtree = allocate_section_tree();
+            (*w)->row[row_num].subtree = allocate_section_tree();
         }
-        w = w[row_num].subtree;
+        w = &(*w)->row[row_num].subtree;
     }
+    unshare_section_tree(w, MEMORY_TREE_DEPTH - 1);
     row_num = get_tree_row(offset, MEMORY_TREE_DEPTH - 1);
-    if (w[row_num].sec == nullptr) {
-        if (!create) {
+    MemorySection *&sec = (*w)->row[row_num].sec;
+    if (sec == nullptr) {
+        sec = new MemorySection(MEMORY_SECTION_SIZE, simulated_machine_endian);
+    } else if (sec->refs > 1) {
+        MemorySection *copy = new MemorySection(*sec);
+        release_section(sec);
+        sec = copy;
+    }
+    return sec;
+}
+
+const MemorySection *Memory::get_section(size_t offset) const {
+    const struct MemoryTreeNode *w = this->mt_root;
+    for (size_t i = 0; i < (MEMORY_TREE_DEPTH - 1); i++) {
+        w = w->row[get_tree_row(offset, i)].subtree;
+        if (w == nullptr) {
             return nullptr;
         }
-        w[row_num].sec
-            = new MemorySection(MEMORY_SECTION_SIZE, simulated_machine_endian);
     }
-    return w[row_num].sec;
+    return w->row[get_tree_row(offset, MEMORY_TREE_DEPTH - 1)].sec;
 }
 
 size_t get_section_offset_mask(size_t addr) {
@@ -255,7 +272,7 @@ ReadResult Memory::read(
         [this](
             void *_destination, Offset _source, size_t _size,
             ReadOptions _options) -> ReadResult {
-            MemorySection *section = this->get_section(_source, false);
+            const MemorySection *section = this->get_section(_source);
             if (section == nullptr) {
                 memset(_destination, 0, _size);
                 // TODO Warning read of uninitialized memory
@@ -280,51 +297,67 @@ bool Memory::operator!=(const Memory &m) const {
     return !this->operator==(m);
 }
 
-const union machine::MemoryTree *Memory::get_memory_tree_root() const {
+const struct machine::MemoryTreeNode *Memory::get_memory_tree_root() const {
     return this->mt_root;
 }
 
-union machine::MemoryTree *Memory::allocate_section_tree() {
-    auto *mt = new union MemoryTree[MEMORY_TREE_ROW_SIZE];
-    memset(mt, 0, sizeof *mt * MEMORY_TREE_ROW_SIZE);
-    return mt;
+struct machine::MemoryTreeNode *Memory::allocate_section_tree() {
+    return new MemoryTreeNode;
 }
 
-void Memory::free_section_tree(union MemoryTree *mt, size_t depth) {
+void Memory::free_section_tree(struct MemoryTreeNode *mt, size_t depth) {
+    if (mt == nullptr || --mt->refs != 0) {
+        return; // Still used by other memory
+    }
     if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
-        for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
-            if (mt[i].subtree != nullptr) {
-                free_section_tree(mt[i].subtree, depth + 1);
-                delete[] mt[i].subtree;
-            }
+        for (auto &entry : mt->row) {
+            free_section_tree(entry.subtree, depth + 1);
         }
     } else { // Following level is memory section
-        for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
-            delete mt[i].sec;
+        for (auto &entry : mt->row) {
+            release_section(entry.sec);
         }
     }
+    delete mt;
+}
+
+struct machine::MemoryTreeNode *
+Memory::share_section_tree(struct MemoryTreeNode *mt) {
+    if (mt != nullptr) {
+        mt->refs++;
+    }
+    return mt;
+}
+
+void Memory::release_section(MemorySection *sec) {
+    if (sec != nullptr && --sec->refs == 0) {
+        delete sec;
+    }
 }
 
 bool Memory::compare_section_tree(
-    const union MemoryTree *mt1,
-    const union MemoryTree *mt2,
+    const struct MemoryTreeNode *mt1,
+    const struct MemoryTreeNode *mt2,
     size_t depth) {
+    if (mt1 == mt2) {
+        return true; // Shared or both missing
+    }
+    if (mt1 == nullptr || mt2 == nullptr) {
+        return false;
+    }
     if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
         for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
-            if (((mt1[i].subtree == nullptr || mt2[i].subtree == nullptr)
-                 && mt1[i].subtree != mt2[i].subtree)
-                || (mt1[i].subtree != nullptr && mt2[i].subtree != nullptr
-                    && !compare_section_tree(
-                        mt1[i].subtree, mt2[i].subtree, depth + 1))) {
+            if (!compare_section_tree(
+                    mt1->row[i].subtree, mt2->row[i].subtree, depth + 1)) {
                 return false;
             }
         }
     } else { // Following level is memory section
         for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
-            if (((mt1[i].sec == nullptr || mt2[i].sec == nullptr)
-                 && mt1[i].sec != mt2[i].sec)
-                || (mt1[i].sec != nullptr && mt2[i].sec != nullptr
-                    && *mt1[i].sec != *mt2[i].sec)) {
+            const MemorySection *sec1 = mt1->row[i].sec;
+            const MemorySection *sec2 = mt2->row[i].sec;
+            if (sec1 != sec2
+                && (sec1 == nullptr || sec2 == nullptr || *sec1 != *sec2)) {
                 return false;
             }
         }
@@ -332,24 +365,75 @@ bool Memory::compare_section_tree(
     return true;
 }
 
-union machine::MemoryTree *
-Memory::copy_section_tree(const union MemoryTree *mt, size_t depth) {
-    union MemoryTree *nmt = allocate_section_tree();
-    if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
-        for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
-            if (mt[i].subtree != nullptr) {
-                nmt[i].subtree = copy_section_tree(mt[i].subtree, depth + 1);
-            }
+/**
+ * Copies one node of the tree, the children are shared with the original.
+ */
+struct machine::MemoryTreeNode *
+Memory::copy_section_tree(const struct MemoryTreeNode *mt, size_t depth) {
+    struct MemoryTreeNode *nmt = allocate_section_tree();
+    for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
+        if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
+            nmt->row[i].subtree = share_section_tree(mt->row[i].subtree);
+        } else if (mt->row[i].sec != nullptr) { // Following level is section
+            mt->row[i].sec->refs++;
+            nmt->row[i].sec = mt->row[i].sec;
         }
-    } else { // Following level is memory section
-        for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
-            if (mt[i].sec != nullptr) {
-                nmt[i].sec = new MemorySection(*mt[i].sec);
+    }
+    return nmt;
+}
+
+void Memory::unshare_section_tree(struct MemoryTreeNode **mt, size_t depth) {
+    if ((*mt)->refs > 1) {
+        struct MemoryTreeNode *copy = copy_section_tree(*mt, depth);
+        free_section_tree(*mt, depth);
+        *mt = copy;
+    }
+}
+
+void Memory::collect_sections(
+    const struct MemoryTreeNode *mt,
+    size_t depth,
+    uint32_t base,
+    std::vector<std::pair<uint32_t, const MemorySection *>> &sections) {
+    size_t shift = tree_row_bit_offset(depth);
+    for (size_t i = 0; i < MEMORY_TREE_ROW_SIZE; i++) {
+        uint32_t addr = base | (uint32_t)(i << shift);
+        if (depth < (MEMORY_TREE_DEPTH - 1)) { // Following level is memory tree
+            if (mt->row[i].subtree != nullptr) {
+                collect_sections(mt->row[i].subtree, depth + 1, addr, sections);
             }
+        } else if (mt->row[i].sec != nullptr) { // Following level is section
+            sections.emplace_back(addr, mt->row[i].sec);
         }
     }
-    return nmt;
 }
+
+void Memory::save_state(QDataStream &out) const {
+    std::vector<std::pair<uint32_t, const MemorySection *>> sections;
+    collect_sections(this->mt_root, 0, 0, sections);
+    out << (quint32)MEMORY_SECTION_SIZE << (quint32)sections.size();
+    for (const auto &sec : sections) {
+        out << (quint32)sec.first;
+        out.writeRawData((const char *)sec.second->data(), MEMORY_SECTION_SIZE);
+    }
+}
+
+void Memory::load_state(QDataStream &in) {
+    quint32 section_size, count, addr;
+    in >> section_size >> count;
+    if (section_size != MEMORY_SECTION_SIZE) {
+        throw SIMULATOR_EXCEPTION(
+            Input, "Checkpoint memory format mismatch",
+            QString("Memory section size: ") + QString::number(section_size));
+    }
+    reset();
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        in >> addr;
+        MemorySection *sec = get_section(addr, true);
+        in.readRawData((char *)sec->dt.data(), MEMORY_SECTION_SIZE);
+    }
+}
+
 LocationStatus Memory::location_status(Offset offset) const {
     UNUSED(offset)
     // Lazy allocation of memory is only internal implementation detail.
@@ -47,6 +47,7 @@
 #include "utils.h"
 
 #include <QObject>
+#include <atomic>
 #include <cstdint>
 
 namespace machine {
@@ -82,7 +83,11 @@ public:
     bool operator!=(const MemorySection &) const;
 
 private:
+    friend class Memory;
+
     std::vector<byte> dt;
+    // Number of memory trees sharing this section (copy on write)
+    std::atomic<uint32_t> refs { 1 };
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -100,11 +105,25 @@ constexpr size_t MEMORY_TREE_ROW_SIZE = (1u << MEMORY_TREE_BITS);
 constexpr size_t MEMORY_TREE_DEPTH
     = ((32 - MEMORY_SECTION_BITS) / MEMORY_TREE_BITS);
 
+struct MemoryTreeNode;
+
 union MemoryTree {
-    union MemoryTree *subtree;
+    struct MemoryTreeNode *subtree;
     MemorySection *sec;
 };
 
+/**
+ * One row of the lookup tree.
+ *
+ * Rows and sections are shared between copies of the memory and are copied
+ * only when written (copy on write). Copy of the memory is therefore O(1) and
+ * the cost is paid only for the parts of the tree modified later.
+ */
+struct MemoryTreeNode {
+    std::atomic<uint32_t> refs { 1 };
+    union MemoryTree row[MEMORY_TREE_ROW_SIZE] {};
+};
+
 /**
  * NOTE: Internal endian of memory must be the same as endian of the whole
  * simulated machine. Therefore it does not have internal_endian field.
@@ -115,14 +134,17 @@ public:
     // This is dummy constructor for qt internal uses only.
     Memory();
     explicit Memory(Endian simulated_machine_endian);
-    Memory(const Memory &);
+    Memory(const Memory &); // Shares content with the original, O(1)
     ~Memory() override;
     void reset(); // Reset whole content of memory (removes old tree and creates
                   // new one)
-    void reset(const Memory &);
+    void reset(const Memory &); // Shares content with given memory, O(1)
 
-    // returns section containing given address
-    MemorySection *get_section(size_t offset, bool create) const;
+    // returns section containing given address, the section is not shared
+    // with other memories and can be modified
+    MemorySection *get_section(size_t offset, bool create);
+    // returns section containing given address for read only access
+    const MemorySection *get_section(size_t offset) const;
 
     WriteResult write(
         Offset destination,
@@ -141,19 +163,31 @@ public:
     bool operator==(const Memory &) const;
     bool operator!=(const Memory &) const;
 
-    const union MemoryTree *get_memory_tree_root() const;
+    const struct MemoryTreeNode *get_memory_tree_root() const;
+
+    // Checkpoint support, populated sections are stored as raw images
+    void save_state(QDataStream &out) const override;
+    void load_state(QDataStream &in) override;
 
 private:
-    union MemoryTree *mt_root;
+    struct MemoryTreeNode *mt_root;
     uint32_t change_counter = 0;
-    static union MemoryTree *allocate_section_tree();
-    static void free_section_tree(union MemoryTree *, size_t depth);
+    static struct MemoryTreeNode *allocate_section_tree();
+    static void free_section_tree(struct MemoryTreeNode *, size_t depth);
+    static struct MemoryTreeNode *share_section_tree(struct MemoryTreeNode *);
     static bool compare_section_tree(
-        const union MemoryTree *,
-        const union MemoryTree *,
+        const struct MemoryTreeNode *,
+        const struct MemoryTreeNode *,
         size_t depth);
-    static union MemoryTree *
-    copy_section_tree(const union MemoryTree *, size_t depth);
+    static struct MemoryTreeNode *
+    copy_section_tree(const struct MemoryTreeNode *, size_t depth);
+    static void unshare_section_tree(struct MemoryTreeNode **, size_t depth);
+    static void release_section(MemorySection *);
+    static void collect_sections(
+        const struct MemoryTreeNode *,
+        size_t depth,
+        uint32_t base,
+        std::vector<std::pair<uint32_t, const MemorySection *>> &sections);
     uint32_t get_change_counter() const;
 };
 } // namespace machine
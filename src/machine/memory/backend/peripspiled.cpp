@@ -39,6 +39,8 @@
 
 #include "common/endian.h"
 
+#include <QDataStream>
+
 using namespace machine;
 
 constexpr size_t SPILED_REG_LED_LINE_o = 0x004;
@@ -163,6 +165,33 @@ void PeripSpiLed::knob_update_notify(uint32_t val, uint32_t mask, size_t shift)
         ae::INTERNAL);
 }
 
+void PeripSpiLed::save_state(QDataStream &out) const {
+    out << (quint32)spiled_reg_led_line << (quint32)spiled_reg_led_rgb1
+        << (quint32)spiled_reg_led_rgb2 << (quint32)spiled_reg_led_kbdwr_direct
+        << (quint32)spiled_reg_kbdrd_knobs_direct
+        << (quint32)spiled_reg_knobs_8bit;
+}
+
+void PeripSpiLed::load_state(QDataStream &in) {
+    quint32 val;
+    uint32_t *regs[] = { &spiled_reg_led_line,
+                         &spiled_reg_led_rgb1,
+                         &spiled_reg_led_rgb2,
+                         &spiled_reg_led_kbdwr_direct,
+                         &spiled_reg_kbdrd_knobs_direct,
+                         &spiled_reg_knobs_8bit };
+    for (uint32_t *reg : regs) {
+        in >> val;
+        *reg = val;
+    }
+    emit led_line_changed(spiled_reg_led_line);
+    emit led_rgb1_changed(spiled_reg_led_rgb1);
+    emit led_rgb2_changed(spiled_reg_led_rgb2);
+    emit external_backend_change_notify(
+        this, SPILED_REG_LED_LINE_o, SPILED_REG_KNOBS_8BIT_o + 3,
+        ae::INTERNAL);
+}
+
 void PeripSpiLed::red_knob_update(int val) {
     knob_update_notify(val, 0xff, 16);
 }
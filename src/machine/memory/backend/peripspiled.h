@@ -85,6 +85,10 @@ public:
 
     LocationStatus location_status(Offset offset) const override;
 
+    /** Checkpoint support - stores the device registers. */
+    void save_state(QDataStream &out) const override;
+    void load_state(QDataStream &in) override;
+
 private:
     uint32_t read_reg(Offset source) const;
     bool write_reg(Offset destination, uint32_t value);
@@ -39,6 +39,8 @@
 
 #include "common/endian.h"
 
+#include <QDataStream>
+
 using ae = machine::AccessEffects; // For enum values, type is obvious from
                                    // context.
 
@@ -64,12 +66,26 @@ SerialPort::SerialPort(Endian simulated_machine_endian)
 
 SerialPort::~SerialPort() = default;
 
-void SerialPort::pool_rx_byte() const {
+void SerialPort::pool_rx_byte(bool async) const {
     unsigned int byte = 0;
     bool available = false;
     if (!(rx_st_reg & SERP_RX_ST_REG_READY_m)) {
         rx_st_reg |= SERP_RX_ST_REG_READY_m;
-        emit rx_byte_pool(0, byte, available);
+        int32_t result;
+        if (!async && io_journal != nullptr
+            && io_journal->replay(IoJournal::OP_SERIAL_RX, result)) {
+            // Input has been consumed by the original execution
+            available = result >= 0;
+            byte = result;
+        } else {
+            emit rx_byte_pool(0, byte, available);
+            // Asynchronous checks without input have no effect
+            if (io_journal != nullptr && (available || !async)) {
+                io_journal->record(
+                    async ? IoJournal::OP_SERIAL_RX_ASYNC : IoJournal::OP_SERIAL_RX,
+                    available ? (int32_t)byte : -1);
+            }
+        }
         if (available) {
             change_counter++;
             rx_data_reg = byte;
@@ -119,15 +135,15 @@ void SerialPort::update_rx_irq() const {
     }
 }
 
-void SerialPort::rx_queue_check_internal() const {
+void SerialPort::rx_queue_check_internal(bool async) const {
     if (rx_st_reg & SERP_RX_ST_REG_IE_m) {
-        pool_rx_byte();
+        pool_rx_byte(async);
     }
     update_rx_irq();
 }
 
 void SerialPort::rx_queue_check() const {
-    rx_queue_check_internal();
+    rx_queue_check_internal(true);
     emit external_backend_change_notify(
         this, SERP_RX_ST_REG_o, SERP_RX_DATA_REG_o + 3, ae::INTERNAL);
 }
@@ -195,10 +211,18 @@ bool SerialPort::write_reg(Offset destination, uint32_t value) {
             tx_st_reg |= value & SERP_TX_ST_REG_IE_m;
             update_tx_irq();
             return true;
-        case SERP_TX_DATA_REG_o:
-            emit tx_byte(value & 0xffu);
+        case SERP_TX_DATA_REG_o: {
+            int32_t result;
+            if (io_journal == nullptr
+                || !io_journal->replay(IoJournal::OP_SERIAL_TX, result)) {
+                emit tx_byte(value & 0xffu);
+                if (io_journal != nullptr) {
+                    io_journal->record(IoJournal::OP_SERIAL_TX, 0);
+                }
+            }
             update_tx_irq();
             return true;
+        }
         default:
             printf(
                 "WARNING: Serial port - write out of range (at 0x%lu).\n",
@@ -229,6 +253,27 @@ LocationStatus SerialPort::location_status(Offset offset) const {
     }
 }
 
+void SerialPort::save_state(QDataStream &out) const {
+    out << (quint32)tx_st_reg << (quint32)rx_st_reg << (quint32)rx_data_reg;
+}
+
+void SerialPort::load_state(QDataStream &in) {
+    quint32 tx_st, rx_st, rx_data;
+    in >> tx_st >> rx_st >> rx_data;
+    tx_st_reg = tx_st;
+    rx_st_reg = rx_st;
+    rx_data_reg = rx_data;
+    change_counter++;
+    update_rx_irq();
+    update_tx_irq();
+    emit external_backend_change_notify(
+        this, SERP_RX_ST_REG_o, SERP_TX_DATA_REG_o + 3, ae::INTERNAL);
+}
+
+void SerialPort::set_io_journal(IoJournal *journal) {
+    io_journal = journal;
+}
+
 uint32_t SerialPort::get_change_counter() const {
     return change_counter;
 }
@@ -76,11 +76,18 @@ public:
 
     LocationStatus location_status(Offset offset) const override;
 
+    /** Checkpoint support - stores the device registers. */
+    void save_state(QDataStream &out) const override;
+    void load_state(QDataStream &in) override;
+    /** Received and sent bytes are journaled for the execution history. */
+    void set_io_journal(IoJournal *journal) override;
+
 private:
     uint32_t read_reg(Offset source, AccessEffects type) const;
     bool write_reg(Offset destination, uint32_t value);
-    void rx_queue_check_internal() const;
-    void pool_rx_byte() const;
+    // Asynchronous check comes from outside while the core is not running
+    void rx_queue_check_internal(bool async = false) const;
+    void pool_rx_byte(bool async = false) const;
     void update_rx_irq() const;
     void update_tx_irq() const;
     uint32_t get_change_counter() const;
@@ -95,6 +102,7 @@ private:
     mutable uint32_t rx_data_reg = { 0 };
     mutable bool tx_irq_active = false;
     mutable bool rx_irq_active = false;
+    IoJournal *io_journal = nullptr;
 };
 
 } // namespace machine
@@ -37,7 +37,16 @@
 
 #include "memory/cache/cache.h"
 
+#include "memory/cache/cache_coherence.h"
 #include "memory/cache/cache_types.h"
+#include "simulator_exception.h"
+#include "trace/trace_writer.h"
+
+#include <QDataStream>
+#include <algorithm>
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
 using ae = machine::AccessEffects; // For enum values, type is obvious from
                                    // context.
@@ -52,26 +61,25 @@ Cache::Cache(
     uint32_t memory_access_penalty_b)
     : FrontendMemory(memory->simulated_machine_endian)
     , cache_config(config)
+    , assoc(config->associativity())
+    , block_words(config->block_size())
     , mem(memory)
-    , uncached_start(0xf0000000_addr)
-    , uncached_last(0xfffffffe_addr)
     , access_pen_r(memory_access_penalty_r)
     , access_pen_w(memory_access_penalty_w)
     , access_pen_b(memory_access_penalty_b)
-    , replacement_policy(CachePolicy::get_policy_instance(config)) {
+    , replacement_policy(CachePolicy::get_policy_instance(config))
+    , prefetcher(CachePrefetcher::get_prefetcher_instance(config)) {
     // Skip memory allocation if cache is disabled
     if (!config->enabled()) {
         return;
     }
 
-    dt.resize(
-        config->associativity(),
-        std::vector<CacheLine>(
-            config->set_count(),
-            { .valid = false,
-              .dirty = false,
-              .tag = 0,
-              .data = std::vector<uint32_t>(config->block_size()) }));
+    const size_t line_count = assoc * config->set_count();
+    tags.resize(line_count, INVALID_TAG);
+    lines.resize(
+        line_count,
+        { .dirty = false, .exclusive = false, .prefetched = false, .ready = 0 });
+    data.resize(line_count * block_words);
 }
 
 Cache::~Cache() = default;
@@ -81,23 +89,47 @@ WriteResult Cache::write(
     const void *source,
     size_t size,
     WriteOptions options) {
+    if (reference_observer) {
+        reference_observer(
+            { (uint32_t)destination.get_raw(), (uint32_t)size,
+              CacheReference::WRITE });
+    }
     if (!cache_config.enabled() || is_in_uncached_area(destination)
         || is_in_uncached_area(destination + size)) {
-        mem_writes++;
-        emit memory_writes_update(mem_writes);
+        if (coherence != nullptr && !is_in_uncached_area(destination)) {
+            coherence->write_miss(this, destination);
+            coherence->written(this, destination, size);
+        }
+        stats.mem_writes++;
+        emit memory_writes_update(stats.mem_writes);
         update_all_statistics();
         return mem->write(destination, source, size, options);
     }
 
+    if (coherence != nullptr) {
+        coherence->written(this, destination, size);
+    }
+
     // FIXME: Get rid of the cast
     // access is mostly the same for read and write but one needs to write
     // to the address
     const bool changed
         = access(destination, const_cast<void *>(source), size, WRITE);
 
+    if (prefetcher != nullptr) {
+        // Buffered copies of the written blocks are stale now
+        const size_t block_bytes = cache_config.block_size() * BLOCK_ITEM_SIZE;
+        const uint64_t first = destination.get_raw() / block_bytes;
+        const uint64_t last = (destination.get_raw() + size - 1) / block_bytes;
+        for (uint64_t block = first; block <= last; block++) {
+            stats.prefetch_useless
+                += prefetcher->invalidate(Address(block * block_bytes));
+        }
+    }
+
     if (cache_config.write_policy() != CacheConfig::WP_BACK) {
-        mem_writes++;
-        emit memory_writes_update(mem_writes);
+        stats.mem_writes++;
+        emit memory_writes_update(stats.mem_writes);
         update_all_statistics();
         return mem->write(destination, source, size, options);
     }
@@ -110,10 +142,19 @@ ReadResult Cache::read(
     Address source,
     size_t size,
     ReadOptions options) const {
+    if (reference_observer && options.type != ae::INTERNAL) {
+        reference_observer(
+            { (uint32_t)source.get_raw(), (uint32_t)size,
+              CacheReference::READ });
+    }
     if (!cache_config.enabled() || is_in_uncached_area(source)
         || is_in_uncached_area(source + size)) {
-        mem_reads++;
-        emit memory_reads_update(mem_reads);
+        if (coherence != nullptr && options.type != ae::INTERNAL
+            && !is_in_uncached_area(source)) {
+            coherence->read_miss(this, source);
+        }
+        stats.mem_reads++;
+        emit memory_reads_update(stats.mem_reads);
         update_all_statistics();
         return mem->read(destination, source, size, options);
     }
@@ -131,11 +172,14 @@ ReadResult Cache::read(
 
     return {};
 }
-bool Cache::is_in_uncached_area(Address source) const {
-    return (source >= uncached_start && source <= uncached_last);
+bool Cache::is_in_uncached_area(Address source) {
+    return (source >= 0xf0000000_addr && source <= 0xfffffffe_addr);
 }
 
 void Cache::flush() {
+    if (reference_observer) {
+        reference_observer({ 0, 0, CacheReference::FLUSH });
+    }
     if (!cache_config.enabled()) {
         return;
     }
@@ -144,7 +188,7 @@ void Cache::flush() {
          assoc_index += 1) {
         for (size_t set_index = 0; set_index < cache_config.set_count();
              set_index += 1) {
-            if (dt[assoc_index][set_index].valid) {
+            if (tags[line_index(assoc_index, set_index)] != INVALID_TAG) {
                 kick(assoc_index, set_index);
                 emit cache_update(
                     assoc_index, set_index, 0, false, false, 0, nullptr, false);
@@ -159,26 +203,32 @@ void Cache::sync() {
     flush();
 }
 
+void Cache::access_hint(Address inst_addr, uint32_t cycle) const {
+    hint_inst_addr = inst_addr;
+    hint_cycle = cycle;
+    hint_valid = true;
+    mem->access_hint(inst_addr, cycle);
+}
+
 void Cache::reset() {
     // Set all cells to invalid
     if (cache_config.enabled()) {
-        for (auto &set : dt) {
-            for (auto &block : set) {
-                block.valid = false;
-            }
+        std::fill(tags.begin(), tags.end(), INVALID_TAG);
+        std::fill(
+            lines.begin(), lines.end(),
+            CacheLine { .dirty = false,
+                        .exclusive = false,
+                        .prefetched = false,
+                        .ready = 0 });
+        if (prefetcher != nullptr) {
+            prefetcher->reset();
         }
-        // Note: We don't have to zero replacement policy data as those are
-        // zeroed when first used on invalid cell.
+        // Policy state refers to the lines which are gone now
+        replacement_policy->reset();
     }
 
-    hit_read = 0;
-    hit_write = 0;
-    miss_read = 0;
-    miss_write = 0;
-    mem_reads = 0;
-    mem_writes = 0;
-    burst_reads = 0;
-    burst_writes = 0;
+    stats = {};
+    hint_valid = false;
 
     emit hit_update(get_hit_count());
     emit miss_update(get_miss_count());
@@ -198,18 +248,114 @@ void Cache::reset() {
     }
 }
 
+void Cache::save_state(QDataStream &out) const {
+    out << (quint32)stats.hit_read << (quint32)stats.miss_read
+        << (quint32)stats.hit_write << (quint32)stats.miss_write
+        << (quint32)stats.mem_reads << (quint32)stats.mem_writes
+        << (quint32)stats.burst_reads << (quint32)stats.burst_writes
+        << (quint32)stats.prefetches << (quint32)stats.prefetch_useful
+        << (quint32)stats.prefetch_late << (quint32)stats.prefetch_useless;
+    if (!cache_config.enabled()) {
+        return;
+    }
+    out << (quint32)cache_config.associativity()
+        << (quint32)cache_config.set_count()
+        << (quint32)cache_config.block_size();
+    // Way by way, as the lines were stored before the set-major layout
+    for (size_t way = 0; way < assoc; way++) {
+        for (size_t row = 0; row < cache_config.set_count(); row++) {
+            const size_t index = line_index(way, row);
+            const CacheLine &line = lines[index];
+            const bool valid = tags[index] != INVALID_TAG;
+            out << valid << line.dirty << line.prefetched << (quint32)line.ready
+                << (quint64)(valid ? tags[index] : 0);
+            const uint32_t *block = line_data(index);
+            for (size_t col = 0; col < block_words; col++) {
+                out << (quint32)block[col];
+            }
+        }
+    }
+    replacement_policy->save_state(out);
+    if (prefetcher != nullptr) {
+        prefetcher->save_state(out);
+    }
+}
+
+void Cache::load_state(QDataStream &in) {
+    quint32 val;
+    uint32_t *counters[]
+        = { &stats.hit_read,   &stats.miss_read,  &stats.hit_write,
+            &stats.miss_write, &stats.mem_reads,  &stats.mem_writes,
+            &stats.burst_reads, &stats.burst_writes, &stats.prefetches,
+            &stats.prefetch_useful, &stats.prefetch_late,
+            &stats.prefetch_useless };
+    for (uint32_t *counter : counters) {
+        in >> val;
+        *counter = val;
+    }
+    if (cache_config.enabled()) {
+        quint32 assoc, sets, block;
+        in >> assoc >> sets >> block;
+        if (assoc != cache_config.associativity()
+            || sets != cache_config.set_count()
+            || block != cache_config.block_size()) {
+            throw SIMULATOR_EXCEPTION(
+                Input, "Cache geometry does not match checkpoint", "");
+        }
+        bool valid;
+        quint64 tag;
+        for (size_t way = 0; way < assoc; way++) {
+            for (size_t row = 0; row < cache_config.set_count(); row++) {
+                const size_t index = line_index(way, row);
+                CacheLine &line = lines[index];
+                in >> valid >> line.dirty >> line.prefetched >> val >> tag;
+                line.ready = val;
+                tags[index] = valid ? tag : INVALID_TAG;
+                uint32_t *block = line_data(index);
+                for (size_t col = 0; col < block_words; col++) {
+                    in >> val;
+                    block[col] = val;
+                }
+            }
+        }
+        replacement_policy->load_state(in);
+        if (prefetcher != nullptr) {
+            prefetcher->load_state(in);
+        }
+    }
+    change_counter++;
+    publish_state();
+}
+
+void Cache::publish_state() const {
+    emit hit_update(get_hit_count());
+    emit miss_update(get_miss_count());
+    emit memory_reads_update(get_read_count());
+    emit memory_writes_update(get_write_count());
+    update_all_statistics();
+
+    if (cache_config.enabled()) {
+        for (size_t way = 0; way < assoc; way++) {
+            for (size_t row = 0; row < cache_config.set_count(); row++) {
+                const size_t index = line_index(way, row);
+                const bool valid = tags[index] != INVALID_TAG;
+                emit cache_update(
+                    way, row, 0, valid, lines[index].dirty,
+                    valid ? tags[index] : 0, line_data(index), false);
+            }
+        }
+    }
+}
+
 void Cache::internal_read(Address source, void *destination, size_t size) const {
     CacheLocation loc = compute_location(source);
-    for (size_t assoc_index = 0; assoc_index < cache_config.associativity();
-         assoc_index++) {
-        if (dt[assoc_index][loc.row].valid
-            && dt[assoc_index][loc.row].tag == loc.tag) {
-            memcpy(
-                destination,
-                (byte *)&dt[assoc_index][loc.row].data[loc.col] + loc.byte,
-                size);
-            return;
-        }
+    const size_t way = find_block_index(loc);
+    if (way < assoc) {
+        memcpy(
+            destination,
+            (byte *)&line_data(line_index(way, loc.row))[loc.col] + loc.byte,
+            size);
+        return;
     }
     memset(destination, 0, size); // TODO is this correct
 }
@@ -233,9 +379,15 @@ bool Cache::access(
         // allocate
         if (access_type == WRITE
             && cache_config.write_policy() == CacheConfig::WP_THROUGH_NOALLOC) {
-            miss_write++;
+            if (coherence != nullptr) {
+                coherence->write_miss(this, address);
+            }
+            stats.miss_write++;
             emit miss_update(get_miss_count());
             update_all_statistics();
+            if (trace != nullptr) {
+                trace->cache(trace_data_cache, address.get_raw(), false, true);
+            }
 
             const size_t size_overflow
                 = calculate_overflow_to_next_blocks(size, loc);
@@ -258,42 +410,93 @@ bool Cache::access(
             "Probably unimplemented replacement policy");
     }
 
-    struct CacheLine &cd = dt[way][loc.row];
+    const size_t index = line_index(way, loc.row);
+    struct CacheLine &cd = lines[index];
+    uint32_t *block = line_data(index);
+    const bool miss = tags[index] == INVALID_TAG;
 
+    if (trace != nullptr) {
+        trace->cache(trace_data_cache, address.get_raw(), !miss, access_type == WRITE);
+    }
     // Update statistics and otherwise read from memory
-    if (cd.valid) {
+    const Address base = calc_base_address(loc.tag, loc.row);
+    bool prefetch_hit = false;
+    uint32_t ready = 0;
+    if (!miss) {
+        if (cd.prefetched) {
+            prefetch_hit = true;
+            prefetch_used(cd.ready);
+            cd.prefetched = false;
+        }
         if (access_type == WRITE) {
-            hit_write++;
+            stats.hit_write++;
+            if (!cd.exclusive && coherence != nullptr) {
+                coherence->upgrade(this, address);
+            }
+            cd.exclusive = true;
         } else {
-            hit_read++;
+            stats.hit_read++;
         }
         emit hit_update(get_hit_count());
         update_all_statistics();
     } else {
-        if (access_type == WRITE) {
-            miss_write++;
+        // Block supplied by the prefetch buffer is counted as a hit
+        prefetch_hit = prefetcher != nullptr && prefetcher->is_buffered()
+                       && prefetcher->take(base, block, ready);
+        if (prefetch_hit) {
+            if (access_type == WRITE) {
+                stats.hit_write++;
+            } else {
+                stats.hit_read++;
+            }
+            emit hit_update(get_hit_count());
         } else {
-            miss_read++;
+            if (access_type == WRITE) {
+                stats.miss_write++;
+            } else {
+                stats.miss_read++;
+            }
+            emit miss_update(get_miss_count());
+        }
+
+        // Other caches write back the modified block before it is loaded
+        bool shared = false;
+        if (coherence != nullptr) {
+            if (access_type == WRITE) {
+                coherence->write_miss(this, address);
+            } else {
+                shared = coherence->read_miss(this, address);
+            }
         }
-        emit miss_update(get_miss_count());
 
-        mem->read(
-            cd.data.data(), calc_base_address(loc.tag, loc.row),
-            cache_config.block_size() * BLOCK_ITEM_SIZE,
-            { .type = ae::REGULAR });
+        bool moved_dirty = false;
+        if (prefetch_hit) {
+            prefetch_used(ready);
+        } else if (lower_exclusive) {
+            moved_dirty = lower_level->move_up(
+                base, block,
+                cache_config.write_policy() == CacheConfig::WP_BACK);
+        } else {
+            mem->read(
+                block, base, block_words * BLOCK_ITEM_SIZE,
+                { .type = ae::REGULAR });
+        }
 
-        cd.valid = true;
-        cd.dirty = false;
-        cd.tag = loc.tag;
+        tags[index] = loc.tag;
+        cd.dirty = moved_dirty;
+        cd.exclusive = !shared;
+        cd.prefetched = false;
 
         change_counter += cache_config.block_size();
-        mem_reads += cache_config.block_size();
-        burst_reads += cache_config.block_size() - 1;
-        emit memory_reads_update(mem_reads);
+        if (!prefetch_hit) {
+            stats.mem_reads += cache_config.block_size();
+            stats.burst_reads += cache_config.block_size() - 1;
+            emit memory_reads_update(stats.mem_reads);
+        }
         update_all_statistics();
     }
 
-    replacement_policy->update_stats(way, loc.row, cd.valid);
+    replacement_policy->update_stats(way, loc.row, true);
 
     const size_t size_overflow = calculate_overflow_to_next_blocks(size, loc);
     const size_t size_within_block = size - size_overflow;
@@ -301,16 +504,16 @@ bool Cache::access(
     bool changed = false;
 
     if (access_type == READ) {
-        memcpy(buffer, (byte *)&cd.data[loc.col] + loc.byte, size_within_block);
+        memcpy(buffer, (byte *)&block[loc.col] + loc.byte, size_within_block);
     } else if (access_type == WRITE) {
         cd.dirty = true;
         changed = memcmp(
-                      (byte *)&cd.data[loc.col] + loc.byte, buffer,
+                      (byte *)&block[loc.col] + loc.byte, buffer,
                       size_within_block)
                   != 0;
         if (changed) {
             memcpy(
-                ((byte *)&cd.data[loc.col]) + loc.byte, buffer,
+                ((byte *)&block[loc.col]) + loc.byte, buffer,
                 size_within_block);
             change_counter++;
         }
@@ -319,8 +522,11 @@ bool Cache::access(
         = (loc.col * BLOCK_ITEM_SIZE + loc.byte + size_within_block - 1) / BLOCK_ITEM_SIZE;
     for (auto col = loc.col; col <= last_affected_col; col++) {
         emit cache_update(
-            way, loc.row, col, cd.valid, cd.dirty, cd.tag, cd.data.data(),
-            access_type);
+            way, loc.row, col, true, cd.dirty, loc.tag, block, access_type);
+    }
+
+    if (prefetcher != nullptr) {
+        run_prefetcher(address, base, miss, prefetch_hit);
     }
 
     if (size_overflow > 0) {
@@ -342,36 +548,316 @@ size_t Cache::calculate_overflow_to_next_blocks(
 }
 
 size_t Cache::find_block_index(const CacheLocation &loc) const {
-    uint32_t index = 0;
-    while (
-        index < cache_config.associativity()
-        and (!dt[index][loc.row].valid or dt[index][loc.row].tag != loc.tag)) {
-        index++;
+    const uint64_t *set_tags = &tags[loc.row * assoc];
+    size_t way = 0;
+#if defined(__SSE2__)
+    // SSE2 is the x86-64 baseline, so it is used without any build option.
+    // 64-bit compare is not available, both halves of the tag have to match
+    const __m128i key = _mm_set1_epi64x((long long)loc.tag);
+    for (; way + 2 <= assoc; way += 2) {
+        const __m128i eq = _mm_cmpeq_epi32(
+            _mm_loadu_si128((const __m128i *)(set_tags + way)), key);
+        const int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if ((mask & 0x3) == 0x3) {
+            return way;
+        }
+        if ((mask & 0xc) == 0xc) {
+            return way + 1;
+        }
     }
-    return index;
+#endif
+    for (; way < assoc; way++) {
+        if (set_tags[way] == loc.tag) {
+            return way;
+        }
+    }
+    return way;
 }
 
 void Cache::kick(size_t way, size_t row) const {
-    struct CacheLine &cd = dt[way][row];
+    const size_t index = line_index(way, row);
+    struct CacheLine &cd = lines[index];
+    const bool valid = tags[index] != INVALID_TAG;
+    if (valid) {
+        // Upper levels write back their modified copies to this line first
+        invalidate_upper(way, row);
+        if (cd.prefetched) {
+            stats.prefetch_useless++;
+        }
+    }
+    if (valid && lower_exclusive) {
+        lower_level->insert_victim(
+            calc_base_address(tags[index], row), line_data(index),
+            cd.dirty && cache_config.write_policy() == CacheConfig::WP_BACK);
+        stats.mem_writes += cache_config.block_size();
+        stats.burst_writes += cache_config.block_size() - 1;
+        emit memory_writes_update(stats.mem_writes);
+    } else {
+        write_back(way, row);
+    }
+    tags[index] = INVALID_TAG;
+    cd.dirty = false;
+    cd.exclusive = false;
+    cd.prefetched = false;
+
+    change_counter++;
+
+    replacement_policy->update_stats(way, row, false);
+}
+
+void Cache::write_back(size_t way, size_t row) const {
+    const size_t index = line_index(way, row);
+    struct CacheLine &cd = lines[index];
     if (cd.dirty && cache_config.write_policy() == CacheConfig::WP_BACK) {
         mem->write(
-            calc_base_address(cd.tag, row), cd.data.data(),
-            cache_config.block_size() * BLOCK_ITEM_SIZE, {});
-        mem_writes += cache_config.block_size();
-        burst_writes += cache_config.block_size() - 1;
-        emit memory_writes_update(mem_writes);
+            calc_base_address(tags[index], row), line_data(index),
+            block_words * BLOCK_ITEM_SIZE, {});
+        stats.mem_writes += cache_config.block_size();
+        stats.burst_writes += cache_config.block_size() - 1;
+        emit memory_writes_update(stats.mem_writes);
     }
-    cd.valid = false;
     cd.dirty = false;
+}
+
+void Cache::invalidate_upper(size_t way, size_t row) const {
+    if (cache_config.inclusion_policy() != CacheConfig::IP_INCLUSIVE) {
+        return;
+    }
+    const Address base = calc_base_address(tags[line_index(way, row)], row);
+    const size_t size = cache_config.block_size() * BLOCK_ITEM_SIZE;
+    for (const Cache *upper : upper_levels) {
+        const size_t step = upper->cache_config.block_size() * BLOCK_ITEM_SIZE;
+        for (size_t offset = 0; offset < size; offset += step) {
+            upper->snoop(base + offset, true);
+        }
+    }
+}
 
+bool Cache::move_up(Address base, uint32_t *data, bool keep_dirty) const {
+    const size_t size = cache_config.block_size() * BLOCK_ITEM_SIZE;
+    const CacheLocation loc = compute_location(base);
+    const size_t way = find_block_index(loc);
+    if (way >= cache_config.associativity()) {
+        stats.miss_read++;
+        emit miss_update(get_miss_count());
+        mem->read(data, base, size, { .type = ae::REGULAR });
+        stats.mem_reads += cache_config.block_size();
+        stats.burst_reads += cache_config.block_size() - 1;
+        emit memory_reads_update(stats.mem_reads);
+        update_all_statistics();
+        return false;
+    }
+
+    const size_t index = line_index(way, loc.row);
+    struct CacheLine &cd = lines[index];
+    stats.hit_read++;
+    emit hit_update(get_hit_count());
+    if (cd.prefetched) {
+        prefetch_used(cd.ready);
+        cd.prefetched = false;
+    }
+    memcpy(data, line_data(index), size);
+    bool dirty
+        = cd.dirty && cache_config.write_policy() == CacheConfig::WP_BACK;
+    if (!keep_dirty) {
+        write_back(way, loc.row);
+        dirty = false;
+    }
+    tags[index] = INVALID_TAG;
+    cd.dirty = false;
+    cd.exclusive = false;
     change_counter++;
+    replacement_policy->update_stats(way, loc.row, false);
+    emit cache_update(way, loc.row, 0, false, false, 0, nullptr, false);
+    update_all_statistics();
+    return dirty;
+}
 
-    replacement_policy->update_stats(way, row, false);
+void Cache::insert_victim(Address base, const uint32_t *data, bool dirty) const {
+    const size_t size = cache_config.block_size() * BLOCK_ITEM_SIZE;
+    if (dirty && cache_config.write_policy() != CacheConfig::WP_BACK) {
+        mem->write(base, data, size, {});
+        stats.mem_writes += cache_config.block_size();
+        stats.burst_writes += cache_config.block_size() - 1;
+        emit memory_writes_update(stats.mem_writes);
+        dirty = false;
+    }
+    const CacheLocation loc = compute_location(base);
+    size_t way = find_block_index(loc);
+    if (way >= cache_config.associativity()) {
+        way = replacement_policy->select_way_to_evict(loc.row);
+        kick(way, loc.row);
+    }
+
+    const size_t index = line_index(way, loc.row);
+    struct CacheLine &cd = lines[index];
+    memcpy(line_data(index), data, size);
+    cd.dirty = (tags[index] != INVALID_TAG && cd.dirty) || dirty;
+    tags[index] = loc.tag;
+    cd.exclusive = true;
+    cd.prefetched = false;
+    change_counter += cache_config.block_size();
+    replacement_policy->update_stats(way, loc.row, true);
+    emit cache_update(
+        way, loc.row, 0, true, cd.dirty, loc.tag, line_data(index), true);
+    update_all_statistics();
+}
+
+void Cache::add_upper_level(Cache *upper) {
+    SANITY_ASSERT(
+        upper->mem == this, "Upper cache level has to be backed by this cache");
+    upper_levels.push_back(upper);
+    upper->lower_level = this;
+    upper->lower_exclusive
+        = cache_config.enabled() && upper->cache_config.enabled()
+          && cache_config.inclusion_policy() == CacheConfig::IP_EXCLUSIVE
+          && cache_config.block_size() == upper->cache_config.block_size();
+}
+
+void Cache::set_coherence(CacheCoherence *coherence) {
+    this->coherence = coherence;
+}
+
+void Cache::set_reference_observer(ReferenceObserver observer) {
+    reference_observer = std::move(observer);
+}
+
+void Cache::set_trace_writer(TraceWriter *writer, bool data_cache) {
+    trace = writer;
+    trace_data_cache = data_cache;
+}
+
+enum SnoopResult Cache::snoop(Address address, bool invalidate) const {
+    if (!cache_config.enabled()) {
+        return SNOOP_MISS;
+    }
+    const CacheLocation loc = compute_location(address);
+    if (prefetcher != nullptr) {
+        // Buffered copy would not be kept coherent
+        stats.prefetch_useless
+            += prefetcher->invalidate(calc_base_address(loc.tag, loc.row));
+    }
+    const size_t way = find_block_index(loc);
+    if (way >= cache_config.associativity()) {
+        return SNOOP_MISS;
+    }
+    const size_t index = line_index(way, loc.row);
+    struct CacheLine &cd = lines[index];
+    enum SnoopResult res = SNOOP_SHARED;
+    if (cd.dirty && cache_config.write_policy() == CacheConfig::WP_BACK) {
+        res = SNOOP_MODIFIED;
+    }
+    if (invalidate) {
+        kick(way, loc.row);
+        emit cache_update(way, loc.row, 0, false, false, 0, nullptr, false);
+    } else {
+        write_back(way, loc.row);
+        cd.exclusive = false;
+        emit cache_update(
+            way, loc.row, 0, true, cd.dirty, loc.tag, line_data(index), false);
+    }
+    update_all_statistics();
+    return res;
+}
+
+void Cache::run_prefetcher(
+    Address address,
+    Address base,
+    bool miss,
+    bool prefetch_hit) const {
+    // Local list, fetching a block can reenter this cache through the
+    // upper levels
+    std::vector<Address> requests;
+    stats.prefetch_useless += prefetcher->access(
+        { .address = address,
+          .block = base,
+          .inst_addr = hint_valid ? hint_inst_addr : Address::null(),
+          .miss = miss,
+          .prefetch_hit = prefetch_hit },
+        requests);
+    for (Address request : requests) {
+        const CacheLocation loc = compute_location(request);
+        prefetch(calc_base_address(loc.tag, loc.row));
+    }
+    update_all_statistics();
+}
+
+void Cache::prefetch(Address base) const {
+    if (is_in_uncached_area(base)) {
+        return;
+    }
+    const CacheLocation loc = compute_location(base);
+    if (find_block_index(loc) < cache_config.associativity()) {
+        return;
+    }
+    const size_t size = cache_config.block_size() * BLOCK_ITEM_SIZE;
+    const uint32_t ready = hint_valid ? fill_ready_cycle(hint_cycle) : 0;
+
+    // Block is loaded as by a read miss
+    bool shared = false;
+    if (coherence != nullptr) {
+        shared = coherence->read_miss(this, base);
+    }
+    if (prefetcher->is_buffered()) {
+        prefetch_data.resize(cache_config.block_size());
+        if (lower_exclusive) {
+            lower_level->move_up(base, prefetch_data.data(), false);
+        } else {
+            mem->read(prefetch_data.data(), base, size, { .type = ae::REGULAR });
+        }
+        prefetcher->fill(base, prefetch_data.data(), ready);
+    } else {
+        const size_t way = replacement_policy->select_way_to_evict(loc.row);
+        kick(way, loc.row);
+        const size_t index = line_index(way, loc.row);
+        struct CacheLine &cd = lines[index];
+        uint32_t *block = line_data(index);
+        bool moved_dirty = false;
+        if (lower_exclusive) {
+            moved_dirty = lower_level->move_up(
+                base, block,
+                cache_config.write_policy() == CacheConfig::WP_BACK);
+        } else {
+            mem->read(block, base, size, { .type = ae::REGULAR });
+        }
+        tags[index] = loc.tag;
+        cd.dirty = moved_dirty;
+        cd.exclusive = !shared;
+        cd.prefetched = true;
+        cd.ready = ready;
+        change_counter += cache_config.block_size();
+        replacement_policy->update_stats(way, loc.row, true);
+        emit cache_update(
+            way, loc.row, 0, true, cd.dirty, loc.tag, block, false);
+    }
+
+    stats.prefetches++;
+    stats.mem_reads += cache_config.block_size();
+    stats.burst_reads += cache_config.block_size() - 1;
+    emit memory_reads_update(stats.mem_reads);
+}
+
+void Cache::prefetch_used(uint32_t ready) const {
+    if (hint_valid && hint_cycle < ready) {
+        stats.prefetch_late++;
+    } else {
+        stats.prefetch_useful++;
+    }
+}
+
+uint32_t Cache::fill_ready_cycle(uint32_t cycle) const {
+    const uint32_t burst = access_pen_b != 0 ? access_pen_b : access_pen_r;
+    return cycle + access_pen_r + (cache_config.block_size() - 1) * burst;
 }
 
 void Cache::update_all_statistics() const {
     emit statistics_update(
         get_stall_count(), get_speed_improvement(), get_hit_rate());
+    if (prefetcher != nullptr) {
+        emit prefetch_update(
+            stats.prefetches, stats.prefetch_useful, stats.prefetch_late,
+            stats.prefetch_useless);
+    }
 }
 
 Address Cache::calc_base_address(size_t tag, size_t row) const {
@@ -403,17 +889,13 @@ enum LocationStatus Cache::location_status(Address address) const {
     const CacheLocation loc = compute_location(address);
 
     if (cache_config.enabled()) {
-        for (auto const &set : dt) {
-            auto const &block = set[loc.row];
-
-            if (block.valid && block.tag == loc.tag) {
-                if (block.dirty
-                    && cache_config.write_policy() == CacheConfig::WP_BACK) {
-                    return (enum LocationStatus)(
-                        LOCSTAT_CACHED | LOCSTAT_DIRTY);
-                } else {
-                    return LOCSTAT_CACHED;
-                }
+        const size_t way = find_block_index(loc);
+        if (way < assoc) {
+            if (lines[line_index(way, loc.row)].dirty
+                && cache_config.write_policy() == CacheConfig::WP_BACK) {
+                return (enum LocationStatus)(LOCSTAT_CACHED | LOCSTAT_DIRTY);
+            } else {
+                return LOCSTAT_CACHED;
             }
         }
     }
@@ -429,33 +911,71 @@ uint32_t Cache::get_change_counter() const {
 }
 
 uint32_t Cache::get_hit_count() const {
-    return hit_read + hit_write;
+    return stats.hit_read + stats.hit_write;
 }
 
 uint32_t Cache::get_miss_count() const {
-    return miss_read + miss_write;
+    return stats.miss_read + stats.miss_write;
 }
 
 uint32_t Cache::get_read_count() const {
-    return mem_reads;
+    return stats.mem_reads;
 }
 
 uint32_t Cache::get_write_count() const {
-    return mem_writes;
+    return stats.mem_writes;
 }
 
 uint32_t Cache::get_stall_count() const {
+    return stats.stall_count(
+        cache_config, access_pen_r, access_pen_w, access_pen_b);
+}
+
+uint32_t Cache::get_hierarchy_stall_count() const {
+    return get_stall_count()
+           + (lower_level != nullptr ? lower_level->get_hierarchy_stall_count()
+                                     : 0);
+}
+
+double Cache::get_speed_improvement() const {
+    return stats.speed_improvement(
+        cache_config, access_pen_r, access_pen_w, access_pen_b);
+}
+
+double Cache::get_hit_rate() const {
+    return stats.hit_rate();
+}
+
+const CacheStatistics &Cache::get_statistics() const {
+    return stats;
+}
+
+uint32_t CacheStatistics::stall_count(
+    const CacheConfig &config,
+    uint32_t access_pen_r,
+    uint32_t access_pen_w,
+    uint32_t access_pen_b) const {
+    // Fetches of prefetches which were not late overlap with the execution
+    const uint32_t overlapped = prefetches - prefetch_late;
+    const uint32_t reads = mem_reads - overlapped * config.block_size();
+    const uint32_t bursts
+        = burst_reads - overlapped * (config.block_size() - 1);
     uint32_t st_cycles
-        = mem_reads * (access_pen_r - 1) + mem_writes * (access_pen_w - 1);
-    st_cycles += (miss_read + miss_write) * cache_config.block_size();
+        = reads * (access_pen_r - 1) + mem_writes * (access_pen_w - 1);
+    st_cycles
+        += (miss_read + miss_write + prefetch_late) * config.block_size();
     if (access_pen_b != 0) {
-        st_cycles -= burst_reads * (access_pen_r - access_pen_b)
+        st_cycles -= bursts * (access_pen_r - access_pen_b)
                      + burst_writes * (access_pen_w - access_pen_b);
     }
     return st_cycles;
 }
 
-double Cache::get_speed_improvement() const {
+double CacheStatistics::speed_improvement(
+    const CacheConfig &config,
+    uint32_t access_pen_r,
+    uint32_t access_pen_w,
+    uint32_t access_pen_b) const {
     uint32_t lookup_time;
     uint32_t mem_access_time;
     uint32_t comp = hit_read + hit_write + miss_read + miss_write;
@@ -463,20 +983,25 @@ double Cache::get_speed_improvement() const {
         return 100.0;
     }
     lookup_time = hit_read + miss_read;
-    if (cache_config.write_policy() == CacheConfig::WP_BACK) {
+    if (config.write_policy() == CacheConfig::WP_BACK) {
         lookup_time += hit_write + miss_write;
     }
-    mem_access_time = mem_reads * access_pen_r + mem_writes * access_pen_w;
+    const uint32_t overlapped = prefetches - prefetch_late;
+    mem_access_time
+        = (mem_reads - overlapped * config.block_size()) * access_pen_r
+          + mem_writes * access_pen_w;
     if (access_pen_b != 0) {
-        mem_access_time -= burst_reads * (access_pen_r - access_pen_b)
-                           + burst_writes * (access_pen_w - access_pen_b);
+        mem_access_time
+            -= (burst_reads - overlapped * (config.block_size() - 1))
+                   * (access_pen_r - access_pen_b)
+               + burst_writes * (access_pen_w - access_pen_b);
     }
     return (
         (double)((miss_read + hit_read) * access_pen_r + (miss_write + hit_write) * access_pen_w)
         / (double)(lookup_time + mem_access_time) * 100);
 }
 
-double Cache::get_hit_rate() const {
+double CacheStatistics::hit_rate() const {
     uint32_t comp = hit_read + hit_write + miss_read + miss_write;
     if (comp == 0) {
         return 0.0;
@@ -484,4 +1009,12 @@ double Cache::get_hit_rate() const {
     return (double)(hit_read + hit_write) / (double)comp * 100.0;
 }
 
+double CacheStatistics::prefetch_accuracy() const {
+    if (prefetches == 0) {
+        return 0.0;
+    }
+    return (double)(prefetch_useful + prefetch_late) / (double)prefetches
+           * 100.0;
+}
+
 } // namespace machine
@@ -40,16 +40,54 @@
 
 #include "machineconfig.h"
 #include "memory/cache/cache_policy.h"
+#include "memory/cache/cache_prefetcher.h"
 #include "memory/cache/cache_types.h"
 #include "memory/frontend_memory.h"
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 
+class QDataStream;
+
 namespace machine {
 
+class CacheCoherence;
+class TraceWriter;
+
 constexpr size_t BLOCK_ITEM_SIZE = sizeof(uint32_t);
 
+/**
+ * Counters of cache accesses and of the backing memory traffic caused by them.
+ * Derived statistics take the memory access penalties (in cycles) and follow
+ * the description of `Cache` constructor.
+ *
+ * Prefetched blocks are counted in the memory traffic. Prefetch is useful
+ * when the block is accessed after the fetch completed, late when accessed
+ * before and useless when it is evicted or dropped without an access. Only
+ * late prefetches stall, their block is counted as a miss by `stall_count`.
+ */
+struct CacheStatistics {
+    uint32_t hit_read = 0, miss_read = 0, hit_write = 0, miss_write = 0,
+             mem_reads = 0, mem_writes = 0, burst_reads = 0, burst_writes = 0;
+    uint32_t prefetches = 0, prefetch_useful = 0, prefetch_late = 0,
+             prefetch_useless = 0;
+
+    uint32_t stall_count(
+        const CacheConfig &config,
+        uint32_t access_pen_r,
+        uint32_t access_pen_w,
+        uint32_t access_pen_b) const;
+    double speed_improvement(
+        const CacheConfig &config,
+        uint32_t access_pen_r,
+        uint32_t access_pen_w,
+        uint32_t access_pen_b) const;
+    double hit_rate() const;
+    // Used (useful or late) prefetches in percents of issued ones
+    double prefetch_accuracy() const;
+};
+
 /**
  * NOTE ON TERMINOLOGY:
  * N-way set associative cache consist of N ways (where N is degree
@@ -82,8 +120,8 @@ public:
      *                                  only)
      *
      * NOTE: Memory access penalties apply only to statistics and are not taken
-     * into account during simulation itself. There is no point in doing so
-     * without superscalar execution.
+     * into account by in-order cores. Out-of-order core uses the stall cycles
+     * as access latencies, see `CoreOutOfOrder::set_memory_timing`.
      */
     Cache(
         FrontendMemory *memory,
@@ -110,6 +148,9 @@ public:
 
     void flush();         // flush cache
     void sync() override; // Same as flush
+    // Instruction address trains the stride prefetcher, the cycle is used
+    // to tell late prefetches
+    void access_hint(Address inst_addr, uint32_t cycle) const override;
 
     uint32_t get_hit_count() const;       // Number of recorded hits
     uint32_t get_miss_count() const;      // Number of recorded misses
@@ -117,16 +158,64 @@ public:
     uint32_t get_write_count() const;     // Number backing/main memory writes
     uint32_t get_stall_count() const;     // Number of wasted cycles in
                                           // memory waiting statistic
+    uint32_t get_hierarchy_stall_count() const; // Stalls of this cache and
+                                                // all levels below it
     double get_speed_improvement() const; // Speed improvement in percents in
                                           // comare with no used cache
     double get_hit_rate() const;          // Usage efficiency in percents
+    const CacheStatistics &get_statistics() const;
 
     void reset(); // Reset whole state of cache
 
+    /**
+     * Checkpoint support. Lines, statistics and replacement policy state are
+     * stored, the configuration is expected to match on load.
+     */
+    void save_state(QDataStream &out) const;
+    void load_state(QDataStream &in);
+    // Emits statistics and content of all lines, used when the cache was
+    // changed with blocked signals
+    void publish_state() const;
+
     const CacheConfig &get_config() const;
 
     enum LocationStatus location_status(Address address) const override;
 
+    /**
+     * Makes the cache participant of the coherence protocol. Misses and
+     * writes are announced to `coherence` then.
+     */
+    void set_coherence(CacheCoherence *coherence);
+    /**
+     * Snoops bus transaction of another cache. Modified block is written back
+     * to the memory, the block is invalidated or marked as shared.
+     */
+    enum SnoopResult snoop(Address address, bool invalidate) const;
+
+    /**
+     * Makes this cache the next level below `upper`, which has to use this
+     * cache as its backing memory. Inclusion policy of this cache is kept
+     * against all upper levels. Inclusive level invalidates its evicted
+     * blocks in the upper levels. Exclusive level is filled only by blocks
+     * evicted from the upper levels and a block leaves it when it is loaded
+     * to an upper level. Exclusion is kept only against upper levels of the
+     * same block size, others see the level as non-inclusive.
+     */
+    void add_upper_level(Cache *upper);
+
+    using ReferenceObserver = std::function<void(const CacheReference &)>;
+    /**
+     * Observer is called for every read and write requested by the core
+     * (internal accesses are not reported) and for every flush, before the
+     * cache processes it. Used to record reference streams, see `CacheSweep`.
+     */
+    void set_reference_observer(ReferenceObserver observer);
+    // Hits and misses are recorded to the trace as data or program cache ones
+    void set_trace_writer(TraceWriter *writer, bool data_cache);
+
+    // Accesses touching this area (peripherals) bypass the cache
+    static bool is_in_uncached_area(Address source);
+
 signals:
     void hit_update(uint32_t) const;
     void miss_update(uint32_t) const;
@@ -145,20 +234,52 @@ signals:
         bool write) const;
     void memory_writes_update(uint32_t) const;
     void memory_reads_update(uint32_t) const;
+    void prefetch_update(
+        uint32_t issued,
+        uint32_t useful,
+        uint32_t late,
+        uint32_t useless) const;
 
 private:
     const CacheConfig cache_config;
+    const size_t assoc, block_words; // Geometry copied for the lookups
     FrontendMemory *const mem = nullptr;
-    const Address uncached_start;
-    const Address uncached_last;
     const uint32_t access_pen_r, access_pen_w, access_pen_b;
     const std::unique_ptr<CachePolicy> replacement_policy;
+    const std::unique_ptr<CachePrefetcher> prefetcher;
+    CacheCoherence *coherence = nullptr;
+    std::vector<Cache *> upper_levels;
+    Cache *lower_level = nullptr;
+    // Misses are filled from and evicted blocks are moved to the lower level
+    bool lower_exclusive = false;
+    ReferenceObserver reference_observer;
+    TraceWriter *trace = nullptr;
+    bool trace_data_cache = false;
+
+    /**
+     * Lines are stored set-major, line of `way` in `row` has the same index
+     * `row * assoc + way` in all the arrays. Tags of a set are contiguous and
+     * valid state is encoded in them (see `INVALID_TAG`), so the lookup
+     * compares all ways of the set at once. Blocks are kept in a single slab.
+     */
+    mutable std::vector<uint64_t> tags;
+    mutable std::vector<CacheLine> lines;
+    mutable std::vector<uint32_t> data;
 
-    mutable std::vector<std::vector<CacheLine>> dt;
+    size_t line_index(size_t way, size_t row) const {
+        return row * assoc + way;
+    }
+    uint32_t *line_data(size_t index) const {
+        return &data[index * block_words];
+    }
 
-    mutable uint32_t hit_read = 0, miss_read = 0, hit_write = 0, miss_write = 0,
-                     mem_reads = 0, mem_writes = 0, burst_reads = 0,
-                     burst_writes = 0, change_counter = 0;
+    mutable CacheStatistics stats;
+    mutable uint32_t change_counter = 0;
+    // Set by `access_hint` for the following access
+    mutable Address hint_inst_addr;
+    mutable uint32_t hint_cycle = 0;
+    mutable bool hint_valid = false;
+    mutable std::vector<uint32_t> prefetch_data;
 
     void internal_read(Address source, void *destination, size_t size) const;
 
@@ -169,6 +290,34 @@ private:
         AccessType access_type) const;
 
     void kick(size_t way, size_t row) const;
+    void write_back(size_t way, size_t row) const;
+    // Inclusive level removes the block from the upper levels
+    void invalidate_upper(size_t way, size_t row) const;
+
+    /**
+     * Exclusive level hands the block over to the upper level. The block is
+     * read from the backing memory without allocation on miss.
+     *
+     * @param keep_dirty    upper level writes back, modified block is not
+     *                      written here
+     * @return              the block was modified
+     */
+    bool move_up(Address base, uint32_t *data, bool keep_dirty) const;
+    // Exclusive level takes a block evicted from the upper level
+    void insert_victim(Address base, const uint32_t *data, bool dirty) const;
+
+    // Passes the demand access to the prefetcher and fetches requested blocks
+    void run_prefetcher(
+        Address address,
+        Address base,
+        bool miss,
+        bool prefetch_hit) const;
+    // Loads single block to a line or to the prefetcher buffer
+    void prefetch(Address base) const;
+    // Counts the access of prefetched block as useful or late
+    void prefetch_used(uint32_t ready) const;
+    // Cycle the fetch of a block started at `cycle` completes
+    uint32_t fill_ready_cycle(uint32_t cycle) const;
 
     Address calc_base_address(size_t tag, size_t row) const;
 
@@ -177,7 +326,8 @@ private:
     CacheLocation compute_location(Address address) const;
 
     /**
-     * Searches for given tag in a set
+     * Searches for given tag in a set, two ways are compared at once by SSE2
+     * when the target has it.
      *
      * @param loc       requested location in cache
      * @return          associativity index of found block, max index + 1 if not
@@ -185,8 +335,6 @@ private:
      */
     size_t find_block_index(const CacheLocation &loc) const;
 
-    bool is_in_uncached_area(Address source) const;
-
     /**
      * RW access to cache may span multiple blocks but it needs to be
      * performed per block.
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "memory/cache/cache_coherence.h"
+
+#include "memory/cache/cache.h"
+#include "simulator_exception.h"
+
+namespace machine {
+
+void CacheCoherence::add(Cache *cache, WriteObserver observer) {
+    participants.push_back({ cache, std::move(observer), {} });
+    cache->set_coherence(this);
+}
+
+size_t CacheCoherence::participant_count() const {
+    return participants.size();
+}
+
+const CacheCoherence::Statistics &CacheCoherence::get_statistics(size_t index) const {
+    return participants.at(index).stats;
+}
+
+CacheCoherence::Statistics CacheCoherence::get_total_statistics() const {
+    Statistics total;
+    for (const Participant &p : participants) {
+        total.bus_reads += p.stats.bus_reads;
+        total.bus_writes += p.stats.bus_writes;
+        total.upgrades += p.stats.upgrades;
+        total.invalidations += p.stats.invalidations;
+        total.interventions += p.stats.interventions;
+    }
+    return total;
+}
+
+void CacheCoherence::reset_statistics() {
+    for (Participant &p : participants) {
+        p.stats = {};
+    }
+}
+
+bool CacheCoherence::read_miss(const Cache *requester, Address address) {
+    find(requester).stats.bus_reads++;
+    bool shared = false;
+    for (Participant &p : participants) {
+        if (p.cache == requester) {
+            continue;
+        }
+        enum SnoopResult res = p.cache->snoop(address, false);
+        if (res == SNOOP_MODIFIED) {
+            p.stats.interventions++;
+        }
+        shared |= res != SNOOP_MISS;
+    }
+    return shared;
+}
+
+void CacheCoherence::write_miss(const Cache *requester, Address address) {
+    find(requester).stats.bus_writes++;
+    invalidate_others(requester, address);
+}
+
+void CacheCoherence::upgrade(const Cache *requester, Address address) {
+    find(requester).stats.upgrades++;
+    invalidate_others(requester, address);
+}
+
+void CacheCoherence::written(const Cache *requester, Address address, size_t size) {
+    for (Participant &p : participants) {
+        if (p.cache != requester && p.observer) {
+            p.observer(address, address + size - 1);
+        }
+    }
+}
+
+CacheCoherence::Participant &CacheCoherence::find(const Cache *cache) {
+    for (Participant &p : participants) {
+        if (p.cache == cache) {
+            return p;
+        }
+    }
+    throw SANITY_EXCEPTION("Cache is not coherence participant");
+}
+
+void CacheCoherence::invalidate_others(const Cache *requester, Address address) {
+    for (Participant &p : participants) {
+        if (p.cache == requester) {
+            continue;
+        }
+        enum SnoopResult res = p.cache->snoop(address, true);
+        if (res == SNOOP_MODIFIED) {
+            p.stats.interventions++;
+        }
+        if (res != SNOOP_MISS) {
+            p.stats.invalidations++;
+        }
+    }
+}
+
+} // namespace machine
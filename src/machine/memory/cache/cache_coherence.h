@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef CACHE_COHERENCE_H
+#define CACHE_COHERENCE_H
+
+#include "memory/address.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace machine {
+
+class Cache;
+
+/**
+ * MESI snooping protocol keeping private caches of multiprocessor coherent.
+ * The caches share one memory bus and announce their bus transactions here,
+ * all other caches snoop them:
+ *
+ *  - Read miss: other copies become shared, modified copy is written back to
+ *    the memory first (intervention). The line is loaded as exclusive when
+ *    there is no other copy.
+ *  - Write miss (read for ownership) and upgrade (write hit of shared line):
+ *    other copies are invalidated, modified ones written back first.
+ *
+ * The line state is kept by the caches (see `CacheLine`). Participant without
+ * enabled cache accesses the bus directly, its accesses are snooped as
+ * misses. Writes are reported to the other participants as well to cancel
+ * LL reservations of their cores.
+ */
+class CacheCoherence {
+public:
+    struct Statistics {
+        uint32_t bus_reads = 0;     // Read misses
+        uint32_t bus_writes = 0;    // Write misses (read for ownership)
+        uint32_t upgrades = 0;      // Write hits of shared lines
+        uint32_t invalidations = 0; // Own lines invalidated by others
+        uint32_t interventions = 0; // Own modified lines written back for others
+    };
+    // Called with range [start, last] written by another participant
+    using WriteObserver = std::function<void(Address start, Address last)>;
+
+    void add(Cache *cache, WriteObserver observer = nullptr);
+    size_t participant_count() const;
+    const Statistics &get_statistics(size_t index) const;
+    Statistics get_total_statistics() const;
+    void reset_statistics();
+
+    // Returns whether the block stays cached by other participants
+    bool read_miss(const Cache *requester, Address address);
+    void write_miss(const Cache *requester, Address address);
+    void upgrade(const Cache *requester, Address address);
+    void written(const Cache *requester, Address address, size_t size);
+
+private:
+    struct Participant {
+        Cache *cache;
+        WriteObserver observer;
+        Statistics stats;
+    };
+    std::vector<Participant> participants;
+
+    Participant &find(const Cache *cache);
+    void invalidate_others(const Cache *requester, Address address);
+};
+
+} // namespace machine
+
+#endif // CACHE_COHERENCE_H
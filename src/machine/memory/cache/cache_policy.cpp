@@ -37,11 +37,30 @@
 
 #include "cache_policy.h"
 
+#include <QDataStream>
+#include <algorithm>
+
 #include "simulator_exception.h"
 #include "utils.h"
 
 namespace machine {
 
+template<typename T, typename Stored>
+static void save_stats(QDataStream &out, const std::vector<T> &stats) {
+    for (T val : stats) {
+        out << (Stored)val;
+    }
+}
+
+template<typename T, typename Stored>
+static void load_stats(QDataStream &in, std::vector<T> &stats) {
+    Stored val;
+    for (T &item : stats) {
+        in >> val;
+        item = val;
+    }
+}
+
 std::unique_ptr<CachePolicy>
 CachePolicy::get_policy_instance(const CacheConfig *config) {
     if (config->enabled()) {
@@ -54,6 +73,15 @@ CachePolicy::get_policy_instance(const CacheConfig *config) {
         case CacheConfig::RP_LFU:
             return std::make_unique<CachePolicyLFU>(
                 config->associativity(), config->set_count());
+        case CacheConfig::RP_PLRU:
+            return std::make_unique<CachePolicyPLRU>(
+                config->associativity(), config->set_count());
+        case CacheConfig::RP_NRU:
+            return std::make_unique<CachePolicyRRIP>(
+                config->associativity(), config->set_count(), 1);
+        case CacheConfig::RP_SRRIP:
+            return std::make_unique<CachePolicyRRIP>(
+                config->associativity(), config->set_count(), 2);
         }
     } else {
         // Disabled cache will never use it.
@@ -63,57 +91,193 @@ CachePolicy::get_policy_instance(const CacheConfig *config) {
     Q_UNREACHABLE();
 }
 
+void CachePolicy::reset() {}
+
+void CachePolicy::save_state(QDataStream &out) const {
+    UNUSED(out)
+}
+
+void CachePolicy::load_state(QDataStream &in) {
+    UNUSED(in)
+}
+
 CachePolicyLRU::CachePolicyLRU(size_t associativity, size_t set_count)
     : associativity(associativity) {
-    stats.resize(set_count);
-    for (auto &row : stats) {
-        row.reserve(associativity);
-        for (size_t i = 0; i < associativity; i++) {
-            row.push_back(i);
+    stats.resize(set_count * associativity, 0);
+}
+
+void CachePolicyLRU::update_stats(size_t way, size_t row, bool is_valid) {
+    clock++;
+    stats[row * associativity + way] = is_valid ? clock : -clock;
+}
+
+size_t CachePolicyLRU::select_way_to_evict(size_t row) const {
+    const int64_t *row_stats = &stats[row * associativity];
+    size_t index = 0;
+    for (size_t i = 1; i < associativity; i++) {
+        if (row_stats[i] < row_stats[index]) {
+            index = i;
         }
     }
+    return index;
 }
 
-void CachePolicyLRU::update_stats(size_t way, size_t row, bool is_valid) {
-    // The following code is essentially a single pass of bubble sort (with
-    // temporary variable instead of inplace swapping) adding one element to
-    // back or front (respectively) of a sorted array. The sort stops, when the
-    // original location of the inserted element is reached and the original
-    // instance is moved to the temporary variable (`next_way`).
-
-    try {
-        // Statistics corresponding to single cache row
-        std::vector<uint32_t> &row_stats = stats.at(row);
-        uint32_t next_way = way;
-
-        if (is_valid) {
-            ssize_t i = associativity - 1;
-            do {
-                std::swap(row_stats.at(i), next_way);
-                i--;
-            } while (next_way != way);
-        } else {
-            size_t i = 0;
-            do {
-                std::swap(row_stats.at(i), next_way);
-                i++;
-            } while (next_way != way);
+void CachePolicyLRU::reset() {
+    std::fill(stats.begin(), stats.end(), 0);
+    clock = 0;
+}
+
+void CachePolicyLRU::save_state(QDataStream &out) const {
+    out << (qint64)clock;
+    save_stats<int64_t, qint64>(out, stats);
+}
+
+void CachePolicyLRU::load_state(QDataStream &in) {
+    qint64 val;
+    in >> val;
+    clock = val;
+    load_stats<int64_t, qint64>(in, stats);
+}
+
+CachePolicyPLRU::CachePolicyPLRU(size_t associativity, size_t set_count)
+    : associativity(associativity) {
+    leaves = 1;
+    while (leaves < associativity) {
+        leaves *= 2;
+    }
+    tree.resize(set_count * (leaves - 1), 0);
+    valid.resize(set_count * associativity, false);
+}
+
+void CachePolicyPLRU::update_stats(size_t way, size_t row, bool is_valid) {
+    valid[row * associativity + way] = is_valid;
+    if (!is_valid || leaves == 1) {
+        return; // Direct mapped cache has no tree
+    }
+    // Nodes on the path point away from the accessed way
+    uint8_t *nodes = &tree[row * (leaves - 1)];
+    size_t node = 0;
+    for (size_t half = leaves / 2; half > 0; half /= 2) {
+        const bool right = (way & half) != 0;
+        nodes[node] = !right;
+        node = 2 * node + (right ? 2 : 1);
+    }
+}
+
+size_t CachePolicyPLRU::select_way_to_evict(size_t row) const {
+    const uint8_t *row_valid = &valid[row * associativity];
+    for (size_t i = 0; i < associativity; i++) {
+        if (!row_valid[i]) {
+            return i;
+        }
+    }
+    if (leaves == 1) {
+        return 0;
+    }
+    const uint8_t *nodes = &tree[row * (leaves - 1)];
+    size_t node = 0, way = 0;
+    for (size_t half = leaves / 2; half > 0; half /= 2) {
+        // Right half without any way cannot be chosen
+        const bool right = nodes[node] && way + half < associativity;
+        if (right) {
+            way += half;
         }
-    } catch (std::out_of_range &e) {
-        throw SANITY_EXCEPTION("Out of range: LRU lost the way from priority queue.");
+        node = 2 * node + (right ? 2 : 1);
     }
+    return way;
 }
 
-size_t CachePolicyLRU::select_way_to_evict(size_t row) const {
-    return stats.at(row).at(0);
+void CachePolicyPLRU::reset() {
+    std::fill(tree.begin(), tree.end(), 0);
+    std::fill(valid.begin(), valid.end(), false);
+}
+
+void CachePolicyPLRU::save_state(QDataStream &out) const {
+    save_stats<uint8_t, quint8>(out, tree);
+    save_stats<uint8_t, quint8>(out, valid);
+}
+
+void CachePolicyPLRU::load_state(QDataStream &in) {
+    load_stats<uint8_t, quint8>(in, tree);
+    load_stats<uint8_t, quint8>(in, valid);
+}
+
+constexpr uint8_t CachePolicyRRIP::INVALID;
+
+CachePolicyRRIP::CachePolicyRRIP(
+    size_t associativity,
+    size_t set_count,
+    unsigned bits)
+    : associativity(associativity)
+    , distant((1u << bits) - 1) {
+    rrpv.resize(set_count * associativity, INVALID);
+}
+
+void CachePolicyRRIP::update_stats(size_t way, size_t row, bool is_valid) {
+    uint8_t &item = rrpv[row * associativity + way];
+    if (!is_valid) {
+        item = INVALID;
+    } else if (item == INVALID) {
+        // Inserted block, long re-reference interval
+        item = distant - 1;
+    } else {
+        item = 0;
+    }
+}
+
+size_t CachePolicyRRIP::select_way_to_evict(size_t row) const {
+    uint8_t *row_rrpv = &rrpv[row * associativity];
+    size_t index = 0;
+    uint8_t oldest = 0;
+    for (size_t i = 0; i < associativity; i++) {
+        if (row_rrpv[i] == INVALID) {
+            return i;
+        }
+        if (row_rrpv[i] > oldest) {
+            oldest = row_rrpv[i];
+            index = i;
+        }
+    }
+    // Aging all lines until the oldest one is distant is done at once
+    if (oldest < distant) {
+        for (size_t i = 0; i < associativity; i++) {
+            row_rrpv[i] += distant - oldest;
+        }
+    }
+    return index;
 }
 
-CachePolicyLFU::CachePolicyLFU(size_t associativity, size_t set_count) {
-    stats.resize(set_count, std::vector<uint32_t>(associativity, 0));
+void CachePolicyRRIP::reset() {
+    std::fill(rrpv.begin(), rrpv.end(), INVALID);
+}
+
+void CachePolicyRRIP::save_state(QDataStream &out) const {
+    save_stats<uint8_t, quint8>(out, rrpv);
+}
+
+void CachePolicyRRIP::load_state(QDataStream &in) {
+    load_stats<uint8_t, quint8>(in, rrpv);
+}
+
+CachePolicyLFU::CachePolicyLFU(size_t associativity, size_t set_count)
+    : associativity(associativity) {
+    stats.resize(set_count * associativity, 0);
+}
+
+void CachePolicyLFU::reset() {
+    std::fill(stats.begin(), stats.end(), 0);
+}
+
+void CachePolicyLFU::save_state(QDataStream &out) const {
+    save_stats<uint32_t, quint32>(out, stats);
+}
+
+void CachePolicyLFU::load_state(QDataStream &in) {
+    load_stats<uint32_t, quint32>(in, stats);
 }
 
 void CachePolicyLFU::update_stats(size_t way, size_t row, bool is_valid) {
-    auto &stat_item = stats.at(row).at(way);
+    auto &stat_item = stats[row * associativity + way];
 
     if (is_valid) {
         stat_item += 1;
@@ -123,24 +287,20 @@ void CachePolicyLFU::update_stats(size_t way, size_t row, bool is_valid) {
 }
 
 size_t CachePolicyLFU::select_way_to_evict(size_t row) const {
+    // Statistics corresponding to single cache row
+    const uint32_t *row_stats = &stats[row * associativity];
     size_t index = 0;
-    try {
-        // Statistics corresponding to single cache row
-        auto &row_stats = stats.at(row);
-        size_t lowest = row_stats.at(0);
-        for (size_t i = 0; i < row_stats.size(); i++) {
-            if (row_stats.at(i) == 0) {
-                // Only invalid blocks have zero stat
-                index = i;
-                break;
-            }
-            if (lowest > row_stats.at(i)) {
-                lowest = row_stats.at(i);
-                index = i;
-            }
+    size_t lowest = row_stats[0];
+    for (size_t i = 0; i < associativity; i++) {
+        if (row_stats[i] == 0) {
+            // Only invalid blocks have zero stat
+            index = i;
+            break;
+        }
+        if (lowest > row_stats[i]) {
+            lowest = row_stats[i];
+            index = i;
         }
-    } catch (std::out_of_range &e) {
-        throw SANITY_EXCEPTION("Out of range: LRU lost the way from priority queue.");
     }
     return index;
 }
@@ -47,6 +47,8 @@
 
 using std::size_t;
 
+class QDataStream;
+
 namespace machine {
 
 /**
@@ -67,6 +69,13 @@ public:
      */
     virtual void update_stats(size_t way, size_t row, bool is_valid) = 0;
 
+    // Called when the cache invalidates all lines
+    virtual void reset();
+
+    // Checkpoint support, stateless policies keep the default (nothing stored)
+    virtual void save_state(QDataStream &out) const;
+    virtual void load_state(QDataStream &in);
+
     virtual ~CachePolicy() = default;
 
     static std::unique_ptr<CachePolicy>
@@ -76,9 +85,10 @@ public:
 /**
  * Last recently used policy
  *
- *  Keeps queue of associativity indexes from last accessed
- *   to most recently accesed.
- *  Empty indexes are shifted to the begining.
+ *  Keeps time of the last access of each line, access is recorded in constant
+ *  time and the line with the oldest time is evicted. Invalidated lines get
+ *  negative time so they are evicted first, the most recently invalidated
+ *  one first.
  */
 class CachePolicyLRU final : public CachePolicy {
 public:
@@ -93,12 +103,88 @@ public:
 
     void update_stats(size_t way, size_t row, bool is_valid) final;
 
+    void reset() final;
+    void save_state(QDataStream &out) const final;
+    void load_state(QDataStream &in) final;
+
 private:
+    // Access times stored set-major as the cache lines (times of `row`
+    // start at `row * associativity`)
+    std::vector<int64_t> stats;
+    int64_t clock = 0;
+    const size_t associativity;
+};
+
+/**
+ * Tree pseudo least recently used policy
+ *
+ *  Binary tree over the ways of a set, each node points to the half which
+ *  was not accessed more recently. Access redirects the nodes on the path to
+ *  the way away from it, the victim is found by following the nodes. Invalid
+ *  lines are evicted first. Associativity which is not power of two uses
+ *  only the leftmost leaves of the tree.
+ */
+class CachePolicyPLRU final : public CachePolicy {
+public:
     /**
-     * Last access order queues for each cache set (row)
+     * @param associativity     degree of assiciaivity
+     * @param set_count         number of blocks / rows in a way (or sets in
+     * cache)
      */
-    std::vector<std::vector<uint32_t>> stats;
+    CachePolicyPLRU(size_t associativity, size_t set_count);
+
+    size_t select_way_to_evict(size_t row) const final;
+
+    void update_stats(size_t way, size_t row, bool is_valid) final;
+
+    void reset() final;
+    void save_state(QDataStream &out) const final;
+    void load_state(QDataStream &in) final;
+
+private:
+    // Nodes of each set stored in heap order, node is set when the right
+    // half is the one to evict from
+    std::vector<uint8_t> tree;
+    std::vector<uint8_t> valid;
     const size_t associativity;
+    size_t leaves; // Associativity rounded up to power of two
+};
+
+/**
+ * Re-reference interval prediction policy (static RRIP)
+ *
+ *  Each line keeps `bits` wide re-reference prediction value. Hit predicts
+ *  near re-reference (zero), new block is inserted with long prediction
+ *  (one below maximum). The first line with distant prediction (maximum) is
+ *  evicted, all lines of the set are aged until there is one. With single bit
+ *  it is not recently used (NRU) policy, new blocks are inserted as recently
+ *  used then. Invalid lines are evicted first.
+ */
+class CachePolicyRRIP final : public CachePolicy {
+public:
+    /**
+     * @param associativity     degree of assiciaivity
+     * @param set_count         number of blocks / rows in a way (or sets in
+     * cache)
+     * @param bits              width of the prediction value
+     */
+    CachePolicyRRIP(size_t associativity, size_t set_count, unsigned bits);
+
+    size_t select_way_to_evict(size_t row) const final;
+
+    void update_stats(size_t way, size_t row, bool is_valid) final;
+
+    void reset() final;
+    void save_state(QDataStream &out) const final;
+    void load_state(QDataStream &in) final;
+
+private:
+    static constexpr uint8_t INVALID = UINT8_MAX;
+
+    // Aging on eviction changes the predictions
+    mutable std::vector<uint8_t> rrpv;
+    const size_t associativity;
+    const uint8_t distant;
 };
 
 /**
@@ -120,8 +206,13 @@ public:
 
     void update_stats(size_t way, size_t row, bool is_valid) final;
 
+    void reset() final;
+    void save_state(QDataStream &out) const final;
+    void load_state(QDataStream &in) final;
+
 private:
-    std::vector<std::vector<uint32_t>> stats;
+    std::vector<uint32_t> stats; // Set-major as the cache lines
+    const size_t associativity;
 };
 
 class CachePolicyRAND final : public CachePolicy {
@@ -0,0 +1,326 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "memory/cache/cache_prefetcher.h"
+
+#include "simulator_exception.h"
+#include "utils.h"
+
+#include <QDataStream>
+
+namespace machine {
+
+std::unique_ptr<CachePrefetcher>
+CachePrefetcher::get_prefetcher_instance(const CacheConfig *config) {
+    if (!config->enabled()) {
+        return { nullptr };
+    }
+    const size_t block_bytes = config->block_size() * sizeof(uint32_t);
+    switch (config->prefetcher()) {
+    case CacheConfig::PF_NONE: return { nullptr };
+    case CacheConfig::PF_NEXT_LINE:
+        return std::make_unique<CachePrefetcherNextLine>(
+            block_bytes, config->prefetch_degree());
+    case CacheConfig::PF_STRIDE:
+        return std::make_unique<CachePrefetcherStride>(
+            config->prefetch_table_size(), config->prefetch_degree());
+    case CacheConfig::PF_STREAM:
+        return std::make_unique<CachePrefetcherStream>(
+            block_bytes, config->prefetch_table_size(),
+            config->prefetch_degree());
+    }
+    Q_UNREACHABLE();
+}
+
+bool CachePrefetcher::is_buffered() const {
+    return false;
+}
+
+void CachePrefetcher::fill(Address block, const uint32_t *data, uint32_t ready) {
+    UNUSED(block)
+    UNUSED(data)
+    UNUSED(ready)
+}
+
+bool CachePrefetcher::take(Address block, uint32_t *data, uint32_t &ready) {
+    UNUSED(block)
+    UNUSED(data)
+    UNUSED(ready)
+    return false;
+}
+
+unsigned CachePrefetcher::invalidate(Address block) {
+    UNUSED(block)
+    return 0;
+}
+
+void CachePrefetcher::reset() {}
+
+void CachePrefetcher::save_state(QDataStream &out) const {
+    UNUSED(out)
+}
+
+void CachePrefetcher::load_state(QDataStream &in) {
+    UNUSED(in)
+}
+
+CachePrefetcherNextLine::CachePrefetcherNextLine(
+    size_t block_bytes,
+    unsigned degree)
+    : block_bytes(block_bytes)
+    , degree(degree) {}
+
+unsigned CachePrefetcherNextLine::access(
+    const PrefetchAccess &access,
+    std::vector<Address> &requests) {
+    if (access.miss || access.prefetch_hit) {
+        for (unsigned i = 1; i <= degree; i++) {
+            requests.push_back(access.block + i * block_bytes);
+        }
+    }
+    return 0;
+}
+
+CachePrefetcherStride::CachePrefetcherStride(unsigned table_size, unsigned degree)
+    : table(table_size)
+    , degree(degree) {
+    reset();
+}
+
+unsigned CachePrefetcherStride::access(
+    const PrefetchAccess &access,
+    std::vector<Address> &requests) {
+    const auto inst_addr = (uint32_t)access.inst_addr.get_raw();
+    const auto address = (uint32_t)access.address.get_raw();
+    Entry &entry = table[(inst_addr / 4) % table.size()];
+    if (!entry.valid || entry.tag != inst_addr) {
+        entry = { true, ST_INITIAL, inst_addr, address, 0 };
+        return 0;
+    }
+
+    const auto stride = (int32_t)(address - entry.last_address);
+    const bool correct = stride == entry.stride;
+    switch (entry.state) {
+    case ST_INITIAL:
+    case ST_TRANSIENT:
+        if (correct) {
+            entry.state = ST_STEADY;
+        } else {
+            entry.state = entry.state == ST_INITIAL ? ST_TRANSIENT : ST_NO_PRED;
+            entry.stride = stride;
+        }
+        break;
+    case ST_STEADY:
+        // Single irregular access does not change the learned stride
+        if (!correct) { entry.state = ST_INITIAL; }
+        break;
+    case ST_NO_PRED:
+        if (correct) {
+            entry.state = ST_TRANSIENT;
+        } else {
+            entry.stride = stride;
+        }
+        break;
+    }
+    entry.last_address = address;
+
+    if (entry.state == ST_STEADY && entry.stride != 0) {
+        for (unsigned i = 1; i <= degree; i++) {
+            requests.push_back(Address(address + i * entry.stride));
+        }
+    }
+    return 0;
+}
+
+void CachePrefetcherStride::reset() {
+    for (Entry &entry : table) {
+        entry = { false, ST_INITIAL, 0, 0, 0 };
+    }
+}
+
+void CachePrefetcherStride::save_state(QDataStream &out) const {
+    for (const Entry &entry : table) {
+        out << entry.valid << (quint8)entry.state << (quint32)entry.tag
+            << (quint32)entry.last_address << (qint32)entry.stride;
+    }
+}
+
+void CachePrefetcherStride::load_state(QDataStream &in) {
+    for (Entry &entry : table) {
+        quint8 state;
+        quint32 tag, last_address;
+        qint32 stride;
+        in >> entry.valid >> state >> tag >> last_address >> stride;
+        entry.state = (State)state;
+        entry.tag = tag;
+        entry.last_address = last_address;
+        entry.stride = stride;
+    }
+}
+
+CachePrefetcherStream::CachePrefetcherStream(
+    size_t block_bytes,
+    unsigned buffers,
+    unsigned depth)
+    : buffers(buffers)
+    , block_bytes(block_bytes)
+    , depth(depth) {
+    reset();
+}
+
+unsigned CachePrefetcherStream::access(
+    const PrefetchAccess &access,
+    std::vector<Address> &requests) {
+    if (!access.miss) {
+        return 0;
+    }
+    unsigned dropped = 0;
+    if (access.prefetch_hit) {
+        // Keep the buffer the block was taken from full
+        fill_buffer = taken_buffer;
+    } else {
+        fill_buffer = 0;
+        for (size_t i = 1; i < buffers.size(); i++) {
+            if (buffers[i].last_use < buffers[fill_buffer].last_use) {
+                fill_buffer = i;
+            }
+        }
+        Buffer &buffer = buffers[fill_buffer];
+        dropped = buffer.entries.size();
+        buffer.entries.clear();
+        buffer.next = access.block + block_bytes;
+    }
+    Buffer &buffer = buffers[fill_buffer];
+    buffer.last_use = ++use_counter;
+    while (buffer.entries.size() + requests.size() < depth) {
+        requests.push_back(buffer.next);
+        buffer.next += block_bytes;
+    }
+    return dropped;
+}
+
+bool CachePrefetcherStream::is_buffered() const {
+    return true;
+}
+
+void CachePrefetcherStream::fill(
+    Address block,
+    const uint32_t *data,
+    uint32_t ready) {
+    buffers[fill_buffer].entries.push_back(
+        { block, ready,
+          std::vector<uint32_t>(data, data + block_bytes / sizeof(uint32_t)) });
+}
+
+bool CachePrefetcherStream::take(Address block, uint32_t *data, uint32_t &ready) {
+    for (size_t i = 0; i < buffers.size(); i++) {
+        std::deque<Entry> &entries = buffers[i].entries;
+        if (!entries.empty() && entries.front().block == block) {
+            std::copy(entries.front().data.begin(), entries.front().data.end(), data);
+            ready = entries.front().ready;
+            entries.pop_front();
+            taken_buffer = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned CachePrefetcherStream::invalidate(Address block) {
+    unsigned dropped = 0;
+    for (Buffer &buffer : buffers) {
+        for (auto it = buffer.entries.begin(); it != buffer.entries.end();) {
+            if (it->block == block) {
+                it = buffer.entries.erase(it);
+                dropped++;
+            } else {
+                ++it;
+            }
+        }
+    }
+    return dropped;
+}
+
+void CachePrefetcherStream::reset() {
+    for (Buffer &buffer : buffers) {
+        buffer = { {}, Address(), 0 };
+    }
+    use_counter = 0;
+    fill_buffer = 0;
+    taken_buffer = 0;
+}
+
+void CachePrefetcherStream::save_state(QDataStream &out) const {
+    out << (quint32)use_counter;
+    for (const Buffer &buffer : buffers) {
+        out << (quint64)buffer.next.get_raw() << (quint32)buffer.last_use
+            << (quint32)buffer.entries.size();
+        for (const Entry &entry : buffer.entries) {
+            out << (quint64)entry.block.get_raw() << (quint32)entry.ready;
+            for (uint32_t val : entry.data) {
+                out << (quint32)val;
+            }
+        }
+    }
+}
+
+void CachePrefetcherStream::load_state(QDataStream &in) {
+    quint32 val, count;
+    quint64 address;
+    in >> val;
+    use_counter = val;
+    for (Buffer &buffer : buffers) {
+        in >> address >> val >> count;
+        buffer.next = Address(address);
+        buffer.last_use = val;
+        if (count > depth) {
+            throw SIMULATOR_EXCEPTION(
+                Input, "Stream buffer does not match checkpoint", "");
+        }
+        buffer.entries.resize(count);
+        for (Entry &entry : buffer.entries) {
+            in >> address >> val;
+            entry.block = Address(address);
+            entry.ready = val;
+            entry.data.resize(block_bytes / sizeof(uint32_t));
+            for (uint32_t &item : entry.data) {
+                in >> val;
+                item = val;
+            }
+        }
+    }
+}
+
+} // namespace machine
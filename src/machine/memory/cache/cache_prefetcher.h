@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef CACHE_PREFETCHER_H
+#define CACHE_PREFETCHER_H
+
+#include "machineconfig.h"
+#include "memory/address.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class QDataStream;
+
+namespace machine {
+
+/**
+ * Demand access of the cache observed by a prefetcher.
+ */
+struct PrefetchAccess {
+    Address address;   // Accessed address
+    Address block;     // Base address of the accessed block
+    Address inst_addr; // Instruction performing the access, zero if unknown
+    bool miss;
+    bool prefetch_hit; // First use of a prefetched block
+};
+
+/**
+ * Cache prefetcher interface.
+ *
+ * Prefetcher observes demand accesses and requests blocks to be fetched
+ * ahead. The cache places the requested blocks to its lines marked as
+ * prefetched, unless the prefetcher is buffered. Buffered prefetcher keeps
+ * the fetched blocks in its own buffers and hands them over to the cache on
+ * miss.
+ */
+class CachePrefetcher {
+public:
+    /**
+     * Appends base addresses of blocks to prefetch to `requests`, the
+     * cache skips the blocks already present in it.
+     *
+     * @return  number of buffered blocks dropped unused
+     */
+    virtual unsigned
+    access(const PrefetchAccess &access, std::vector<Address> &requests)
+        = 0;
+
+    virtual bool is_buffered() const;
+    // Buffered prefetcher stores the block fetched for the last request.
+    // Cycle `ready` is when the fetch completes.
+    virtual void fill(Address block, const uint32_t *data, uint32_t ready);
+    // Buffered prefetcher hands over the missed block if it holds it
+    virtual bool take(Address block, uint32_t *data, uint32_t &ready);
+    // Buffered prefetcher drops its copy of modified block, returns the
+    // number of dropped blocks
+    virtual unsigned invalidate(Address block);
+
+    virtual void reset();
+    // Checkpoint support, stateless prefetchers keep the default
+    virtual void save_state(QDataStream &out) const;
+    virtual void load_state(QDataStream &in);
+
+    virtual ~CachePrefetcher() = default;
+
+    // Null is returned when the cache does not prefetch
+    static std::unique_ptr<CachePrefetcher>
+    get_prefetcher_instance(const CacheConfig *config);
+};
+
+/**
+ * Tagged next-line prefetcher
+ *
+ *  Miss or the first use of a prefetched block requests `degree` following
+ *  blocks.
+ */
+class CachePrefetcherNextLine final : public CachePrefetcher {
+public:
+    CachePrefetcherNextLine(size_t block_bytes, unsigned degree);
+
+    unsigned access(const PrefetchAccess &access, std::vector<Address> &requests)
+        final;
+
+private:
+    const size_t block_bytes;
+    const unsigned degree;
+};
+
+/**
+ * Stride prefetcher with reference prediction table
+ *
+ *  Table indexed by instruction address keeps the last address and stride of
+ *  the instruction. Two equal strides in a row make the entry steady and
+ *  `degree` addresses ahead by the stride are requested then (Chen and Baer).
+ */
+class CachePrefetcherStride final : public CachePrefetcher {
+public:
+    CachePrefetcherStride(unsigned table_size, unsigned degree);
+
+    unsigned access(const PrefetchAccess &access, std::vector<Address> &requests)
+        final;
+
+    void reset() final;
+    void save_state(QDataStream &out) const final;
+    void load_state(QDataStream &in) final;
+
+private:
+    enum State : uint8_t { ST_INITIAL, ST_TRANSIENT, ST_STEADY, ST_NO_PRED };
+    struct Entry {
+        bool valid;
+        State state;
+        uint32_t tag;
+        uint32_t last_address;
+        int32_t stride;
+    };
+    std::vector<Entry> table;
+    const unsigned degree;
+};
+
+/**
+ * Stream buffers
+ *
+ *  Miss which is not found at the head of any buffer restarts the least
+ *  recently used buffer with `degree` blocks following the missed one. Block
+ *  taken from the head of a buffer is replaced by the next block of the
+ *  stream (Jouppi).
+ */
+class CachePrefetcherStream final : public CachePrefetcher {
+public:
+    CachePrefetcherStream(size_t block_bytes, unsigned buffers, unsigned depth);
+
+    unsigned access(const PrefetchAccess &access, std::vector<Address> &requests)
+        final;
+    bool is_buffered() const final;
+    void fill(Address block, const uint32_t *data, uint32_t ready) final;
+    bool take(Address block, uint32_t *data, uint32_t &ready) final;
+    unsigned invalidate(Address block) final;
+
+    void reset() final;
+    void save_state(QDataStream &out) const final;
+    void load_state(QDataStream &in) final;
+
+private:
+    struct Entry {
+        Address block;
+        uint32_t ready;
+        std::vector<uint32_t> data;
+    };
+    struct Buffer {
+        std::deque<Entry> entries;
+        Address next; // Next block of the stream to be requested
+        uint32_t last_use;
+    };
+    std::vector<Buffer> buffers;
+    const size_t block_bytes;
+    const unsigned depth;
+    uint32_t use_counter = 0;
+    // Buffer filled by the requests of the last access and the one the last
+    // block was taken from
+    size_t fill_buffer = 0, taken_buffer = 0;
+};
+
+} // namespace machine
+
+#endif // CACHE_PREFETCHER_H
@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "memory/cache/cache_sweep.h"
+
+#include "memory/backend/memory.h"
+#include "memory/memory_bus.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace machine {
+
+/**
+ * Stack distance analysis state of configurations sharing set count and block
+ * size.
+ */
+struct CacheSweep::StackGroup {
+    unsigned set_count;
+    unsigned block_size;
+    unsigned max_associativity;
+    std::vector<size_t> members; // Indexes of evaluated configurations
+    // Histograms of stack distances, distance `max_associativity` stands for
+    // a block not found in any of the caches
+    std::vector<uint64_t> read_distance;
+    std::vector<uint64_t> write_distance;
+    // Dirty blocks evicted or flushed, indexed by associativity
+    std::vector<uint64_t> write_backs;
+};
+
+namespace {
+
+struct StackEntry {
+    uint64_t block;
+    // Deepest stack position reached since the block was written. The block
+    // is dirty in caches with larger associativity.
+    uint32_t max_depth;
+    bool dirty;
+};
+
+bool is_uncached(const CacheReference &ref) {
+    return Cache::is_in_uncached_area(Address(ref.address))
+           || Cache::is_in_uncached_area(Address(ref.address) + ref.size);
+}
+
+// Moves entry from stack position `depth` one position down, the block
+// leaves the cache with associativity `depth + 1`.
+void push_down(StackEntry &entry, uint32_t depth, std::vector<uint64_t> &write_backs) {
+    if (entry.max_depth == depth) {
+        if (entry.dirty) {
+            write_backs[depth + 1]++;
+        }
+        entry.max_depth = depth + 1;
+    }
+}
+
+} // namespace
+
+CacheSweep::CacheSweep(
+    uint32_t memory_access_penalty_r,
+    uint32_t memory_access_penalty_w,
+    uint32_t memory_access_penalty_b)
+    : access_pen_r(memory_access_penalty_r)
+    , access_pen_w(memory_access_penalty_w)
+    , access_pen_b(memory_access_penalty_b) {}
+
+void CacheSweep::record(const CacheReference &reference) {
+    references.push_back(reference);
+}
+
+void CacheSweep::clear() {
+    references.clear();
+}
+
+const std::vector<CacheReference> &CacheSweep::get_references() const {
+    return references;
+}
+
+bool CacheSweep::is_stack_evaluable(const CacheConfig &config) {
+    return config.enabled()
+           && config.replacement_policy() == CacheConfig::RP_LRU
+           && config.write_policy() != CacheConfig::WP_THROUGH_NOALLOC
+           && config.prefetcher() == CacheConfig::PF_NONE;
+}
+
+std::vector<CacheSweep::Result>
+CacheSweep::evaluate(const std::vector<CacheConfig> &configs) const {
+    std::vector<Result> results(configs.size());
+
+    // Accesses passed to the memory whatever the configuration is
+    uint64_t read_refs = 0, write_refs = 0;
+    uint64_t uncached_reads = 0, uncached_writes = 0;
+    for (const CacheReference &ref : references) {
+        if (ref.type == CacheReference::READ) {
+            read_refs++;
+            uncached_reads += is_uncached(ref);
+        } else if (ref.type == CacheReference::WRITE) {
+            write_refs++;
+            uncached_writes += is_uncached(ref);
+        }
+    }
+
+    std::map<std::pair<unsigned, unsigned>, StackGroup> groups;
+    for (size_t i = 0; i < configs.size(); i++) {
+        const CacheConfig &config = configs[i];
+        if (!config.enabled()) {
+            CacheStatistics stats;
+            stats.mem_reads = read_refs;
+            stats.mem_writes = write_refs;
+            results[i] = make_result(config, stats, false);
+        } else if (!is_stack_evaluable(config)) {
+            results[i] = replay(config);
+        } else {
+            StackGroup &group = groups[{ config.set_count(), config.block_size() }];
+            if (group.members.empty()) {
+                group.set_count = config.set_count();
+                group.block_size = config.block_size();
+                group.max_associativity = 0;
+            }
+            group.max_associativity
+                = std::max(group.max_associativity, config.associativity());
+            group.members.push_back(i);
+        }
+    }
+
+    for (auto &item : groups) {
+        StackGroup &group = item.second;
+        evaluate_group(group);
+
+        uint64_t read_blocks = 0, write_blocks = 0;
+        for (unsigned d = 0; d <= group.max_associativity; d++) {
+            read_blocks += group.read_distance[d];
+            write_blocks += group.write_distance[d];
+        }
+        for (size_t i : group.members) {
+            const CacheConfig &config = configs[i];
+            CacheStatistics stats;
+            uint64_t miss_read = 0, miss_write = 0;
+            for (unsigned d = config.associativity(); d <= group.max_associativity;
+                 d++) {
+                miss_read += group.read_distance[d];
+                miss_write += group.write_distance[d];
+            }
+            stats.hit_read = read_blocks - miss_read;
+            stats.miss_read = miss_read;
+            stats.hit_write = write_blocks - miss_write;
+            stats.miss_write = miss_write;
+            stats.mem_reads
+                = (miss_read + miss_write) * config.block_size() + uncached_reads;
+            stats.burst_reads
+                = (miss_read + miss_write) * (config.block_size() - 1);
+            if (config.write_policy() == CacheConfig::WP_BACK) {
+                uint64_t write_backs = group.write_backs[config.associativity()];
+                stats.mem_writes
+                    = write_backs * config.block_size() + uncached_writes;
+                stats.burst_writes = write_backs * (config.block_size() - 1);
+            } else {
+                stats.mem_writes = write_refs;
+            }
+            results[i] = make_result(config, stats, false);
+        }
+    }
+
+    return results;
+}
+
+void CacheSweep::evaluate_group(StackGroup &group) const {
+    const unsigned max_assoc = group.max_associativity;
+    const uint64_t block_bytes = group.block_size * BLOCK_ITEM_SIZE;
+    // LRU stack of each set, most recently used block first. Blocks deeper
+    // than the largest associativity are not needed.
+    std::vector<std::vector<StackEntry>> stacks(group.set_count);
+
+    group.read_distance.assign(max_assoc + 1, 0);
+    group.write_distance.assign(max_assoc + 1, 0);
+    group.write_backs.assign(max_assoc + 1, 0);
+
+    for (const CacheReference &ref : references) {
+        if (ref.type == CacheReference::FLUSH) {
+            for (auto &stack : stacks) {
+                for (const StackEntry &entry : stack) {
+                    if (!entry.dirty) {
+                        continue;
+                    }
+                    for (unsigned assoc = entry.max_depth + 1;
+                         assoc <= max_assoc; assoc++) {
+                        group.write_backs[assoc]++;
+                    }
+                }
+                stack.clear();
+            }
+            continue;
+        }
+        if (ref.size == 0 || is_uncached(ref)) {
+            continue;
+        }
+        const bool write = ref.type == CacheReference::WRITE;
+        const uint64_t first = ref.address / block_bytes;
+        const uint64_t last = ((uint64_t)ref.address + ref.size - 1) / block_bytes;
+        for (uint64_t block = first; block <= last; block++) {
+            std::vector<StackEntry> &stack = stacks[block % group.set_count];
+            uint32_t depth = 0;
+            while (depth < stack.size() && stack[depth].block != block) {
+                depth++;
+            }
+
+            StackEntry entry;
+            if (depth < stack.size()) {
+                (write ? group.write_distance : group.read_distance)[depth]++;
+                entry = stack[depth];
+            } else {
+                (write ? group.write_distance : group.read_distance)[max_assoc]++;
+                entry = { block, 0, false };
+                if (stack.size() < max_assoc) {
+                    stack.emplace_back();
+                } else {
+                    // Least recently used block leaves all the caches
+                    push_down(stack.back(), max_assoc - 1, group.write_backs);
+                }
+                depth = stack.size() - 1;
+            }
+            for (uint32_t k = depth; k > 0; k--) {
+                stack[k] = stack[k - 1];
+                push_down(stack[k], k - 1, group.write_backs);
+            }
+            if (write) {
+                entry.dirty = true;
+                entry.max_depth = 0;
+            }
+            stack[0] = entry;
+        }
+    }
+}
+
+CacheSweep::Result CacheSweep::replay(const CacheConfig &config) const {
+    Memory memory(BIG);
+    TrivialBus bus(&memory);
+    Cache cache(&bus, &config, access_pen_r, access_pen_w, access_pen_b);
+    std::vector<byte> buffer;
+
+    for (const CacheReference &ref : references) {
+        if (buffer.size() < ref.size) {
+            buffer.resize(ref.size);
+        }
+        switch (ref.type) {
+        case CacheReference::READ:
+            cache.read(
+                buffer.data(), Address(ref.address), ref.size,
+                { .type = ae::REGULAR });
+            break;
+        case CacheReference::WRITE:
+            cache.write(
+                Address(ref.address), buffer.data(), ref.size,
+                { .type = ae::REGULAR });
+            break;
+        case CacheReference::FLUSH: cache.flush(); break;
+        }
+    }
+    return make_result(config, cache.get_statistics(), true);
+}
+
+CacheSweep::Result CacheSweep::make_result(
+    const CacheConfig &config,
+    const CacheStatistics &stats,
+    bool replayed) const {
+    return { config,
+             stats,
+             stats.stall_count(config, access_pen_r, access_pen_w, access_pen_b),
+             stats.speed_improvement(
+                 config, access_pen_r, access_pen_w, access_pen_b),
+             stats.hit_rate(),
+             replayed };
+}
+
+} // namespace machine
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef CACHE_SWEEP_H
+#define CACHE_SWEEP_H
+
+#include "machineconfig.h"
+#include "memory/cache/cache.h"
+#include "memory/cache/cache_types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Evaluates many cache configurations on one recorded reference stream.
+ *
+ * The stream is recorded once (see `Cache::set_reference_observer`) and all
+ * requested configurations are evaluated afterwards without running the
+ * program again. Enabled LRU caches with write back or write through with
+ * allocation are evaluated by per-set stack distance (Mattson) analysis: all
+ * configurations sharing set count and block size are evaluated in a single
+ * pass over the stream, whatever their associativity is. A cache with
+ * associativity A hits when fewer than A distinct blocks of the set were
+ * referenced since the last reference of the block. Write backs are counted
+ * by tracking the deepest stack position each dirty block reached since it
+ * was last written. Other configurations (LFU, random replacement, write
+ * through without allocation) do not have the inclusion property and are
+ * evaluated by replaying the stream through a `Cache` instance.
+ *
+ * Statistics are the ones `Cache` itself would report after the same
+ * references.
+ */
+class CacheSweep {
+public:
+    /**
+     * @param memory_access_penalty_r   cycles to perform read
+     * @param memory_access_penalty_w   cycles to perform write
+     * @param memory_access_penalty_b   cycles to perform burst access
+     */
+    explicit CacheSweep(
+        uint32_t memory_access_penalty_r = 1,
+        uint32_t memory_access_penalty_w = 1,
+        uint32_t memory_access_penalty_b = 0);
+
+    void record(const CacheReference &reference);
+    void clear();
+    const std::vector<CacheReference> &get_references() const;
+
+    struct Result {
+        CacheConfig config;
+        CacheStatistics statistics;
+        uint32_t stall_count;
+        double speed_improvement;
+        double hit_rate;
+        bool replayed; // Evaluated by replay instead of stack analysis
+    };
+
+    /**
+     * Evaluates all configurations, results are in the order of `configs`.
+     */
+    std::vector<Result> evaluate(const std::vector<CacheConfig> &configs) const;
+    /**
+     * Evaluates single configuration by passing the stream through a cache.
+     */
+    Result replay(const CacheConfig &config) const;
+
+    // Whether the configuration can be evaluated by stack analysis
+    static bool is_stack_evaluable(const CacheConfig &config);
+
+private:
+    const uint32_t access_pen_r, access_pen_w, access_pen_b;
+    std::vector<CacheReference> references;
+
+    struct StackGroup;
+    void evaluate_group(StackGroup &group) const;
+    Result
+    make_result(const CacheConfig &config, const CacheStatistics &stats, bool replayed)
+        const;
+};
+
+} // namespace machine
+
+#endif // CACHE_SWEEP_H
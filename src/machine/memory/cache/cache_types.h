@@ -54,12 +54,35 @@ struct CacheLocation {
 };
 
 /**
- * Single cache line. Appropriate cache block is stored in `data`.
+ * State of single cache line. Tag and block of the line are kept by the cache
+ * in separate arrays, see `Cache`.
  */
 struct CacheLine {
-    bool valid, dirty;
-    uint64_t tag;
-    std::vector<uint32_t> data;
+    bool dirty;
+    bool exclusive; // No other coherent cache has the block (MESI E or M)
+    bool prefetched; // Loaded by the prefetcher and not accessed yet
+    uint32_t ready;  // Core cycle the prefetch of the block completes
+};
+
+// Tag of invalid line, no address maps to it
+constexpr uint64_t INVALID_TAG = UINT64_MAX;
+
+/**
+ * State of snooped block in the cache before the bus transaction of another
+ * cache, see `CacheCoherence`.
+ */
+enum SnoopResult { SNOOP_MISS, SNOOP_SHARED, SNOOP_MODIFIED };
+
+/**
+ * Single reference received by a cache from the core, as reported to the
+ * reference observer of the cache. Flush has no address nor size.
+ */
+struct CacheReference {
+    enum Type : uint8_t { READ, WRITE, FLUSH };
+
+    uint32_t address;
+    uint32_t size;
+    Type type;
 };
 
 /**
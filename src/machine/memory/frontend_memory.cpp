@@ -141,6 +141,11 @@ FrontendMemory::read_ctl(enum AccessControl ctl, Address address) const {
 
 void FrontendMemory::sync() {}
 
+void FrontendMemory::access_hint(Address inst_addr, uint32_t cycle) const {
+    (void)inst_addr;
+    (void)cycle;
+}
+
 LocationStatus FrontendMemory::location_status(Address address) const {
     (void)address;
     return LOCSTAT_NONE;
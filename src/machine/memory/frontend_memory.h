@@ -125,6 +125,15 @@ public:
     virtual LocationStatus location_status(Address address) const;
     virtual uint32_t get_change_counter() const = 0;
 
+    /**
+     * Announces the instruction and the core cycle of the following access.
+     * Used by cache prefetchers, other components ignore it.
+     *
+     * @param inst_addr     address of the instruction performing the access
+     * @param cycle         core cycle of the access
+     */
+    virtual void access_hint(Address inst_addr, uint32_t cycle) const;
+
     /**
      * Write byte sequence to memory
      *
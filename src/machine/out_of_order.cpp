@@ -0,0 +1,388 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "out_of_order.h"
+
+#include <QDataStream>
+#include <algorithm>
+
+using namespace machine;
+
+double OutOfOrderEngine::Occupancy::average(uint64_t cycles) const {
+    return cycles != 0 ? (double)sum / (double)cycles : 0.0;
+}
+
+double OutOfOrderEngine::Stats::ipc() const {
+    return cycles != 0 ? (double)committed / (double)cycles : 0.0;
+}
+
+OutOfOrderEngine::OutOfOrderEngine(const OutOfOrderConfig &config) : config(config) {
+    reset();
+}
+
+uint64_t OutOfOrderEngine::cycle() const {
+    return now;
+}
+
+void OutOfOrderEngine::commit() {
+    dispatched = 0;
+    stall = STALL_NONE;
+    usage.erase(usage.begin(), usage.lower_bound(now));
+
+    unsigned committed = 0;
+    while (!rob.empty() && committed < config.issue_width() && rob.front().complete <= now) {
+        const Entry &entry = rob.front();
+        if (entry.mem) { lsq_used--; }
+        if (entry.serialize) {
+            // Fetch restarts from the handler or the following instruction
+            serializing = false;
+            fetch_resume = std::max(fetch_resume, now + 1);
+            resume_stall = STALL_SERIALIZE;
+        }
+        rob.pop_front();
+        committed++;
+    }
+    stats.committed += committed;
+}
+
+bool OutOfOrderEngine::front_end_ready() {
+    if (serializing) {
+        stall = STALL_SERIALIZE;
+        return false;
+    }
+    if (now < fetch_resume) {
+        stall = resume_stall;
+        return false;
+    }
+    return true;
+}
+
+bool OutOfOrderEngine::dispatch(const Op &op) {
+    bool mem = op.memread || op.memwrite;
+    if (op.fetch_ready > now) {
+        stall = STALL_FETCH;
+        return false;
+    }
+    if (rob.size() >= config.rob_size()) {
+        stall = STALL_ROB_FULL;
+        return false;
+    }
+    if (rs_used() >= config.rs_size()) {
+        stall = STALL_RS_FULL;
+        return false;
+    }
+    if (mem && lsq_used >= config.lsq_size()) {
+        stall = STALL_LSQ_FULL;
+        return false;
+    }
+
+    uint64_t ready = now + 1;
+    for (uint8_t reg : op.src) {
+        if (reg != 0) { ready = std::max(ready, reg_ready[reg]); }
+    }
+    unsigned latency = op.latency;
+    uint32_t word = op.mem_addr & ~3U;
+    if (op.memread) {
+        // Store to load forwarding from the youngest older store
+        for (auto it = rob.rbegin(); it != rob.rend(); ++it) {
+            if (it->memwrite && it->mem_addr == word) {
+                ready = std::max(ready, it->complete);
+                latency = 1;
+                stats.forwarded_loads++;
+                break;
+            }
+        }
+    }
+
+    unsigned busy = op.unit == FU_DIV ? latency : 1;
+    uint64_t issue = ready;
+    while (!unit_free(issue, op.unit, busy)) {
+        issue++;
+    }
+    reserve(issue, op.unit, busy);
+
+    uint64_t complete = issue + latency;
+    for (uint8_t reg : op.dst) {
+        if (reg != 0) { reg_ready[reg] = complete; }
+    }
+    if (op.store_data != 0) { complete = std::max(complete, reg_ready[op.store_data]); }
+
+    rob.push_back({
+        .issue = issue,
+        .complete = complete,
+        .mem = mem,
+        .memwrite = op.memwrite,
+        .serialize = op.serialize,
+        .mem_addr = word,
+    });
+    if (mem) { lsq_used++; }
+    if (op.serialize) { serializing = true; }
+    if (op.mispredicted) {
+        fetch_resume = std::max(fetch_resume, complete + op.penalty);
+        resume_stall = STALL_BRANCH;
+    }
+    dispatched++;
+    stats.dispatched++;
+    stats.issued[op.unit]++;
+    return true;
+}
+
+bool OutOfOrderEngine::end_cycle() {
+    auto sample = [](Occupancy &occupancy, unsigned used) {
+        occupancy.sum += used;
+        occupancy.max = std::max(occupancy.max, used);
+    };
+    sample(stats.rob, rob.size());
+    sample(stats.rs, rs_used());
+    sample(stats.lsq, lsq_used);
+    stats.cycles++;
+
+    bool stalled = dispatched == 0 && stall != STALL_NONE;
+    if (stalled) { stats.stalls[stall]++; }
+    now++;
+    return stalled;
+}
+
+void OutOfOrderEngine::reset() {
+    now = 0;
+    rob.clear();
+    lsq_used = 0;
+    reg_ready.fill(0);
+    usage.clear();
+    fetch_resume = 0;
+    resume_stall = STALL_NONE;
+    serializing = false;
+    dispatched = 0;
+    stall = STALL_NONE;
+    stats = Stats();
+}
+
+const OutOfOrderConfig &OutOfOrderEngine::get_config() const {
+    return config;
+}
+
+const OutOfOrderEngine::Stats &OutOfOrderEngine::get_stats() const {
+    return stats;
+}
+
+const char *OutOfOrderEngine::stall_name(enum Stall stall) {
+    switch (stall) {
+    case STALL_FETCH: return "fetch";
+    case STALL_BRANCH: return "branch";
+    case STALL_SERIALIZE: return "serialize";
+    case STALL_ROB_FULL: return "rob-full";
+    case STALL_RS_FULL: return "rs-full";
+    case STALL_LSQ_FULL: return "lsq-full";
+    default: return "none";
+    }
+}
+
+const char *OutOfOrderEngine::unit_name(enum Unit unit) {
+    switch (unit) {
+    case FU_ALU: return "alu";
+    case FU_MUL: return "mul";
+    case FU_DIV: return "div";
+    case FU_MEM: return "mem";
+    default: return "none";
+    }
+}
+
+unsigned OutOfOrderEngine::rs_used() const {
+    // Entries wait in reservation stations until they issue
+    unsigned used = 0;
+    for (const Entry &entry : rob) {
+        if (entry.issue > now) { used++; }
+    }
+    return used;
+}
+
+unsigned OutOfOrderEngine::unit_count(enum Unit unit) const {
+    return unit == FU_ALU ? config.issue_width() : 1;
+}
+
+bool OutOfOrderEngine::unit_free(uint64_t cycle, enum Unit unit, unsigned busy) const {
+    auto it = usage.find(cycle);
+    if (it != usage.end() && it->second[FU_COUNT] >= config.issue_width()) { return false; }
+    for (uint64_t c = cycle; c < cycle + busy; c++) {
+        it = usage.find(c);
+        if (it != usage.end() && it->second[unit] >= unit_count(unit)) { return false; }
+    }
+    return true;
+}
+
+void OutOfOrderEngine::reserve(uint64_t cycle, enum Unit unit, unsigned busy) {
+    usage[cycle][FU_COUNT]++;
+    for (uint64_t c = cycle; c < cycle + busy; c++) {
+        usage[c][unit]++;
+    }
+}
+
+static void save_occupancy(QDataStream &out, const OutOfOrderEngine::Occupancy &occupancy) {
+    out << (quint64)occupancy.sum << (quint32)occupancy.max;
+}
+
+static void load_occupancy(QDataStream &in, OutOfOrderEngine::Occupancy &occupancy) {
+    quint64 sum;
+    quint32 max;
+    in >> sum >> max;
+    occupancy.sum = sum;
+    occupancy.max = max;
+}
+
+void OutOfOrderEngine::save_op(QDataStream &out, const Op &op) {
+    out << (quint64)op.inst_addr.get_raw() << (qint32)op.unit << (quint32)op.latency;
+    for (uint8_t reg : op.src) {
+        out << (quint8)reg;
+    }
+    for (uint8_t reg : op.dst) {
+        out << (quint8)reg;
+    }
+    out << (quint8)op.store_data << op.memread << op.memwrite << (quint32)op.mem_addr
+        << (quint64)op.fetch_ready << op.serialize << op.mispredicted << (quint32)op.penalty
+        << op.end_group;
+}
+
+void OutOfOrderEngine::load_op(QDataStream &in, Op &op) {
+    quint64 addr, fetch_ready;
+    qint32 unit;
+    quint32 latency, mem_addr, penalty;
+    quint8 reg;
+    in >> addr >> unit >> latency;
+    op.inst_addr = Address(addr);
+    op.unit = (enum Unit)unit;
+    op.latency = latency;
+    for (uint8_t &src : op.src) {
+        in >> reg;
+        src = reg;
+    }
+    for (uint8_t &dst : op.dst) {
+        in >> reg;
+        dst = reg;
+    }
+    in >> reg >> op.memread >> op.memwrite >> mem_addr >> fetch_ready >> op.serialize
+        >> op.mispredicted >> penalty >> op.end_group;
+    op.store_data = reg;
+    op.mem_addr = mem_addr;
+    op.fetch_ready = fetch_ready;
+    op.penalty = penalty;
+}
+
+void OutOfOrderEngine::save_state(QDataStream &out) const {
+    out << (quint64)now << (quint32)rob.size();
+    for (const Entry &entry : rob) {
+        out << (quint64)entry.issue << (quint64)entry.complete << entry.mem << entry.memwrite
+            << entry.serialize << (quint32)entry.mem_addr;
+    }
+    out << (quint32)lsq_used;
+    for (uint64_t ready : reg_ready) {
+        out << (quint64)ready;
+    }
+    out << (quint32)usage.size();
+    for (const auto &cycle_usage : usage) {
+        out << (quint64)cycle_usage.first;
+        for (uint8_t used : cycle_usage.second) {
+            out << (quint8)used;
+        }
+    }
+    out << (quint64)fetch_resume << (qint32)resume_stall << serializing;
+
+    out << (quint64)stats.cycles << (quint64)stats.dispatched << (quint64)stats.committed
+        << (quint64)stats.forwarded_loads;
+    for (uint64_t issued : stats.issued) {
+        out << (quint64)issued;
+    }
+    for (uint64_t stalls : stats.stalls) {
+        out << (quint64)stalls;
+    }
+    save_occupancy(out, stats.rob);
+    save_occupancy(out, stats.rs);
+    save_occupancy(out, stats.lsq);
+}
+
+void OutOfOrderEngine::load_state(QDataStream &in) {
+    reset();
+    quint64 val64;
+    quint32 count, val32;
+    qint32 kind;
+    quint8 val8;
+
+    in >> val64 >> count;
+    now = val64;
+    for (quint32 i = 0; i < count; i++) {
+        quint64 issue, complete;
+        Entry entry {};
+        in >> issue >> complete >> entry.mem >> entry.memwrite >> entry.serialize >> val32;
+        entry.issue = issue;
+        entry.complete = complete;
+        entry.mem_addr = val32;
+        rob.push_back(entry);
+    }
+    in >> val32;
+    lsq_used = val32;
+    for (uint64_t &ready : reg_ready) {
+        in >> val64;
+        ready = val64;
+    }
+    in >> count;
+    for (quint32 i = 0; i < count; i++) {
+        in >> val64;
+        Usage &cycle_usage = usage[val64];
+        for (uint8_t &used : cycle_usage) {
+            in >> val8;
+            used = val8;
+        }
+    }
+    in >> val64 >> kind >> serializing;
+    fetch_resume = val64;
+    resume_stall = (enum Stall)kind;
+
+    quint64 cycles, dispatched_count, committed, forwarded;
+    in >> cycles >> dispatched_count >> committed >> forwarded;
+    stats.cycles = cycles;
+    stats.dispatched = dispatched_count;
+    stats.committed = committed;
+    stats.forwarded_loads = forwarded;
+    for (uint64_t &issued : stats.issued) {
+        in >> val64;
+        issued = val64;
+    }
+    for (uint64_t &stalls : stats.stalls) {
+        in >> val64;
+        stalls = val64;
+    }
+    load_occupancy(in, stats.rob);
+    load_occupancy(in, stats.rs);
+    load_occupancy(in, stats.lsq);
+}
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef OUT_OF_ORDER_H
+#define OUT_OF_ORDER_H
+
+#include "machineconfig.h"
+#include "memory/address.h"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+
+class QDataStream;
+
+namespace machine {
+
+/**
+ * Timing model of out-of-order core with reorder buffer, reservation
+ * stations and load/store queue (Tomasulo scheme with register renaming).
+ *
+ * The core executes the program in order and describes each instruction by
+ * `Op` when it is dispatched. Renaming removes WAR and WAW dependencies, so
+ * only results of the last producers of registers are tracked. Issue cycle
+ * of the instruction is chosen at dispatch as the first cycle in which its
+ * operands are ready and an issue slot and a functional unit are free, the
+ * instruction stays in reservation station until then. Instructions commit
+ * in order, up to issue width per cycle. Exceptions and serializing
+ * instructions stop dispatch until they commit, which keeps them precise.
+ * Loads obtain data from older in-flight stores to the same word, memory
+ * dependencies are otherwise assumed to be predicted perfectly.
+ */
+class OutOfOrderEngine {
+public:
+    explicit OutOfOrderEngine(const OutOfOrderConfig &config);
+
+    enum Unit {
+        FU_ALU, // Issue width of single cycle units, branches included
+        FU_MUL, // Pipelined multiplier
+        FU_DIV, // Divider, it is not pipelined
+        FU_MEM, // Single load/store port
+        FU_COUNT
+    };
+
+    enum Stall {
+        STALL_NONE,
+        STALL_FETCH,     // Instruction fetch waits for memory
+        STALL_BRANCH,    // Front end waits for mispredicted branch
+        STALL_SERIALIZE, // Exception or serializing instruction waits for commit
+        STALL_ROB_FULL,
+        STALL_RS_FULL,
+        STALL_LSQ_FULL,
+        STALL_COUNT
+    };
+
+    // Renamed registers, general purpose ones are followed by HI and LO
+    static constexpr unsigned REG_HI = 32;
+    static constexpr unsigned REG_LO = 33;
+    static constexpr unsigned REG_COUNT = 34;
+
+    struct Op {
+        Address inst_addr;
+        enum Unit unit = FU_ALU;
+        unsigned latency = 1; // Execution latency, memory access included
+        uint8_t src[4] {};    // Source registers, zero is unused slot
+        uint8_t dst[2] {};    // Destination registers, zero is unused slot
+        uint8_t store_data = 0; // Stored register is needed by commit only
+        bool memread = false;
+        bool memwrite = false;
+        uint32_t mem_addr = 0;
+        uint64_t fetch_ready = 0;  // Cycle the instruction leaves fetch
+        bool serialize = false;    // Exception or stop of fetch
+        bool mispredicted = false; // Front end is redirected by resolution
+        unsigned penalty = 0;      // Redirection cycles after resolution
+        bool end_group = false;    // Taken control transfer ends fetch group
+    };
+
+    struct Occupancy {
+        uint64_t sum = 0; // Sum of entries in use over cycles
+        unsigned max = 0;
+
+        double average(uint64_t cycles) const;
+    };
+
+    struct Stats {
+        uint64_t cycles = 0;
+        uint64_t dispatched = 0;
+        uint64_t committed = 0;
+        uint64_t forwarded_loads = 0;
+        uint64_t issued[FU_COUNT] {};
+        // Cycles without dispatched instruction by the reason
+        uint64_t stalls[STALL_COUNT] {};
+        Occupancy rob, rs, lsq;
+
+        double ipc() const;
+    };
+
+    // Cycle which is being simulated
+    uint64_t cycle() const;
+    // Commits completed instructions, the first step of each cycle
+    void commit();
+    // Front end can deliver the next instruction in this cycle
+    bool front_end_ready();
+    // Returns false when a structure is full, the instruction is retried
+    // in the following cycle
+    bool dispatch(const Op &op);
+    // Updates statistics and advances time, returns true for stalled cycle
+    bool end_cycle();
+    void reset();
+
+    const OutOfOrderConfig &get_config() const;
+    const Stats &get_stats() const;
+    static const char *stall_name(enum Stall stall);
+    static const char *unit_name(enum Unit unit);
+
+    void save_state(QDataStream &out) const;
+    void load_state(QDataStream &in);
+    // Checkpoint of instruction waiting in the front end
+    static void save_op(QDataStream &out, const Op &op);
+    static void load_op(QDataStream &in, Op &op);
+
+private:
+    struct Entry {
+        uint64_t issue;
+        uint64_t complete;
+        bool mem;
+        bool memwrite;
+        bool serialize;
+        uint32_t mem_addr;
+    };
+    // Issue slots (the last item) and units used in the cycle
+    typedef std::array<uint8_t, FU_COUNT + 1> Usage;
+
+    unsigned rs_used() const;
+    unsigned unit_count(enum Unit unit) const;
+    // Unit is occupied for busy cycles, issue slot in the first one only
+    bool unit_free(uint64_t cycle, enum Unit unit, unsigned busy) const;
+    void reserve(uint64_t cycle, enum Unit unit, unsigned busy);
+
+    const OutOfOrderConfig config;
+    uint64_t now = 0;
+    std::deque<Entry> rob;
+    unsigned lsq_used = 0;
+    std::array<uint64_t, REG_COUNT> reg_ready {};
+    std::map<uint64_t, Usage> usage;
+    uint64_t fetch_resume = 0; // The front end is redirected until then
+    enum Stall resume_stall = STALL_NONE;
+    bool serializing = false;  // Dispatch waits for commit of serializing op
+    unsigned dispatched = 0;   // In the current cycle
+    enum Stall stall = STALL_NONE;
+    Stats stats;
+};
+
+} // namespace machine
+
+#endif // OUT_OF_ORDER_H
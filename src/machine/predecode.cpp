@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "predecode.h"
+
+#include "utils.h"
+
+using namespace machine;
+
+PredecodeCache::PredecodeCache(unsigned size_bits)
+    : table(1u << size_bits)
+    , index_mask((1u << size_bits) - 1) {
+    invalidate();
+}
+
+void PredecodeCache::invalidate() {
+    for (auto &pd : table) {
+        pd.valid = false;
+    }
+}
+
+void PredecodeCache::decode(
+    PredecodedInstruction &pd,
+    Address inst_addr,
+    const Instruction &inst) {
+    inst.flags_alu_op_mem_ctl(pd.flags, pd.alu_op, pd.mem_ctl);
+    pd.inst_addr = inst_addr.get_raw();
+    pd.inst_word = inst.data();
+    pd.excause = (pd.flags & IMF_EXCEPTION) ? inst.encoded_exception() : EXCAUSE_NONE;
+    pd.num_rs = inst.rs();
+    pd.num_rt = inst.rt();
+    pd.num_rd = inst.rd();
+    if (pd.flags & IMF_ZERO_EXTEND) {
+        pd.immediate_val = inst.immediate();
+    } else {
+        pd.immediate_val = sign_extend(inst.immediate());
+    }
+    pd.valid = true;
+}
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef PREDECODE_H
+#define PREDECODE_H
+
+#include "instruction.h"
+#include "machinedefs.h"
+#include "memory/address.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Result of instruction decoding which depends only on the instruction word.
+ *
+ * Values are taken from `InstructionMap` and from instruction fields, so
+ * `Core::decode` does not have to walk the nested instruction tables again for
+ * every executed instruction.
+ */
+struct PredecodedInstruction {
+    uint32_t inst_addr;             // Address the entry was filled for
+    uint32_t inst_word;             // Instruction word the entry was filled for
+    enum InstructionFlags flags;    // Including IMF_SUPPORTED masking
+    enum AluOp alu_op;              // Decoded ALU operation
+    enum AccessControl mem_ctl;     // Decoded memory access type
+    enum ExceptionCause excause;    // Exception encoded in the instruction
+    uint8_t num_rs;                 // Number of the register s
+    uint8_t num_rt;                 // Number of the register t
+    uint8_t num_rd;                 // Number of the register d
+    uint32_t immediate_val;         // zero or sign-extended immediate value
+    bool valid;
+};
+
+/**
+ * Direct mapped table of decoded instructions indexed by program counter.
+ *
+ * Entry is used only when both the address and the instruction word match,
+ * so any change of the code (store to program memory, self-modifying code,
+ * loading of a new program or memory restart) is detected when the changed
+ * word is fetched again and the entry is refilled. This keeps results
+ * identical to decoding the instruction from scratch.
+ */
+class PredecodeCache {
+public:
+    /**
+     * @param size_bits     log2 of number of entries in the table
+     */
+    explicit PredecodeCache(unsigned size_bits = 12);
+
+    /**
+     * Returns decoded form of instruction `inst` located at `inst_addr`.
+     * The table entry is (re)filled when it does not correspond to
+     * the requested address and instruction word.
+     */
+    inline const PredecodedInstruction &
+    lookup(Address inst_addr, const Instruction &inst);
+
+    void invalidate(); // Drop all entries
+
+    static void decode(PredecodedInstruction &pd, Address inst_addr, const Instruction &inst);
+
+private:
+    std::vector<PredecodedInstruction> table;
+    const uint32_t index_mask;
+};
+
+inline const PredecodedInstruction &
+PredecodeCache::lookup(Address inst_addr, const Instruction &inst) {
+    const uint32_t addr = inst_addr.get_raw();
+    PredecodedInstruction &pd = table[(addr >> 2) & index_mask];
+    if (pd.valid && pd.inst_addr == addr && pd.inst_word == inst.data()) {
+        return pd;
+    }
+    decode(pd, inst_addr, inst);
+    return pd;
+}
+
+} // namespace machine
+
+#endif // PREDECODE_H
@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+using namespace machine;
+
+Profiler::Counters &Profiler::Counters::operator+=(const Counters &other) {
+    cycles += other.cycles;
+    stalls += other.stalls;
+    instructions += other.instructions;
+    icache_misses += other.icache_misses;
+    dcache_misses += other.dcache_misses;
+    return *this;
+}
+
+Profiler::Profiler(const Cache *cache_program, const Cache *cache_data)
+    : cache_program(cache_program)
+    , cache_data(cache_data) {
+    clear();
+}
+
+void Profiler::clear() {
+    instructions.clear();
+    total = Counters();
+    calls.clear();
+    stack.clear();
+    fetch_counters = nullptr;
+    icache_misses = icache_miss_count();
+    dcache_misses = dcache_miss_count();
+}
+
+void Profiler::fetched(Address inst_addr) {
+    fetch_counters = &instructions[inst_addr.get_raw()];
+    uint32_t misses = icache_miss_count();
+    fetch_counters->icache_misses += misses - icache_misses;
+    total.icache_misses += misses - icache_misses;
+    icache_misses = misses;
+}
+
+void Profiler::cycle() {
+    if (fetch_counters != nullptr) {
+        fetch_counters->cycles++;
+        total.cycles++;
+    }
+}
+
+void Profiler::stalled(Address inst_addr) {
+    instructions[inst_addr.get_raw()].stalls++;
+    total.stalls++;
+}
+
+void Profiler::memory_accessed(Address inst_addr) {
+    uint32_t misses = dcache_miss_count();
+    if (misses != dcache_misses) {
+        instructions[inst_addr.get_raw()].dcache_misses += misses - dcache_misses;
+        total.dcache_misses += misses - dcache_misses;
+        dcache_misses = misses;
+    }
+}
+
+void Profiler::retired(Address inst_addr) {
+    instructions[inst_addr.get_raw()].instructions++;
+    total.instructions++;
+}
+
+void Profiler::called(Address call_site, Address target) {
+    if (stack.size() >= MAX_STACK_DEPTH) {
+        stack.erase(stack.begin());
+    }
+    stack.push_back({ call_site, target, total });
+}
+
+void Profiler::returned(Address target) {
+    // Return address skips the delay slot
+    auto frame = std::find_if(stack.rbegin(), stack.rend(), [target](const Frame &f) {
+        return f.call_site + 8 == target;
+    });
+    if (frame == stack.rend()) {
+        return;
+    }
+    size_t depth = stack.rend() - frame - 1;
+    while (stack.size() > depth) {
+        const Frame &f = stack.back();
+        Call &call = calls[{ f.call_site.get_raw(), f.target.get_raw() }];
+        call.call_site = f.call_site;
+        call.target = f.target;
+        call.count++;
+        call.inclusive += difference(total, f.entry);
+        stack.pop_back();
+    }
+}
+
+const std::unordered_map<uint32_t, Profiler::Counters> &
+Profiler::get_instructions() const {
+    return instructions;
+}
+
+Profiler::Counters Profiler::get_total() const {
+    return total;
+}
+
+std::vector<Profiler::Function> Profiler::get_functions(const SymbolTable *symtab) const {
+    std::map<std::pair<uint64_t, QString>, Counters> functions;
+    for (const auto &item : instructions) {
+        QString name;
+        SymbolValue start = 0;
+        if (symtab == nullptr || !symtab->function_at(name, start, item.first)) {
+            name.clear();
+            start = 0;
+        }
+        functions[{ start, name }] += item.second;
+    }
+
+    std::vector<Function> result;
+    result.reserve(functions.size());
+    for (const auto &item : functions) {
+        result.push_back({ item.first.second, Address(item.first.first), item.second });
+    }
+    std::stable_sort(result.begin(), result.end(), [](const Function &a, const Function &b) {
+        return a.counters.cycles > b.counters.cycles;
+    });
+    return result;
+}
+
+std::vector<Profiler::Call> Profiler::get_calls() const {
+    std::map<std::pair<uint32_t, uint32_t>, Call> result = calls;
+    for (const Frame &f : stack) {
+        Call &call = result[{ f.call_site.get_raw(), f.target.get_raw() }];
+        call.call_site = f.call_site;
+        call.target = f.target;
+        call.count++;
+        call.inclusive += difference(total, f.entry);
+    }
+    std::vector<Call> list;
+    list.reserve(result.size());
+    for (const auto &item : result) {
+        list.push_back(item.second);
+    }
+    return list;
+}
+
+static void write_costs(std::ostream &out, const Profiler::Counters &c) {
+    out << ' ' << c.cycles << ' ' << c.stalls << ' ' << c.instructions << ' '
+        << c.icache_misses << ' ' << c.dcache_misses << '\n';
+}
+
+void Profiler::write_callgrind(
+    std::ostream &out,
+    const SymbolTable *symtab,
+    const QString &command) const {
+    struct FunctionCosts {
+        std::map<uint32_t, Counters> instructions;
+        std::vector<const Call *> calls;
+    };
+    auto function_name = [symtab](uint32_t address) {
+        QString name;
+        SymbolValue start;
+        if (symtab == nullptr || !symtab->function_at(name, start, address)) {
+            return std::string("<unknown>");
+        }
+        return name.toStdString();
+    };
+
+    std::vector<Call> call_list = get_calls();
+    std::map<std::string, FunctionCosts> functions;
+    for (const auto &item : instructions) {
+        functions[function_name(item.first)].instructions[item.first] = item.second;
+    }
+    for (const Call &call : call_list) {
+        functions[function_name(call.call_site.get_raw())].calls.push_back(&call);
+    }
+
+    std::ios_base::fmtflags saveflg(out.flags());
+    out << "# callgrind format\n";
+    out << "version: 1\n";
+    out << "creator: qtmips\n";
+    if (!command.isEmpty()) {
+        out << "cmd: " << command.toStdString() << '\n';
+    }
+    out << "positions: instr\n";
+    out << "event: Cy : Cycles\n";
+    out << "event: St : Stall cycles\n";
+    out << "event: Ir : Instructions retired\n";
+    out << "event: I1mr : I-cache misses\n";
+    out << "event: D1mr : D-cache misses\n";
+    out << "events: Cy St Ir I1mr D1mr\n";
+    out << "summary:";
+    write_costs(out, total);
+    for (const auto &function : functions) {
+        out << "\nfn=" << function.first << '\n';
+        for (const auto &item : function.second.instructions) {
+            out << "0x" << std::hex << item.first << std::dec;
+            write_costs(out, item.second);
+        }
+        for (const Call *call : function.second.calls) {
+            out << "cfn=" << function_name(call->target.get_raw()) << '\n';
+            out << "calls=" << call->count << " 0x" << std::hex
+                << call->target.get_raw() << '\n';
+            out << "0x" << call->call_site.get_raw() << std::dec;
+            write_costs(out, call->inclusive);
+        }
+    }
+    out.flags(saveflg);
+}
+
+Profiler::Counters
+Profiler::difference(const Counters &later, const Counters &earlier) {
+    Counters result;
+    result.cycles = later.cycles - earlier.cycles;
+    result.stalls = later.stalls - earlier.stalls;
+    result.instructions = later.instructions - earlier.instructions;
+    result.icache_misses = later.icache_misses - earlier.icache_misses;
+    result.dcache_misses = later.dcache_misses - earlier.dcache_misses;
+    return result;
+}
+
+uint32_t Profiler::icache_miss_count() const {
+    return cache_program != nullptr ? cache_program->get_miss_count() : 0;
+}
+
+uint32_t Profiler::dcache_miss_count() const {
+    return cache_data != nullptr ? cache_data->get_miss_count() : 0;
+}
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "memory/address.h"
+#include "memory/cache/cache.h"
+#include "symboltable.h"
+
+#include <QString>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Flat profile of the program run by a core.
+ *
+ * Every cycle is attributed to the instruction fetched in it (as PC
+ * sampling of gprof does, only every cycle is sampled). Stall cycles are
+ * attributed to the instruction held in decode, program cache misses to the
+ * fetched instruction, data cache misses to the instruction in memory stage
+ * and instruction counts to the instructions leaving writeback. Cache misses
+ * are taken from the cache statistics, so caches have to be accessed only by
+ * the profiled core.
+ *
+ * Calls (JAL, JALR and taken BAL family branches) and returns (`jr $ra`)
+ * resolved by the core are followed on a shadow call stack. Costs accounted
+ * while a call is active make its inclusive cost. A return pops the frames
+ * up to the call it returns to, returns without a matching call are ignored.
+ */
+class Profiler {
+public:
+    struct Counters {
+        uint64_t cycles = 0;
+        uint64_t stalls = 0;
+        uint64_t instructions = 0;
+        uint64_t icache_misses = 0;
+        uint64_t dcache_misses = 0;
+
+        Counters &operator+=(const Counters &other);
+    };
+    struct Function {
+        QString name; // Empty for instructions outside of any symbol
+        Address start;
+        Counters counters;
+    };
+    struct Call {
+        Address call_site;
+        Address target;
+        uint64_t count = 0;
+        Counters inclusive;
+    };
+
+    // Caches can be null when the core accesses memory directly
+    Profiler(const Cache *cache_program, const Cache *cache_data);
+
+    void clear();
+
+    // Called by the core
+    void fetched(Address inst_addr);
+    void cycle();
+    void stalled(Address inst_addr);
+    void memory_accessed(Address inst_addr);
+    void retired(Address inst_addr);
+    void called(Address call_site, Address target);
+    void returned(Address target);
+
+    const std::unordered_map<uint32_t, Counters> &get_instructions() const;
+    Counters get_total() const;
+    /**
+     * Aggregates instructions by functions containing them (see
+     * `SymbolTable::function_at`), result is sorted by cycles.
+     */
+    std::vector<Function> get_functions(const SymbolTable *symtab) const;
+    /**
+     * Call edges ordered by call site and target. Calls which did not return
+     * yet are included with costs up to now.
+     */
+    std::vector<Call> get_calls() const;
+    /**
+     * Writes the profile in callgrind format (KCachegrind, callgrind_annotate)
+     * with instruction granularity. Instructions outside of any function are
+     * collected in function "<unknown>".
+     */
+    void write_callgrind(
+        std::ostream &out,
+        const SymbolTable *symtab,
+        const QString &command = QString()) const;
+
+private:
+    struct Frame {
+        Address call_site;
+        Address target;
+        Counters entry; // Total at the time of the call
+    };
+    // Deeper frames are dropped, e.g. for functions which never return
+    static constexpr size_t MAX_STACK_DEPTH = 4096;
+
+    const Cache *const cache_program;
+    const Cache *const cache_data;
+    std::unordered_map<uint32_t, Counters> instructions;
+    Counters total;
+    std::map<std::pair<uint32_t, uint32_t>, Call> calls;
+    std::vector<Frame> stack;
+    // Counters of the instruction fetched in the current cycle, elements of
+    // unordered map are not moved by insertion
+    Counters *fetch_counters = nullptr;
+    uint32_t icache_misses = 0;
+    uint32_t dcache_misses = 0;
+
+    static Counters difference(const Counters &later, const Counters &earlier);
+    uint32_t icache_miss_count() const;
+    uint32_t dcache_miss_count() const;
+};
+
+} // namespace machine
+
+#endif // PROFILER_H
@@ -37,6 +37,9 @@
 
 #include "memory/address.h"
 #include "simulator_exception.h"
+#include "trace/trace_writer.h"
+
+#include <QDataStream>
 
 using namespace machine;
 
@@ -65,6 +68,7 @@ Address Registers::read_pc() const {
 Address Registers::pc_inc() {
     this->pc += 4;
     emit pc_update(this->pc);
+    if (trace != nullptr) { trace->pc(pc.get_raw()); }
     return this->pc;
 }
 
@@ -75,6 +79,7 @@ Address Registers::pc_jmp(int32_t offset) {
     }
     this->pc += offset;
     emit pc_update(this->pc);
+    if (trace != nullptr) { trace->pc(pc.get_raw()); }
     return this->pc;
 }
 
@@ -86,6 +91,7 @@ void Registers::pc_abs_jmp(machine::Address address) {
     }
     this->pc = address;
     emit pc_update(this->pc);
+    if (trace != nullptr) { trace->pc(pc.get_raw()); }
 }
 
 void Registers::pc_abs_jmp_28(Address address) {
@@ -109,6 +115,7 @@ void Registers::write_gp(RegisterId reg, RegisterValue value) {
 
     this->gp.at(reg.data) = value;
     emit gp_update(reg, value.as_u32());
+    if (trace != nullptr) { trace->gp(reg.data, value.as_u32()); }
 }
 
 RegisterValue Registers::read_hi_lo(bool is_hi) const {
@@ -124,6 +131,7 @@ void Registers::write_hi_lo(bool is_hi, RegisterValue value) {
         lo = value;
     }
     emit hi_lo_update(is_hi, value.as_u32());
+    if (trace != nullptr) { trace->hi_lo(is_hi, value.as_u32()); }
 }
 
 bool Registers::operator==(const Registers &c) const {
@@ -156,3 +164,29 @@ void Registers::reset() {
     write_hi_lo(false, 0);
     write_hi_lo(true, 0);
 }
+
+void Registers::set_trace_writer(TraceWriter *writer) {
+    trace = writer;
+}
+
+void Registers::save_state(QDataStream &out) const {
+    out << (quint64)pc.get_raw();
+    out << (quint64)hi.as_u64() << (quint64)lo.as_u64();
+    for (size_t i = 1; i < REGISTER_COUNT; i++) {
+        out << (quint64)gp.at(i).as_u64();
+    }
+}
+
+void Registers::load_state(QDataStream &in) {
+    quint64 val;
+    in >> val;
+    pc_abs_jmp(Address(val));
+    in >> val;
+    write_hi_lo(true, RegisterValue((uint64_t)val));
+    in >> val;
+    write_hi_lo(false, RegisterValue((uint64_t)val));
+    for (size_t i = 1; i < REGISTER_COUNT; i++) {
+        in >> val;
+        write_gp(i, RegisterValue((uint64_t)val));
+    }
+}
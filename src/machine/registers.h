@@ -44,8 +44,12 @@
 #include <array>
 #include <cstdint>
 
+class QDataStream;
+
 namespace machine {
 
+class TraceWriter;
+
 /**
  * General-purpose register count
  */
@@ -108,6 +112,13 @@ public:
 
     void reset(); // Reset all values to zero (except pc)
 
+    // Checkpoint support, see Machine::save_checkpoint
+    void save_state(QDataStream &out) const;
+    void load_state(QDataStream &in);
+
+    // Register writes are recorded to the trace, copy is not traced
+    void set_trace_writer(TraceWriter *writer);
+
 signals:
     void pc_update(Address val);
     void gp_update(RegisterId reg, RegisterValue val);
@@ -125,6 +136,7 @@ private:
     std::array<RegisterValue, REGISTER_COUNT> gp {};
     RegisterValue hi {}, lo {};
     Address pc {}; // program counter
+    TraceWriter *trace = nullptr;
 };
 
 } // namespace machine
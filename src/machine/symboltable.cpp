@@ -118,6 +118,31 @@ bool SymbolTable::location_to_name(QString &name, SymbolValue value) const {
     return true;
 }
 
+bool SymbolTable::function_at(
+    QString &name,
+    SymbolValue &start,
+    SymbolValue address) const {
+    // ELF symbol types in the low nibble of info
+    constexpr SymbolInfo STT_NOTYPE = 0, STT_FUNC = 2;
+    auto iter = map_value_to_symbol.upperBound(address);
+    while (iter != map_value_to_symbol.begin()) {
+        --iter;
+        const SymbolTableEntry *p_entry = iter.value();
+        SymbolInfo type = p_entry->info & 0xf;
+        if (type != STT_NOTYPE && type != STT_FUNC) {
+            continue;
+        }
+        if (p_entry->size != 0 && address >= p_entry->value + p_entry->size) {
+            break;
+        }
+        name = p_entry->name;
+        start = p_entry->value;
+        return true;
+    }
+    name = "";
+    return false;
+}
+
 QStringList SymbolTable::names() const {
     return map_name_to_symbol.keys();
 }
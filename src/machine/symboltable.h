@@ -103,6 +103,12 @@ public slots:
      * single location as it is multimap.
      */
     bool location_to_name(QString &name, SymbolValue value) const;
+    /**
+     * Finds function (or untyped symbol, assembler labels are untyped)
+     * containing the address. Symbol without size extends up to the next
+     * symbol.
+     */
+    bool function_at(QString &name, SymbolValue &start, SymbolValue address) const;
 
 private:
     // QString cannot be made const, because it would not fit into QT gui API.
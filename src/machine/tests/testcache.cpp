@@ -36,11 +36,14 @@
 #include "common/endian.h"
 #include "machine/memory/backend/memory.h"
 #include "machine/memory/cache/cache.h"
+#include "machine/memory/cache/cache_coherence.h"
 #include "machine/memory/cache/cache_policy.h"
+#include "machine/memory/cache/cache_sweep.h"
 #include "machine/memory/memory_bus.h"
 #include "tests/data/cache_test_performance_data.h"
 #include "tst_machine.h"
 
+#include <algorithm>
 #include <tests/utils/integer_decomposition.h>
 #include <unordered_map>
 
@@ -285,3 +288,394 @@ void MachineTests::cache_correctness() {
         QCOMPARE(performance, cache_test_performance_data.at(case_number));
     }
 }
+
+void MachineTests::cache_coherence_data() {
+    QTest::addColumn<CacheConfig>("cache_c");
+    QTest::addColumn<unsigned>("interventions");
+
+    CacheConfig cache_c;
+    cache_c.set_enabled(true);
+    cache_c.set_set_count(4);
+    cache_c.set_block_size(2);
+    cache_c.set_associativity(1);
+    cache_c.set_write_policy(CacheConfig::WP_BACK);
+    QTest::newRow("Write back") << cache_c << (unsigned)2;
+    cache_c.set_write_policy(CacheConfig::WP_THROUGH_ALLOC);
+    QTest::newRow("Write through") << cache_c << (unsigned)0;
+}
+
+void MachineTests::cache_coherence() {
+    QFETCH(CacheConfig, cache_c);
+    QFETCH(unsigned, interventions);
+
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache cache0(&m_frontend, &cache_c);
+    Cache cache1(&m_frontend, &cache_c);
+    CacheCoherence coherence;
+    uint64_t written = 0;
+    coherence.add(&cache0, [&written](Address start, Address) { written = start.get_raw(); });
+    coherence.add(&cache1);
+
+    // Modified block is supplied to the reader, both copies are shared then
+    cache0.write_u32(0x100_addr, 0x11);
+    QCOMPARE(cache1.read_u32(0x100_addr), (uint32_t)0x11);
+    QCOMPARE(cache0.read_u32(0x104_addr), (uint32_t)0);
+    // Write to shared block invalidates the other copy
+    cache1.write_u32(0x104_addr, 0x22);
+    QCOMPARE(written, (uint64_t)0x104);
+    QVERIFY(!(cache0.location_status(0x104_addr) & LOCSTAT_CACHED));
+    QCOMPARE(cache0.read_u32(0x104_addr), (uint32_t)0x22);
+    QCOMPARE(cache0.read_u32(0x100_addr), (uint32_t)0x11);
+
+    const CacheCoherence::Statistics &st0 = coherence.get_statistics(0);
+    const CacheCoherence::Statistics &st1 = coherence.get_statistics(1);
+    QCOMPARE(st0.bus_writes, (uint32_t)1);
+    QCOMPARE(st0.bus_reads, (uint32_t)1);
+    QCOMPARE(st0.invalidations, (uint32_t)1);
+    QCOMPARE(st1.bus_reads, (uint32_t)1);
+    QCOMPARE(st1.upgrades, (uint32_t)1);
+    QCOMPARE(st1.invalidations, (uint32_t)0);
+    QCOMPARE(st0.interventions + st1.interventions, (uint32_t)interventions);
+}
+
+static void compare_cache_statistics(
+    const CacheStatistics &actual,
+    const CacheStatistics &expected) {
+    QCOMPARE(actual.hit_read, expected.hit_read);
+    QCOMPARE(actual.miss_read, expected.miss_read);
+    QCOMPARE(actual.hit_write, expected.hit_write);
+    QCOMPARE(actual.miss_write, expected.miss_write);
+    QCOMPARE(actual.mem_reads, expected.mem_reads);
+    QCOMPARE(actual.mem_writes, expected.mem_writes);
+    QCOMPARE(actual.burst_reads, expected.burst_reads);
+    QCOMPARE(actual.burst_writes, expected.burst_writes);
+}
+
+void MachineTests::cache_sweep_data() {
+    QTest::addColumn<CacheConfig>("cache_c");
+
+    CacheConfig cache_c;
+    cache_c.set_enabled(true);
+    cache_c.set_set_count(4);
+    cache_c.set_block_size(2);
+    cache_c.set_associativity(2);
+    cache_c.set_replacement_policy(CacheConfig::RP_LRU);
+    cache_c.set_write_policy(CacheConfig::WP_BACK);
+    QTest::newRow("Write back") << cache_c;
+    cache_c.set_write_policy(CacheConfig::WP_THROUGH_ALLOC);
+    QTest::newRow("Write through allocate") << cache_c;
+    cache_c.set_write_policy(CacheConfig::WP_THROUGH_NOALLOC);
+    QTest::newRow("Write through") << cache_c;
+}
+
+void MachineTests::cache_sweep() {
+    QFETCH(CacheConfig, cache_c);
+
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache cache(&m_frontend, &cache_c, 3, 4, 1);
+    CacheSweep sweep(3, 4, 1);
+    cache.set_reference_observer(
+        [&sweep](const CacheReference &ref) { sweep.record(ref); });
+
+    // Unaligned accesses of all sizes to a small working set with some
+    // accesses to peripherals and cache flushes
+    uint32_t seed = 1;
+    uint64_t val = 0;
+    for (int i = 0; i < 5000; i++) {
+        seed = seed * 1103515245 + 12345;
+        Address address((seed >> 8) % 0x600);
+        size_t size = 1 << ((seed >> 20) & 3);
+        if ((seed >> 24) % 97 == 0) {
+            address = Address(0xffffc000 + (address.get_raw() & ~3));
+            size = 4;
+        }
+        if ((seed >> 16) % 501 == 0) {
+            cache.flush();
+        } else if ((seed >> 28) & 1) {
+            cache.write(address, &val, size, {});
+        } else {
+            cache.read(&val, address, size, { .type = ae::REGULAR });
+        }
+    }
+    // Internal accesses do not contribute to the statistics
+    cache.read(&val, 0x100_addr, 4, { .type = ae::INTERNAL });
+
+    std::vector<CacheConfig> configs;
+    for (unsigned sets : { 1, 2, 4, 16 }) {
+        for (unsigned block : { 1, 2, 4 }) {
+            for (unsigned assoc : { 1, 2, 3, 8 }) {
+                CacheConfig config(cache_c);
+                config.set_set_count(sets);
+                config.set_block_size(block);
+                config.set_associativity(assoc);
+                configs.push_back(config);
+            }
+        }
+    }
+    for (auto policy : { CacheConfig::RP_LFU, CacheConfig::RP_NRU, CacheConfig::RP_SRRIP }) {
+        CacheConfig other(cache_c);
+        other.set_replacement_policy(policy);
+        configs.push_back(other);
+    }
+    // Tree of two ways is exact LRU, direct mapped cache has no tree at all
+    CacheConfig plru(cache_c);
+    plru.set_replacement_policy(CacheConfig::RP_PLRU);
+    const size_t two_way_plru = configs.size();
+    configs.push_back(plru);
+    plru.set_associativity(1);
+    const size_t direct_plru = configs.size();
+    configs.push_back(plru);
+    CacheConfig lru(cache_c);
+    lru.set_associativity(1);
+    const size_t direct_lru = std::find(configs.begin(), configs.end(), lru) - configs.begin();
+    QVERIFY(direct_lru < configs.size());
+    CacheConfig disabled(cache_c);
+    disabled.set_enabled(false);
+    configs.push_back(disabled);
+    configs.push_back(cache_c);
+
+    std::vector<CacheSweep::Result> results = sweep.evaluate(configs);
+    QCOMPARE(results.size(), configs.size());
+    for (size_t i = 0; i < configs.size(); i++) {
+        QVERIFY(results[i].config == configs[i]);
+        QCOMPARE(
+            results[i].replayed,
+            configs[i].enabled() && !CacheSweep::is_stack_evaluable(configs[i]));
+        compare_cache_statistics(
+            results[i].statistics, sweep.replay(configs[i]).statistics);
+    }
+    const CacheSweep::Result &same = results.back();
+    compare_cache_statistics(same.statistics, cache.get_statistics());
+    compare_cache_statistics(results[two_way_plru].statistics, same.statistics);
+    compare_cache_statistics(
+        results[direct_plru].statistics, results[direct_lru].statistics);
+    QCOMPARE(same.stall_count, cache.get_stall_count());
+    QCOMPARE(same.speed_improvement, cache.get_speed_improvement());
+    QCOMPARE(same.hit_rate, cache.get_hit_rate());
+}
+
+void MachineTests::cache_hierarchy_data() {
+    QTest::addColumn<unsigned>("inclusion");
+    QTest::addColumn<uint32_t>("l2_misses");
+    QTest::addColumn<uint32_t>("written_back");
+
+    QTest::newRow("NINE") << (unsigned)CacheConfig::IP_NINE << 5u << 0u;
+    QTest::newRow("Inclusive")
+        << (unsigned)CacheConfig::IP_INCLUSIVE << 5u << 0x1234u;
+    QTest::newRow("Exclusive") << (unsigned)CacheConfig::IP_EXCLUSIVE << 4u << 0u;
+}
+
+void MachineTests::cache_hierarchy() {
+    QFETCH(unsigned, inclusion);
+    QFETCH(uint32_t, l2_misses);
+    QFETCH(uint32_t, written_back);
+
+    CacheConfig l1_c;
+    l1_c.set_enabled(true);
+    l1_c.set_set_count(4);
+    l1_c.set_block_size(1);
+    l1_c.set_associativity(1);
+    l1_c.set_write_policy(CacheConfig::WP_BACK);
+    // Level 2 holds only two blocks to force evictions
+    CacheConfig l2_c(l1_c);
+    l2_c.set_set_count(1);
+    l2_c.set_associativity(2);
+    l2_c.set_replacement_policy(CacheConfig::RP_LRU);
+    l2_c.set_hit_latency(5);
+    l2_c.set_inclusion_policy((enum CacheConfig::InclusionPolicy)inclusion);
+
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache level2(&m_frontend, &l2_c, 10, 10, 0);
+    Cache level1(&level2, &l1_c, l2_c.hit_latency(), l2_c.hit_latency(), 1);
+    level2.add_upper_level(&level1);
+
+    level1.write_u32(0x0_addr, 0x1234);
+    QCOMPARE(level1.read_u32(0x4_addr), (uint32_t)0);
+    QCOMPARE(level1.read_u32(0x8_addr), (uint32_t)0);
+    // Conflicts with the modified block in level 1
+    QCOMPARE(level1.read_u32(0x10_addr), (uint32_t)0);
+    QCOMPARE(level1.read_u32(0x0_addr), (uint32_t)0x1234);
+
+    QCOMPARE(level1.get_miss_count(), (uint32_t)5);
+    QCOMPARE(level2.get_hit_count(), (uint32_t)1);
+    QCOMPARE(level2.get_miss_count(), l2_misses);
+    // Inclusive level writes back the block invalidated in level 1
+    QCOMPARE(m_frontend.read_u32(0x0_addr), written_back);
+    QCOMPARE(
+        level1.get_hierarchy_stall_count(),
+        level1.get_stall_count() + level2.get_stall_count());
+
+    level1.flush();
+    level2.flush();
+    QCOMPARE(m_frontend.read_u32(0x0_addr), (uint32_t)0x1234);
+}
+
+void MachineTests::cache_prefetch_data() {
+    QTest::addColumn<unsigned>("prefetcher");
+    QTest::addColumn<uint32_t>("cycle_step");
+    QTest::addColumn<uint32_t>("misses");
+    QTest::addColumn<uint32_t>("prefetches");
+    QTest::addColumn<uint32_t>("useful");
+    QTest::addColumn<uint32_t>("late");
+
+    QTest::newRow("None") << (unsigned)CacheConfig::PF_NONE << 100u << 16u
+                          << 0u << 0u << 0u;
+    QTest::newRow("Next line") << (unsigned)CacheConfig::PF_NEXT_LINE << 100u
+                               << 1u << 16u << 15u << 0u;
+    // Prefetch is issued one cycle before the access, fill takes 12 cycles
+    QTest::newRow("Stride") << (unsigned)CacheConfig::PF_STRIDE << 1u << 3u
+                            << 14u << 0u << 13u;
+    QTest::newRow("Stream") << (unsigned)CacheConfig::PF_STREAM << 100u << 1u
+                            << 17u << 15u << 0u;
+}
+
+void MachineTests::cache_prefetch() {
+    QFETCH(unsigned, prefetcher);
+    QFETCH(uint32_t, cycle_step);
+    QFETCH(uint32_t, misses);
+    QFETCH(uint32_t, prefetches);
+    QFETCH(uint32_t, useful);
+    QFETCH(uint32_t, late);
+
+    CacheConfig cache_c;
+    cache_c.set_enabled(true);
+    cache_c.set_set_count(8);
+    cache_c.set_block_size(2);
+    cache_c.set_associativity(2);
+    cache_c.set_replacement_policy(CacheConfig::RP_LRU);
+    cache_c.set_write_policy(CacheConfig::WP_BACK);
+    cache_c.set_prefetcher((enum CacheConfig::Prefetcher)prefetcher);
+    cache_c.set_prefetch_degree(prefetcher == CacheConfig::PF_STREAM ? 2 : 1);
+    cache_c.set_prefetch_table_size(2);
+
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    for (uint32_t addr = 0; addr < 0x100; addr += 4) {
+        m_frontend.write_u32(Address(addr), addr ^ 0xa5a5);
+    }
+    Cache cache(&m_frontend, &cache_c, 10, 10, 2);
+
+    // Single load instruction walks the array block by block
+    for (uint32_t i = 0; i < 16; i++) {
+        const Address address = Address(i * 8);
+        cache.access_hint(0x400_addr, i * cycle_step);
+        QCOMPARE(cache.read_u32(address), (uint32_t)((i * 8) ^ 0xa5a5));
+    }
+
+    const CacheStatistics &st = cache.get_statistics();
+    QCOMPARE(cache.get_miss_count(), misses);
+    QCOMPARE(cache.get_hit_count(), 16 - misses);
+    QCOMPARE(st.prefetches, prefetches);
+    QCOMPARE(st.prefetch_useful, useful);
+    QCOMPARE(st.prefetch_late, late);
+    QCOMPARE(st.prefetch_useless, (uint32_t)0);
+    // Prefetched blocks are counted in the memory traffic
+    QCOMPARE(cache.get_read_count(), (misses + prefetches) * 2);
+    // Only misses and late prefetches stall, the block is loaded in
+    // 10 + 2 cycles
+    QCOMPARE(cache.get_stall_count(), (misses + late) * 12);
+}
+
+void MachineTests::cache_high_associativity_data() {
+    QTest::addColumn<unsigned>("associativity");
+    QTest::addColumn<unsigned>("policy");
+
+    QTest::newRow("16 ways") << 16u << (unsigned)CacheConfig::RP_LRU;
+    // Ways not filling the whole vector compare are looked up one by one
+    QTest::newRow("37 ways") << 37u << (unsigned)CacheConfig::RP_LRU;
+    QTest::newRow("64 ways") << 64u << (unsigned)CacheConfig::RP_LRU;
+    // Tree is not complete
+    QTest::newRow("37 ways PLRU") << 37u << (unsigned)CacheConfig::RP_PLRU;
+    QTest::newRow("64 ways PLRU") << 64u << (unsigned)CacheConfig::RP_PLRU;
+    QTest::newRow("64 ways NRU") << 64u << (unsigned)CacheConfig::RP_NRU;
+    QTest::newRow("64 ways SRRIP") << 64u << (unsigned)CacheConfig::RP_SRRIP;
+}
+
+void MachineTests::cache_high_associativity() {
+    QFETCH(unsigned, associativity);
+    QFETCH(unsigned, policy);
+
+    CacheConfig cache_c;
+    cache_c.set_enabled(true);
+    cache_c.set_set_count(2);
+    cache_c.set_block_size(1);
+    cache_c.set_associativity(associativity);
+    cache_c.set_replacement_policy((CacheConfig::ReplacementPolicy)policy);
+    cache_c.set_write_policy(CacheConfig::WP_BACK);
+
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache cache(&m_frontend, &cache_c);
+
+    // Fill all ways of the first set, every block is found in its own way
+    for (uint32_t i = 0; i < associativity; i++) {
+        cache.write_u32(Address(i * 8), i + 1);
+    }
+    for (uint32_t i = 0; i < associativity; i++) {
+        QCOMPARE(cache.read_u32(Address(i * 8)), i + 1);
+    }
+    QCOMPARE(cache.get_miss_count(), associativity);
+    QCOMPARE(cache.get_hit_count(), associativity);
+    QCOMPARE(
+        cache.location_status(Address((associativity - 1) * 8)),
+        (enum LocationStatus)(LOCSTAT_CACHED | LOCSTAT_DIRTY));
+
+    // Least recently used block is evicted and written back (all policies
+    // agree for blocks filled and used in order)
+    QCOMPARE(cache.read_u32(Address(associativity * 8)), (uint32_t)0);
+    QCOMPARE(m_frontend.read_u32(0x0_addr), (uint32_t)1);
+    QCOMPARE(cache.location_status(0x0_addr), LOCSTAT_NONE);
+    QCOMPARE(cache.read_u32(0x8_addr), (uint32_t)2);
+    QCOMPARE(cache.get_miss_count(), associativity + 1);
+}
+
+void MachineTests::cache_replacement_data() {
+    QTest::addColumn<unsigned>("policy");
+    QTest::addColumn<unsigned>("evicted");
+
+    // Blocks 0-3 fill the set, block 0 is used again and block 4 replaces
+    QTest::newRow("LRU") << (unsigned)CacheConfig::RP_LRU << 1u;
+    QTest::newRow("LFU") << (unsigned)CacheConfig::RP_LFU << 1u;
+    // Tree points to the pair not containing block 0, block 3 is the more
+    // recent of the pair
+    QTest::newRow("PLRU") << (unsigned)CacheConfig::RP_PLRU << 2u;
+    // All lines are recently used, aging makes all of them victims
+    QTest::newRow("NRU") << (unsigned)CacheConfig::RP_NRU << 0u;
+    // Block 0 hit predicts near re-reference, the others are aged
+    QTest::newRow("SRRIP") << (unsigned)CacheConfig::RP_SRRIP << 1u;
+}
+
+void MachineTests::cache_replacement() {
+    QFETCH(unsigned, policy);
+    QFETCH(unsigned, evicted);
+
+    CacheConfig cache_c;
+    cache_c.set_enabled(true);
+    cache_c.set_set_count(1);
+    cache_c.set_block_size(1);
+    cache_c.set_associativity(4);
+    cache_c.set_replacement_policy((CacheConfig::ReplacementPolicy)policy);
+    cache_c.set_write_policy(CacheConfig::WP_BACK);
+
+    Memory m(BIG);
+    TrivialBus m_frontend(&m);
+    Cache cache(&m_frontend, &cache_c);
+
+    // Reset starts the policy over, the same block is evicted again
+    for (int i = 0; i < 2; i++) {
+        for (uint32_t block : { 0, 1, 2, 3, 0, 4 }) {
+            cache.read_u32(Address(block * 4));
+        }
+        QCOMPARE(cache.get_hit_count(), 1u);
+        QCOMPARE(cache.get_miss_count(), 5u);
+        for (uint32_t block = 0; block < 5; block++) {
+            QCOMPARE(
+                cache.location_status(Address(block * 4)),
+                block == evicted ? LOCSTAT_NONE : LOCSTAT_CACHED);
+        }
+        cache.reset();
+    }
+}
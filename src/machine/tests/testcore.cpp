@@ -34,13 +34,19 @@
  ******************************************************************************/
 
 #include "machine/core.h"
+#include "machine/history.h"
 #include "machine/machineconfig.h"
 #include "machine/memory/backend/memory.h"
 #include "machine/memory/cache/cache.h"
 #include "machine/memory/memory_bus.h"
+#include "machine/trace/trace_reader.h"
 #include "tst_machine.h"
 
+#include <QDataStream>
 #include <QVector>
+#include <climits>
+#include <memory>
+#include <sstream>
 
 using namespace machine;
 
@@ -1154,3 +1160,1398 @@ void MachineTests::pipecore_wb_memory_tests() {
         &reg_init, &i_cache, &d_cache, MachineConfig::HU_STALL_FORWARD);
     run_code_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
 }
+
+// Writes code words to memory starting at addr
+static void load_code(Memory &mem, Address addr, const QVector<uint32_t> &code) {
+    foreach (uint32_t i, code) {
+        memory_write_u32(&mem, addr.get_raw(), i);
+        addr += 4;
+    }
+}
+
+// Caches of the tests comparing cores running memory tests code
+static CacheConfig core_test_cache_config() {
+    CacheConfig cache_conf;
+    cache_conf.set_enabled(true);
+    cache_conf.set_set_count(4);     // Number of sets
+    cache_conf.set_block_size(2);    // Number of blocks
+    cache_conf.set_associativity(2); // Degree of associativity
+    cache_conf.set_replacement_policy(CacheConfig::RP_LRU);
+    cache_conf.set_write_policy(CacheConfig::WP_BACK);
+    return cache_conf;
+}
+
+void MachineTests::pipecore_headless_memory_tests_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::pipecore_headless_memory_tests() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    QFETCH(Memory, mem_init);
+    QFETCH(Memory, mem_res);
+    Registers reg_ref(reg_init);
+    Memory mem_ref(mem_init);
+    Memory mem_ref_res(mem_res);
+    Registers reg_ref_res(reg_res);
+    TrivialBus mem_init_frontend(&mem_init);
+    TrivialBus mem_ref_frontend(&mem_ref);
+    const CacheConfig cache_conf = core_test_cache_config();
+    Cache i_cache(&mem_init_frontend, &cache_conf);
+    Cache d_cache(&mem_init_frontend, &cache_conf);
+    Cache i_cache_ref(&mem_ref_frontend, &cache_conf);
+    Cache d_cache_ref(&mem_ref_frontend, &cache_conf);
+    CorePipelined core(
+        &reg_init, &i_cache, &d_cache, MachineConfig::HU_STALL_FORWARD, 1,
+        nullptr, true);
+    CorePipelined core_ref(
+        &reg_ref, &i_cache_ref, &d_cache_ref,
+        MachineConfig::HU_STALL_FORWARD);
+    QVERIFY(core.is_headless());
+    QVERIFY(!core_ref.is_headless());
+    run_code_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
+    run_code_fragment(core_ref, reg_ref, reg_ref_res, mem_ref, mem_ref_res, code);
+    // Headless mode has to be bit exact with the visualized one
+    QCOMPARE(reg_init, reg_ref);
+    QCOMPARE(core.get_cycle_count(), core_ref.get_cycle_count());
+    QCOMPARE(core.get_stall_count(), core_ref.get_stall_count());
+    QCOMPARE(i_cache.get_hit_count(), i_cache_ref.get_hit_count());
+    QCOMPARE(d_cache.get_miss_count(), d_cache_ref.get_miss_count());
+}
+
+void MachineTests::singlecore_block_interpreter_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::singlecore_block_interpreter() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    QFETCH(Memory, mem_init);
+    QFETCH(Memory, mem_res);
+
+    load_code(mem_init, reg_init.read_pc(), code);
+    load_code(mem_res, reg_init.read_pc(), code);
+
+    const CacheConfig cache_conf = core_test_cache_config();
+
+    for (int variant = 0; variant < 4; variant++) {
+        const bool delay_slot = variant & 1;
+        const bool fetch_simulated = variant & 2;
+        Registers reg_ref(reg_init);
+        Registers reg_run(reg_init);
+        Memory mem_ref(mem_init);
+        Memory mem_run(mem_init);
+        TrivialBus mem_ref_frontend(&mem_ref);
+        TrivialBus mem_run_frontend(&mem_run);
+        Cache i_cache_ref(&mem_ref_frontend, &cache_conf);
+        Cache d_cache_ref(&mem_ref_frontend, &cache_conf);
+        Cache i_cache_run(&mem_run_frontend, &cache_conf);
+        Cache d_cache_run(&mem_run_frontend, &cache_conf);
+        CoreSingle core_ref(&reg_ref, &i_cache_ref, &d_cache_ref, delay_slot);
+        CoreSingle core_run(&reg_run, &i_cache_run, &d_cache_run, delay_slot, 1, nullptr, true);
+        core_run.set_fetch_simulated(fetch_simulated);
+
+        for (int k = 0; k < 10000; k++) {
+            core_ref.step();
+        }
+        // Split the run to check that the state is kept between runs
+        QCOMPARE(core_run.run(1234), 1234u);
+        QCOMPARE(core_run.run(10000 - 1234), 10000u - 1234);
+
+        QCOMPARE(reg_run, reg_ref);
+        QCOMPARE(core_run.get_cycle_count(), core_ref.get_cycle_count());
+        if (fetch_simulated) {
+            QCOMPARE(i_cache_run.get_hit_count(), i_cache_ref.get_hit_count());
+            QCOMPARE(i_cache_run.get_miss_count(), i_cache_ref.get_miss_count());
+        } else {
+            // Blocks executed again are not fetched
+            QVERIFY(
+                i_cache_run.get_hit_count() + i_cache_run.get_miss_count()
+                < i_cache_ref.get_hit_count() + i_cache_ref.get_miss_count());
+        }
+        QCOMPARE(d_cache_run.get_hit_count(), d_cache_ref.get_hit_count());
+        QCOMPARE(d_cache_run.get_miss_count(), d_cache_ref.get_miss_count());
+        d_cache_run.sync();
+        d_cache_ref.sync();
+        QCOMPARE(mem_run, mem_ref);
+        if (delay_slot) {
+            reg_res.pc_abs_jmp(reg_run.read_pc()); // We do not compare result pc
+            QCOMPARE(reg_run, reg_res);
+            QCOMPARE(mem_run, mem_res);
+        }
+    }
+}
+
+void MachineTests::singlecore_block_modified_code() {
+    Registers reg_init;
+    const uint32_t loop = reg_init.read_pc().get_raw();
+    const uint32_t code[] = {
+        0xad6a0008, // sw t2, 8(t3)
+        0x014d5026, // xor t2, t2, t5
+        0x25290001, // addiu t1, t1, 1 (rewritten by the store)
+        0x25080001, // addiu t0, t0, 1
+        0x150cfffb, // bne t0, t4, loop
+        0x00000000, // nop
+    };
+    Memory mem_init(BIG);
+    for (size_t i = 0; i < sizeof(code) / sizeof(code[0]); i++) {
+        memory_write_u32(&mem_init, loop + 4 * i, code[i]);
+    }
+    // Each iteration rewrites its own increment to the other one
+    reg_init.write_gp(10, 0x25290100); // addiu t1, t1, 0x100
+    reg_init.write_gp(11, loop);
+    reg_init.write_gp(12, 50);
+    reg_init.write_gp(13, 0x25290100 ^ 0x25290001);
+
+    for (bool delay_slot : { true, false }) {
+        Registers reg_ref(reg_init);
+        Registers reg_run(reg_init);
+        Memory mem_ref(mem_init);
+        Memory mem_run(mem_init);
+        TrivialBus mem_ref_frontend(&mem_ref);
+        TrivialBus mem_run_frontend(&mem_run);
+        CoreSingle core_ref(&reg_ref, &mem_ref_frontend, &mem_ref_frontend, delay_slot);
+        CoreSingle core_run(
+            &reg_run, &mem_run_frontend, &mem_run_frontend, delay_slot, 1, nullptr, true);
+        core_run.set_fetch_simulated(false);
+
+        for (int k = 0; k < 400; k++) {
+            core_ref.step();
+        }
+        QCOMPARE(core_run.run(400), 400u);
+
+        QCOMPARE(reg_run, reg_ref);
+        QCOMPARE(reg_run.read_gp(9).as_u32(), 25 * 0x101u);
+        QCOMPARE(core_run.get_cycle_count(), core_ref.get_cycle_count());
+        QCOMPARE(mem_run, mem_ref);
+    }
+}
+
+void MachineTests::singlecore_run_end_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::singlecore_run_end() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Memory, mem_init);
+
+    load_code(mem_init, reg_init.read_pc(), code);
+    // Stop at the end of the outer loop, code after it never runs
+    Address end_addr = reg_init.read_pc() + 0x80;
+
+    for (bool headless : { false, true }) {
+        Registers reg_ref(reg_init);
+        Registers reg_run(reg_init);
+        Memory mem_ref(mem_init);
+        Memory mem_run(mem_init);
+        TrivialBus mem_ref_frontend(&mem_ref);
+        TrivialBus mem_run_frontend(&mem_run);
+        CoreSingle core_ref(&reg_ref, &mem_ref_frontend, &mem_ref_frontend, true);
+        CoreSingle core_run(
+            &reg_run, &mem_run_frontend, &mem_run_frontend, true, 1, nullptr, headless);
+
+        unsigned steps = 0;
+        do {
+            core_ref.step();
+            steps++;
+        } while (reg_ref.read_pc() < end_addr);
+
+        QCOMPARE(core_run.run(100000, false, end_addr), steps);
+        QCOMPARE(reg_run, reg_ref);
+        QCOMPARE(core_run.get_cycle_count(), core_ref.get_cycle_count());
+        QCOMPARE(mem_run, mem_ref);
+    }
+}
+
+void MachineTests::singlecore_jit_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::singlecore_jit() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    QFETCH(Memory, mem_init);
+    QFETCH(Memory, mem_res);
+
+    if (!JitEngine::is_supported()) {
+        QSKIP("JIT is not supported on this host");
+    }
+
+    load_code(mem_init, reg_init.read_pc(), code);
+    load_code(mem_res, reg_init.read_pc(), code);
+
+    const CacheConfig cache_conf = core_test_cache_config();
+
+    for (bool delay_slot : { true, false }) {
+        Registers reg_ref(reg_init);
+        Registers reg_run(reg_init);
+        Memory mem_ref(mem_init);
+        Memory mem_run(mem_init);
+        TrivialBus mem_ref_frontend(&mem_ref);
+        TrivialBus mem_run_frontend(&mem_run);
+        Cache i_cache_ref(&mem_ref_frontend, &cache_conf);
+        Cache d_cache_ref(&mem_ref_frontend, &cache_conf);
+        Cache i_cache_run(&mem_run_frontend, &cache_conf);
+        Cache d_cache_run(&mem_run_frontend, &cache_conf);
+        CoreSingle core_ref(&reg_ref, &i_cache_ref, &d_cache_ref, delay_slot);
+        CoreSingle core_run(&reg_run, &i_cache_run, &d_cache_run, delay_slot, 1, nullptr, true);
+        QVERIFY(core_run.set_jit_enabled(true));
+
+        for (int k = 0; k < 10000; k++) {
+            core_ref.step();
+        }
+        QCOMPARE(core_run.run(1234), 1234u);
+        QCOMPARE(core_run.run(10000 - 1234), 10000u - 1234);
+
+        // Instruction fetches of translated code are not simulated,
+        // program cache statistics are not compared
+        QCOMPARE(reg_run, reg_ref);
+        QCOMPARE(core_run.get_cycle_count(), core_ref.get_cycle_count());
+        QCOMPARE(d_cache_run.get_hit_count(), d_cache_ref.get_hit_count());
+        QCOMPARE(d_cache_run.get_miss_count(), d_cache_ref.get_miss_count());
+        d_cache_run.sync();
+        d_cache_ref.sync();
+        QCOMPARE(mem_run, mem_ref);
+        if (delay_slot) {
+            reg_res.pc_abs_jmp(reg_run.read_pc()); // We do not compare result pc
+            QCOMPARE(reg_run, reg_res);
+            QCOMPARE(mem_run, mem_res);
+        }
+    }
+}
+
+// Memory failing reads of given offset since n-th one, counts writes
+class FaultingMemory final : public BackendMemory {
+public:
+    FaultingMemory(Memory *memory, Offset fault_offset, unsigned fault_read)
+        : BackendMemory(BIG)
+        , memory(memory)
+        , fault_offset(fault_offset)
+        , fault_read(fault_read) {}
+
+    WriteResult
+    write(Offset destination, const void *source, size_t size, WriteOptions options) override {
+        writes++;
+        return memory->write(destination, source, size, options);
+    }
+
+    ReadResult
+    read(void *destination, Offset source, size_t size, ReadOptions options) const override {
+        if (source == fault_offset && ++reads >= fault_read) {
+            throw SIMULATOR_EXCEPTION(OutOfMemoryAccess, "Injected fault", "");
+        }
+        return memory->read(destination, source, size, options);
+    }
+
+    enum LocationStatus location_status(Offset offset) const override {
+        return memory->location_status(offset);
+    }
+
+    unsigned writes = 0;
+
+private:
+    Memory *const memory;
+    const Offset fault_offset;
+    const unsigned fault_read;
+    mutable unsigned reads = 0;
+};
+
+void MachineTests::singlecore_jit_fault() {
+    if (!JitEngine::is_supported()) {
+        QSKIP("JIT is not supported on this host");
+    }
+
+    Registers reg_init;
+    const uint32_t code[] = {
+        0xac080100, // sw t0, 0x100(zero)
+        0xac080104, // sw t0, 0x104(zero)
+        0x8c090200, // lw t1, 0x200(zero) (fails in translated code)
+        0x25080001, // addiu t0, t0, 1
+        0x150cfffb, // bne t0, t4, loop
+        0x00000000, // nop
+    };
+    Memory mem_init(BIG);
+    for (size_t i = 0; i < sizeof(code) / sizeof(code[0]); i++) {
+        memory_write_u32(&mem_init, reg_init.read_pc().get_raw() + 4 * i, code[i]);
+    }
+    reg_init.write_gp(12, 50);
+
+    for (bool delay_slot : { true, false }) {
+        Registers reg_ref(reg_init);
+        Registers reg_run(reg_init);
+        Memory mem_ref(mem_init);
+        Memory mem_run(mem_init);
+        FaultingMemory fault_ref(&mem_ref, 0x200, 20);
+        FaultingMemory fault_run(&mem_run, 0x200, 20);
+        TrivialBus mem_ref_frontend(&fault_ref);
+        TrivialBus mem_run_frontend(&fault_run);
+        CoreSingle core_ref(
+            &reg_ref, &mem_ref_frontend, &mem_ref_frontend, delay_slot, 1, nullptr, true);
+        CoreSingle core_run(
+            &reg_run, &mem_run_frontend, &mem_run_frontend, delay_slot, 1, nullptr, true);
+        QVERIFY(core_run.set_jit_enabled(true));
+
+        // Stores of the block preceding the failed load are not repeated
+        // when the interpreter executes the load again
+        bool ref_failed = false, run_failed = false;
+        try {
+            core_ref.run(1000);
+        } catch (SimulatorException &) { ref_failed = true; }
+        try {
+            core_run.run(1000);
+        } catch (SimulatorException &) { run_failed = true; }
+        QVERIFY(ref_failed);
+        QVERIFY(run_failed);
+        QCOMPARE(fault_run.writes, fault_ref.writes);
+        QCOMPARE(reg_run, reg_ref);
+        QCOMPARE(core_run.get_cycle_count(), core_ref.get_cycle_count());
+        QCOMPARE(mem_run, mem_ref);
+    }
+}
+
+void MachineTests::pipecore_checkpoint_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::pipecore_checkpoint() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Memory, mem_init);
+
+    load_code(mem_init, reg_init.read_pc(), code);
+
+    const CacheConfig cache_conf = core_test_cache_config();
+    BranchPredictorConfig bp_conf;
+    bp_conf.set_predictor(BranchPredictorConfig::BP_GSHARE);
+
+    Registers reg_ref(reg_init);
+    Memory mem_ref(mem_init);
+    TrivialBus mem_ref_frontend(&mem_ref);
+    Cache i_cache_ref(&mem_ref_frontend, &cache_conf);
+    Cache d_cache_ref(&mem_ref_frontend, &cache_conf);
+    CorePipelined core_ref(
+        &reg_ref, &i_cache_ref, &d_cache_ref, MachineConfig::HU_STALL_FORWARD, 1,
+        nullptr, false, bp_conf);
+
+    QByteArray checkpoint;
+    {
+        Registers reg_save(reg_init);
+        Memory mem_save(mem_init);
+        TrivialBus mem_save_frontend(&mem_save);
+        Cache i_cache_save(&mem_save_frontend, &cache_conf);
+        Cache d_cache_save(&mem_save_frontend, &cache_conf);
+        CorePipelined core_save(
+            &reg_save, &i_cache_save, &d_cache_save,
+            MachineConfig::HU_STALL_FORWARD, 1, nullptr, false, bp_conf);
+        for (int k = 0; k < 1234; k++) {
+            core_save.step();
+        }
+        QDataStream out(&checkpoint, QIODevice::WriteOnly);
+        reg_save.save_state(out);
+        mem_save.save_state(out);
+        i_cache_save.save_state(out);
+        d_cache_save.save_state(out);
+        core_save.save_state(out);
+    }
+
+    // Restored components continue exactly where the saved ones stopped
+    Registers reg_load;
+    Memory mem_load(mem_init.simulated_machine_endian);
+    TrivialBus mem_load_frontend(&mem_load);
+    Cache i_cache_load(&mem_load_frontend, &cache_conf);
+    Cache d_cache_load(&mem_load_frontend, &cache_conf);
+    CorePipelined core_load(
+        &reg_load, &i_cache_load, &d_cache_load,
+        MachineConfig::HU_STALL_FORWARD, 1, nullptr, false, bp_conf);
+    QDataStream in(checkpoint);
+    reg_load.load_state(in);
+    mem_load.load_state(in);
+    i_cache_load.load_state(in);
+    d_cache_load.load_state(in);
+    core_load.load_state(in);
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QVERIFY(in.atEnd());
+
+    for (int k = 0; k < 10000; k++) {
+        core_ref.step();
+    }
+    for (int k = 1234; k < 10000; k++) {
+        core_load.step();
+    }
+
+    QCOMPARE(reg_load, reg_ref);
+    QCOMPARE(core_load.get_cycle_count(), core_ref.get_cycle_count());
+    QCOMPARE(core_load.get_stall_count(), core_ref.get_stall_count());
+    QCOMPARE(
+        core_load.get_branch_predictor()->get_stats().lost_cycles,
+        core_ref.get_branch_predictor()->get_stats().lost_cycles);
+    QCOMPARE(i_cache_load.get_hit_count(), i_cache_ref.get_hit_count());
+    QCOMPARE(d_cache_load.get_hit_count(), d_cache_ref.get_hit_count());
+    QCOMPARE(d_cache_load.get_miss_count(), d_cache_ref.get_miss_count());
+    d_cache_load.sync();
+    d_cache_ref.sync();
+    QCOMPARE(mem_load, mem_ref);
+}
+
+void MachineTests::pipecore_history_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::pipecore_history() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Memory, mem_init);
+
+    load_code(mem_init, reg_init.read_pc(), code);
+    const Address break_addr = reg_init.read_pc() + 12;
+
+    const CacheConfig cache_conf = core_test_cache_config();
+
+    Registers reg_run(reg_init);
+    Memory mem_run(mem_init);
+    TrivialBus mem_run_frontend(&mem_run);
+    Cache i_cache_run(&mem_run_frontend, &cache_conf);
+    Cache d_cache_run(&mem_run_frontend, &cache_conf);
+    CorePipelined core_run(
+        &reg_run, &i_cache_run, &d_cache_run, MachineConfig::HU_STALL_FORWARD);
+    ExecutionHistory history(
+        &core_run, &mem_run, { &i_cache_run, &d_cache_run }, {}, 100, 1000);
+
+    // Recorded the same way as by the machine
+    const unsigned end = 3000;
+    auto record_run = [&]() {
+        history.record();
+        while (core_run.get_cycle_count() < end) {
+            unsigned batch = std::min(
+                end - core_run.get_cycle_count(), history.cycles_to_record());
+            core_run.run(batch);
+            history.record();
+        }
+    };
+    record_run();
+    QVERIFY(!history.travel_to(end + 1));
+
+    // Reference is stepped forward to the same cycle
+    unsigned last_hit = 0;
+    for (unsigned cycle : { end, 2999u, 2345u, 1234u, 100u, 0u }) {
+        Registers reg_ref(reg_init);
+        Memory mem_ref(mem_init);
+        TrivialBus mem_ref_frontend(&mem_ref);
+        Cache i_cache_ref(&mem_ref_frontend, &cache_conf);
+        Cache d_cache_ref(&mem_ref_frontend, &cache_conf);
+        CorePipelined core_ref(
+            &reg_ref, &i_cache_ref, &d_cache_ref,
+            MachineConfig::HU_STALL_FORWARD);
+        Address prev_pc = 0xffffffff_addr;
+        for (unsigned k = 0; k < cycle; k++) {
+            if (reg_ref.read_pc() == break_addr && prev_pc != break_addr) {
+                last_hit = std::max(last_hit, k);
+            }
+            prev_pc = reg_ref.read_pc();
+            core_ref.step();
+        }
+
+        QVERIFY(history.travel_to(cycle));
+        QCOMPARE(reg_run, reg_ref);
+        QCOMPARE(core_run.get_cycle_count(), core_ref.get_cycle_count());
+        QCOMPARE(core_run.get_stall_count(), core_ref.get_stall_count());
+        QCOMPARE(d_cache_run.get_hit_count(), d_cache_ref.get_hit_count());
+        QCOMPARE(d_cache_run.get_miss_count(), d_cache_ref.get_miss_count());
+        d_cache_run.sync();
+        d_cache_ref.sync();
+        QCOMPARE(mem_run, mem_ref);
+        // Newer snapshots are dropped, history continues from here
+        QVERIFY(!history.travel_to(cycle + 1));
+    }
+
+    // Return to the last breakpoint hit before the current cycle
+    record_run();
+    core_run.insert_hwbreak(break_addr);
+    QCOMPARE(history.travel_to_break(), last_hit != 0);
+    QCOMPARE(core_run.get_cycle_count(), last_hit);
+    QCOMPARE(reg_run.read_pc(), last_hit != 0 ? break_addr : reg_init.read_pc());
+    core_run.remove_hwbreak(break_addr);
+}
+
+// Counts calls to the host, results are journaled when requested
+class HostCallHandler final : public ExceptionHandler {
+public:
+    explicit HostCallHandler(bool journaled) : journaled(journaled) {}
+
+    bool handle_exception(
+        Core *core,
+        Registers *regs,
+        ExceptionCause excause,
+        Address inst_addr,
+        Address next_addr,
+        Address jump_branch_pc,
+        bool in_delay_slot,
+        Address mem_ref_addr) override {
+        UNUSED(core) UNUSED(excause) UNUSED(inst_addr) UNUSED(next_addr)
+        UNUSED(jump_branch_pc) UNUSED(in_delay_slot) UNUSED(mem_ref_addr)
+        int32_t result;
+        if (io_journal == nullptr || !io_journal->replay(IoJournal::OP_HOST_WRITE, result)) {
+            result = ++host_calls;
+            if (io_journal != nullptr) {
+                io_journal->record(IoJournal::OP_HOST_WRITE, result);
+            }
+        }
+        regs->write_gp(2, result);
+        return true;
+    }
+
+    bool set_io_journal(IoJournal *journal) override {
+        io_journal = journal;
+        return journaled;
+    }
+
+    int32_t host_calls = 0;
+
+private:
+    const bool journaled;
+    IoJournal *io_journal = nullptr;
+};
+
+void MachineTests::singlecore_history_journal() {
+    // loop: syscall; addu s0, s0, v0; beq zero, zero, loop; nop
+    const QVector<uint32_t> code = { 0x0000000c, 0x02028021, 0x1000fffd, 0x00000000 };
+    const Address start = 0x200_addr;
+
+    for (bool journaled : { true, false }) {
+        Registers reg_run;
+        reg_run.pc_abs_jmp(start);
+        Memory mem_run(BIG);
+        load_code(mem_run, start, code);
+        TrivialBus mem_run_frontend(&mem_run);
+        CoreSingle core_run(&reg_run, &mem_run_frontend, &mem_run_frontend, true);
+        auto *handler = new HostCallHandler(journaled);
+        core_run.register_exception_handler(EXCAUSE_SYSCALL, handler);
+        ExecutionHistory history(&core_run, &mem_run, {}, {}, 10, 1000);
+
+        // Core stops after each syscall
+        auto run_for = [&](unsigned cycles) {
+            const unsigned end = core_run.get_cycle_count() + cycles;
+            while (core_run.get_cycle_count() < end) {
+                core_run.run(end - core_run.get_cycle_count());
+            }
+        };
+
+        // Recorded the same way as by the machine
+        uint32_t v0_past = 0;
+        history.record();
+        while (core_run.get_cycle_count() < 400) {
+            core_run.run(history.cycles_to_record());
+            history.record();
+            if (core_run.get_cycle_count() == 120) {
+                v0_past = reg_run.read_gp(2).as_u32();
+            }
+        }
+        const int32_t calls = handler->host_calls;
+        const uint32_t sum = reg_run.read_gp(16).as_u32();
+        QVERIFY(calls > 1);
+
+        // Host effects cannot be suppressed, the past is not reachable
+        if (!journaled) {
+            QVERIFY(!history.travel_to(120));
+            QCOMPARE(core_run.get_cycle_count(), 400u);
+            continue;
+        }
+
+        // Calls replayed up to the travel target and forward again take
+        // their results from the journal
+        QVERIFY(history.travel_to(120));
+        QCOMPARE(handler->host_calls, calls);
+        QCOMPARE(reg_run.read_gp(2).as_u32(), v0_past);
+        run_for(400 - 120);
+        QCOMPARE(handler->host_calls, calls);
+        QCOMPARE(reg_run.read_gp(16).as_u32(), sum);
+
+        // Execution past the journal calls the host again
+        run_for(code.size() + 1);
+        QCOMPARE(handler->host_calls, calls + 1);
+        QCOMPARE(reg_run.read_gp(2).as_u32(), (uint32_t)calls + 1);
+    }
+}
+
+void MachineTests::pipecore_hwbreak_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::pipecore_hwbreak() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Memory, mem_init);
+
+    load_code(mem_init, reg_init.read_pc(), code);
+    const Address break_addr = reg_init.read_pc() + 12;
+    const unsigned cycles = 3000;
+
+    // Breakpoint which is never reached counts all hits
+    unsigned hits;
+    {
+        Registers reg(reg_init);
+        Memory mem(mem_init);
+        TrivialBus mem_frontend(&mem);
+        CorePipelined core(
+            &reg, &mem_frontend, &mem_frontend,
+            MachineConfig::HU_STALL_FORWARD);
+        core.insert_hwbreak(break_addr + 4096, 0);
+        core.insert_hwbreak(break_addr, UINT_MAX);
+        QCOMPARE(core.run(cycles), cycles);
+        hits = core.get_hwbreak_count(break_addr);
+        QCOMPARE(core.get_hwbreak_count(break_addr + 4096), 0u);
+    }
+    QVERIFY(hits > 0);
+
+    for (unsigned ignore_count : { 0u, hits / 2, hits - 1 }) {
+        Registers reg(reg_init);
+        Memory mem(mem_init);
+        TrivialBus mem_frontend(&mem);
+        CorePipelined core(
+            &reg, &mem_frontend, &mem_frontend,
+            MachineConfig::HU_STALL_FORWARD);
+        core.insert_hwbreak(break_addr, ignore_count);
+        QVERIFY(core.run(cycles) < cycles);
+        QCOMPARE(core.get_hwbreak_count(break_addr), ignore_count + 1);
+        core.reset_hwbreak_counts();
+        QCOMPARE(core.get_hwbreak_count(break_addr), 0u);
+        core.remove_hwbreak(break_addr);
+        QVERIFY(!core.is_hwbreak(break_addr));
+    }
+}
+
+void MachineTests::pipecore_watchpoint_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::pipecore_watchpoint() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Memory, mem_init);
+
+    load_code(mem_init, reg_init.read_pc(), code);
+    const unsigned cycles = 3000;
+    TrivialBus mem_init_frontend(&mem_init);
+    auto read_sized = [](const FrontendMemory &mem, Address address, unsigned size) {
+        switch (size) {
+        case 1: return (uint64_t)mem.read_u8(address);
+        case 2: return (uint64_t)mem.read_u16(address);
+        case 4: return (uint64_t)mem.read_u32(address);
+        default: return mem.read_u64(address);
+        }
+    };
+
+    Registers reg_ref(reg_init);
+    Memory mem_ref(mem_init);
+    TrivialBus mem_ref_frontend(&mem_ref);
+    CorePipelined core_ref(
+        &reg_ref, &mem_ref_frontend, &mem_ref_frontend,
+        MachineConfig::HU_STALL_FORWARD);
+    QCOMPARE(core_ref.run(cycles), cycles);
+
+    for (auto type : { Core::WATCH_READ, Core::WATCH_WRITE }) {
+        Registers reg(reg_init);
+        Memory mem(mem_init);
+        TrivialBus mem_frontend(&mem);
+        CorePipelined core(
+            &reg, &mem_frontend, &mem_frontend, MachineConfig::HU_STALL_FORWARD);
+        // Range spanning all pages stops on the first access
+        core.insert_watchpoint(0x0_addr, 0xffffffff_addr, type);
+        unsigned executed = core.run(cycles);
+        QVERIFY(executed < cycles);
+        const Core::WatchpointHit &hit = core.get_watchpoint_hit();
+        QCOMPARE(hit.type, type);
+        QCOMPARE(hit.new_value.as_u64(), read_sized(mem_frontend, hit.mem_addr, hit.size));
+        QCOMPARE(
+            hit.old_value.as_u64(), read_sized(mem_init_frontend, hit.mem_addr, hit.size));
+        if (type == Core::WATCH_READ) {
+            QCOMPARE(hit.new_value.as_u64(), hit.old_value.as_u64());
+        }
+
+        // Watchpoint does not affect the execution
+        core.remove_watchpoint(0x0_addr);
+        QVERIFY(!core.has_watchpoints());
+        QCOMPARE(core.run(cycles - executed), cycles - executed);
+        QCOMPARE(reg, reg_ref);
+        QCOMPARE(mem, mem_ref);
+    }
+}
+
+void MachineTests::pipecore_trace_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::pipecore_trace() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Memory, mem_init);
+
+    load_code(mem_init, reg_init.read_pc(), code);
+    const unsigned cycles = 3000;
+    Registers reg(reg_init);
+    Memory mem(mem_init);
+    TrivialBus mem_frontend(&mem);
+    CorePipelined core(
+        &reg, &mem_frontend, &mem_frontend, MachineConfig::HU_STALL_FORWARD);
+    std::stringstream stream;
+    TraceWriter writer(stream, 256);
+    core.set_trace_writer(&writer);
+    reg.set_trace_writer(&writer);
+    QCOMPARE(core.run(cycles), cycles);
+    writer.finish();
+
+    // Replayed register and memory writes give the final state
+    Registers reg_replay(reg_init);
+    Memory mem_replay(mem_init);
+    TrivialBus mem_replay_frontend(&mem_replay);
+    TraceReader reader(stream);
+    QVERIFY(reader.open());
+    TraceRecord rec;
+    unsigned writebacks = 0;
+    while (reader.next(rec)) {
+        switch (rec.type) {
+        case TraceRecord::PC: reg_replay.pc_abs_jmp(Address(rec.address)); break;
+        case TraceRecord::GP: reg_replay.write_gp(rec.reg, rec.value); break;
+        case TraceRecord::HI_LO:
+            reg_replay.write_hi_lo(rec.flags & TraceRecord::HI, rec.value);
+            break;
+        case TraceRecord::MEM:
+            if (rec.flags & TraceRecord::WRITE) {
+                Address address(rec.address);
+                switch (rec.size) {
+                case 1: mem_replay_frontend.write_u8(address, rec.value); break;
+                case 2: mem_replay_frontend.write_u16(address, rec.value); break;
+                case 4: mem_replay_frontend.write_u32(address, rec.value); break;
+                default: mem_replay_frontend.write_u64(address, rec.value); break;
+                }
+            }
+            break;
+        case TraceRecord::WRITEBACK:
+            writebacks += (rec.flags & TraceRecord::VALID) ? 1 : 0;
+            break;
+        default: break;
+        }
+    }
+    QVERIFY(reader.get_error().empty());
+    QCOMPARE(rec.cycle, (uint64_t)cycles);
+    QVERIFY(writebacks > 0);
+    QCOMPARE(reg_replay, reg);
+    // SWL and SWR record the register value, not the merged word
+    bool partial_stores = false;
+    foreach (uint32_t i, code) {
+        partial_stores |= (i >> 26) == 42 || (i >> 26) == 46;
+    }
+    if (!partial_stores) { QCOMPARE(mem_replay, mem); }
+}
+
+void MachineTests::pipecore_profile_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::pipecore_profile() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Memory, mem_init);
+
+    load_code(mem_init, reg_init.read_pc(), code);
+    TrivialBus mem_frontend(&mem_init);
+    CacheConfig cache_conf;
+    cache_conf.set_enabled(true);
+    cache_conf.set_set_count(2);
+    cache_conf.set_block_size(1);
+    cache_conf.set_associativity(2);
+    cache_conf.set_replacement_policy(CacheConfig::RP_LRU);
+    cache_conf.set_write_policy(CacheConfig::WP_BACK);
+    Cache i_cache(&mem_frontend, &cache_conf);
+    Cache d_cache(&mem_frontend, &cache_conf);
+    CorePipelined core(
+        &reg_init, &i_cache, &d_cache, MachineConfig::HU_STALL_FORWARD);
+    Profiler profiler(&i_cache, &d_cache);
+    core.set_profiler(&profiler);
+    const unsigned cycles = 1000;
+    QCOMPARE(core.run(cycles), cycles);
+
+    // Every cycle, stall and cache miss is attributed to some instruction
+    Profiler::Counters total = profiler.get_total();
+    QCOMPARE(total.cycles, (uint64_t)core.get_cycle_count());
+    QCOMPARE(total.stalls, (uint64_t)core.get_stall_count());
+    QCOMPARE(total.icache_misses, (uint64_t)i_cache.get_miss_count());
+    QCOMPARE(total.dcache_misses, (uint64_t)d_cache.get_miss_count());
+    QVERIFY(total.instructions > 0);
+    QVERIFY(total.instructions <= total.cycles);
+    QVERIFY(profiler.get_instructions().count(0x80020000) != 0);
+
+    std::vector<Profiler::Function> functions = profiler.get_functions(nullptr);
+    QCOMPARE(functions.size(), (size_t)1);
+    QVERIFY(functions[0].name.isEmpty());
+    QCOMPARE(functions[0].counters.cycles, total.cycles);
+}
+
+void MachineTests::core_profile_calls() {
+    QVector<uint32_t> code {
+        0x0c008008, // jal     80020020 <outer>
+        0x00000000, // nop
+        0x0c008008, // jal     80020020 <outer>
+        0x00000000, // nop
+        // loop:
+        0x1000ffff, // b       80020010 <loop>
+        0x00000000, // nop
+        0x00000000, // nop
+        0x00000000, // nop
+        // outer:
+        0x03e04020, // add     t0,ra,zero
+        0x0c008010, // jal     80020040 <inner>
+        0x00000000, // nop
+        0x0100f820, // add     ra,t0,zero
+        0x03e00008, // jr      ra
+        0x00000000, // nop
+        0x00000000, // nop
+        0x00000000, // nop
+        // inner:
+        0x03e00008, // jr      ra
+        0x20420001, // addi    v0,v0,1
+    };
+    for (bool pipelined : { false, true }) {
+        Memory mem(BIG);
+        load_code(mem, Address(0x80020000), code);
+        Registers regs;
+        TrivialBus mem_frontend(&mem);
+        std::unique_ptr<Core> core;
+        if (pipelined) {
+            core.reset(new CorePipelined(
+                &regs, &mem_frontend, &mem_frontend, MachineConfig::HU_STALL_FORWARD));
+        } else {
+            core.reset(new CoreSingle(&regs, &mem_frontend, &mem_frontend, true));
+        }
+        Profiler profiler(nullptr, nullptr);
+        core->set_profiler(&profiler);
+        core->run(100);
+        QCOMPARE(regs.read_gp(2).as_u32(), 2u);
+
+        // All calls returned, inner calls are part of the outer ones
+        std::vector<Profiler::Call> calls = profiler.get_calls();
+        QCOMPARE(calls.size(), (size_t)3);
+        QCOMPARE(calls[0].call_site, 0x80020000_addr);
+        QCOMPARE(calls[0].target, 0x80020020_addr);
+        QCOMPARE(calls[0].count, (uint64_t)1);
+        QCOMPARE(calls[1].call_site, 0x80020008_addr);
+        QCOMPARE(calls[1].count, (uint64_t)1);
+        QCOMPARE(calls[2].call_site, 0x80020024_addr);
+        QCOMPARE(calls[2].target, 0x80020040_addr);
+        QCOMPARE(calls[2].count, (uint64_t)2);
+        QCOMPARE(calls[2].inclusive.instructions, (uint64_t)4);
+        QVERIFY(calls[2].inclusive.cycles > 0);
+        QVERIFY(
+            calls[0].inclusive.cycles + calls[1].inclusive.cycles
+            > calls[2].inclusive.cycles);
+        QVERIFY(
+            calls[0].inclusive.cycles + calls[1].inclusive.cycles
+            < profiler.get_total().cycles);
+
+        std::stringstream out;
+        profiler.write_callgrind(out, nullptr);
+        QVERIFY(out.str().find("calls=2 0x80020040\n0x80020024 ") != std::string::npos);
+    }
+}
+
+void MachineTests::pipecore_branch_predictor_data() {
+    QTest::addColumn<bool>("calls");
+    QTest::addColumn<QString>("kind");
+    QTest::addColumn<unsigned>("btb");
+    QTest::addColumn<unsigned>("ras");
+    QTest::addColumn<unsigned>("mispredictions");
+
+    // Loop of 10 iterations, without BTB taken branches know their target
+    QTest::newRow("loop_not_taken") << false << QString("not-taken") << 0u << 0u << 9u;
+    QTest::newRow("loop_taken") << false << QString("taken") << 0u << 0u << 1u;
+    QTest::newRow("loop_taken_btb") << false << QString("taken") << 64u << 0u << 2u;
+    QTest::newRow("loop_btfn") << false << QString("btfn") << 64u << 0u << 2u;
+    QTest::newRow("loop_1bit") << false << QString("1bit") << 64u << 0u << 2u;
+    QTest::newRow("loop_2bit") << false << QString("2bit") << 64u << 0u << 2u;
+    // Each iteration has new history, counters are not trained yet
+    QTest::newRow("loop_gshare") << false << QString("gshare") << 64u << 0u << 9u;
+    // Two calls of a function, the returns are predicted by RAS or BTB
+    QTest::newRow("call_ras") << true << QString("2bit") << 0u << 8u << 0u;
+    QTest::newRow("call_no_ras") << true << QString("2bit") << 0u << 0u << 2u;
+    QTest::newRow("call_btb") << true << QString("2bit") << 64u << 0u << 4u;
+    QTest::newRow("call_btb_ras") << true << QString("2bit") << 64u << 8u << 2u;
+}
+
+void MachineTests::pipecore_branch_predictor() {
+    QFETCH(bool, calls);
+    QFETCH(QString, kind);
+    QFETCH(unsigned, btb);
+    QFETCH(unsigned, ras);
+    QFETCH(unsigned, mispredictions);
+
+    QVector<uint32_t> code;
+    if (!calls) {
+        code = {
+            0x2008000a, // addi    t0,zero,10
+            // loop:
+            0x2108ffff, // addi    t0,t0,-1
+            0x1500fffe, // bnez    t0,80020004 <loop>
+            0x21290001, // addi    t1,t1,1
+            // end:
+            0x1000ffff, // b       80020010 <end>
+            0x00000000, // nop
+        };
+    } else {
+        code = {
+            0x0c008008, // jal     80020020 <fnc>
+            0x21290001, // addi    t1,t1,1
+            0x0c008008, // jal     80020020 <fnc>
+            0x21290001, // addi    t1,t1,1
+            // end:
+            0x1000ffff, // b       80020010 <end>
+            0x00000000, // nop
+            0x00000000, // nop
+            0x00000000, // nop
+            // fnc:
+            0x03e00008, // jr      ra
+            0x21080001, // addi    t0,t0,1
+        };
+    }
+    const Address end = 0x80020010_addr;
+    Memory mem(BIG);
+    load_code(mem, Address(0x80020000), code);
+    TrivialBus mem_frontend(&mem);
+    BranchPredictorConfig config;
+    QVERIFY(config.set_predictor(kind));
+    config.set_btb_size(btb);
+    config.set_ras_depth(ras);
+    config.set_penalty(3);
+
+    Registers regs_ref;
+    CorePipelined core_ref(&regs_ref, &mem_frontend, &mem_frontend);
+    Registers regs;
+    CorePipelined core(
+        &regs, &mem_frontend, &mem_frontend, MachineConfig::HU_STALL_FORWARD, 1,
+        nullptr, false, config);
+    QVERIFY(core_ref.get_branch_predictor() == nullptr);
+    const BranchPredictor *predictor = core.get_branch_predictor();
+    QVERIFY(predictor != nullptr);
+
+    // Prediction changes timing only, lost cycles are added to stalls. The
+    // end is reached when the branch at the end has been fetched.
+    while (regs_ref.read_pc() != end + 4) {
+        core_ref.step();
+    }
+    while (regs.read_pc() != end + 4) {
+        core.step();
+    }
+    const BranchPredictor::Stats &stats = predictor->get_stats();
+    QCOMPARE(stats.branches, (uint64_t)(calls ? 4 : 10));
+    QCOMPARE(stats.mispredictions(), (uint64_t)mispredictions);
+    QCOMPARE(stats.lost_cycles, (uint64_t)mispredictions * 3);
+    QCOMPARE(
+        core.get_cycle_count(), core_ref.get_cycle_count() + stats.lost_cycles);
+    QCOMPARE(
+        core.get_stall_count(), core_ref.get_stall_count() + stats.lost_cycles);
+    uint64_t executed = 0;
+    for (const auto &item : predictor->get_branch_stats()) {
+        executed += item.second.executed;
+    }
+    QCOMPARE(executed, stats.branches);
+
+    for (unsigned i = 0; i < 6; i++) {
+        core_ref.step();
+        core.step();
+    }
+    regs.pc_abs_jmp(regs_ref.read_pc());
+    QCOMPARE(regs, regs_ref);
+    QCOMPARE(regs.read_gp(8).as_u32(), calls ? 2u : 0u);
+    QCOMPARE(regs.read_gp(9).as_u32(), calls ? 2u : 10u);
+}
+
+// Fetch runs ahead of issue of single instructions, the end address is
+// passed before the delay slot of the last jump is issued and the pipeline
+// needs more cycles to drain than in run_code_fragment
+static void run_dual_issue_fragment(
+    Core &core,
+    Registers &reg_init,
+    Registers &reg_res,
+    Memory &mem_init,
+    Memory &mem_res,
+    QVector<uint32_t> &code) {
+    load_code(mem_init, reg_init.read_pc(), code);
+    load_code(mem_res, reg_init.read_pc(), code);
+
+    for (int k = 10000; k; k--) {
+        core.step();
+        if (reg_init.read_pc() == reg_res.read_pc() && k > 20) {
+            k = 20;
+        }
+    }
+    reg_res.pc_abs_jmp(reg_init.read_pc()); // We do not compare result pc
+    QCOMPARE(reg_init, reg_res);
+    QCOMPARE(mem_init, mem_res);
+}
+
+void MachineTests::pipecore_dual_issue_alu_forward_data() {
+    core_alu_forward_data();
+}
+
+void MachineTests::pipecore_dual_issue_alu_forward() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    Memory mem_init(BIG);
+    TrivialBus mem_init_frontend(&mem_init);
+    Memory mem_res(BIG);
+    TrivialBus mem_res_frontend(&mem_res);
+    CorePipelined core(
+        &reg_init, &mem_init_frontend, &mem_init_frontend,
+        MachineConfig::HU_STALL_FORWARD, 1, nullptr, false, BranchPredictorConfig(), true);
+    run_dual_issue_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
+}
+
+void MachineTests::pipecore_dual_issue_memory_tests_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::pipecore_dual_issue_memory_tests() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    QFETCH(Memory, mem_init);
+    QFETCH(Memory, mem_res);
+    TrivialBus mem_init_frontend(&mem_init);
+    TrivialBus mem_res_frontend(&mem_res);
+    CorePipelined core(
+        &reg_init, &mem_init_frontend, &mem_init_frontend,
+        MachineConfig::HU_STALL_FORWARD, 1, nullptr, false, BranchPredictorConfig(), true);
+    run_dual_issue_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
+    const DualIssueStats *stats = core.get_dual_issue();
+    QVERIFY(stats != nullptr);
+    uint64_t single = 0;
+    for (uint64_t count : stats->single) {
+        single += count;
+    }
+    QCOMPARE(stats->dual + single, stats->issue_cycles);
+}
+
+void MachineTests::pipecore_dual_issue_data() {
+    QTest::addColumn<QVector<uint32_t>>("code");
+    QTest::addColumn<unsigned>("cycles");
+    QTest::addColumn<unsigned>("dual");
+    QTest::addColumn<unsigned>("pipe");
+    QTest::addColumn<unsigned>("dependency");
+    QTest::addColumn<unsigned>("hazard");
+
+    QVector<uint32_t> independent {
+        0x24080001, // li      t0,1
+        0x24090002, // li      t1,2
+        0x240a0003, // li      t2,3
+        0x240b0004, // li      t3,4
+        0x240c0005, // li      t4,5
+        0x240d0006, // li      t5,6
+        0x240e0007, // li      t6,7
+        0x240f0008, // li      t7,8
+        // end:
+        0x1000ffff, // b       80020020 <end>
+        0x00000000, // nop
+    };
+    QVector<uint32_t> dependent {
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        // end:
+        0x1000ffff, // b       80020020 <end>
+        0x00000000, // nop
+    };
+    QVector<uint32_t> memory {
+        0x24090005, // li      t1,5
+        0xac090100, // sw      t1,256(zero)
+        0x8c0b0100, // lw      t3,256(zero)
+        0x240a0007, // li      t2,7
+        0x240d0001, // li      t5,1
+        0x016a6021, // addu    t4,t3,t2
+        0x01a97021, // addu    t6,t5,t1
+        0x240f0002, // li      t7,2
+        // end:
+        0x1000ffff, // b       80020020 <end>
+        0x00000000, // nop
+    };
+    // Cycles until all results are written back, the branch at the end
+    // pairs with its delay slot
+    QTest::newRow("independent") << independent << 8u << 7u << 0u << 0u << 0u;
+    QTest::newRow("dependent") << dependent << 12u << 3u << 1u << 7u << 0u;
+    // Memory instructions issue only in the first slot, addu in the second
+    // slot waits for the load in the execute stage
+    QTest::newRow("memory") << memory << 10u << 5u << 3u << 0u << 1u;
+}
+
+void MachineTests::pipecore_dual_issue() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(unsigned, cycles);
+    QFETCH(unsigned, dual);
+    QFETCH(unsigned, pipe);
+    QFETCH(unsigned, dependency);
+    QFETCH(unsigned, hazard);
+
+    Memory mem(BIG);
+    load_code(mem, Address(0x80020000), code);
+    Memory mem_ref(mem);
+    TrivialBus mem_frontend(&mem);
+    TrivialBus mem_ref_frontend(&mem_ref);
+    Registers regs;
+    Registers regs_ref;
+    CorePipelined core(
+        &regs, &mem_frontend, &mem_frontend, MachineConfig::HU_STALL_FORWARD, 1, nullptr,
+        false, BranchPredictorConfig(), true);
+    CoreSingle core_ref(&regs_ref, &mem_ref_frontend, &mem_ref_frontend, true);
+    const DualIssueStats *stats = core.get_dual_issue();
+    QVERIFY(stats != nullptr);
+
+    const Address end = 0x80020020_addr;
+    while (regs_ref.read_pc() != end + 4) {
+        core_ref.step();
+    }
+    QByteArray checkpoint;
+    for (unsigned k = 0;; k++) {
+        QVERIFY(k < 100);
+        if (k == 3) {
+            QDataStream out(&checkpoint, QIODevice::WriteOnly);
+            regs.save_state(out);
+            mem.save_state(out);
+            core.save_state(out);
+        }
+        core.step();
+        Registers done(regs);
+        done.pc_abs_jmp(regs_ref.read_pc());
+        if (done == regs_ref) { break; }
+    }
+    QCOMPARE(mem, mem_ref);
+    QCOMPARE(core.get_cycle_count(), cycles);
+    QCOMPARE(stats->dual, (uint64_t)dual);
+    QCOMPARE(stats->single[DualIssueStats::SI_PIPE], (uint64_t)pipe);
+    QCOMPARE(stats->single[DualIssueStats::SI_DEPENDENCY], (uint64_t)dependency);
+    QCOMPARE(stats->single[DualIssueStats::SI_HAZARD], (uint64_t)hazard);
+
+    // Instructions in flight of both pipes are restored from checkpoint
+    Memory mem_load(BIG);
+    TrivialBus mem_load_frontend(&mem_load);
+    Registers regs_load;
+    CorePipelined core_load(
+        &regs_load, &mem_load_frontend, &mem_load_frontend, MachineConfig::HU_STALL_FORWARD,
+        1, nullptr, false, BranchPredictorConfig(), true);
+    QDataStream in(checkpoint);
+    regs_load.load_state(in);
+    mem_load.load_state(in);
+    core_load.load_state(in);
+    QCOMPARE(in.status(), QDataStream::Ok);
+    while (core_load.get_cycle_count() < cycles) {
+        core_load.step();
+    }
+    QCOMPARE(regs_load, regs);
+    QCOMPARE(core_load.get_dual_issue()->dual, stats->dual);
+    QCOMPARE(core_load.get_dual_issue()->issue_cycles, stats->issue_cycles);
+}
+
+void MachineTests::ooocore_alu_forward_data() {
+    core_alu_forward_data();
+}
+
+void MachineTests::ooocore_alu_forward() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    Memory mem_init(BIG);
+    TrivialBus mem_init_frontend(&mem_init);
+    Memory mem_res(BIG);
+    TrivialBus mem_res_frontend(&mem_res);
+    OutOfOrderConfig config;
+    config.set_issue_width(4);
+    CoreOutOfOrder core(&reg_init, &mem_init_frontend, &mem_init_frontend, true, config);
+    run_code_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
+}
+
+void MachineTests::ooocore_memory_tests_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::ooocore_memory_tests() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    QFETCH(Memory, mem_init);
+    QFETCH(Memory, mem_res);
+    TrivialBus mem_init_frontend(&mem_init);
+    TrivialBus mem_res_frontend(&mem_res);
+    const CacheConfig cache_conf = core_test_cache_config();
+    Cache i_cache(&mem_init_frontend, &cache_conf, 4, 4);
+    Cache d_cache(&mem_init_frontend, &cache_conf, 4, 4);
+    OutOfOrderConfig config;
+    config.set_lsq_size(2);
+    CoreOutOfOrder core(&reg_init, &i_cache, &d_cache, true, config);
+    core.set_memory_timing(&i_cache, &d_cache);
+    run_code_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
+    const OutOfOrderEngine::Stats &stats = core.get_out_of_order()->get_stats();
+    QCOMPARE(stats.cycles, (uint64_t)core.get_cycle_count());
+    QVERIFY(stats.committed <= stats.dispatched);
+    QVERIFY(stats.lsq.max <= 2);
+}
+
+void MachineTests::ooocore_timing_data() {
+    QTest::addColumn<QVector<uint32_t>>("code");
+    QTest::addColumn<unsigned>("width");
+    QTest::addColumn<unsigned>("rob");
+    QTest::addColumn<unsigned>("cycles");
+    QTest::addColumn<unsigned>("stalls");
+
+    // Eight instructions and branch with delay slot at the end
+    QVector<uint32_t> independent {
+        0x24080001, // li      t0,1
+        0x24090002, // li      t1,2
+        0x240a0003, // li      t2,3
+        0x240b0004, // li      t3,4
+        0x240c0005, // li      t4,5
+        0x240d0006, // li      t5,6
+        0x240e0007, // li      t6,7
+        0x240f0008, // li      t7,8
+        // end:
+        0x1000ffff, // b       80020020 <end>
+        0x00000000, // nop
+    };
+    QVector<uint32_t> dependent {
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        0x25080001, // addiu   t0,t0,1
+        // end:
+        0x1000ffff, // b       80020020 <end>
+        0x00000000, // nop
+    };
+    QVector<uint32_t> divide {
+        0x0109001a, // div     zero,t0,t1
+        0x0109001a, // div     zero,t0,t1
+        0x24080001, // li      t0,1
+        0x24090002, // li      t1,2
+        0x240a0003, // li      t2,3
+        0x240b0004, // li      t3,4
+        0x240c0005, // li      t4,5
+        0x240d0006, // li      t5,6
+        // end:
+        0x1000ffff, // b       80020020 <end>
+        0x00000000, // nop
+    };
+    // Cycles until the branch at the end commits. The first cycle dispatches
+    // empty delay slot latch, the loop at the end keeps dispatching.
+    QTest::newRow("independent_1") << independent << 1u << 32u << 12u << 0u;
+    QTest::newRow("independent_4") << independent << 4u << 32u << 5u << 0u;
+    // Renaming does not help true dependencies
+    QTest::newRow("dependent_4") << dependent << 4u << 32u << 10u << 0u;
+    // Not pipelined divider delays commit until reorder buffer is full
+    QTest::newRow("divide_rob_32") << divide << 4u << 32u << 43u << 25u;
+    QTest::newRow("divide_rob_4") << divide << 4u << 4u << 44u << 39u;
+}
+
+void MachineTests::ooocore_timing() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(unsigned, width);
+    QFETCH(unsigned, rob);
+    QFETCH(unsigned, cycles);
+    QFETCH(unsigned, stalls);
+
+    Memory mem(BIG);
+    load_code(mem, Address(0x80020000), code);
+    TrivialBus mem_frontend(&mem);
+    OutOfOrderConfig config;
+    config.set_issue_width(width);
+    config.set_rob_size(rob);
+    Registers regs;
+    Registers regs_ref;
+    CoreOutOfOrder core(&regs, &mem_frontend, &mem_frontend, true, config);
+    CoreSingle core_ref(&regs_ref, &mem_frontend, &mem_frontend, true);
+    const OutOfOrderEngine::Stats &stats = core.get_out_of_order()->get_stats();
+
+    // The end is reached when the branch at the end is committed
+    const Address end = 0x80020020_addr;
+    QByteArray checkpoint;
+    for (unsigned k = 0; stats.committed < 9; k++) {
+        QVERIFY(k < 1000);
+        if (k == 3) {
+            QDataStream out(&checkpoint, QIODevice::WriteOnly);
+            regs.save_state(out);
+            core.save_state(out);
+        }
+        core.step();
+    }
+    while (regs_ref.read_pc() != end + 4) {
+        core_ref.step();
+    }
+    regs.pc_abs_jmp(regs_ref.read_pc());
+    QCOMPARE(regs, regs_ref);
+
+    QCOMPARE(core.get_cycle_count(), cycles);
+    QCOMPARE(core.get_stall_count(), stalls);
+    QCOMPARE(stats.cycles, (uint64_t)cycles);
+    QVERIFY(stats.rob.max <= rob);
+    QCOMPARE(stats.stalls[OutOfOrderEngine::STALL_ROB_FULL], (uint64_t)stalls);
+
+    // Instructions in flight are restored from checkpoint
+    Registers regs_load;
+    CoreOutOfOrder core_load(&regs_load, &mem_frontend, &mem_frontend, true, config);
+    QDataStream in(checkpoint);
+    regs_load.load_state(in);
+    core_load.load_state(in);
+    QCOMPARE(in.status(), QDataStream::Ok);
+    const OutOfOrderEngine::Stats &stats_load = core_load.get_out_of_order()->get_stats();
+    while (stats_load.committed < 9) {
+        core_load.step();
+    }
+    QCOMPARE(core_load.get_cycle_count(), cycles);
+    QCOMPARE(core_load.get_stall_count(), stalls);
+    QCOMPARE(stats_load.dispatched, stats.dispatched);
+    QCOMPARE(stats_load.rob.sum, stats.rob.sum);
+    QCOMPARE(stats_load.rs.sum, stats.rs.sum);
+    uint64_t issued = 0;
+    for (uint64_t count : stats.issued) {
+        issued += count;
+    }
+    QCOMPARE(issued, stats.dispatched);
+}
+
+void MachineTests::singlecore_ll_sc() {
+    for (bool cancel : { false, true }) {
+        Memory mem(BIG);
+        Registers regs;
+        regs.write_gp(1, 0x20);
+        regs.write_gp(2, 0x55);
+        regs.write_gp(4, 0x66);
+        uint64_t addr = regs.read_pc().get_raw();
+        memory_write_u32(&mem, addr, Instruction(48, 1, 3, 0).data());     // LL
+        memory_write_u32(&mem, addr + 4, Instruction(56, 1, 2, 0).data()); // SC
+        memory_write_u32(&mem, addr + 8, Instruction(56, 1, 4, 0).data()); // SC
+        TrivialBus mem_frontend(&mem);
+        CoreSingle core(&regs, &mem_frontend, &mem_frontend, false);
+
+        // Write of another core between LL and SC makes the store fail
+        core.step();
+        if (cancel) {
+            core.cancel_ll_reservation(0x20_addr, 0x23_addr);
+        }
+        core.step();
+        uint32_t stored = cancel ? 0 : 0x55;
+        QCOMPARE(regs.read_gp(2).as_u32(), (uint32_t)!cancel);
+        QCOMPARE(memory_read_u32(&mem, 0x20), stored);
+        // Reservation is used up by the first SC
+        core.step();
+        QCOMPARE(regs.read_gp(4).as_u32(), (uint32_t)0);
+        QCOMPARE(memory_read_u32(&mem, 0x20), stored);
+    }
+}
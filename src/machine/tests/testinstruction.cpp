@@ -34,6 +34,7 @@
  ******************************************************************************/
 
 #include "machine/instruction.h"
+#include "machine/predecode.h"
 #include "tst_machine.h"
 
 using namespace machine;
@@ -61,4 +62,35 @@ void MachineTests::instruction_access() {
     QCOMPARE(i.address().get_raw(), (uint64_t)0x3ffffff);
 }
 
+// Test that predecoded instruction matches full decode and follows code changes
+void MachineTests::instruction_predecode() {
+    PredecodeCache pdc(4);
+    Instruction addiu(9, 24, 26, 0xfff4);
+    Instruction ori(13, 24, 26, 0xfff4);
+
+    const PredecodedInstruction &pd1 = pdc.lookup(0x80020000_addr, addiu);
+    QCOMPARE(pd1.flags, addiu.flags());
+    QCOMPARE(pd1.alu_op, addiu.alu_op());
+    QCOMPARE(pd1.mem_ctl, addiu.mem_ctl());
+    QCOMPARE(pd1.num_rs, (uint8_t)24);
+    QCOMPARE(pd1.num_rt, (uint8_t)26);
+    QCOMPARE(pd1.immediate_val, (uint32_t)0xfffffff4);
+    QCOMPARE(&pdc.lookup(0x80020000_addr, addiu), &pd1);
+    QCOMPARE(pd1.inst_word, addiu.data());
+
+    // Same address with different word (modified code) has to be re-decoded
+    const PredecodedInstruction &pd2 = pdc.lookup(0x80020000_addr, ori);
+    QCOMPARE(pd2.inst_word, ori.data());
+    QCOMPARE(pd2.alu_op, ori.alu_op());
+    QCOMPARE(pd2.immediate_val, (uint32_t)0xfff4);
+
+    // Aliasing address has to be re-decoded too
+    const PredecodedInstruction &pd3 = pdc.lookup(0x80020040_addr, ori);
+    QCOMPARE(pd3.inst_addr, (uint32_t)0x80020040);
+
+    pdc.invalidate();
+    QVERIFY(!pd3.valid);
+    QVERIFY(pdc.lookup(0x80020040_addr, ori).valid);
+}
+
 // TODO test to_str
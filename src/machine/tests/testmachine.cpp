@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "machine/instruction.h"
+#include "machine/machine.h"
+#include "machine/memory/memory_utils.h"
+#include "tst_machine.h"
+
+using namespace machine;
+
+// Each core increments the shared counter by LL/SC `ITERATIONS` times and
+// counts failed SCs in $11, then it loops at `SMP_END`.
+static const uint32_t SMP_COUNTER = 0x10000;
+static const uint32_t SMP_ITERATIONS = 50;
+static const uint32_t SMP_END = 0x80020030;
+
+static void load_smp_program(Machine &machine) {
+    const QVector<uint32_t> code = {
+        Instruction(15, 0, 8, 1).data(),              // lui $8, 1
+        Instruction(9, 0, 9, SMP_ITERATIONS).data(),  // addiu $9, $0, ITERATIONS
+        Instruction(48, 8, 10, 0).data(),             // loop: ll $10, 0($8)
+        Instruction(9, 10, 10, 1).data(),             // addiu $10, $10, 1
+        Instruction(56, 8, 10, 0).data(),             // sc $10, 0($8)
+        Instruction(5, 10, 0, 3).data(),              // bne $10, $0, done
+        Instruction(0).data(),                        // nop
+        Instruction(4, 0, 0, (uint16_t)-6).data(),    // b loop
+        Instruction(9, 11, 11, 1).data(),             // addiu $11, $11, 1
+        Instruction(9, 9, 9, (uint16_t)-1).data(),    // done: addiu $9, $9, -1
+        Instruction(5, 9, 0, (uint16_t)-9).data(),    // bne $9, $0, loop
+        Instruction(0).data(),                        // nop
+        Instruction(4, 0, 0, (uint16_t)-1).data(),    // end: b end
+        Instruction(0).data(),                        // nop
+    };
+    Address addr = machine.registers()->read_pc();
+    QCOMPARE(addr + 4 * 12, Address(SMP_END));
+    for (uint32_t word : code) {
+        memory_write_u32(machine.memory_rw(), addr.get_raw(), word);
+        addr += 4;
+    }
+}
+
+static MachineConfig smp_config(unsigned quantum) {
+    MachineConfig config;
+    config.set_pipelined(false);
+    config.set_delay_slot(true);
+    config.set_headless(true);
+    config.set_core_count(2);
+    config.set_smp_quantum(quantum);
+    return config;
+}
+
+void MachineTests::machine_smp_round_robin() {
+    Machine machine(smp_config(4), false, false);
+    load_smp_program(machine);
+    QCOMPARE(machine.core_count(), 2u);
+
+    // Core 0 runs the first quantum, the turn is kept between the runs
+    QCOMPARE(machine.run(10), 10u);
+    QCOMPARE(machine.core(0)->get_cycle_count(), 6u);
+    QCOMPARE(machine.core(1)->get_cycle_count(), 4u);
+    QCOMPARE(machine.run(5), 5u);
+    QCOMPARE(machine.core(0)->get_cycle_count(), 8u);
+    QCOMPARE(machine.core(1)->get_cycle_count(), 7u);
+    for (unsigned i = 0; i < 3; i++) {
+        QCOMPARE(machine.run(1), 1u);
+    }
+    QCOMPARE(machine.core(0)->get_cycle_count(), 10u);
+    QCOMPARE(machine.core(1)->get_cycle_count(), 8u);
+}
+
+void MachineTests::machine_smp_ll_sc_data() {
+    QTest::addColumn<unsigned>("quantum");
+    QTest::addColumn<bool>("race");
+    QTest::newRow("quantum-1") << 1u << true;
+    QTest::newRow("quantum-3") << 3u << true;
+    QTest::newRow("quantum-7") << 7u << true;
+    // Core 0 finishes the loop before the other core starts
+    QTest::newRow("quantum-1000") << 1000u << false;
+}
+
+void MachineTests::machine_smp_ll_sc() {
+    QFETCH(unsigned, quantum);
+    QFETCH(bool, race);
+
+    Machine machine(smp_config(quantum), false, false);
+    load_smp_program(machine);
+    auto finished = [&](unsigned core) {
+        return machine.registers(core)->read_pc() >= Address(SMP_END);
+    };
+    for (unsigned step = 0; step < 100 && !(finished(0) && finished(1)); step++) {
+        machine.run(100);
+    }
+    QVERIFY(finished(0));
+    QVERIFY(finished(1));
+
+    // Increments of the other core between LL and SC make the SC fail and
+    // they are repeated, no increment is lost
+    machine.cache_sync();
+    QCOMPARE(memory_read_u32(machine.memory(), SMP_COUNTER), 2 * SMP_ITERATIONS);
+    const uint32_t failed = machine.registers(0)->read_gp(11).as_u32()
+                            + machine.registers(1)->read_gp(11).as_u32();
+    QCOMPARE(failed != 0, race);
+}
+
+void MachineTests::machine_smp_cpu_num() {
+    Machine machine(smp_config(2), false, false);
+    const QVector<uint32_t> code = {
+        0x7c08003b,                                // rdhwr $8, $0
+        Instruction(4, 0, 0, (uint16_t)-1).data(), // end: b end
+        Instruction(0).data(),                     // nop
+    };
+    Address addr = machine.registers()->read_pc();
+    for (uint32_t word : code) {
+        memory_write_u32(machine.memory_rw(), addr.get_raw(), word);
+        addr += 4;
+    }
+    machine.run(8);
+
+    // Each core reads its own number from the low bits of EBase
+    QCOMPARE(machine.registers(0)->read_gp(8).as_u32(), 0u);
+    QCOMPARE(machine.registers(1)->read_gp(8).as_u32(), 1u);
+}
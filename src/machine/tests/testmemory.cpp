@@ -293,6 +293,41 @@ void MachineTests::memory_compare() {
     QVERIFY(m1 != m3);
 }
 
+void MachineTests::memory_copy_on_write_data() {
+    prepare_endian_test();
+}
+
+void MachineTests::memory_copy_on_write() {
+    QFETCH(Endian, endian);
+
+    Memory m1(endian);
+    memory_write_u32(&m1, 0x20, 0x11223344);
+    memory_write_u32(&m1, 0xFFFF20, 0x55667788);
+
+    // Copy shares the sections until written
+    Memory m2(m1);
+    QCOMPARE(m2.get_section(0x20), m1.get_section(0x20));
+    memory_write_u32(&m2, 0x24, 0x99AABBCC);
+    QVERIFY(m2.get_section(0x20) != m1.get_section(0x20));
+    QCOMPARE(m2.get_section(0xFFFF20), m1.get_section(0xFFFF20));
+    QCOMPARE(memory_read_u32(&m1, 0x24), (uint32_t)0);
+    QCOMPARE(memory_read_u32(&m2, 0x24), (uint32_t)0x99AABBCC);
+    QCOMPARE(memory_read_u32(&m2, 0x20), (uint32_t)0x11223344);
+
+    // Original can be modified without affecting the copy
+    memory_write_u32(&m1, 0xFFFF20, 0);
+    QCOMPARE(memory_read_u32(&m2, 0xFFFF20), (uint32_t)0x55667788);
+
+    // Reset returns to the shared content
+    Memory m3(m1);
+    memory_write_u8(&m3, 0x10000, 0x42);
+    m3.reset(m2);
+    QCOMPARE(m3, m2);
+    QCOMPARE(m3.get_section(0x10000), (const MemorySection *)nullptr);
+    m3.reset(m3);
+    QCOMPARE(m3, m2);
+}
+
 void MachineTests::memory_write_ctl_data() {
     QTest::addColumn<AccessControl>("ctl");
     QTest::addColumn<Memory>("result");
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "machine/trace/trace_reader.h"
+#include "machine/trace/trace_writer.h"
+#include "tst_machine.h"
+
+#include <sstream>
+
+using namespace machine;
+
+// Writes `cycles` cycles with a few records each, cycle is stored in values
+static void write_test_trace(std::ostream &out, uint64_t cycles) {
+    TraceWriter writer(out, 128);
+    for (uint64_t c = 1; c <= cycles; c++) {
+        writer.cycle(c);
+        writer.stage(TraceRecord::FETCH, 0x80020000 + 4 * c, 0x24000000 + c, 0, true);
+        writer.stage(TraceRecord::DECODE, 0, 0, 0, false);
+        writer.pc(0x80020004 + 4 * c);
+        if (c % 3 == 0) {
+            writer.mem(0x1000 + 8 * c, 4, c & 1, c * 7);
+        }
+        if (c % 5 == 0) {
+            writer.gp(c % 32, c);
+            writer.cache(true, 0xbfffff00 - 4 * c, c & 2, false);
+        }
+    }
+}
+
+static void check_test_record(const TraceRecord &rec) {
+    const uint64_t c = rec.cycle;
+    switch (rec.type) {
+    case TraceRecord::FETCH:
+        QCOMPARE(rec.flags, (uint8_t)TraceRecord::VALID);
+        QCOMPARE(rec.address, (uint32_t)(0x80020000 + 4 * c));
+        QCOMPARE(rec.inst, (uint32_t)(0x24000000 + c));
+        break;
+    case TraceRecord::DECODE: QCOMPARE(rec.flags, (uint8_t)0); break;
+    case TraceRecord::PC: QCOMPARE(rec.address, (uint32_t)(0x80020004 + 4 * c)); break;
+    case TraceRecord::MEM:
+        QCOMPARE(c % 3, (uint64_t)0);
+        QCOMPARE(rec.address, (uint32_t)(0x1000 + 8 * c));
+        QCOMPARE(rec.size, (uint8_t)4);
+        QCOMPARE((uint64_t)(rec.flags & TraceRecord::WRITE), c & 1);
+        QCOMPARE(rec.value, c * 7);
+        break;
+    case TraceRecord::GP:
+        QCOMPARE(c % 5, (uint64_t)0);
+        QCOMPARE(rec.reg, (uint8_t)(c % 32));
+        QCOMPARE(rec.value, c);
+        break;
+    case TraceRecord::CACHE:
+        QCOMPARE(rec.address, (uint32_t)(0xbfffff00 - 4 * c));
+        QCOMPARE((bool)(rec.flags & TraceRecord::HIT), (bool)(c & 2));
+        QCOMPARE((bool)(rec.flags & TraceRecord::DATA), true);
+        break;
+    default: QFAIL("Unexpected record type");
+    }
+}
+
+void MachineTests::trace_round_trip() {
+    const uint64_t cycles = 1000;
+    std::stringstream stream;
+    write_test_trace(stream, cycles);
+
+    TraceReader reader(stream);
+    QVERIFY(reader.open());
+    QVERIFY(reader.get_chunk_count() > 1);
+    TraceRecord rec;
+    uint64_t records = 0, last_cycle = 0;
+    while (reader.next(rec)) {
+        QVERIFY(rec.cycle >= last_cycle);
+        last_cycle = rec.cycle;
+        check_test_record(rec);
+        records++;
+    }
+    QVERIFY(reader.get_error().empty());
+    QCOMPARE(last_cycle, cycles);
+    // Cycle markers are counted but not returned
+    QVERIFY(records < reader.get_record_count());
+    QVERIFY(reader.get_record_count() <= records + cycles);
+
+    for (uint64_t cycle : { 1, 2, 333, 500, 999, 1000 }) {
+        QVERIFY(reader.seek_cycle(cycle));
+        QVERIFY(reader.next(rec));
+        QCOMPARE(rec.cycle, cycle);
+        QCOMPARE(rec.type, TraceRecord::FETCH);
+        check_test_record(rec);
+    }
+    QVERIFY(reader.seek_cycle(cycles + 1));
+    QVERIFY(!reader.next(rec));
+    QVERIFY(reader.rewind());
+    QVERIFY(reader.next(rec));
+    QCOMPARE(rec.cycle, (uint64_t)1);
+}
+
+void MachineTests::trace_truncated() {
+    std::stringstream complete;
+    write_test_trace(complete, 1000);
+    // Index is missing and the last chunk is cut
+    std::string data = complete.str();
+    std::stringstream stream(data.substr(0, data.size() / 2));
+
+    TraceReader reader(stream);
+    QVERIFY(reader.open());
+    QVERIFY(reader.get_chunk_count() > 1);
+    TraceRecord rec;
+    uint64_t last_cycle = 0;
+    while (reader.next(rec)) {
+        check_test_record(rec);
+        last_cycle = rec.cycle;
+    }
+    QVERIFY(reader.get_error().empty());
+    QVERIFY(last_cycle > 1 && last_cycle < 1000);
+
+    std::stringstream garbage("not a trace");
+    TraceReader garbage_reader(garbage);
+    QVERIFY(!garbage_reader.open());
+    QVERIFY(!garbage_reader.get_error().empty());
+}
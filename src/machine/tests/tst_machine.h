@@ -57,6 +57,8 @@ private Q_SLOTS:
     static void memory_section_data();
     void memory_compare();
     void memory_compare_data();
+    void memory_copy_on_write();
+    void memory_copy_on_write_data();
     static void memory_write_ctl_data();
     static void memory_write_ctl();
     static void memory_read_ctl_data();
@@ -66,6 +68,7 @@ private Q_SLOTS:
     // Instruction
     void instruction();
     void instruction_access();
+    void instruction_predecode();
     // Alu
     void alu();
     void alu_data();
@@ -79,6 +82,21 @@ private Q_SLOTS:
     static void cache();
     static void cache_correctness_data();
     static void cache_correctness();
+    static void cache_coherence_data();
+    static void cache_coherence();
+    static void cache_sweep_data();
+    static void cache_sweep();
+    static void cache_hierarchy_data();
+    static void cache_hierarchy();
+    static void cache_prefetch_data();
+    static void cache_prefetch();
+    static void cache_high_associativity_data();
+    static void cache_high_associativity();
+    static void cache_replacement_data();
+    static void cache_replacement();
+    // Trace
+    static void trace_round_trip();
+    static void trace_truncated();
     // Core
     void singlecore_regs();
     void singlecore_regs_data();
@@ -108,6 +126,50 @@ private Q_SLOTS:
     void pipecore_wt_na_memory_tests();
     void pipecore_wt_a_memory_tests();
     void pipecore_wb_memory_tests();
+    void pipecore_headless_memory_tests_data();
+    void pipecore_headless_memory_tests();
+    void singlecore_block_interpreter_data();
+    void singlecore_block_interpreter();
+    void singlecore_block_modified_code();
+    void singlecore_run_end_data();
+    void singlecore_run_end();
+    void singlecore_jit_data();
+    void singlecore_jit();
+    void singlecore_jit_fault();
+    void pipecore_checkpoint_data();
+    void pipecore_checkpoint();
+    void pipecore_history_data();
+    void pipecore_history();
+    void singlecore_history_journal();
+    void pipecore_hwbreak_data();
+    void pipecore_hwbreak();
+    void pipecore_watchpoint_data();
+    void pipecore_watchpoint();
+    void pipecore_trace_data();
+    void pipecore_trace();
+    void pipecore_profile_data();
+    void pipecore_profile();
+    void core_profile_calls();
+    void pipecore_branch_predictor_data();
+    void pipecore_branch_predictor();
+    void pipecore_dual_issue_alu_forward_data();
+    void pipecore_dual_issue_alu_forward();
+    void pipecore_dual_issue_memory_tests_data();
+    void pipecore_dual_issue_memory_tests();
+    void pipecore_dual_issue_data();
+    void pipecore_dual_issue();
+    void ooocore_alu_forward_data();
+    void ooocore_alu_forward();
+    void ooocore_memory_tests_data();
+    void ooocore_memory_tests();
+    void ooocore_timing_data();
+    void ooocore_timing();
+    void singlecore_ll_sc();
+    // Machine
+    void machine_smp_round_robin();
+    void machine_smp_ll_sc_data();
+    void machine_smp_ll_sc();
+    void machine_smp_cpu_num();
 };
 
 #endif // TST_MACHINE_H
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <cstdint>
+
+namespace machine {
+
+/**
+ * Binary execution trace format.
+ *
+ * The file starts with header (magic `TRACE_MAGIC`, u32 version) followed by
+ * chunks of records and ends with index of the chunks and footer. Fixed width
+ * integers are little endian.
+ *
+ *   chunk:  u32 `TRACE_CHUNK_MAGIC`, u32 payload size, u32 record count,
+ *           u64 cycle of the first record, payload
+ *   index:  per chunk u64 file offset, u64 first cycle, u64 first record
+ *   footer: u64 index offset, u64 record count, u32 chunk count,
+ *           `TRACE_INDEX_MAGIC`
+ *
+ * Every record (cycle markers included) starts with tag byte, record type in
+ * low nibble and flags in high nibble, type specific fields follow. Variable width numbers are LEB128
+ * encoded. Addresses and cycles are stored as zig-zag encoded differences
+ * to the previous value of the same kind, all bases are reset at the chunk
+ * start so chunks can be decoded independently (and the file is seekable
+ * through the index).
+ *
+ *   CYCLE       cycle difference, following records belong to the cycle
+ *   FETCH..WB   flags VALID, EXCEPTION; valid one has address difference
+ *               and u32 instruction word, exception cause varint follows
+ *   PC          address difference
+ *   GP          u8 register number, varint value
+ *   HI_LO       flag HI, varint value
+ *   MEM         flags WRITE and size (log2 in two bits), address
+ *               difference, varint value read or written (partial word
+ *               accesses LWL, SWR etc. keep the register value)
+ *   CACHE       flags DATA (else program cache), HIT, WRITE, address
+ *               difference
+ *
+ * Truncated file (without index) is still readable sequentially.
+ */
+
+constexpr char TRACE_MAGIC[8] = { 'Q', 'T', 'M', 'T', 'R', 'A', 'C', 'E' };
+constexpr char TRACE_INDEX_MAGIC[8] = { 'Q', 'T', 'M', 'T', 'R', 'I', 'D', 'X' };
+constexpr uint32_t TRACE_CHUNK_MAGIC = 0x4b4e4843; // "CHNK"
+constexpr uint32_t TRACE_VERSION = 1;
+constexpr uint32_t TRACE_HEADER_SIZE = 12;
+constexpr uint32_t TRACE_CHUNK_HEADER_SIZE = 20;
+constexpr uint32_t TRACE_FOOTER_SIZE = 28;
+
+/**
+ * Decoded trace record.
+ */
+struct TraceRecord {
+    enum Type : uint8_t {
+        CYCLE,
+        FETCH,
+        DECODE,
+        EXECUTE,
+        MEMORY,
+        WRITEBACK,
+        PC,
+        GP,
+        HI_LO,
+        MEM,
+        CACHE,
+        TYPE_COUNT
+    };
+    // Flags of the records
+    enum : uint8_t {
+        VALID = 1 << 0,     // Stage
+        EXCEPTION = 1 << 1, // Stage
+        HI = 1 << 0,        // HI_LO
+        WRITE = 1 << 0,     // MEM, CACHE
+        DATA = 1 << 1,      // CACHE
+        HIT = 1 << 2,       // CACHE
+    };
+
+    Type type;
+    uint8_t flags;
+    uint64_t cycle;    // Cycle the record belongs to
+    uint32_t address;  // Instruction, PC, memory or cache access address
+    uint32_t inst;     // Instruction word of stage record
+    uint32_t excause;  // Exception cause of stage record
+    uint8_t reg;       // Register number of GP record
+    uint8_t size;      // Memory access size in bytes
+    uint64_t value;    // Register value or value read/written by memory access
+};
+
+// Access size (up to 8 bytes) is stored as log2 in two bits of MEM flags
+inline uint8_t trace_size_code(unsigned size) {
+    return size >= 8 ? 3 : size >= 4 ? 2 : size >= 2 ? 1 : 0;
+}
+
+inline uint64_t trace_zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline int64_t trace_unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+} // namespace machine
+
+#endif // TRACE_FORMAT_H
@@ -0,0 +1,318 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "trace/trace_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace machine {
+
+static uint64_t get_le(const uint8_t *src, unsigned bytes) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i < bytes; i++) {
+        value |= (uint64_t)src[i] << (8 * i);
+    }
+    return value;
+}
+
+TraceReader::TraceReader(std::istream &in) : in(in) {}
+
+bool TraceReader::open() {
+    index.clear();
+    record_count = 0;
+    error.clear();
+
+    uint8_t header[TRACE_HEADER_SIZE];
+    in.clear();
+    in.seekg(0);
+    if (!read(header, sizeof(header))
+        || memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        return fail("Not a trace file");
+    }
+    if (get_le(header + 8, 4) != TRACE_VERSION) {
+        return fail("Unsupported trace version");
+    }
+
+    uint8_t footer[TRACE_FOOTER_SIZE];
+    in.seekg(0, std::ios::end);
+    const int64_t file_size = in.tellg();
+    bool indexed = false;
+    if (file_size >= (int64_t)(TRACE_HEADER_SIZE + TRACE_FOOTER_SIZE)) {
+        in.seekg(file_size - TRACE_FOOTER_SIZE);
+        if (read(footer, sizeof(footer))
+            && memcmp(footer + 20, TRACE_INDEX_MAGIC, sizeof(TRACE_INDEX_MAGIC)) == 0) {
+            record_count = get_le(footer + 8, 8);
+            indexed = read_index(get_le(footer, 8), (uint32_t)get_le(footer + 16, 4));
+        }
+    }
+    if (!indexed) {
+        scan_chunks();
+    }
+    return rewind();
+}
+
+const std::string &TraceReader::get_error() const {
+    return error;
+}
+
+size_t TraceReader::get_chunk_count() const {
+    return index.size();
+}
+
+uint64_t TraceReader::get_record_count() const {
+    return record_count;
+}
+
+bool TraceReader::next(TraceRecord &record) {
+    if (has_pending) {
+        record = pending;
+        has_pending = false;
+        return true;
+    }
+    while (true) {
+        while (records_left == 0) {
+            if (!error.empty() || next_chunk >= index.size()) {
+                return false;
+            }
+            if (!load_chunk(next_chunk++)) {
+                return false;
+            }
+        }
+        if (!decode(record)) {
+            return false;
+        }
+        if (record.type != TraceRecord::CYCLE) {
+            return true;
+        }
+    }
+}
+
+bool TraceReader::seek_cycle(uint64_t target) {
+    // Records of the cycle may start in the last chunk starting before it
+    auto it = std::lower_bound(
+        index.begin(), index.end(), target,
+        [](const IndexEntry &entry, uint64_t c) { return entry.cycle < c; });
+    rewind();
+    next_chunk = it == index.begin() ? 0 : (it - index.begin()) - 1;
+    TraceRecord record;
+    while (next(record)) {
+        if (record.cycle >= target) {
+            pending = record;
+            has_pending = true;
+            return true;
+        }
+    }
+    return error.empty();
+}
+
+bool TraceReader::rewind() {
+    records_left = 0;
+    next_chunk = 0;
+    has_pending = false;
+    return error.empty();
+}
+
+bool TraceReader::fail(const std::string &message) {
+    if (error.empty()) {
+        error = message;
+    }
+    records_left = 0;
+    return false;
+}
+
+bool TraceReader::read(void *data, size_t size) {
+    in.read((char *)data, size);
+    return (size_t)in.gcount() == size;
+}
+
+bool TraceReader::read_index(uint64_t offset, uint32_t chunks) {
+    in.clear();
+    in.seekg(offset);
+    index.resize(chunks);
+    for (IndexEntry &entry : index) {
+        uint8_t buf[24];
+        if (!read(buf, sizeof(buf))) {
+            index.clear();
+            return false;
+        }
+        entry = { get_le(buf, 8), get_le(buf + 8, 8), get_le(buf + 16, 8) };
+    }
+    return true;
+}
+
+void TraceReader::scan_chunks() {
+    in.clear();
+    in.seekg(0, std::ios::end);
+    const uint64_t file_size = in.tellg();
+    uint64_t offset = TRACE_HEADER_SIZE;
+    record_count = 0;
+    while (offset + TRACE_CHUNK_HEADER_SIZE <= file_size) {
+        uint8_t header[TRACE_CHUNK_HEADER_SIZE];
+        in.seekg(offset);
+        if (!read(header, sizeof(header)) || get_le(header, 4) != TRACE_CHUNK_MAGIC) {
+            break;
+        }
+        uint64_t end = offset + TRACE_CHUNK_HEADER_SIZE + get_le(header + 4, 4);
+        if (end > file_size) {
+            break; // Incomplete chunk is dropped
+        }
+        index.push_back({ offset, get_le(header + 12, 8), record_count });
+        record_count += get_le(header + 8, 4);
+        offset = end;
+    }
+    in.clear();
+}
+
+bool TraceReader::load_chunk(size_t i) {
+    uint8_t header[TRACE_CHUNK_HEADER_SIZE];
+    in.clear();
+    in.seekg(index[i].offset);
+    if (!read(header, sizeof(header)) || get_le(header, 4) != TRACE_CHUNK_MAGIC) {
+        return fail("Corrupted trace chunk header");
+    }
+    payload.resize(get_le(header + 4, 4));
+    if (!read(payload.data(), payload.size())) {
+        return fail("Truncated trace chunk");
+    }
+    pos = 0;
+    records_left = (uint32_t)get_le(header + 8, 4);
+    cycle = get_le(header + 12, 8);
+    last_inst_addr = last_pc = last_mem = last_cache = 0;
+    return true;
+}
+
+bool TraceReader::decode(TraceRecord &record) {
+    if (pos >= payload.size()) {
+        return fail("Corrupted trace chunk");
+    }
+    uint8_t tag = payload[pos++];
+    records_left--;
+    record = {};
+    record.type = (TraceRecord::Type)(tag & 0x0f);
+    record.flags = tag >> 4;
+    uint64_t value;
+    switch (record.type) {
+    case TraceRecord::CYCLE:
+        if (!get_varint(value)) {
+            return false;
+        }
+        cycle += trace_unzigzag(value);
+        break;
+    case TraceRecord::FETCH:
+    case TraceRecord::DECODE:
+    case TraceRecord::EXECUTE:
+    case TraceRecord::MEMORY:
+    case TraceRecord::WRITEBACK:
+        if (record.flags & TraceRecord::VALID) {
+            if (!get_delta(record.address, last_inst_addr)) {
+                return false;
+            }
+            if (payload.size() - pos < 4) {
+                return fail("Corrupted trace chunk");
+            }
+            record.inst = (uint32_t)get_le(&payload[pos], 4);
+            pos += 4;
+        }
+        if (record.flags & TraceRecord::EXCEPTION) {
+            if (!get_varint(value)) {
+                return false;
+            }
+            record.excause = (uint32_t)value;
+        }
+        break;
+    case TraceRecord::PC:
+        if (!get_delta(record.address, last_pc)) {
+            return false;
+        }
+        break;
+    case TraceRecord::GP:
+        if (pos >= payload.size()) {
+            return fail("Corrupted trace chunk");
+        }
+        record.reg = payload[pos++];
+        if (!get_varint(record.value)) {
+            return false;
+        }
+        break;
+    case TraceRecord::HI_LO:
+        if (!get_varint(record.value)) {
+            return false;
+        }
+        break;
+    case TraceRecord::MEM:
+        record.size = 1 << ((record.flags >> 1) & 3);
+        record.flags &= TraceRecord::WRITE;
+        if (!get_delta(record.address, last_mem) || !get_varint(record.value)) {
+            return false;
+        }
+        break;
+    case TraceRecord::CACHE:
+        if (!get_delta(record.address, last_cache)) {
+            return false;
+        }
+        break;
+    default: return fail("Unknown trace record type");
+    }
+    record.cycle = cycle;
+    return true;
+}
+
+bool TraceReader::get_varint(uint64_t &value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (pos >= payload.size()) {
+            break;
+        }
+        uint8_t byte = payload[pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return fail("Corrupted trace chunk");
+}
+
+bool TraceReader::get_delta(uint32_t &value, uint32_t &base) {
+    uint64_t raw;
+    if (!get_varint(raw)) {
+        return false;
+    }
+    value = base + (uint32_t)trace_unzigzag(raw);
+    base = value;
+    return true;
+}
+
+} // namespace machine
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include "trace/trace_format.h"
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Reader of the binary trace (see `trace/trace_format.h`).
+ *
+ * The reader does not depend on the simulator, it can be linked into
+ * external analysis tools. Cycle markers are consumed internally, `next`
+ * returns the other records with their cycle filled in.
+ */
+class TraceReader {
+public:
+    explicit TraceReader(std::istream &in);
+
+    /**
+     * Reads header and chunk index.
+     * File without index (writer was not finished) is scanned for chunks.
+     *
+     * @return false when file is not readable trace, see `get_error`
+     */
+    bool open();
+    const std::string &get_error() const;
+    size_t get_chunk_count() const;
+    // Number of records including cycle markers
+    uint64_t get_record_count() const;
+
+    // @return false at the end of the trace or on error
+    bool next(TraceRecord &record);
+    // Positions reader to the first record of the given or later cycle
+    bool seek_cycle(uint64_t cycle);
+    bool rewind();
+
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint64_t cycle;
+        uint64_t record;
+    };
+
+    std::istream &in;
+    std::string error;
+    std::vector<IndexEntry> index;
+    uint64_t record_count = 0;
+    std::vector<uint8_t> payload;
+    size_t pos = 0;
+    uint32_t records_left = 0;
+    size_t next_chunk = 0;
+    uint64_t cycle = 0;
+    uint32_t last_inst_addr = 0, last_pc = 0, last_mem = 0, last_cache = 0;
+    // Record found by `seek_cycle`, returned by the following `next`
+    TraceRecord pending;
+    bool has_pending = false;
+
+    bool fail(const std::string &message);
+    bool read(void *data, size_t size);
+    bool read_index(uint64_t offset, uint32_t chunks);
+    void scan_chunks();
+    bool load_chunk(size_t i);
+    bool decode(TraceRecord &record);
+    bool get_varint(uint64_t &value);
+    bool get_delta(uint32_t &value, uint32_t &base);
+};
+
+} // namespace machine
+
+#endif // TRACE_READER_H
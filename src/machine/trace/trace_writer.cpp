@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "trace/trace_writer.h"
+
+namespace machine {
+
+static void put_le(uint8_t *dst, uint64_t value, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; i++) {
+        dst[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+TraceWriter::TraceWriter(std::ostream &out, size_t chunk_size)
+    : out(out)
+    , chunk_size(chunk_size) {
+    payload.reserve(chunk_size + 32);
+    uint8_t header[TRACE_HEADER_SIZE];
+    std::copy(TRACE_MAGIC, TRACE_MAGIC + 8, header);
+    put_le(header + 8, TRACE_VERSION, 4);
+    write(header, sizeof(header));
+}
+
+TraceWriter::~TraceWriter() {
+    finish();
+}
+
+void TraceWriter::finish() {
+    if (finished) {
+        return;
+    }
+    if (chunk_records != 0) {
+        write_chunk();
+    }
+    const uint64_t index_offset = offset;
+    for (const IndexEntry &entry : index) {
+        uint8_t buf[24];
+        put_le(buf, entry.offset, 8);
+        put_le(buf + 8, entry.cycle, 8);
+        put_le(buf + 16, entry.record, 8);
+        write(buf, sizeof(buf));
+    }
+    uint8_t footer[TRACE_FOOTER_SIZE];
+    put_le(footer, index_offset, 8);
+    put_le(footer + 8, record_count, 8);
+    put_le(footer + 16, index.size(), 4);
+    std::copy(TRACE_INDEX_MAGIC, TRACE_INDEX_MAGIC + 8, footer + 20);
+    write(footer, sizeof(footer));
+    out.flush();
+    finished = true;
+}
+
+bool TraceWriter::good() const {
+    return out.good();
+}
+
+uint64_t TraceWriter::get_record_count() const {
+    return record_count;
+}
+
+void TraceWriter::cycle(uint64_t cycle) {
+    current_cycle = cycle;
+}
+
+void TraceWriter::stage(
+    enum TraceRecord::Type stage,
+    uint32_t inst_addr,
+    uint32_t inst,
+    uint32_t excause,
+    bool valid) {
+    uint8_t flags = (valid ? TraceRecord::VALID : 0)
+                    | (excause != 0 ? TraceRecord::EXCEPTION : 0);
+    begin(stage, flags);
+    if (valid) {
+        put_delta(inst_addr, last_inst_addr);
+        put_u32(inst);
+    }
+    if (excause != 0) {
+        put_varint(excause);
+    }
+}
+
+void TraceWriter::pc(uint32_t address) {
+    begin(TraceRecord::PC, 0);
+    put_delta(address, last_pc);
+}
+
+void TraceWriter::gp(uint8_t reg, uint64_t value) {
+    begin(TraceRecord::GP, 0);
+    payload.push_back(reg);
+    put_varint(value);
+}
+
+void TraceWriter::hi_lo(bool hi, uint64_t value) {
+    begin(TraceRecord::HI_LO, hi ? TraceRecord::HI : 0);
+    put_varint(value);
+}
+
+void TraceWriter::mem(uint32_t address, unsigned size, bool write, uint64_t value) {
+    begin(
+        TraceRecord::MEM,
+        (write ? TraceRecord::WRITE : 0) | (trace_size_code(size) << 1));
+    put_delta(address, last_mem);
+    put_varint(value);
+}
+
+void TraceWriter::cache(bool data, uint32_t address, bool hit, bool write) {
+    begin(
+        TraceRecord::CACHE, (write ? TraceRecord::WRITE : 0)
+                                | (data ? TraceRecord::DATA : 0)
+                                | (hit ? TraceRecord::HIT : 0));
+    put_delta(address, last_cache);
+}
+
+void TraceWriter::begin(enum TraceRecord::Type type, uint8_t flags) {
+    if (payload.size() >= chunk_size) {
+        write_chunk();
+    }
+    if (chunk_records == 0) {
+        chunk_cycle = current_cycle;
+        written_cycle = current_cycle;
+        last_inst_addr = last_pc = last_mem = last_cache = 0;
+    }
+    if (current_cycle != written_cycle) {
+        payload.push_back(TraceRecord::CYCLE);
+        put_varint(trace_zigzag((int64_t)(current_cycle - written_cycle)));
+        written_cycle = current_cycle;
+        chunk_records++;
+        record_count++;
+    }
+    payload.push_back((uint8_t)(type | (flags << 4)));
+    chunk_records++;
+    record_count++;
+}
+
+void TraceWriter::put_varint(uint64_t value) {
+    while (value >= 0x80) {
+        payload.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    payload.push_back((uint8_t)value);
+}
+
+void TraceWriter::put_delta(uint32_t value, uint32_t &base) {
+    put_varint(trace_zigzag((int32_t)(value - base)));
+    base = value;
+}
+
+void TraceWriter::put_u32(uint32_t value) {
+    uint8_t buf[4];
+    put_le(buf, value, 4);
+    payload.insert(payload.end(), buf, buf + 4);
+}
+
+void TraceWriter::write(const void *data, size_t size) {
+    out.write((const char *)data, size);
+    offset += size;
+}
+
+void TraceWriter::write_chunk() {
+    if (finished) {
+        return;
+    }
+    index.push_back({ offset, chunk_cycle, record_count - chunk_records });
+    uint8_t header[TRACE_CHUNK_HEADER_SIZE];
+    put_le(header, TRACE_CHUNK_MAGIC, 4);
+    put_le(header + 4, payload.size(), 4);
+    put_le(header + 8, chunk_records, 4);
+    put_le(header + 12, chunk_cycle, 8);
+    write(header, sizeof(header));
+    write(payload.data(), payload.size());
+    payload.clear();
+    chunk_records = 0;
+}
+
+} // namespace machine
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*******************************************************************************
+ * QtMips - MIPS 32-bit Architecture Subset Simulator
+ *
+ * Implemented to support following courses:
+ *
+ *   B35APO - Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b35apo
+ *
+ *   B4M35PAP - Advanced Computer Architectures
+ *   https://cw.fel.cvut.cz/wiki/courses/b4m35pap/start
+ *
+ * Copyright (c) 2017-2019 Karel Koci<cynerd@email.cz>
+ * Copyright (c) 2019      Pavel Pisa <pisa@cmp.felk.cvut.cz>
+ *
+ * Faculty of Electrical Engineering (http://www.fel.cvut.cz)
+ * Czech Technical University        (http://www.cvut.cz/)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include "trace/trace_format.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace machine {
+
+/**
+ * Buffered writer of the binary trace (see `trace/trace_format.h`).
+ *
+ * Records are encoded into memory and the stream is written a whole chunk at
+ * a time. The core, registers and caches feed the writer directly when it is
+ * set up by `Machine::set_trace_writer`. The index is written by `finish`
+ * (or by the destructor), stream has to be kept open till then.
+ */
+class TraceWriter {
+public:
+    /**
+     * @param out           stream the trace is written to
+     * @param chunk_size    approximate size of chunk payload in bytes
+     */
+    explicit TraceWriter(std::ostream &out, size_t chunk_size = 64 * 1024);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    // Writes pending records and the index, further records are ignored
+    void finish();
+    bool good() const;
+    uint64_t get_record_count() const;
+
+    // Cycle of the following records
+    void cycle(uint64_t cycle);
+    void stage(
+        enum TraceRecord::Type stage,
+        uint32_t inst_addr,
+        uint32_t inst,
+        uint32_t excause,
+        bool valid);
+    void pc(uint32_t address);
+    void gp(uint8_t reg, uint64_t value);
+    void hi_lo(bool hi, uint64_t value);
+    void mem(uint32_t address, unsigned size, bool write, uint64_t value);
+    void cache(bool data, uint32_t address, bool hit, bool write);
+
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint64_t cycle;
+        uint64_t record;
+    };
+
+    std::ostream &out;
+    const size_t chunk_size;
+    std::vector<uint8_t> payload;
+    std::vector<IndexEntry> index;
+    uint64_t offset = 0; // Bytes written to the stream
+    uint64_t record_count = 0;
+    uint32_t chunk_records = 0;
+    uint64_t chunk_cycle = 0;
+    uint64_t current_cycle = 0;
+    uint64_t written_cycle = 0;
+    // Bases of differences, reset at the chunk start
+    uint32_t last_inst_addr = 0, last_pc = 0, last_mem = 0, last_cache = 0;
+    bool finished = false;
+
+    void begin(enum TraceRecord::Type type, uint8_t flags);
+    void put_varint(uint64_t value);
+    void put_delta(uint32_t value, uint32_t &base);
+    void put_u32(uint32_t value);
+    void write(const void *data, size_t size);
+    void write_chunk();
+};
+
+} // namespace machine
+
+#endif // TRACE_WRITER_H
@@ -41,6 +41,8 @@
 #include "syscall_nr.h"
 #include "target_errno.h"
 
+#include <QDataStream>
+#include <algorithm>
 #include <cerrno>
 #include <cinttypes>
 #include <cstdio>
@@ -1118,13 +1120,22 @@ int32_t OsSyscallExceptionHandler::write_io(int fd, const QVector<uint8_t> &data
         count = data.size();
     if (fd == FD_UNUSED) {
         return -1;
-    } else if (fd == FD_TERMINAL) {
+    }
+    int32_t result;
+    if (io_journal != nullptr && io_journal->replay(IoJournal::OP_HOST_WRITE, result)) {
+        return result; // Written by the original execution
+    }
+    if (fd == FD_TERMINAL) {
         for (uint32_t i = 0; i < count; i++)
             emit char_written(fd, data[i]);
     } else {
         count = write(fd, data.data(), count);
     }
-    return result_errno_if_error(count);
+    result = result_errno_if_error(count);
+    if (io_journal != nullptr) {
+        io_journal->record(IoJournal::OP_HOST_WRITE, result);
+    }
+    return result;
 }
 
 int32_t OsSyscallExceptionHandler::read_io(
@@ -1137,7 +1148,17 @@ int32_t OsSyscallExceptionHandler::read_io(
         count = data.size();
     if (fd == FD_UNUSED) {
         return -1;
-    } else if (fd == FD_TERMINAL) {
+    }
+    int32_t result;
+    QByteArray journaled;
+    if (io_journal != nullptr
+        && io_journal->replay(IoJournal::OP_HOST_READ, result, &journaled)) {
+        // Input has been consumed by the original execution
+        data.resize(journaled.size());
+        std::copy(journaled.constData(), journaled.constData() + journaled.size(), data.begin());
+        return result;
+    }
+    if (fd == FD_TERMINAL) {
         for (uint32_t i = 0; i < count; i++) {
             unsigned int byte;
             bool available = false;
@@ -1156,7 +1177,58 @@ int32_t OsSyscallExceptionHandler::read_io(
     }
     if ((int32_t)count >= 0)
         data.resize(count);
-    return result_errno_if_error(count);
+    result = result_errno_if_error(count);
+    if (io_journal != nullptr) {
+        io_journal->record(
+            IoJournal::OP_HOST_READ, result,
+            QByteArray((const char *)data.data(), (int)data.size()));
+    }
+    return result;
+}
+
+void OsSyscallExceptionHandler::save_state(QDataStream &out) const {
+    out << (quint32)brk_limit << (quint32)anonymous_base << (quint32)anonymous_last;
+    out << (quint32)fd_mapping.size();
+    for (int fd : fd_mapping) {
+        out << (qint32)fd;
+    }
+}
+
+void OsSyscallExceptionHandler::load_state(QDataStream &in) {
+    quint32 brk, base, last, count;
+    in >> brk >> base >> last >> count;
+    brk_limit = brk;
+    anonymous_base = base;
+    anonymous_last = last;
+    QVector<int> loaded(count);
+    for (int &fd : loaded) {
+        qint32 val;
+        in >> val;
+        fd = val;
+    }
+    if (io_journal != nullptr && io_journal->replaying()) {
+        // Execution history returns to the past, journaled operations keep
+        // host files as they are at the end of the journal
+        fd_mapping = loaded;
+        return;
+    }
+    for (int &fd : loaded) {
+        // Only host files still open by this handler can be used
+        if (fd >= 0 && !fd_mapping.contains(fd)) {
+            fd = FD_INVALID;
+        }
+    }
+    for (int fd : fd_mapping) {
+        if (fd >= 0 && !loaded.contains(fd)) {
+            close(fd);
+        }
+    }
+    fd_mapping = loaded;
+}
+
+bool OsSyscallExceptionHandler::set_io_journal(IoJournal *journal) {
+    io_journal = journal;
+    return true;
 }
 
 int OsSyscallExceptionHandler::allocate_fd(int val) {
@@ -1194,11 +1266,19 @@ int OsSyscallExceptionHandler::file_open(QString fname, int flags, int mode) {
 
     fname = filepath_to_host(fname);
 
-    fd = open(fname.toLatin1().data(), hostflags, OPEN_MODE);
+    if (io_journal == nullptr || !io_journal->replay(IoJournal::OP_HOST_OPEN, fd)) {
+        fd = open(fname.toLatin1().data(), hostflags, OPEN_MODE);
+        if (fd < 0) {
+            fd = result_errno_if_error(fd);
+        }
+        if (io_journal != nullptr) {
+            io_journal->record(IoJournal::OP_HOST_OPEN, fd);
+        }
+    }
     if (fd >= 0) {
         targetfd = allocate_fd(fd);
     } else {
-        targetfd = result_errno_if_error(fd);
+        targetfd = fd;
     }
     return targetfd;
 }
@@ -1644,7 +1724,13 @@ int OsSyscallExceptionHandler::do_sys_close(
         return 0;
     }
 
-    close(fd);
+    int32_t closed;
+    if (io_journal == nullptr || !io_journal->replay(IoJournal::OP_HOST_CLOSE, closed)) {
+        close(fd);
+        if (io_journal != nullptr) {
+            io_journal->record(IoJournal::OP_HOST_CLOSE, 0);
+        }
+    }
     close_fd(targetfd);
 
     return status_from_result(result);
@@ -1686,7 +1772,15 @@ int OsSyscallExceptionHandler::do_sys_ftruncate(
         return 0;
     }
 
-    result = result_errno_if_error(ftruncate(fd, length));
+    int32_t truncated;
+    if (io_journal != nullptr && io_journal->replay(IoJournal::OP_HOST_TRUNCATE, truncated)) {
+        result = truncated;
+    } else {
+        result = result_errno_if_error(ftruncate(fd, length));
+        if (io_journal != nullptr) {
+            io_journal->record(IoJournal::OP_HOST_TRUNCATE, result);
+        }
+    }
 
     return status_from_result(result);
 }
@@ -72,6 +72,20 @@ public:
         machine::Address jump_branch_pc,
         bool in_delay_slot,
         machine::Address mem_ref_addr) override;
+    /**
+     * Program break, anonymous mappings and target file descriptors are
+     * stored. Host files which are not open anymore (e.g. state from other
+     * process) cannot be reopened, their descriptors are restored as invalid
+     * and the program gets EBADF when it uses them.
+     */
+    void save_state(QDataStream &out) const override;
+    void load_state(QDataStream &in) override;
+    /**
+     * Host file and terminal operations are journaled, their results are
+     * reused and their effects suppressed when the execution history
+     * executes them again.
+     */
+    bool set_io_journal(machine::IoJournal *journal) override;
     OSSYCALL_HANDLER_DECLARE(syscall_default_handler);
     OSSYCALL_HANDLER_DECLARE(do_sys_exit);
     OSSYCALL_HANDLER_DECLARE(do_sys_set_thread_area);
@@ -132,6 +146,7 @@ private:
     bool known_syscall_stop;
     bool unknown_syscall_stop;
     QString fs_root;
+    machine::IoJournal *io_journal = nullptr;
 };
 
 #undef OSSYCALL_HANDLER_DECLARE